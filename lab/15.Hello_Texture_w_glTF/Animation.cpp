@@ -0,0 +1,415 @@
+#include "Animation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "ThreadPool.h"
+
+namespace {
+  // 한 worker가 한 번에 가져가는 instance 수 (instance 하나는 금방 끝나므로 묶어서 나눈다)
+  const size_t INSTANCE_BATCH = 64;
+
+  void normalize_quat(float* q)
+  {
+    const float len = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    if (len > 0.0f)
+    {
+      for (int c = 0; c < 4; ++c)
+        q[c] /= len;
+    }
+  }
+
+  // 짧은 쪽으로 도는 slerp. 두 회전이 거의 같으면 선형 보간 후 정규화한다.
+  void slerp(const float* a, const float* b, float s, float* out)
+  {
+    float d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    const float sign = (d < 0.0f) ? -1.0f : 1.0f;
+    d *= sign;
+
+    float wa = 1.0f - s, wb = s;
+    if (d < 0.9995f)
+    {
+      const float theta = std::acos(d);
+      const float sin_theta = std::sin(theta);
+      wa = std::sin((1.0f - s) * theta) / sin_theta;
+      wb = std::sin(s * theta) / sin_theta;
+    }
+    for (int c = 0; c < 4; ++c)
+      out[c] = wa * a[c] + sign * wb * b[c];
+    normalize_quat(out);
+  }
+
+  // 지난 위치 k에서 time의 구간까지 앞으로 간다. time이 k보다 앞이면(되감기) 처음부터 다시 찾는다.
+  size_t advance_key(const AnimationChannel& channel, float time, size_t k)
+  {
+    const size_t last = channel.times.size() - 1;
+    if (k > last || time < channel.times[k])
+      k = 0;
+    while (k < last && time >= channel.times[k + 1])
+      ++k;
+    return k;
+  }
+
+  float* pose_target(const AnimationChannel& channel, AnimationPose* pose, int* count)
+  {
+    const size_t node = size_t(channel.node);
+    switch (channel.path)
+    {
+    case ANIMATION_TRANSLATION: *count = 3; return &pose->translations[node * 3];
+    case ANIMATION_ROTATION:    *count = 4; return &pose->rotations[node * 4];
+    case ANIMATION_SCALE:       *count = 3; return &pose->scales[node * 3];
+    case ANIMATION_WEIGHTS:
+      *count = std::min(channel.components, pose->weight_counts[node]);
+      return pose->weights.data() + pose->weight_offsets[node];
+    }
+    *count = 0;
+    return nullptr;
+  }
+
+  // 구간 k에서 channel을 계산해 out에 count개를 쓴다.
+  void sample_channel(const AnimationChannel& channel, size_t k, float time, float* out, int count)
+  {
+    const int n = channel.components;
+    const bool cubic = channel.interpolation == ANIMATION_CUBICSPLINE;
+    const size_t key_stride = cubic ? 3 * n : n;
+    const float* v0 = channel.values.data() + k * key_stride + (cubic ? n : 0);
+
+    const float t0 = channel.times[k];
+    if (k + 1 >= channel.times.size() || time <= t0 || channel.interpolation == ANIMATION_STEP)
+    {
+      std::copy(v0, v0 + count, out);
+      return;
+    }
+
+    const float t1 = channel.times[k + 1];
+    const float s = std::min((time - t0) / (t1 - t0), 1.0f);
+    const float* v1 = v0 + key_stride;
+
+    if (channel.interpolation == ANIMATION_LINEAR)
+    {
+      if (channel.path == ANIMATION_ROTATION)
+        slerp(v0, v1, s, out);
+      else
+      {
+        for (int c = 0; c < count; ++c)
+          out[c] = v0[c] + (v1[c] - v0[c]) * s;
+      }
+      return;
+    }
+
+    // Hermite: v0의 out-tangent(b0)와 v1의 in-tangent(a1)는 구간 길이를 곱해서 쓴다.
+    const float* b0 = v0 + n;
+    const float* a1 = v1 - n;
+    const float dt = t1 - t0;
+    const float s2 = s * s, s3 = s2 * s;
+    const float h00 = 2.0f * s3 - 3.0f * s2 + 1.0f;
+    const float h10 = (s3 - 2.0f * s2 + s) * dt;
+    const float h01 = -2.0f * s3 + 3.0f * s2;
+    const float h11 = (s3 - s2) * dt;
+    for (int c = 0; c < count; ++c)
+      out[c] = h00 * v0[c] + h10 * b0[c] + h01 * v1[c] + h11 * a1[c];
+    if (channel.path == ANIMATION_ROTATION)
+      normalize_quat(out);
+  }
+
+  // bufferView의 byte_offset부터 stride 간격으로 원소 count개(원소마다 n개 성분)를 float로 읽는다.
+  bool read_view_floats(const tinygltf::Model& model, int view_index, size_t byte_offset, size_t stride, size_t count,
+    int n, int component_type, bool norm, float* out)
+  {
+    const int component_bytes = tinygltf::GetComponentSizeInBytes(uint32_t(component_type));
+    if (view_index < 0 || size_t(view_index) >= model.bufferViews.size() || component_bytes <= 0)
+      return false;
+    const tinygltf::BufferView& view = model.bufferViews[view_index];
+    if (view.buffer < 0 || size_t(view.buffer) >= model.buffers.size())
+      return false;
+    const std::vector<unsigned char>& data = model.buffers[view.buffer].data;
+    const size_t begin = view.byteOffset + byte_offset;
+    if (count > 0 && begin + (count - 1) * stride + n * component_bytes > data.size())
+      return false;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      const unsigned char* p = data.data() + begin + i * stride;
+      float* v = out + i * n;
+      for (int c = 0; c < n; ++c)
+      {
+        switch (component_type)
+        {
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
+          { int8_t x; std::memcpy(&x, p + c, 1); v[c] = norm ? std::max(x / 127.0f, -1.0f) : x; } break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+          v[c] = norm ? p[c] / 255.0f : p[c]; break;
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
+          { int16_t x; std::memcpy(&x, p + 2 * c, 2); v[c] = norm ? std::max(x / 32767.0f, -1.0f) : x; } break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+          { uint16_t x; std::memcpy(&x, p + 2 * c, 2); v[c] = norm ? x / 65535.0f : x; } break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+          { uint32_t x; std::memcpy(&x, p + 4 * c, 4); v[c] = float(x); } break;
+        case TINYGLTF_COMPONENT_TYPE_FLOAT:
+          std::memcpy(&v[c], p + 4 * c, 4); break;
+        default:
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+}
+
+bool read_accessor_floats(const tinygltf::Model& model, const tinygltf::Accessor& accessor, std::vector<float>* out)
+{
+  const int n = tinygltf::GetTypeSizeInBytes(uint32_t(accessor.type));
+  if (n <= 0)
+    return false;
+
+  // bufferView가 없는 sparse accessor는 0에서 시작한다.
+  if (accessor.bufferView < 0)
+  {
+    if (!accessor.sparse.isSparse)
+      return false;
+    out->assign(accessor.count * n, 0.0f);
+  }
+  else
+  {
+    if (size_t(accessor.bufferView) >= model.bufferViews.size())
+      return false;
+    out->resize(accessor.count * n);
+    const int stride = accessor.ByteStride(model.bufferViews[accessor.bufferView]);
+    if (stride <= 0 || !read_view_floats(model, accessor.bufferView, accessor.byteOffset, size_t(stride),
+      accessor.count, n, accessor.componentType, accessor.normalized, out->data()))
+      return false;
+  }
+  if (!accessor.sparse.isSparse)
+    return true;
+
+  std::vector<uint32_t> indices;
+  std::vector<float> values;
+  if (!read_sparse_accessor(model, accessor, &indices, &values))
+    return false;
+  for (size_t i = 0; i < indices.size(); ++i)
+    std::copy(values.begin() + i * n, values.begin() + (i + 1) * n, out->begin() + size_t(indices[i]) * n);
+  return true;
+}
+
+bool read_sparse_accessor(const tinygltf::Model& model, const tinygltf::Accessor& accessor,
+  std::vector<uint32_t>* indices, std::vector<float>* values)
+{
+  const int n = tinygltf::GetTypeSizeInBytes(uint32_t(accessor.type));
+  const int component_bytes = tinygltf::GetComponentSizeInBytes(uint32_t(accessor.componentType));
+  if (!accessor.sparse.isSparse || accessor.sparse.count < 0 || n <= 0 || component_bytes <= 0)
+    return false;
+  const size_t count = size_t(accessor.sparse.count);
+
+  // 값은 빈틈 없이 이어져 있다.
+  values->resize(count * n);
+  if (!read_view_floats(model, accessor.sparse.values.bufferView, size_t(accessor.sparse.values.byteOffset),
+    size_t(n) * component_bytes, count, n, accessor.componentType, accessor.normalized, values->data()))
+    return false;
+
+  // 인덱스는 부호 없는 정수 (float로 읽으면 2^24 넘는 인덱스가 틀어지므로 따로 읽는다)
+  const int index_type = accessor.sparse.indices.componentType;
+  const int index_bytes = tinygltf::GetComponentSizeInBytes(uint32_t(index_type));
+  const int index_view = accessor.sparse.indices.bufferView;
+  if ((index_type != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE && index_type != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT &&
+    index_type != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) || index_view < 0 ||
+    size_t(index_view) >= model.bufferViews.size())
+    return false;
+  const tinygltf::BufferView& view = model.bufferViews[index_view];
+  if (view.buffer < 0 || size_t(view.buffer) >= model.buffers.size())
+    return false;
+  const std::vector<unsigned char>& data = model.buffers[view.buffer].data;
+  const size_t begin = view.byteOffset + size_t(accessor.sparse.indices.byteOffset);
+  if (begin + count * index_bytes > data.size())
+    return false;
+
+  indices->resize(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    const unsigned char* p = data.data() + begin + i * index_bytes;
+    uint32_t index = p[0];
+    if (index_bytes == 2)
+    {
+      uint16_t x;
+      std::memcpy(&x, p, 2);
+      index = x;
+    }
+    else if (index_bytes == 4)
+      std::memcpy(&index, p, 4);
+    if (index >= accessor.count)
+      return false;
+    (*indices)[i] = index;
+  }
+  return true;
+}
+
+size_t AnimationClip::num_keys() const
+{
+  size_t keys = 0;
+  for (const AnimationChannel& channel : channels)
+    keys += channel.times.size();
+  return keys;
+}
+
+bool build_animation_clips(const tinygltf::Model& model, std::vector<AnimationClip>* clips, std::string* err)
+{
+  size_t skipped = 0;
+  clips->clear();
+  for (const tinygltf::Animation& animation : model.animations)
+  {
+    clips->push_back(AnimationClip());
+    AnimationClip& clip = clips->back();
+    clip.name = animation.name;
+
+    for (const tinygltf::AnimationChannel& source : animation.channels)
+    {
+      AnimationChannel channel;
+      channel.node = source.target_node;
+
+      bool ok = source.target_node >= 0 && size_t(source.target_node) < model.nodes.size() &&
+        source.sampler >= 0 && size_t(source.sampler) < animation.samplers.size();
+      if (source.target_path == "translation")
+        channel.path = ANIMATION_TRANSLATION;
+      else if (source.target_path == "rotation")
+        channel.path = ANIMATION_ROTATION;
+      else if (source.target_path == "scale")
+        channel.path = ANIMATION_SCALE;
+      else if (source.target_path == "weights")
+        channel.path = ANIMATION_WEIGHTS;
+      else
+        ok = false;
+
+      if (ok)
+      {
+        const tinygltf::AnimationSampler& sampler = animation.samplers[source.sampler];
+        if (sampler.interpolation == "STEP")
+          channel.interpolation = ANIMATION_STEP;
+        else if (sampler.interpolation == "CUBICSPLINE")
+          channel.interpolation = ANIMATION_CUBICSPLINE;
+
+        ok = sampler.input >= 0 && size_t(sampler.input) < model.accessors.size() &&
+          sampler.output >= 0 && size_t(sampler.output) < model.accessors.size() &&
+          model.accessors[sampler.input].type == TINYGLTF_TYPE_SCALAR &&
+          read_accessor_floats(model, model.accessors[sampler.input], &channel.times) &&
+          read_accessor_floats(model, model.accessors[sampler.output], &channel.values);
+      }
+
+      // key 하나의 값 개수: weights는 output 크기에서 거꾸로 구한다.
+      const size_t keys = channel.times.size();
+      const size_t per_key = (channel.interpolation == ANIMATION_CUBICSPLINE) ? 3 : 1;
+      if (ok && keys > 0)
+      {
+        if (channel.path == ANIMATION_WEIGHTS)
+          channel.components = int(channel.values.size() / (keys * per_key));
+        else
+          channel.components = (channel.path == ANIMATION_ROTATION) ? 4 : 3;
+        ok = channel.components > 0 && channel.values.size() == keys * per_key * channel.components &&
+          std::is_sorted(channel.times.begin(), channel.times.end());
+      }
+
+      if (!ok || keys == 0)
+      {
+        ++skipped;
+        continue;
+      }
+
+      clip.start = clip.channels.empty() ? channel.times.front() : std::min(clip.start, channel.times.front());
+      clip.end = clip.channels.empty() ? channel.times.back() : std::max(clip.end, channel.times.back());
+      clip.channels.push_back(std::move(channel));
+    }
+  }
+
+  if (skipped > 0 && err)
+    *err = std::to_string(skipped) + " animation channels could not be read";
+  return skipped == 0;
+}
+
+void init_animation_pose(const tinygltf::Model& model, AnimationPose* pose)
+{
+  const size_t num_nodes = model.nodes.size();
+  pose->translations.assign(num_nodes * 3, 0.0f);
+  pose->rotations.assign(num_nodes * 4, 0.0f);
+  pose->scales.assign(num_nodes * 3, 1.0f);
+  pose->is_matrix.assign(num_nodes, 0);
+  pose->weights.clear();
+  pose->weight_offsets.assign(num_nodes, 0);
+  pose->weight_counts.assign(num_nodes, 0);
+
+  for (size_t i = 0; i < num_nodes; ++i)
+  {
+    const tinygltf::Node& node = model.nodes[i];
+    pose->rotations[i * 4 + 3] = 1.0f;
+    for (size_t c = 0; c < node.translation.size() && c < 3; ++c)
+      pose->translations[i * 3 + c] = float(node.translation[c]);
+    for (size_t c = 0; c < node.rotation.size() && c < 4; ++c)
+      pose->rotations[i * 4 + c] = float(node.rotation[c]);
+    for (size_t c = 0; c < node.scale.size() && c < 3; ++c)
+      pose->scales[i * 3 + c] = float(node.scale[c]);
+    pose->is_matrix[i] = node.matrix.size() == 16;
+
+    // morph weight: node에 없으면 mesh의 기본값, 그것도 없으면 target 수만큼 0
+    if (node.mesh < 0 || size_t(node.mesh) >= model.meshes.size())
+      continue;
+    const tinygltf::Mesh& mesh = model.meshes[node.mesh];
+    const std::vector<double>& defaults = !node.weights.empty() ? node.weights : mesh.weights;
+    size_t count = defaults.size();
+    for (const tinygltf::Primitive& primitive : mesh.primitives)
+      count = std::max(count, primitive.targets.size());
+
+    pose->weight_offsets[i] = pose->weights.size();
+    pose->weight_counts[i] = int(count);
+    for (size_t w = 0; w < count; ++w)
+      pose->weights.push_back(w < defaults.size() ? float(defaults[w]) : 0.0f);
+  }
+}
+
+float wrap_animation_time(const AnimationClip& clip, float time)
+{
+  const float length = clip.end - clip.start;
+  if (length <= 0.0f)
+    return clip.start;
+  float t = std::fmod(time - clip.start, length);
+  if (t < 0.0f)
+    t += length;
+  return clip.start + t;
+}
+
+size_t find_animation_key(const AnimationChannel& channel, float time)
+{
+  std::vector<float>::const_iterator it = std::upper_bound(channel.times.begin(), channel.times.end(), time);
+  return (it == channel.times.begin()) ? 0 : size_t(it - channel.times.begin()) - 1;
+}
+
+void sample_animation(const AnimationClip& clip, float time, std::vector<uint32_t>* cursors, AnimationPose* pose)
+{
+  if (cursors && cursors->size() != clip.channels.size())
+    cursors->assign(clip.channels.size(), 0);
+
+  for (size_t i = 0; i < clip.channels.size(); ++i)
+  {
+    const AnimationChannel& channel = clip.channels[i];
+    size_t k;
+    if (cursors)
+    {
+      k = advance_key(channel, time, (*cursors)[i]);
+      (*cursors)[i] = uint32_t(k);
+    }
+    else
+      k = find_animation_key(channel, time);
+
+    int count = 0;
+    float* out = pose_target(channel, pose, &count);
+    if (out && count > 0)
+      sample_channel(channel, k, time, out, count);
+  }
+}
+
+void sample_animation_instances(const AnimationClip& clip, std::vector<AnimationInstance>& instances, ThreadPool& pool)
+{
+  const size_t batches = (instances.size() + INSTANCE_BATCH - 1) / INSTANCE_BATCH;
+  pool.parallel_for(batches, [&clip, &instances](size_t b) {
+    const size_t end = std::min(instances.size(), (b + 1) * INSTANCE_BATCH);
+    for (size_t i = b * INSTANCE_BATCH; i < end; ++i)
+      sample_animation(clip, instances[i].time, &instances[i].cursors, &instances[i].pose);
+  });
+}
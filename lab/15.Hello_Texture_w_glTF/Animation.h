@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../glTF/tiny_gltf.h"
+
+class ThreadPool;
+
+// glTF animation 재생.
+//
+// 로딩 후에 sampler의 input/output accessor를 channel마다 float 배열 두 개(key 시각, key 값)로 풀어 둔다. (SoA)
+// 샘플링은 channel마다 지난 프레임의 key 위치(cursor)에서 앞으로 몇 칸만 움직이므로 재생 중에는 이진 탐색을 하지 않는다.
+// 결과는 node 인덱스별 TRS 배열(AnimationPose)에 쓰고, 그리는 쪽이 그것으로 node 행렬을 만든다.
+// OpenGL 호출은 하지 않는다.
+
+enum AnimationPath
+{
+  ANIMATION_TRANSLATION,
+  ANIMATION_ROTATION,
+  ANIMATION_SCALE,
+  ANIMATION_WEIGHTS,
+};
+
+enum AnimationInterpolation
+{
+  ANIMATION_LINEAR,       // rotation은 slerp
+  ANIMATION_STEP,
+  ANIMATION_CUBICSPLINE,  // key마다 in-tangent, 값, out-tangent
+};
+
+// sampler 하나를 풀어 둔 channel
+struct AnimationChannel
+{
+  int node = -1;
+  AnimationPath path = ANIMATION_TRANSLATION;
+  AnimationInterpolation interpolation = ANIMATION_LINEAR;
+  int components = 0;           // key 하나의 값 개수 (translation/scale 3, rotation 4, weights는 morph target 수)
+  std::vector<float> times;     // 오름차순 key 시각 (초)
+  std::vector<float> values;    // key * components (CUBICSPLINE은 key * 3 * components)
+};
+
+struct AnimationClip
+{
+  std::string name;
+  float start = 0.0f;           // 가장 이른 key 시각
+  float end = 0.0f;             // 가장 늦은 key 시각
+  std::vector<AnimationChannel> channels;
+
+  size_t num_keys() const;
+};
+
+// node 인덱스별 TRS와 morph weight. animation이 없는 node는 glTF의 값 그대로 둔다.
+// (matrix로 변환을 준 node는 animation의 대상이 될 수 없으므로 is_matrix인 node의 TRS는 쓰지 않는다)
+struct AnimationPose
+{
+  std::vector<float> translations;      // node * 3
+  std::vector<float> rotations;         // node * 4 (x, y, z, w)
+  std::vector<float> scales;            // node * 3
+  std::vector<unsigned char> is_matrix; // node.matrix를 쓰는 node
+  std::vector<float> weights;           // node마다 weight_offsets[node]에서 weight_counts[node]개
+  std::vector<size_t> weight_offsets;
+  std::vector<int> weight_counts;
+};
+
+// 같은 clip을 재생하는 instance 하나의 상태
+struct AnimationInstance
+{
+  float time = 0.0f;
+  std::vector<uint32_t> cursors;        // channel별 지난 key 위치
+  AnimationPose pose;
+};
+
+// accessor를 float 배열로 읽는다. (원소마다 type의 성분 수만큼, normalized 정수는 [-1, 1] 또는 [0, 1]로)
+// sparse accessor는 bufferView의 값(없으면 0)에 sparse 값을 덮어쓴다. 범위를 벗어나는 accessor는 false
+bool read_accessor_floats(const tinygltf::Model& model, const tinygltf::Accessor& accessor, std::vector<float>* out);
+
+// sparse accessor의 sparse 부분만 읽는다: 원소 인덱스와 그 값 (values는 indices.size() * 성분 수)
+bool read_sparse_accessor(const tinygltf::Model& model, const tinygltf::Accessor& accessor,
+  std::vector<uint32_t>* indices, std::vector<float>* values);
+
+// model.animations를 clip으로 푼다. 읽을 수 없는 channel(범위를 벗어난 accessor 등)은 빼고 false와 함께 err에 적는다.
+bool build_animation_clips(const tinygltf::Model& model, std::vector<AnimationClip>* clips, std::string* err);
+
+// node의 translation/rotation/scale/weights (없으면 기본값)로 pose를 채운다.
+void init_animation_pose(const tinygltf::Model& model, AnimationPose* pose);
+
+// time을 [start, end] 안으로 되감는다. (반복 재생)
+float wrap_animation_time(const AnimationClip& clip, float time);
+
+// time에서 clip을 샘플링해 pose에 쓴다. clip 범위 밖은 처음/마지막 key 값이다.
+// cursors가 nullptr이면 channel마다 이진 탐색을 한다. (cursor 없이 한 번 찾을 때와 검증용)
+void sample_animation(const AnimationClip& clip, float time, std::vector<uint32_t>* cursors, AnimationPose* pose);
+
+// time이 들어 있는 구간 [times[k], times[k + 1])의 k (처음보다 이르면 0, 끝 이후면 마지막 key)
+size_t find_animation_key(const AnimationChannel& channel, float time);
+
+// instances[i].time으로 각 instance의 pose를 샘플링한다. pool의 worker들이 instance를 묶음으로 나눠 가진다.
+void sample_animation_instances(const AnimationClip& clip, std::vector<AnimationInstance>& instances, ThreadPool& pool);
@@ -0,0 +1,447 @@
+#include "AsyncLoader.h"
+#include "ThreadPool.h"
+#include "ImageDecoder.h"
+#include "SceneCache.h"
+#include "GltfSaxParser.h"
+#include "DracoDecoder.h"
+#include "Hash.h"
+#include "KtxTexture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// tinygltf::Model은 소멸자가 선언되어 있어 move가 복사로 바뀐다.
+// 이미지/버퍼 데이터를 복사하지 않도록 멤버별로 swap한다.
+static void swap_model(tinygltf::Model& a, tinygltf::Model& b)
+{
+  a.accessors.swap(b.accessors);
+  a.animations.swap(b.animations);
+  a.buffers.swap(b.buffers);
+  a.bufferViews.swap(b.bufferViews);
+  a.materials.swap(b.materials);
+  a.meshes.swap(b.meshes);
+  a.nodes.swap(b.nodes);
+  a.textures.swap(b.textures);
+  a.images.swap(b.images);
+  a.skins.swap(b.skins);
+  a.samplers.swap(b.samplers);
+  a.cameras.swap(b.cameras);
+  a.scenes.swap(b.scenes);
+  a.lights.swap(b.lights);
+  a.extensions.swap(b.extensions);
+  std::swap(a.defaultScene, b.defaultScene);
+  a.extensionsUsed.swap(b.extensionsUsed);
+  a.extensionsRequired.swap(b.extensionsRequired);
+  std::swap(a.asset, b.asset);
+  std::swap(a.extras, b.extras);
+}
+
+AsyncLoader::AsyncLoader(ThreadPool& pool)
+  : pool_(pool), parsed_(false), failed_(false), handed_over_(false), decoding_started_(false),
+    use_sax_parser_(false), compression_(TEXTURE_COMPRESSION_NONE), supported_codecs_(0),
+    mip_filter_(MIP_FILTER_NONE), packing_(false), from_cache_(false), model_(nullptr), cache_num_buffers_(0),
+    pending_images_(0), running_jobs_(0)
+{
+}
+
+AsyncLoader::~AsyncLoader()
+{
+  if (parse_thread_.joinable())
+    parse_thread_.join();
+
+  // 디코딩 작업이 넘겨받은 model과 this를 참조하므로 끝날 때까지 기다린다.
+  // (다른 로더가 같은 풀에 넣은 작업은 기다리지 않는다.)
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this] { return running_jobs_ == 0; });
+}
+
+void AsyncLoader::start(const std::string& filename)
+{
+  parse_thread_ = std::thread(&AsyncLoader::parse, this, filename);
+}
+
+void AsyncLoader::parse(const std::string filename)
+{
+  filename_ = filename;
+  if (load_scene_cache(parsed_model_, filename))
+  {
+    std::cout << "Loaded glTF (cache): " << scene_cache_path(filename) << std::endl;
+    from_cache_ = true;
+    hash_images();
+    parsed_ = true;
+    return;
+  }
+
+  std::string err;
+  std::string warn;
+  bool res;
+
+  if (use_sax_parser_)
+  {
+    res = load_gltf_sax(&parsed_model_, &err, &warn, filename, record_encoded_image, nullptr);
+  }
+  else
+  {
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(record_encoded_image, nullptr);
+    res = loader.LoadASCIIFromFile(&parsed_model_, &err, &warn, filename);
+  }
+  // Draco로 압축된 geometry는 여기서 풀어 두므로 scene cache에도 디코딩된 상태로 저장된다.
+  if (res && has_draco_primitives(parsed_model_))
+  {
+    res = decode_draco_primitives(parsed_model_, pool_, &err);
+  }
+  if (!warn.empty())
+  {
+    std::cout << "WARNING: " << warn << std::endl;
+  }
+
+  if (!err.empty())
+  {
+    std::cout << "ERROR: " << err << std::endl;
+  }
+
+  if (!res)
+  {
+    std::cout << "Failed to load glTF: " << filename << std::endl;
+    failed_ = true;
+  }
+  else
+  {
+    std::cout << "Loaded glTF: " << filename << std::endl;
+    hash_images();
+    // 캐시에 기록할 의존 파일은 읽은 내용과 맞도록 저장할 때가 아니라 지금 해시한다.
+    hash_scene_dependencies(parsed_model_, filename, &cache_dependencies_);
+    // 넘겨준 뒤에는 렌더링 스레드가 model을 고치므로 캐시에 저장할 사본을 지금 떼어 둔다.
+    // buffer와 이미지는 디코딩이 끝난 뒤 model_의 것을 저장하므로 빼고 작은 표들만 복사한다.
+    std::vector<tinygltf::Buffer> buffers;
+    std::vector<tinygltf::Image> images;
+    buffers.swap(parsed_model_.buffers);
+    images.swap(parsed_model_.images);
+    cache_model_ = parsed_model_;
+    cache_num_buffers_ = buffers.size();
+    parsed_model_.buffers.swap(buffers);
+    parsed_model_.images.swap(images);
+  }
+
+  parsed_ = true;
+}
+
+// 캐시에서 읽은 이미지는 디코딩된 픽셀, 그 밖에는 인코딩된 바이트의 해시이다.
+void AsyncLoader::hash_images()
+{
+  const std::vector<tinygltf::Image>& images = parsed_model_.images;
+  image_hashes_.assign(images.size(), 0);
+
+  pool_.parallel_for(images.size(), [&](size_t i) {
+    const tinygltf::Image& image = images[i];
+    // 인코딩된 채로 있는 이미지의 bits는 tinygltf가 초기화하지 않으므로 넣지 않는다.
+    const int header[5] = { image.width, image.height, image.component, image.as_is ? 0 : image.bits, image.as_is ? 1 : 0 };
+    image_hashes_[i] = hash_combine(hash64(header, sizeof(header)),
+      hash64(image.image.data(), image.image.size()));
+  });
+}
+
+bool AsyncLoader::poll_model(tinygltf::Model& model)
+{
+  if (handed_over_ || !parsed_ || failed_)
+    return false;
+
+  parse_thread_.join();
+  handed_over_ = true;
+
+  swap_model(model, parsed_model_);
+  model_ = &model;
+
+  // 줄인 이미지는 내용이 달라지므로 읽는 채널과 합친 occlusion 이미지를 해시에 넣는다.
+  // (같은 이미지라도 다른 모델에서 다르게 읽으면 텍스처를 같이 쓰지 않음)
+  if (packing_)
+  {
+    plan_texture_packing(model, &pack_plan_);
+    const std::vector<uint64_t> hashes = image_hashes_;
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+      if (!pack_plan_.packable(int(i)))
+        continue;
+      const int occlusion = pack_plan_.occlusion[i];
+      const uint64_t pack_key[2] = { pack_plan_.usage[i], occlusion >= 0 ? hashes[occlusion] : 0 };
+      image_hashes_[i] = hash_combine(hashes[i], hash64(pack_key, sizeof(pack_key)));
+    }
+  }
+
+  return true;
+}
+
+void AsyncLoader::start_decoding(const std::vector<bool>& needed)
+{
+  std::vector<tinygltf::Image>& images = model_->images;
+
+  // 내용 해시가 같은 이미지는 처음 것만 디코딩한다.
+  std::vector<size_t> jobs;
+  std::vector<uint64_t> seen;
+  for (size_t i = 0; i < images.size(); ++i)
+  {
+    if (!needed[i] || std::find(seen.begin(), seen.end(), image_hashes_[i]) != seen.end())
+      continue;
+    seen.push_back(image_hashes_[i]);
+    jobs.push_back(i);
+  }
+
+  compressed_.assign(images.size(), CompressedTexture());
+  srgb_images_ = srgb_images(*model_);
+  mips_.assign(images.size(), std::vector<MipLevel>());
+  mip_ms_.assign(images.size(), 0.0);
+  packed_.assign(images.size(), tinygltf::Image());
+
+  // 합칠 occlusion 이미지는 자기 디코딩 작업이 model_에서 고치고 있을 수 있으므로 작업을 넣기 전에 사본을 떠 둔다.
+  occlusion_sources_.assign(images.size(), tinygltf::Image());
+  for (size_t i : jobs)
+  {
+    const int o = packing_ && pack_plan_.packable(int(i)) ? pack_plan_.occlusion[i] : -1;
+    if (o >= 0 && occlusion_sources_[o].image.empty())
+      occlusion_sources_[o] = images[o];
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_images_ = jobs.size();
+    running_jobs_ = std::max<size_t>(jobs.size(), 1);
+    decoding_started_ = true;
+  }
+
+  if (jobs.empty())
+    pool_.enqueue([this] { on_image_decoded(-1); });
+
+  for (size_t i : jobs)
+  {
+    tinygltf::Image* image = &images[i];
+    int image_index = static_cast<int>(i);
+    // CPU에서 만든 mip chain을 압축한 결과는 필터와 sRGB 여부에 따라 다르므로 캐시 키에 넣는다.
+    uint64_t hash = image_hashes_[i];
+    if (mip_filter_ != MIP_FILTER_NONE)
+    {
+      const uint32_t mip_key[2] = { uint32_t(mip_filter_), srgb_images_[i] ? 1u : 0u };
+      hash = hash_combine(hash, hash64(mip_key, sizeof(mip_key)));
+    }
+    pool_.enqueue([this, image, image_index, hash] {
+      CompressedTexture* compressed = &compressed_[image_index];
+      std::string err;
+
+      // KTX2는 이미 GPU 형식이므로 압축하지 않는다. (픽셀로 풀린 것은 mip chain만 만든다)
+      if (image->as_is && is_ktx2(image->image.data(), image->image.size()))
+      {
+        if (!decode_ktx2_image(*image, supported_codecs_, compressed, &err))
+          std::cout << "ERROR: " << err << std::endl;
+        else if (compressed->levels.empty())
+          generate_mips(image_index);
+        on_image_decoded(image_index);
+        return;
+      }
+
+      if (compression_ != TEXTURE_COMPRESSION_NONE && load_compressed_texture(hash, compression_, compressed))
+      {
+        on_image_decoded(image_index);
+        return;
+      }
+
+      if (!decode_image(*image, image_index, &err))
+      {
+        std::cout << "ERROR: " << err << std::endl;
+      }
+      else
+      {
+        const tinygltf::Image& pixels = pack_image(image_index) ? packed_[image_index] : *image;
+        generate_mips(image_index);
+        if (compression_ != TEXTURE_COMPRESSION_NONE &&
+          compress_texture(pixels, compression_, compressed, mips_[image_index].empty() ? nullptr : &mips_[image_index]))
+        {
+          save_compressed_texture(hash, compression_, *compressed);
+          std::vector<MipLevel>().swap(mips_[image_index]);     // 압축한 것을 올리므로 필요 없다.
+          std::vector<unsigned char>().swap(packed_[image_index].image);
+        }
+      }
+
+      on_image_decoded(image_index);
+    });
+  }
+}
+
+// worker 스레드에서 호출된다. 디코딩된 이미지를 plan대로 줄인다.
+// 합칠 occlusion 이미지는 사본을 여기서 디코딩한다. (그 이미지를 다른 텍스처가 써서 자기 작업이 model_에서 디코딩해도 겹치지 않음)
+bool AsyncLoader::pack_image(int image_index)
+{
+  if (!packing_ || !pack_plan_.packable(image_index))
+    return false;
+
+  tinygltf::Image occlusion_image;
+  const tinygltf::Image* occlusion = nullptr;
+  const int o = pack_plan_.occlusion[image_index];
+  if (o >= 0)
+  {
+    std::string err;
+    occlusion_image = occlusion_sources_[o];
+    if (decode_image(occlusion_image, o, &err))
+      occlusion = &occlusion_image;
+    else
+      std::cout << "ERROR: " << err << std::endl;
+  }
+
+  return pack_texture_image(model_->images[image_index], occlusion, pack_plan_.usage[image_index],
+    &packed_[image_index]);
+}
+
+// worker 스레드에서 호출된다. 디코딩된 (줄였으면 줄인) 이미지의 mip chain을 만든다.
+void AsyncLoader::generate_mips(int image_index)
+{
+  const tinygltf::Image& image = packed_[image_index].image.empty() ? model_->images[image_index] : packed_[image_index];
+  std::vector<unsigned char> rgba;
+  if (mip_filter_ == MIP_FILTER_NONE || !convert_to_rgba8(image, &rgba))
+    return;
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  generate_mip_chain(&rgba[0], image.width, image.height, mip_filter_, srgb_images_[image_index], &mips_[image_index]);
+  // 0은 만들지 않은 이미지이므로 만든 것은 0보다 크게 둔다. (mip_chain_count)
+  mip_ms_[image_index] = std::max(1e-6,
+    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+}
+
+// worker 스레드에서 호출된다. 마지막 이미지가 끝나면 캐시를 저장한다.
+void AsyncLoader::on_image_decoded(int image_index)
+{
+  bool is_last;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (image_index >= 0)
+    {
+      decoded_images_.push(image_index);
+      --pending_images_;
+    }
+    is_last = (pending_images_ == 0);
+  }
+
+  // 이미지는 디코딩 작업들만 쓰고 (모두 끝났음) 렌더링 스레드는 읽기만 한다.
+  if (is_last && !from_cache_)
+  {
+    if (save_scene_cache(cache_model_, model_->buffers, cache_num_buffers_, model_->images, cache_dependencies_, filename_))
+      std::cout << "Saved scene cache: " << scene_cache_path(filename_) << std::endl;
+    tinygltf::Model empty;
+    swap_model(cache_model_, empty);
+    cache_dependencies_ = SceneCacheDependencies();
+  }
+
+  // 소멸자가 이 알림을 받고 바로 this를 지울 수 있으므로 잠근 채로 알리고, 그 뒤로는 this를 쓰지 않는다.
+  std::lock_guard<std::mutex> lock(mutex_);
+  --running_jobs_;
+  idle_cv_.notify_all();
+}
+
+bool AsyncLoader::pop_decoded_image(int* image_index)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (decoded_images_.empty())
+    return false;
+
+  *image_index = decoded_images_.front();
+  decoded_images_.pop();
+  return true;
+}
+
+const CompressedTexture* AsyncLoader::compressed_image(int image_index) const
+{
+  if (size_t(image_index) >= compressed_.size() || compressed_[image_index].levels.empty())
+    return nullptr;
+  return &compressed_[image_index];
+}
+
+const std::vector<MipLevel>* AsyncLoader::mip_chain(int image_index) const
+{
+  if (size_t(image_index) >= mips_.size() || mips_[image_index].empty())
+    return nullptr;
+  return &mips_[image_index];
+}
+
+void AsyncLoader::release_levels(int image_index)
+{
+  if (size_t(image_index) < compressed_.size())
+    std::vector<CompressedLevel>().swap(compressed_[image_index].levels);
+  if (size_t(image_index) < mips_.size())
+    std::vector<MipLevel>().swap(mips_[image_index]);
+}
+
+int AsyncLoader::packed_image_source(int image_index) const
+{
+  if (size_t(image_index) >= pack_plan_.packed_into.size() || pack_plan_.packed_into[image_index] < 0)
+    return image_index;
+  return pack_plan_.packed_into[image_index];
+}
+
+const tinygltf::Image* AsyncLoader::packed_image(int image_index) const
+{
+  if (size_t(image_index) >= packed_.size() || packed_[image_index].image.empty())
+    return nullptr;
+  return &packed_[image_index];
+}
+
+TextureSwizzle AsyncLoader::texture_swizzle(int image_index) const
+{
+  if (!packing_ || !pack_plan_.packable(image_index))
+    return TEXTURE_SWIZZLE_NONE;
+
+  // 압축 캐시에서 읽은 것은 줄인 이미지가 없으므로 형식의 채널 수로 정한다.
+  int channels = 4;
+  if (const CompressedTexture* compressed = compressed_image(image_index))
+    channels = texture_codec_channels(compressed->codec);
+  else if (const tinygltf::Image* packed = packed_image(image_index))
+    channels = packed->component;
+  return ::texture_swizzle(pack_plan_.usage[image_index], channels);
+}
+
+size_t AsyncLoader::packed_image_count() const
+{
+  size_t count = 0;
+  for (size_t i = 0; i < packed_.size(); ++i)
+    count += (packed_[i].width > 0) ? 1 : 0;
+  return count;
+}
+
+size_t AsyncLoader::merged_image_count() const
+{
+  size_t count = 0;
+  for (size_t i = 0; i < packed_.size(); ++i)
+    count += (packed_[i].width > 0 && pack_plan_.occlusion[i] >= 0) ? 1 : 0;
+  return count;
+}
+
+size_t AsyncLoader::mip_chain_count() const
+{
+  size_t count = 0;
+  for (double ms : mip_ms_)
+    count += (ms > 0.0) ? 1 : 0;
+  return count;
+}
+
+double AsyncLoader::mip_ms() const
+{
+  double total = 0.0;
+  for (double ms : mip_ms_)
+    total += ms;
+  return total;
+}
+
+bool AsyncLoader::idle() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return parsed_ && running_jobs_ == 0;
+}
+
+bool AsyncLoader::finished() const
+{
+  if (failed_)
+    return true;
+  if (!handed_over_)
+    return false;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  return decoding_started_ && pending_images_ == 0 && decoded_images_.empty();
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../glTF/tiny_gltf.h"
+#include "TextureCompressor.h"
+#include "MipGenerator.h"
+#include "TexturePacker.h"
+#include "SceneCache.h"
+
+class ThreadPool;
+
+// glTF 파일을 백그라운드에서 읽어 들이는 로더.
+//
+//  1. start()가 별도 스레드에서 JSON 파싱과 buffer 읽기를 한다. (이미지는 디코딩하지 않음)
+//     유효한 scene cache(SceneCache.h)가 있으면 파싱/디코딩 대신 캐시를 읽는다.
+//  2. 렌더링 스레드가 매 프레임 poll_model()을 호출하다가 파싱이 끝나면 모델을 넘겨받는다.
+//     이미지마다의 내용 해시(image_hash())도 이때 준비되어 있다.
+//     렌더링 스레드가 필요한 이미지를 정해 start_decoding()을 호출하면 스레드 풀에서 디코딩이 시작된다.
+//     텍스처 압축(TextureCompressor.h)을 켜면 디코딩 작업이 이어서 블록 압축까지 한다.
+//     압축 결과가 디스크 캐시에 있으면 디코딩도 하지 않는다.
+//     CPU mip 생성(MipGenerator.h)을 켜면 디코딩한 작업이 mip chain까지 만들고, 압축할 때도 그 level들을 쓴다.
+//     KTX2 이미지(KtxTexture.h)는 디코딩 대신 GPU가 지원하는 형식으로 읽거나 트랜스코딩한다.
+//     채널 줄이기(TexturePacker.h)를 켜면 디코딩한 작업이 읽는 채널만 남긴 이미지를 만들고, mip과 압축도 그것으로 한다.
+//  3. 디코딩이 끝난 이미지는 pop_decoded_image()로 하나씩 꺼내 GPU로 올린다.
+//     캐시 없이 읽은 경우 모든 디코딩이 끝나면 worker 스레드에서 캐시를 저장한다.
+//     넘겨준 model은 렌더링 스레드가 고칠 수 있으므로(양자화, attribute 빼기) 캐시에는 파싱 직후 떼어 둔
+//     buffer와 이미지를 뺀 사본, 넘겨준 model의 원래 buffer들, 디코딩된 이미지를 저장한다.
+//     (렌더링 스레드는 start_decoding() 전에 buffer를 뒤에 붙이기만 하고 원래 buffer의 내용은 고치지 않는다.)
+//
+// OpenGL 호출은 하지 않는다. GL 객체 생성과 업로드는 렌더링 스레드의 몫이다.
+class AsyncLoader
+{
+public:
+  explicit AsyncLoader(ThreadPool& pool);
+  ~AsyncLoader();
+
+  // true면 tinygltf 대신 load_gltf_sax()로 파싱한다. (GltfSaxParser.h, start() 전에 호출)
+  void use_sax_parser(bool enable) { use_sax_parser_ = enable; }
+
+  // 디코딩한 이미지를 mode로 압축해 둔다. (start_decoding() 전에 호출)
+  void set_texture_compression(TextureCompression mode) { compression_ = mode; }
+
+  // 디코딩한 이미지의 mip chain을 filter로 만들어 둔다. (start_decoding() 전에 호출, NONE이면 만들지 않음)
+  void set_mip_filter(MipFilter filter) { mip_filter_ = filter; }
+
+  // material이 읽는 채널만 남기고 occlusion을 metallicRoughness에 합친다. (poll_model() 전에 호출)
+  void set_texture_packing(bool enable) { packing_ = enable; }
+
+  // GPU가 지원하는 압축 형식 (texture_codec_bit()의 bitmask). KTX2 이미지를 읽을 때 쓴다.
+  void set_supported_codecs(unsigned codecs) { supported_codecs_ = codecs; }
+
+  void start(const std::string& filename);
+
+  // 파싱이 끝났으면 결과를 model로 옮기고 true를 반환한다. (한 번만 true)
+  // model은 디코딩이 모두 끝날 때까지 살아 있어야 하며, images 배열의 크기를 바꾸면 안 된다.
+  // buffer는 start_decoding() 전에 뒤에 붙이기만 할 수 있다. (원래 buffer는 캐시에 저장됨)
+  bool poll_model(tinygltf::Model& model);
+
+  // needed[i]가 true인 이미지만 디코딩한다. 내용이 같은 이미지는 하나만 디코딩해서 그 인덱스만 꺼내 준다.
+  // (이미 다른 모델에서 GPU에 올린 이미지는 needed를 false로 해서 디코딩을 건너뛴다.)
+  void start_decoding(const std::vector<bool>& needed);
+
+  // 이미지의 내용 해시 (poll_model이 true를 반환한 뒤부터 유효, 줄인 이미지는 줄인 내용의 해시)
+  uint64_t image_hash(int image_index) const { return image_hashes_[image_index]; }
+
+  // 다른 이미지의 R에 합친 occlusion 이미지면 그 이미지, 아니면 image_index (poll_model이 true를 반환한 뒤부터 유효)
+  int packed_image_source(int image_index) const;
+
+  // 디코딩이 끝난 이미지가 있으면 그 인덱스를 꺼낸다.
+  bool pop_decoded_image(int* image_index);
+
+  // 꺼낸 이미지의 압축 결과. 압축하지 않았으면 nullptr (이때는 model의 픽셀을 올린다)
+  const CompressedTexture* compressed_image(int image_index) const;
+
+  // 꺼낸 이미지의 mip chain (levels[0]은 RGBA8 원본). 만들지 않았거나 압축했으면 nullptr
+  const std::vector<MipLevel>* mip_chain(int image_index) const;
+
+  // 꺼낸 이미지의 mip chain과 압축 결과를 놓는다. (올린 뒤에도 level 데이터를 따로 들고 있는 경우, --texture-budget)
+  void release_levels(int image_index);
+
+  // 꺼낸 이미지를 읽는 채널만 남겨 줄인 것. 줄이지 않았으면 nullptr (mip chain과 압축은 이것으로 만든 것)
+  const tinygltf::Image* packed_image(int image_index) const;
+
+  // 꺼낸 이미지를 올린 텍스처에 걸 swizzle (줄인 이미지나 그것을 압축한 것)
+  TextureSwizzle texture_swizzle(int image_index) const;
+
+  // 이번에 줄인 이미지 수와 그중 occlusion을 합친 수 (finished() 뒤에 유효, 압축 캐시에서 읽은 것은 빠짐)
+  size_t packed_image_count() const;
+  size_t merged_image_count() const;
+
+  // 만든 mip chain 수와 worker 스레드들이 쓴 시간의 합 (finished() 뒤에 유효)
+  size_t mip_chain_count() const;
+  double mip_ms() const;
+
+  bool failed() const { return failed_; }
+  bool from_cache() const { return from_cache_; }
+  bool finished() const;      // 파싱과 모든 이미지 디코딩이 끝났고 꺼낼 이미지도 없음
+  bool idle() const;          // 파싱 스레드와 디코딩 작업이 모두 끝남 (지금 지워도 소멸자가 기다리지 않음)
+
+private:
+  AsyncLoader(const AsyncLoader&);
+  AsyncLoader& operator=(const AsyncLoader&);
+
+  void parse(const std::string filename);
+  void hash_images();
+  bool pack_image(int image_index);
+  void generate_mips(int image_index);
+  void on_image_decoded(int image_index);
+
+private:
+  ThreadPool&         pool_;
+  std::thread         parse_thread_;
+
+  tinygltf::Model     parsed_model_;          // 파싱 스레드의 결과 (poll_model에서 넘겨줌)
+  std::atomic<bool>   parsed_;
+  std::atomic<bool>   failed_;
+  bool                handed_over_;
+  bool                decoding_started_;
+  std::vector<uint64_t> image_hashes_;
+
+  bool                use_sax_parser_;
+  TextureCompression  compression_;
+  unsigned            supported_codecs_;
+  std::vector<CompressedTexture> compressed_; // 이미지 인덱스별 (각 작업이 자기 것만 씀)
+  MipFilter           mip_filter_;
+  std::vector<bool>   srgb_images_;           // 이미지 인덱스별 sRGB 여부 (start_decoding에서 정함)
+  std::vector<std::vector<MipLevel>> mips_;   // 이미지 인덱스별 (각 작업이 자기 것만 씀)
+  std::vector<double> mip_ms_;
+  bool                packing_;
+  TexturePackPlan     pack_plan_;             // poll_model에서 정함
+  std::vector<tinygltf::Image> packed_;       // 이미지 인덱스별 (각 작업이 자기 것만 씀)
+  std::vector<tinygltf::Image> occlusion_sources_;  // 합칠 occlusion 이미지의 사본 (start_decoding에서 만들고 작업들은 읽기만 함)
+  std::string         filename_;
+  std::atomic<bool>   from_cache_;
+  tinygltf::Model*    model_;                 // poll_model로 넘겨준 모델 (디코딩, 캐시 저장용)
+  tinygltf::Model     cache_model_;           // 파싱 직후의 사본 (buffer와 이미지 제외, 캐시를 저장하면 비움)
+  size_t              cache_num_buffers_;     // 파싱 직후의 buffer 수 (model_의 앞 buffer들을 저장)
+  SceneCacheDependencies cache_dependencies_; // 파싱 직후에 해시한 의존 파일
+
+  mutable std::mutex  mutex_;
+  std::queue<int>     decoded_images_;
+  size_t              pending_images_;        // 디코딩 중인 이미지 수
+  size_t              running_jobs_;          // 풀에 넣었지만 아직 끝나지 않은 작업 수 (캐시 저장 포함)
+  std::condition_variable idle_cv_;
+};
@@ -0,0 +1,248 @@
+#include "Base64.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BASE64_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define BASE64_TARGET(x)
+#else
+// 전체를 -mavx2로 빌드하지 않고 이 함수들만 해당 명령어로 컴파일한다. (실행 시 CPU 검사 후 호출)
+#define BASE64_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+namespace {
+  const unsigned char INVALID = 0xff;
+
+  struct DecodeTable
+  {
+    unsigned char value[256];
+
+    DecodeTable()
+    {
+      const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      std::memset(value, INVALID, sizeof(value));
+      for (int i = 0; i < 64; ++i)
+        value[static_cast<unsigned char>(chars[i])] = static_cast<unsigned char>(i);
+    }
+  };
+
+  const DecodeTable table;
+
+  // 4글자 -> 3바이트 단위로 처리하고, 남은 2~3글자는 1~2바이트가 된다.
+  size_t decode_scalar(const char* in, size_t len, unsigned char* out)
+  {
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(in);
+    unsigned char* d = out;
+    size_t i = 0;
+
+    for (; i + 4 <= len; i += 4)
+    {
+      uint32_t a = table.value[s[i]], b = table.value[s[i + 1]];
+      uint32_t c = table.value[s[i + 2]], e = table.value[s[i + 3]];
+      if ((a | b | c | e) & 0x80)      // INVALID가 하나라도 있음
+        break;
+
+      uint32_t v = (a << 18) | (b << 12) | (c << 6) | e;
+      d[0] = static_cast<unsigned char>(v >> 16);
+      d[1] = static_cast<unsigned char>(v >> 8);
+      d[2] = static_cast<unsigned char>(v);
+      d += 3;
+    }
+
+    // 마지막 (또는 '='이나 잘못된 글자가 있는) 그룹
+    uint32_t v = 0;
+    int n = 0;
+    for (; i < len && n < 4; ++i, ++n)
+    {
+      unsigned char x = table.value[s[i]];
+      if (x == INVALID)
+        break;
+      v |= uint32_t(x) << (18 - 6 * n);
+    }
+    if (n >= 2) *d++ = static_cast<unsigned char>(v >> 16);
+    if (n >= 3) *d++ = static_cast<unsigned char>(v >> 8);
+    return static_cast<size_t>(d - out);
+  }
+
+#ifdef BASE64_X86
+  // Wojciech Muła, Daniel Lemire, "Faster Base64 Encoding and Decoding Using AVX2 Instructions"의 방법.
+  // 상위/하위 nibble로 LUT를 찾아 글자를 검사하고 6-bit 값으로 바꾼 뒤,
+  // maddubs/madd로 4개의 6-bit 값을 24-bit로 합치고 shuffle로 3바이트씩 모은다.
+
+  // 반환 값: 블록에 잘못된 글자나 '='이 있으면 false (out은 건드리지 않음)
+  BASE64_TARGET("ssse3")
+  inline bool translate_ssse3(__m128i in, __m128i* values)
+  {
+    const __m128i lut_lo = _mm_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m128i lut_hi = _mm_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2f);
+
+    __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask_2f);
+    __m128i lo_nibbles = _mm_and_si128(in, mask_2f);
+    __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xffff)
+      return false;
+
+    __m128i eq_2f = _mm_cmpeq_epi8(in, mask_2f);
+    __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+    *values = _mm_add_epi8(in, roll);
+    return true;
+  }
+
+  BASE64_TARGET("ssse3")
+  size_t decode_ssse3(const char* in, size_t len, unsigned char* out)
+  {
+    const __m128i merge_ab_bc = _mm_set1_epi32(0x01400140);
+    const __m128i merge_abc = _mm_set1_epi32(0x00011000);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    size_t i = 0;
+    unsigned char* d = out;
+    // 16바이트를 저장하지만 12바이트만 유효하다. 뒤에 8글자(6바이트) 이상 남아 있을 때만 넘치지 않는다.
+    for (; i + 16 + 8 <= len; i += 16)
+    {
+      __m128i values;
+      if (!translate_ssse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), &values))
+        break;
+      __m128i merged = _mm_madd_epi16(_mm_maddubs_epi16(values, merge_ab_bc), merge_abc);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_shuffle_epi8(merged, pack));
+      d += 12;
+    }
+    return static_cast<size_t>(d - out) + decode_scalar(in + i, len - i, d);
+  }
+
+  BASE64_TARGET("avx2")
+  size_t decode_avx2(const char* in, size_t len, unsigned char* out)
+  {
+    const __m256i lut_lo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m256i lut_hi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+    const __m256i merge_ab_bc = _mm256_set1_epi32(0x01400140);
+    const __m256i merge_abc = _mm256_set1_epi32(0x00011000);
+    const __m256i pack = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+    size_t i = 0;
+    unsigned char* d = out;
+    // 32바이트를 저장하지만 24바이트만 유효하다. 뒤에 12글자(9바이트) 이상 남아 있을 때만 넘치지 않는다.
+    for (; i + 32 + 12 <= len; i += 32)
+    {
+      __m256i in_v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+      __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(in_v, 4), mask_2f);
+      __m256i lo_nibbles = _mm256_and_si256(in_v, mask_2f);
+      __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+      __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+      if (!_mm256_testz_si256(lo, hi))
+        break;
+
+      __m256i eq_2f = _mm256_cmpeq_epi8(in_v, mask_2f);
+      __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+      __m256i values = _mm256_add_epi8(in_v, roll);
+
+      __m256i merged = _mm256_madd_epi16(_mm256_maddubs_epi16(values, merge_ab_bc), merge_abc);
+      __m256i packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(merged, pack), lanes);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(d), packed);
+      d += 24;
+    }
+    return static_cast<size_t>(d - out) + decode_ssse3(in + i, len - i, d);
+  }
+
+  bool cpu_has_ssse3()
+  {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+  }
+
+  bool cpu_has_avx2()
+  {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+      return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+  }
+#endif // BASE64_X86
+
+  typedef size_t (*DecodeFunction)(const char*, size_t, unsigned char*);
+
+  struct Impl
+  {
+    DecodeFunction  decode;
+    const char*     name;
+  };
+
+  Impl best_impl()
+  {
+#ifdef BASE64_X86
+#ifndef _MSC_VER
+    __builtin_cpu_init();     // 정적 초기화 중에 호출되므로 먼저 불러야 한다.
+#endif
+    if (cpu_has_avx2())
+      return Impl{ decode_avx2, "avx2" };
+    if (cpu_has_ssse3())
+      return Impl{ decode_ssse3, "ssse3" };
+#endif
+    return Impl{ decode_scalar, "scalar" };
+  }
+
+  const Impl simd_impl = best_impl();
+  std::atomic<bool> simd_enabled(true);
+
+  const Impl& current_impl()
+  {
+    static const Impl scalar = { decode_scalar, "scalar" };
+    return simd_enabled ? simd_impl : scalar;
+  }
+} // namespace
+
+size_t decode_base64(const char* in, size_t len, unsigned char* out)
+{
+  return current_impl().decode(in, len, out);
+}
+
+void base64_use_simd(bool enable)
+{
+  simd_enabled = enable;
+}
+
+const char* base64_impl_name()
+{
+  return current_impl().name;
+}
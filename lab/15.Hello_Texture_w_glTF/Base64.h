@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+
+// data URI용 base64 디코더.
+//
+// x86에서는 CPU가 지원하면 AVX2(32글자씩) 또는 SSSE3(16글자씩)로 디코딩하고,
+// 그 밖의 경우와 블록 안에 '='이나 잘못된 글자가 있는 경우에는 스칼라 코드로 처리한다.
+// tinygltf::DecodeDataURI()가 이 함수를 쓰도록 tiny_gltf.cpp에서 연결해 둔다.
+
+// len 글자를 디코딩할 때 out에 필요한 최대 바이트 수.
+inline size_t base64_decoded_max_size(size_t len)
+{
+  return len / 4 * 3 + 3;
+}
+
+// in[0..len)을 out에 디코딩하고 쓴 바이트 수를 반환한다.
+// tinygltf의 base64_decode()와 같이 첫 '=' 또는 base64가 아닌 글자에서 멈춘다.
+// out에는 base64_decoded_max_size(len) 바이트의 공간이 있어야 한다.
+size_t decode_base64(const char* in, size_t len, unsigned char* out);
+
+// 벤치마크용: false면 SIMD 경로를 쓰지 않는다.
+void base64_use_simd(bool enable);
+
+// 현재 쓰이는 구현 이름 ("avx2", "ssse3", "scalar")
+const char* base64_impl_name();
@@ -0,0 +1,322 @@
+#include "DracoDecoder.h"
+#include "ThreadPool.h"
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+#ifdef USE_DRACO
+#include "draco/compression/decode.h"
+#include "draco/core/decoder_buffer.h"
+#endif
+
+namespace {
+  const char* DRACO_EXTENSION = "KHR_draco_mesh_compression";
+
+  // 압축된 bufferView 하나를 디코딩하는 작업. 같은 bufferView를 쓰는 primitive는 결과를 함께 쓴다.
+  struct DracoJob
+  {
+    int                               compressed_view;
+    std::map<std::string, int>        attributes;     // glTF attribute 이름 -> Draco attribute id
+    std::vector<tinygltf::Primitive*> primitives;
+    int                               output_buffer;  // 디코딩 결과를 쓸 buffer
+    int                               first_view;     // 새 bufferView: index(있으면), attributes 순서
+    std::string                       error;
+  };
+
+  const tinygltf::Value* find_extension(const tinygltf::Primitive& primitive)
+  {
+    tinygltf::ExtensionMap::const_iterator it = primitive.extensions.find(DRACO_EXTENSION);
+    return (it == primitive.extensions.end() || !it->second.IsObject()) ? nullptr : &it->second;
+  }
+
+  bool parse_extension(const tinygltf::Value& ext, int* view, std::map<std::string, int>* attributes)
+  {
+    if (!ext.Has("bufferView") || !ext.Get("bufferView").IsInt() ||
+      !ext.Has("attributes") || !ext.Get("attributes").IsObject())
+      return false;
+
+    *view = ext.Get("bufferView").Get<int>();
+    const tinygltf::Value::Object& object = ext.Get("attributes").Get<tinygltf::Value::Object>();
+    for (tinygltf::Value::Object::const_iterator it = object.begin(); it != object.end(); ++it)
+    {
+      if (!it->second.IsInt())
+        return false;
+      (*attributes)[it->first] = it->second.Get<int>();
+    }
+    return true;
+  }
+
+#ifndef USE_DRACO
+  // Draco 없이도 읽을 수 있는가: 모든 accessor에 압축되지 않은 bufferView가 있어야 한다.
+  bool has_uncompressed_fallback(const tinygltf::Model& model, const tinygltf::Primitive& primitive)
+  {
+    if (primitive.indices >= 0 && model.accessors[primitive.indices].bufferView < 0)
+      return false;
+    for (std::map<std::string, int>::const_iterator it = primitive.attributes.begin(); it != primitive.attributes.end(); ++it)
+    {
+      if (model.accessors[it->second].bufferView < 0)
+        return false;
+    }
+    return true;
+  }
+#else
+  size_t align4(size_t n)
+  {
+    return (n + 3) & ~size_t(3);
+  }
+
+  template <typename T>
+  bool write_attribute(const draco::Mesh& mesh, const draco::PointAttribute& attribute,
+    int num_components, unsigned char* out)
+  {
+    T* dst = reinterpret_cast<T*>(out);
+    for (draco::PointIndex i(0); i < mesh.num_points(); ++i)
+    {
+      if (!attribute.ConvertValue<T>(attribute.mapped_index(i), static_cast<int8_t>(num_components), dst))
+        return false;
+      dst += num_components;
+    }
+    return true;
+  }
+
+  bool write_attribute(int component_type, const draco::Mesh& mesh, const draco::PointAttribute& attribute,
+    int num_components, unsigned char* out)
+  {
+    switch (component_type)
+    {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:           return write_attribute<int8_t>(mesh, attribute, num_components, out);
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:  return write_attribute<uint8_t>(mesh, attribute, num_components, out);
+    case TINYGLTF_COMPONENT_TYPE_SHORT:          return write_attribute<int16_t>(mesh, attribute, num_components, out);
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return write_attribute<uint16_t>(mesh, attribute, num_components, out);
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:   return write_attribute<uint32_t>(mesh, attribute, num_components, out);
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:          return write_attribute<float>(mesh, attribute, num_components, out);
+    default:                                     return false;
+    }
+  }
+
+  template <typename T>
+  void write_indices(const draco::Mesh& mesh, unsigned char* out)
+  {
+    T* dst = reinterpret_cast<T*>(out);
+    for (draco::FaceIndex f(0); f < mesh.num_faces(); ++f)
+    {
+      const draco::Mesh::Face& face = mesh.face(f);
+      *dst++ = static_cast<T>(face[0].value());
+      *dst++ = static_cast<T>(face[1].value());
+      *dst++ = static_cast<T>(face[2].value());
+    }
+  }
+
+  // 작업 하나를 worker 스레드에서 실행한다.
+  // 다른 작업과 겹치지 않는 buffer/bufferView/accessor만 고치므로 잠금이 필요 없다.
+  bool run_job(tinygltf::Model& model, DracoJob& job)
+  {
+    const tinygltf::BufferView& compressed = model.bufferViews[job.compressed_view];
+    const tinygltf::Buffer& source = model.buffers[compressed.buffer];
+
+    draco::DecoderBuffer decoder_buffer;
+    decoder_buffer.Init(reinterpret_cast<const char*>(source.data.data() + compressed.byteOffset),
+      compressed.byteLength);
+    draco::Decoder decoder;
+    auto result = decoder.DecodeMeshFromBuffer(&decoder_buffer);
+    if (!result.ok())
+    {
+      job.error = result.status().error_msg();
+      return false;
+    }
+    const std::unique_ptr<draco::Mesh>& mesh = result.value();
+
+    // 모든 primitive가 같은 accessor 구성을 가진다고 보고 첫 primitive로 배치를 정한다.
+    const tinygltf::Primitive& first = *job.primitives[0];
+    const size_t num_points = mesh->num_points();
+    const size_t num_indices = size_t(mesh->num_faces()) * 3;
+
+    struct Section
+    {
+      const draco::PointAttribute*  attribute;    // nullptr이면 index
+      int                           component_type;
+      int                           num_components;
+      size_t                        offset;
+      size_t                        size;
+    };
+    std::vector<Section> sections;
+    size_t total = 0;
+
+    if (first.indices >= 0)
+    {
+      const tinygltf::Accessor& accessor = model.accessors[first.indices];
+      Section s = { nullptr, accessor.componentType, 1, total,
+        num_indices * tinygltf::GetComponentSizeInBytes(uint32_t(accessor.componentType)) };
+      sections.push_back(s);
+      total = align4(total + s.size);
+    }
+    for (std::map<std::string, int>::const_iterator it = job.attributes.begin(); it != job.attributes.end(); ++it)
+    {
+      std::map<std::string, int>::const_iterator a = first.attributes.find(it->first);
+      const draco::PointAttribute* attribute = mesh->GetAttributeByUniqueId(uint32_t(it->second));
+      if (a == first.attributes.end() || !attribute)
+      {
+        job.error = "attribute " + it->first + " not found";
+        return false;
+      }
+      const tinygltf::Accessor& accessor = model.accessors[a->second];
+      int num_components = tinygltf::GetTypeSizeInBytes(uint32_t(accessor.type));
+      Section s = { attribute, accessor.componentType, num_components, total,
+        num_points * num_components * tinygltf::GetComponentSizeInBytes(uint32_t(accessor.componentType)) };
+      sections.push_back(s);
+      total = align4(total + s.size);
+    }
+
+    // GPU로 올릴 buffer에 바로 쓴다. (중간 버퍼 없음)
+    std::vector<unsigned char>& out = model.buffers[job.output_buffer].data;
+    out.resize(total);
+    for (size_t i = 0; i < sections.size(); ++i)
+    {
+      const Section& s = sections[i];
+      unsigned char* dst = out.data() + s.offset;
+      if (!s.attribute)
+      {
+        switch (s.component_type)
+        {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:  write_indices<uint8_t>(*mesh, dst); break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: write_indices<uint16_t>(*mesh, dst); break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:   write_indices<uint32_t>(*mesh, dst); break;
+        default:
+          job.error = "invalid index component type";
+          return false;
+        }
+      }
+      else if (!write_attribute(s.component_type, *mesh, *s.attribute, s.num_components, dst))
+      {
+        job.error = "failed to convert attribute";
+        return false;
+      }
+
+      tinygltf::BufferView& view = model.bufferViews[job.first_view + int(i)];
+      view.byteOffset = s.offset;
+      view.byteLength = s.size;
+    }
+
+    for (tinygltf::Primitive* primitive : job.primitives)
+    {
+      int view = job.first_view;
+      if (primitive->indices >= 0)
+      {
+        tinygltf::Accessor& accessor = model.accessors[primitive->indices];
+        accessor.bufferView = view++;
+        accessor.byteOffset = 0;
+        accessor.count = num_indices;
+      }
+      for (std::map<std::string, int>::const_iterator it = job.attributes.begin(); it != job.attributes.end(); ++it)
+      {
+        tinygltf::Accessor& accessor = model.accessors[primitive->attributes[it->first]];
+        accessor.bufferView = view++;
+        accessor.byteOffset = 0;
+        accessor.count = num_points;
+      }
+    }
+    return true;
+  }
+#endif // USE_DRACO
+} // namespace
+
+bool has_draco_primitives(const tinygltf::Model& model)
+{
+  for (const tinygltf::Mesh& mesh : model.meshes)
+  {
+    for (const tinygltf::Primitive& primitive : mesh.primitives)
+    {
+      if (find_extension(primitive))
+        return true;
+    }
+  }
+  return false;
+}
+
+bool decode_draco_primitives(tinygltf::Model& model, ThreadPool& pool, std::string* err)
+{
+  // 압축된 bufferView마다 작업 하나
+  std::vector<DracoJob> jobs;
+  std::map<int, size_t> job_of_view;
+  for (tinygltf::Mesh& mesh : model.meshes)
+  {
+    for (tinygltf::Primitive& primitive : mesh.primitives)
+    {
+      const tinygltf::Value* ext = find_extension(primitive);
+      if (!ext)
+        continue;
+
+      int view = -1;
+      std::map<std::string, int> attributes;
+      if (!parse_extension(*ext, &view, &attributes) || view < 0 || size_t(view) >= model.bufferViews.size())
+      {
+        (*err) += "invalid KHR_draco_mesh_compression extension in mesh " + mesh.name + "\n";
+        return false;
+      }
+
+#ifndef USE_DRACO
+      if (has_uncompressed_fallback(model, primitive))
+      {
+        primitive.extensions.erase(DRACO_EXTENSION);
+        continue;
+      }
+      (*err) += "KHR_draco_mesh_compression: built without the Draco decoder (rebuild with make DRACO=1)\n";
+      return false;
+#else
+      std::map<int, size_t>::iterator it = job_of_view.find(view);
+      if (it == job_of_view.end())
+      {
+        it = job_of_view.insert(std::make_pair(view, jobs.size())).first;
+        jobs.push_back(DracoJob());
+        jobs.back().compressed_view = view;
+        jobs.back().attributes = attributes;
+      }
+      jobs[it->second].primitives.push_back(&primitive);
+#endif
+    }
+  }
+
+#ifdef USE_DRACO
+  // 작업 중에는 buffers/bufferViews 배열의 크기가 바뀌지 않도록 결과를 넣을 자리를 먼저 만든다.
+  for (DracoJob& job : jobs)
+  {
+    const tinygltf::Primitive& first = *job.primitives[0];
+    job.output_buffer = int(model.buffers.size());
+    job.first_view = int(model.bufferViews.size());
+    model.buffers.push_back(tinygltf::Buffer());
+
+    size_t num_views = job.attributes.size() + (first.indices >= 0 ? 1 : 0);
+    for (size_t i = 0; i < num_views; ++i)
+    {
+      tinygltf::BufferView view;
+      view.buffer = job.output_buffer;
+      view.byteLength = 0;
+      view.target = (i == 0 && first.indices >= 0) ?
+        TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER : TINYGLTF_TARGET_ARRAY_BUFFER;
+      model.bufferViews.push_back(view);
+    }
+  }
+
+  pool.parallel_for(jobs.size(), [&](size_t i) {
+    run_job(model, jobs[i]);
+  });
+
+  bool ok = true;
+  for (DracoJob& job : jobs)
+  {
+    if (!job.error.empty())
+    {
+      (*err) += "failed to decode Draco bufferView " + std::to_string(job.compressed_view) + ": " + job.error + "\n";
+      ok = false;
+      continue;
+    }
+    for (tinygltf::Primitive* primitive : job.primitives)
+      primitive->extensions.erase(DRACO_EXTENSION);
+  }
+  return ok;
+#else
+  (void)pool;
+  return true;
+#endif
+}
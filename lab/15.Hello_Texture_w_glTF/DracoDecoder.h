@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+
+#include "../glTF/tiny_gltf.h"
+
+class ThreadPool;
+
+// KHR_draco_mesh_compression으로 압축된 primitive의 디코딩.
+//
+// 실제 디코딩은 Draco 라이브러리(https://github.com/google/draco)로 하므로 make DRACO=1로 빌드해야 한다.
+// Draco 없이 빌드하면 압축되지 않은 대체 데이터(accessor의 bufferView)가 있는 primitive만 그것으로 읽고,
+// 없으면 에러를 낸다.
+
+bool has_draco_primitives(const tinygltf::Model& model);
+
+// 압축된 primitive를 스레드 풀에서 병렬로 디코딩한다. (Draco bufferView 하나가 작업 하나)
+//
+// 결과는 작업마다 새 buffer 하나에 index, attribute 순서로 GPU에 그대로 올릴 수 있는 형태로 바로 쓰고,
+// primitive의 accessor가 그 bufferView를 가리키도록 고친다. 디코딩한 primitive에서는 extension을 지운다.
+// pool의 worker 스레드에서 호출하면 안 된다. (ThreadPool::parallel_for 참고)
+bool decode_draco_primitives(tinygltf::Model& model, ThreadPool& pool, std::string* err);
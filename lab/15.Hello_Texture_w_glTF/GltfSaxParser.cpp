@@ -0,0 +1,852 @@
+#include "GltfSaxParser.h"
+
+#include <fstream>
+#include <vector>
+
+#include "../glTF/json.hpp"
+
+namespace {
+  using json = nlohmann::json;
+
+  // SAX 이벤트를 받는 동안 열려 있는 JSON 객체/배열 하나.
+  enum Kind
+  {
+    SKIP,               // 관심 없는 값 (extensions, extras, 모르는 key)
+
+    // 배열
+    OBJECT_ARRAY,       // 원소가 element 종류의 객체인 배열 (target: std::vector<T>*)
+    NUMBER_ARRAY,       // target: std::vector<double>*
+    INT_ARRAY,          // target: std::vector<int>*
+    STRING_ARRAY,       // target: std::vector<std::string>*
+    TARGET_ARRAY,       // primitive.targets (target: std::vector<std::map<std::string, int>>*)
+
+    // 객체
+    ROOT, ASSET, SCENE, NODE, MESH, PRIMITIVE, ATTRIBUTES, PRIMITIVE_EXTENSIONS,
+    VALUE_OBJECT,       // extensions 안에서 읽는 객체 (target: tinygltf::Value::Object*)
+    ACCESSOR, SPARSE, SPARSE_INDICES, SPARSE_VALUES,
+    BUFFER_VIEW, BUFFER, MATERIAL, PBR, TEXTURE_INFO,
+    TEXTURE, TEXTURE_EXTENSIONS, IMAGE, SAMPLER, CAMERA, PERSPECTIVE, ORTHOGRAPHIC,
+    SKIN, ANIMATION, CHANNEL, CHANNEL_TARGET, ANIMATION_SAMPLER,
+  };
+
+  struct Frame
+  {
+    Kind        kind;
+    Kind        element;    // OBJECT_ARRAY의 원소 종류
+    void*       target;     // 채울 대상 (tinygltf::Node*, std::vector<double>* 등)
+    std::string key;        // 객체: 마지막으로 읽은 key
+  };
+
+  // primitive.extensions 중에서 tinygltf::Value로 읽어 두는 것 (나머지는 건너뜀)
+  bool is_known_primitive_extension(const std::string& name)
+  {
+    return name == "KHR_draco_mesh_compression";
+  }
+
+  // texture.extensions 중에서 읽어 두는 것
+  bool is_known_texture_extension(const std::string& name)
+  {
+    return name == "KHR_texture_basisu";
+  }
+
+  template <typename T>
+  T* push_element(void* v)
+  {
+    std::vector<T>* vec = static_cast<std::vector<T>*>(v);
+    vec->push_back(T());
+    return &vec->back();
+  }
+
+  int accessor_type(const std::string& type)
+  {
+    if (type == "SCALAR") return TINYGLTF_TYPE_SCALAR;
+    if (type == "VEC2")   return TINYGLTF_TYPE_VEC2;
+    if (type == "VEC3")   return TINYGLTF_TYPE_VEC3;
+    if (type == "VEC4")   return TINYGLTF_TYPE_VEC4;
+    if (type == "MAT2")   return TINYGLTF_TYPE_MAT2;
+    if (type == "MAT3")   return TINYGLTF_TYPE_MAT3;
+    if (type == "MAT4")   return TINYGLTF_TYPE_MAT4;
+    return -1;
+  }
+
+  // JSON을 읽으면서 tinygltf::Model을 채운다.
+  // tinygltf의 Parse*() 함수들과 같은 기본값과 같은 material parameter 규칙을 따른다.
+  class GltfSaxHandler : public nlohmann::json_sax<json>
+  {
+  public:
+    GltfSaxHandler(tinygltf::Model* model, std::vector<size_t>* buffer_lengths)
+      : model_(model), buffer_lengths_(buffer_lengths)
+    {
+    }
+
+    const std::string& error() const { return error_; }
+
+    bool null() override { return true; }
+    bool boolean(bool val) override { set_bool(val); return true; }
+    bool number_integer(number_integer_t val) override { set_number(double(val), true); return true; }
+    bool number_unsigned(number_unsigned_t val) override { set_number(double(val), true); return true; }
+    bool number_float(number_float_t val, const string_t&) override { set_number(val, false); return true; }
+    bool string(string_t& val) override { set_string(val); return true; }
+
+    bool key(string_t& val) override
+    {
+      // lexer의 버퍼는 다음 토큰에서 비워지므로 복사 대신 swap해 온다.
+      stack_.back().key.swap(val);
+      return true;
+    }
+
+    bool start_object(std::size_t) override
+    {
+      if (stack_.empty())
+      {
+        push(ROOT, model_);
+        return true;
+      }
+
+      Frame& top = stack_.back();
+      switch (top.kind)
+      {
+      case OBJECT_ARRAY:  begin_element(top.element, top.target); break;
+      case TARGET_ARRAY:  push(ATTRIBUTES, push_element<std::map<std::string, int> >(top.target)); break;
+      case NUMBER_ARRAY:
+      case INT_ARRAY:
+      case STRING_ARRAY:
+      case SKIP:          push(SKIP); break;
+      default:            child_object(top); break;
+      }
+      return true;
+    }
+
+    bool end_object() override { stack_.pop_back(); return true; }
+
+    bool start_array(std::size_t) override
+    {
+      Frame& top = stack_.back();
+      if (top.kind < ROOT)
+        push(SKIP);     // 배열 안의 배열은 쓰지 않는다.
+      else
+        child_array(top);
+      return true;
+    }
+
+    bool end_array() override { stack_.pop_back(); return true; }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override
+    {
+      error_ = ex.what();
+      return false;
+    }
+
+  private:
+    void push(Kind kind, void* target = nullptr, Kind element = SKIP)
+    {
+      stack_.push_back(Frame());
+      Frame& f = stack_.back();
+      f.kind = kind;
+      f.element = element;
+      f.target = target;
+    }
+
+    // 배열 원소 객체를 하나 추가한다. 기본값은 tinygltf의 Parse*()와 같다.
+    void begin_element(Kind kind, void* vec)
+    {
+      void* target = nullptr;
+      switch (kind)
+      {
+      case SCENE:       target = push_element<tinygltf::Scene>(vec); break;
+      case NODE:        target = push_element<tinygltf::Node>(vec); break;
+      case MESH:        target = push_element<tinygltf::Mesh>(vec); break;
+      case MATERIAL:    target = push_element<tinygltf::Material>(vec); break;
+      case TEXTURE:     target = push_element<tinygltf::Texture>(vec); break;
+      case IMAGE:       target = push_element<tinygltf::Image>(vec); break;
+      case CAMERA:      target = push_element<tinygltf::Camera>(vec); break;
+      case SKIN:        target = push_element<tinygltf::Skin>(vec); break;
+      case ANIMATION:   target = push_element<tinygltf::Animation>(vec); break;
+      case CHANNEL:     target = push_element<tinygltf::AnimationChannel>(vec); break;
+      case ANIMATION_SAMPLER: target = push_element<tinygltf::AnimationSampler>(vec); break;
+      case PRIMITIVE:
+        {
+          tinygltf::Primitive* p = push_element<tinygltf::Primitive>(vec);
+          p->mode = TINYGLTF_MODE_TRIANGLES;
+          target = p;
+        }
+        break;
+      case ACCESSOR:
+        {
+          tinygltf::Accessor* a = push_element<tinygltf::Accessor>(vec);
+          a->byteOffset = 0;
+          a->normalized = false;
+          a->componentType = -1;
+          a->count = 0;
+          a->type = -1;
+          target = a;
+        }
+        break;
+      case BUFFER_VIEW:
+        {
+          tinygltf::BufferView* v = push_element<tinygltf::BufferView>(vec);
+          v->buffer = -1;
+          v->byteLength = 0;
+          v->target = 0;
+          target = v;
+        }
+        break;
+      case BUFFER:
+        target = push_element<tinygltf::Buffer>(vec);
+        buffer_lengths_->push_back(0);
+        break;
+      case SAMPLER:
+        {
+          tinygltf::Sampler* s = push_element<tinygltf::Sampler>(vec);
+          s->minFilter = TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR;
+          target = s;
+        }
+        break;
+      default:
+        push(SKIP);
+        return;
+      }
+      push(kind, target);
+    }
+
+    void child_object(const Frame& top)
+    {
+      const std::string& key = top.key;
+      switch (top.kind)
+      {
+      case ROOT:
+        if (key == "asset")
+          return push(ASSET, &model_->asset);
+        break;
+      case PRIMITIVE:
+        if (key == "attributes")
+          return push(ATTRIBUTES, &static_cast<tinygltf::Primitive*>(top.target)->attributes);
+        if (key == "extensions")
+          return push(PRIMITIVE_EXTENSIONS, top.target);
+        break;
+      case PRIMITIVE_EXTENSIONS:
+        if (is_known_primitive_extension(key))
+          return push(VALUE_OBJECT, new_object(&static_cast<tinygltf::Primitive*>(top.target)->extensions[key]));
+        break;
+      case TEXTURE:
+        if (key == "extensions")
+          return push(TEXTURE_EXTENSIONS, top.target);
+        break;
+      case TEXTURE_EXTENSIONS:
+        if (is_known_texture_extension(key))
+          return push(VALUE_OBJECT, new_object(&static_cast<tinygltf::Texture*>(top.target)->extensions[key]));
+        break;
+      case VALUE_OBJECT:
+        return push(VALUE_OBJECT, new_object(&(*static_cast<tinygltf::Value::Object*>(top.target))[key]));
+      case ACCESSOR:
+        if (key == "sparse")
+        {
+          static_cast<tinygltf::Accessor*>(top.target)->sparse.isSparse = true;
+          return push(SPARSE, top.target);
+        }
+        break;
+      case SPARSE:
+        if (key == "indices") return push(SPARSE_INDICES, top.target);
+        if (key == "values")  return push(SPARSE_VALUES, top.target);
+        break;
+      case MATERIAL:
+        if (key == "pbrMetallicRoughness")
+          return push(PBR, top.target);
+        if (key != "extensions" && key != "extras")
+          return push(TEXTURE_INFO, &material_param(top).json_double_value);
+        break;
+      case PBR:
+        return push(TEXTURE_INFO, &material_param(top).json_double_value);
+      case CAMERA:
+        if (key == "perspective")
+          return push(PERSPECTIVE, &static_cast<tinygltf::Camera*>(top.target)->perspective);
+        if (key == "orthographic")
+          return push(ORTHOGRAPHIC, &static_cast<tinygltf::Camera*>(top.target)->orthographic);
+        break;
+      case CHANNEL:
+        if (key == "target")
+          return push(CHANNEL_TARGET, top.target);
+        break;
+      default:
+        break;
+      }
+      push(SKIP);
+    }
+
+    void child_array(const Frame& top)
+    {
+      const std::string& key = top.key;
+      switch (top.kind)
+      {
+      case ROOT:
+        {
+          tinygltf::Model* m = model_;
+          if (key == "scenes")      return push(OBJECT_ARRAY, &m->scenes, SCENE);
+          if (key == "nodes")       return push(OBJECT_ARRAY, &m->nodes, NODE);
+          if (key == "meshes")      return push(OBJECT_ARRAY, &m->meshes, MESH);
+          if (key == "accessors")   return push(OBJECT_ARRAY, &m->accessors, ACCESSOR);
+          if (key == "bufferViews") return push(OBJECT_ARRAY, &m->bufferViews, BUFFER_VIEW);
+          if (key == "buffers")     return push(OBJECT_ARRAY, &m->buffers, BUFFER);
+          if (key == "materials")   return push(OBJECT_ARRAY, &m->materials, MATERIAL);
+          if (key == "textures")    return push(OBJECT_ARRAY, &m->textures, TEXTURE);
+          if (key == "images")      return push(OBJECT_ARRAY, &m->images, IMAGE);
+          if (key == "samplers")    return push(OBJECT_ARRAY, &m->samplers, SAMPLER);
+          if (key == "cameras")     return push(OBJECT_ARRAY, &m->cameras, CAMERA);
+          if (key == "skins")       return push(OBJECT_ARRAY, &m->skins, SKIN);
+          if (key == "animations")  return push(OBJECT_ARRAY, &m->animations, ANIMATION);
+          if (key == "extensionsUsed")     return push(STRING_ARRAY, &m->extensionsUsed);
+          if (key == "extensionsRequired") return push(STRING_ARRAY, &m->extensionsRequired);
+        }
+        break;
+      case SCENE:
+        if (key == "nodes")
+          return push(INT_ARRAY, &static_cast<tinygltf::Scene*>(top.target)->nodes);
+        break;
+      case NODE:
+        {
+          tinygltf::Node* node = static_cast<tinygltf::Node*>(top.target);
+          if (key == "children")    return push(INT_ARRAY, &node->children);
+          if (key == "matrix")      return push(NUMBER_ARRAY, &node->matrix);
+          if (key == "rotation")    return push(NUMBER_ARRAY, &node->rotation);
+          if (key == "scale")       return push(NUMBER_ARRAY, &node->scale);
+          if (key == "translation") return push(NUMBER_ARRAY, &node->translation);
+          if (key == "weights")     return push(NUMBER_ARRAY, &node->weights);
+        }
+        break;
+      case MESH:
+        {
+          tinygltf::Mesh* mesh = static_cast<tinygltf::Mesh*>(top.target);
+          if (key == "primitives")  return push(OBJECT_ARRAY, &mesh->primitives, PRIMITIVE);
+          if (key == "weights")     return push(NUMBER_ARRAY, &mesh->weights);
+        }
+        break;
+      case PRIMITIVE:
+        if (key == "targets")
+          return push(TARGET_ARRAY, &static_cast<tinygltf::Primitive*>(top.target)->targets);
+        break;
+      case ACCESSOR:
+        {
+          tinygltf::Accessor* accessor = static_cast<tinygltf::Accessor*>(top.target);
+          if (key == "min")         return push(NUMBER_ARRAY, &accessor->minValues);
+          if (key == "max")         return push(NUMBER_ARRAY, &accessor->maxValues);
+        }
+        break;
+      case MATERIAL:
+        if (key == "extensions" || key == "extras" || key == "pbrMetallicRoughness")
+          break;
+        return push(NUMBER_ARRAY, &material_param(top).number_array);
+      case PBR:
+        return push(NUMBER_ARRAY, &material_param(top).number_array);
+      case SKIN:
+        if (key == "joints")
+          return push(INT_ARRAY, &static_cast<tinygltf::Skin*>(top.target)->joints);
+        break;
+      case ANIMATION:
+        {
+          tinygltf::Animation* animation = static_cast<tinygltf::Animation*>(top.target);
+          if (key == "channels")    return push(OBJECT_ARRAY, &animation->channels, CHANNEL);
+          if (key == "samplers")    return push(OBJECT_ARRAY, &animation->samplers, ANIMATION_SAMPLER);
+        }
+        break;
+      default:
+        break;
+      }
+      push(SKIP);
+    }
+
+    static tinygltf::Value::Object* new_object(tinygltf::Value* value)
+    {
+      *value = tinygltf::Value(tinygltf::Value::Object());
+      return &value->Get<tinygltf::Value::Object>();
+    }
+
+    // material의 pbrMetallicRoughness 안의 값은 values로, 나머지는 additionalValues로 간다.
+    tinygltf::Parameter& material_param(const Frame& top)
+    {
+      tinygltf::Material* material = static_cast<tinygltf::Material*>(top.target);
+      return top.kind == PBR ? material->values[top.key] : material->additionalValues[top.key];
+    }
+
+    bool is_material_value(const Frame& top) const
+    {
+      return top.kind == PBR ||
+        (top.kind == MATERIAL && top.key != "extensions" && top.key != "extras");
+    }
+
+    void set_number(double v, bool integer)
+    {
+      Frame& top = stack_.back();
+      const std::string& key = top.key;
+      const int i = static_cast<int>(v);
+
+      switch (top.kind)
+      {
+      case NUMBER_ARRAY:
+        static_cast<std::vector<double>*>(top.target)->push_back(v);
+        break;
+      case INT_ARRAY:
+        static_cast<std::vector<int>*>(top.target)->push_back(i);
+        break;
+      case ROOT:
+        if (key == "scene") model_->defaultScene = i;
+        break;
+      case NODE:
+        {
+          tinygltf::Node* node = static_cast<tinygltf::Node*>(top.target);
+          if (key == "mesh")        node->mesh = i;
+          else if (key == "skin")   node->skin = i;
+          else if (key == "camera") node->camera = i;
+        }
+        break;
+      case PRIMITIVE:
+        {
+          tinygltf::Primitive* p = static_cast<tinygltf::Primitive*>(top.target);
+          if (key == "indices")       p->indices = i;
+          else if (key == "material") p->material = i;
+          else if (key == "mode")     p->mode = i;
+        }
+        break;
+      case ATTRIBUTES:
+        (*static_cast<std::map<std::string, int>*>(top.target))[key] = i;
+        break;
+      case ACCESSOR:
+        {
+          tinygltf::Accessor* a = static_cast<tinygltf::Accessor*>(top.target);
+          if (key == "bufferView")          a->bufferView = i;
+          else if (key == "byteOffset")     a->byteOffset = size_t(v);
+          else if (key == "componentType")  a->componentType = i;
+          else if (key == "count")          a->count = size_t(v);
+        }
+        break;
+      case SPARSE:
+        if (key == "count")
+          static_cast<tinygltf::Accessor*>(top.target)->sparse.count = i;
+        break;
+      case SPARSE_INDICES:
+        {
+          tinygltf::Accessor* a = static_cast<tinygltf::Accessor*>(top.target);
+          if (key == "bufferView")          a->sparse.indices.bufferView = i;
+          else if (key == "byteOffset")     a->sparse.indices.byteOffset = i;
+          else if (key == "componentType")  a->sparse.indices.componentType = i;
+        }
+        break;
+      case SPARSE_VALUES:
+        {
+          tinygltf::Accessor* a = static_cast<tinygltf::Accessor*>(top.target);
+          if (key == "bufferView")          a->sparse.values.bufferView = i;
+          else if (key == "byteOffset")     a->sparse.values.byteOffset = i;
+        }
+        break;
+      case BUFFER_VIEW:
+        {
+          tinygltf::BufferView* view = static_cast<tinygltf::BufferView*>(top.target);
+          if (key == "buffer")              view->buffer = i;
+          else if (key == "byteOffset")     view->byteOffset = size_t(v);
+          else if (key == "byteLength")     view->byteLength = size_t(v);
+          else if (key == "byteStride")     view->byteStride = size_t(v);
+          else if (key == "target")         view->target = i;
+        }
+        break;
+      case BUFFER:
+        if (key == "byteLength")
+          buffer_lengths_->back() = size_t(v);
+        break;
+      case MATERIAL:
+      case PBR:
+        if (is_material_value(top))
+        {
+          tinygltf::Parameter& param = material_param(top);
+          param.number_value = v;
+          param.has_number_value = true;
+        }
+        break;
+      case TEXTURE_INFO:
+        (*static_cast<std::map<std::string, double>*>(top.target))[key] = v;
+        break;
+      case VALUE_OBJECT:
+        (*static_cast<tinygltf::Value::Object*>(top.target))[key] = integer ? tinygltf::Value(i) : tinygltf::Value(v);
+        break;
+      case TEXTURE:
+        {
+          tinygltf::Texture* t = static_cast<tinygltf::Texture*>(top.target);
+          if (key == "source")              t->source = i;
+          else if (key == "sampler")        t->sampler = i;
+        }
+        break;
+      case IMAGE:
+        {
+          tinygltf::Image* image = static_cast<tinygltf::Image*>(top.target);
+          if (key == "bufferView")          image->bufferView = i;
+          else if (key == "width")          image->width = i;
+          else if (key == "height")         image->height = i;
+        }
+        break;
+      case SAMPLER:
+        {
+          tinygltf::Sampler* s = static_cast<tinygltf::Sampler*>(top.target);
+          if (key == "minFilter")           s->minFilter = i;
+          else if (key == "magFilter")      s->magFilter = i;
+          else if (key == "wrapS")          s->wrapS = i;
+          else if (key == "wrapT")          s->wrapT = i;
+        }
+        break;
+      case PERSPECTIVE:
+        {
+          tinygltf::PerspectiveCamera* c = static_cast<tinygltf::PerspectiveCamera*>(top.target);
+          if (key == "aspectRatio")         c->aspectRatio = v;
+          else if (key == "yfov")           c->yfov = v;
+          else if (key == "zfar")           c->zfar = v;
+          else if (key == "znear")          c->znear = v;
+        }
+        break;
+      case ORTHOGRAPHIC:
+        {
+          tinygltf::OrthographicCamera* c = static_cast<tinygltf::OrthographicCamera*>(top.target);
+          if (key == "xmag")                c->xmag = v;
+          else if (key == "ymag")           c->ymag = v;
+          else if (key == "zfar")           c->zfar = v;
+          else if (key == "znear")          c->znear = v;
+        }
+        break;
+      case SKIN:
+        {
+          tinygltf::Skin* skin = static_cast<tinygltf::Skin*>(top.target);
+          if (key == "inverseBindMatrices") skin->inverseBindMatrices = i;
+          else if (key == "skeleton")       skin->skeleton = i;
+        }
+        break;
+      case CHANNEL:
+        if (key == "sampler")
+          static_cast<tinygltf::AnimationChannel*>(top.target)->sampler = i;
+        break;
+      case CHANNEL_TARGET:
+        if (key == "node")
+          static_cast<tinygltf::AnimationChannel*>(top.target)->target_node = i;
+        break;
+      case ANIMATION_SAMPLER:
+        {
+          tinygltf::AnimationSampler* s = static_cast<tinygltf::AnimationSampler*>(top.target);
+          if (key == "input")               s->input = i;
+          else if (key == "output")         s->output = i;
+        }
+        break;
+      default:
+        break;
+      }
+    }
+
+    void set_string(std::string& val)
+    {
+      Frame& top = stack_.back();
+      const std::string& key = top.key;
+
+      if (top.kind == STRING_ARRAY)
+      {
+        static_cast<std::vector<std::string>*>(top.target)->push_back(val);
+        return;
+      }
+
+      if (is_material_value(top))
+      {
+        // tinygltf는 material의 name을 additionalValues["name"]에도 넣는다.
+        if (top.kind == MATERIAL && key == "name")
+          static_cast<tinygltf::Material*>(top.target)->name = val;
+        material_param(top).string_value.swap(val);
+        return;
+      }
+
+      // name은 대부분의 객체에 있다.
+      std::string* name = nullptr;
+      switch (top.kind)
+      {
+      case SCENE:       name = &static_cast<tinygltf::Scene*>(top.target)->name; break;
+      case NODE:        name = &static_cast<tinygltf::Node*>(top.target)->name; break;
+      case MESH:        name = &static_cast<tinygltf::Mesh*>(top.target)->name; break;
+      case ACCESSOR:    name = &static_cast<tinygltf::Accessor*>(top.target)->name; break;
+      case BUFFER_VIEW: name = &static_cast<tinygltf::BufferView*>(top.target)->name; break;
+      case BUFFER:      name = &static_cast<tinygltf::Buffer*>(top.target)->name; break;
+      case TEXTURE:     name = &static_cast<tinygltf::Texture*>(top.target)->name; break;
+      case IMAGE:       name = &static_cast<tinygltf::Image*>(top.target)->name; break;
+      case SAMPLER:     name = &static_cast<tinygltf::Sampler*>(top.target)->name; break;
+      case CAMERA:      name = &static_cast<tinygltf::Camera*>(top.target)->name; break;
+      case SKIN:        name = &static_cast<tinygltf::Skin*>(top.target)->name; break;
+      case ANIMATION:   name = &static_cast<tinygltf::Animation*>(top.target)->name; break;
+      default:          break;
+      }
+      if (name && key == "name")
+      {
+        name->swap(val);
+        return;
+      }
+
+      switch (top.kind)
+      {
+      case VALUE_OBJECT:
+        (*static_cast<tinygltf::Value::Object*>(top.target))[key] = tinygltf::Value(val);
+        break;
+      case ASSET:
+        {
+          tinygltf::Asset* asset = static_cast<tinygltf::Asset*>(top.target);
+          if (key == "version")             asset->version.swap(val);
+          else if (key == "generator")      asset->generator.swap(val);
+          else if (key == "minVersion")     asset->minVersion.swap(val);
+          else if (key == "copyright")      asset->copyright.swap(val);
+        }
+        break;
+      case ACCESSOR:
+        if (key == "type")
+          static_cast<tinygltf::Accessor*>(top.target)->type = accessor_type(val);
+        break;
+      case BUFFER:
+        if (key == "uri")
+          static_cast<tinygltf::Buffer*>(top.target)->uri.swap(val);
+        break;
+      case IMAGE:
+        {
+          tinygltf::Image* image = static_cast<tinygltf::Image*>(top.target);
+          if (key == "uri")                 image->uri.swap(val);
+          else if (key == "mimeType")       image->mimeType.swap(val);
+        }
+        break;
+      case CAMERA:
+        if (key == "type")
+          static_cast<tinygltf::Camera*>(top.target)->type.swap(val);
+        break;
+      case CHANNEL_TARGET:
+        if (key == "path")
+          static_cast<tinygltf::AnimationChannel*>(top.target)->target_path.swap(val);
+        break;
+      case ANIMATION_SAMPLER:
+        if (key == "interpolation")
+          static_cast<tinygltf::AnimationSampler*>(top.target)->interpolation.swap(val);
+        break;
+      default:
+        break;
+      }
+    }
+
+    void set_bool(bool val)
+    {
+      Frame& top = stack_.back();
+      if (top.kind == ACCESSOR && top.key == "normalized")
+        static_cast<tinygltf::Accessor*>(top.target)->normalized = val;
+      else if (is_material_value(top))
+        material_param(top).bool_value = val;
+      else if (top.kind == VALUE_OBJECT)
+        (*static_cast<tinygltf::Value::Object*>(top.target))[top.key] = tinygltf::Value(val);
+    }
+
+  private:
+    tinygltf::Model*      model_;
+    std::vector<size_t>*  buffer_lengths_;      // buffers[i]의 byteLength
+    std::vector<Frame>    stack_;
+    std::string           error_;
+  };
+
+  std::string get_base_dir(const std::string& filename)
+  {
+    size_t pos = filename.find_last_of("/\\");
+    return pos == std::string::npos ? "" : filename.substr(0, pos + 1);
+  }
+
+  bool check_required(const tinygltf::Model& model, std::string* err)
+  {
+    for (size_t i = 0; i < model.accessors.size(); ++i)
+    {
+      const tinygltf::Accessor& accessor = model.accessors[i];
+      if (accessor.componentType < 0 || accessor.type < 0)
+      {
+        (*err) += "accessor[" + std::to_string(i) + "] has no valid `componentType` or `type`.\n";
+        return false;
+      }
+    }
+    for (size_t i = 0; i < model.bufferViews.size(); ++i)
+    {
+      if (model.bufferViews[i].buffer < 0)
+      {
+        (*err) += "bufferView[" + std::to_string(i) + "] has no `buffer`.\n";
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // buffer 내용을 data URI 또는 외부 파일에서 읽는다.
+  bool load_buffers(tinygltf::Model* model, const std::vector<size_t>& lengths,
+    const std::string& base_dir, std::string* err)
+  {
+    for (size_t i = 0; i < model->buffers.size(); ++i)
+    {
+      tinygltf::Buffer& buffer = model->buffers[i];
+      const size_t length = lengths[i];
+
+      if (buffer.uri.empty())
+      {
+        (*err) += "buffer[" + std::to_string(i) + "] has no `uri`.\n";
+        return false;
+      }
+
+      if (tinygltf::IsDataURI(buffer.uri))
+      {
+        std::string mime_type;
+        if (!tinygltf::DecodeDataURI(&buffer.data, mime_type, buffer.uri, length, true))
+        {
+          (*err) += "Failed to decode 'uri' : " + buffer.uri + " in Buffer\n";
+          return false;
+        }
+      }
+      else
+      {
+        std::string file_err;
+        if (!tinygltf::ReadWholeFile(&buffer.data, &file_err, base_dir + buffer.uri, nullptr))
+        {
+          (*err) += "Failed to load external 'uri' for buffer[" + std::to_string(i) + "] : " + file_err + "\n";
+          return false;
+        }
+        if (buffer.data.size() < length)
+        {
+          (*err) += "File size mismatch : " + buffer.uri + ", requestedBytes " +
+            std::to_string(length) + ", but got " + std::to_string(buffer.data.size()) + "\n";
+          return false;
+        }
+        buffer.data.resize(length);
+      }
+    }
+    return true;
+  }
+
+  // 이미지의 인코딩된 바이트를 찾아 load_image 콜백에 넘긴다.
+  bool load_images(tinygltf::Model* model, const std::string& base_dir, std::string* err, std::string* warn,
+    tinygltf::LoadImageDataFunction load_image, void* user_data)
+  {
+    std::vector<unsigned char> bytes;
+    for (size_t i = 0; i < model->images.size(); ++i)
+    {
+      tinygltf::Image& image = model->images[i];
+      const int idx = static_cast<int>(i);
+      const unsigned char* data = nullptr;
+      size_t size = 0;
+      int req_width = 0, req_height = 0;
+
+      if (image.bufferView >= 0)
+      {
+        if (size_t(image.bufferView) >= model->bufferViews.size())
+        {
+          (*err) += "image[" + std::to_string(i) + "] bufferView not found in the scene.\n";
+          return false;
+        }
+        const tinygltf::BufferView& view = model->bufferViews[image.bufferView];
+        if (size_t(view.buffer) >= model->buffers.size() ||
+          view.byteOffset + view.byteLength > model->buffers[view.buffer].data.size())
+        {
+          (*err) += "image[" + std::to_string(i) + "] buffer not found in the scene.\n";
+          return false;
+        }
+        data = model->buffers[view.buffer].data.data() + view.byteOffset;
+        size = view.byteLength;
+        req_width = image.width;
+        req_height = image.height;
+      }
+      else if (tinygltf::IsDataURI(image.uri))
+      {
+        if (!tinygltf::DecodeDataURI(&bytes, image.mimeType, image.uri, 0, false))
+        {
+          (*err) += "Failed to decode 'uri' for image[" + std::to_string(i) + "]\n";
+          return false;
+        }
+        // tinygltf처럼 data URI 문자열은 남기지 않는다.
+        std::string().swap(image.uri);
+        data = bytes.data();
+        size = bytes.size();
+      }
+      else if (!image.uri.empty())
+      {
+        // 읽지 못한 이미지는 tinygltf처럼 uri만 남기고 경고로 처리한다.
+        std::string file_err;
+        if (!tinygltf::ReadWholeFile(&bytes, &file_err, base_dir + image.uri, nullptr) || bytes.empty())
+        {
+          (*warn) += "Failed to load external 'uri' for image[" + std::to_string(i) + "] name = [" + image.name + "]\n";
+          continue;
+        }
+        data = bytes.data();
+        size = bytes.size();
+      }
+      else
+      {
+        (*err) += "Neither required `bufferView` nor `uri` defined for image[" + std::to_string(i) + "]\n";
+        return false;
+      }
+
+      if (!load_image(&image, idx, err, warn, req_width, req_height, data, static_cast<int>(size), user_data))
+        return false;
+    }
+    return true;
+  }
+
+  // tinygltf와 같이, target이 없는 bufferView는 index로 쓰이면 ELEMENT_ARRAY_BUFFER, 아니면 ARRAY_BUFFER.
+  bool assign_buffer_view_targets(tinygltf::Model* model, std::string* err)
+  {
+    for (const tinygltf::Mesh& mesh : model->meshes)
+    {
+      for (const tinygltf::Primitive& primitive : mesh.primitives)
+      {
+        if (primitive.indices < 0)
+          continue;
+
+        if (size_t(primitive.indices) >= model->accessors.size())
+        {
+          (*err) += "primitive indices accessor out of bounds";
+          return false;
+        }
+
+        // KHR_draco_mesh_compression의 index accessor에는 bufferView가 없다.
+        int view = model->accessors[primitive.indices].bufferView;
+        if (view < 0)
+          continue;
+        if (size_t(view) >= model->bufferViews.size())
+        {
+          (*err) += "accessor[" + std::to_string(primitive.indices) + "] invalid bufferView";
+          return false;
+        }
+        model->bufferViews[view].target = TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER;
+      }
+    }
+
+    for (tinygltf::BufferView& view : model->bufferViews)
+    {
+      if (view.target == 0)
+        view.target = TINYGLTF_TARGET_ARRAY_BUFFER;
+    }
+    return true;
+  }
+} // namespace
+
+bool load_gltf_sax(tinygltf::Model* model, std::string* err, std::string* warn,
+  const std::string& filename,
+  tinygltf::LoadImageDataFunction load_image, void* load_image_user_data)
+{
+  std::ifstream file(filename.c_str(), std::ios::binary);
+  if (!file)
+  {
+    (*err) = "Failed to read file: " + filename + "\n";
+    return false;
+  }
+
+  *model = tinygltf::Model();
+  model->defaultScene = -1;
+
+  // 파일 전체를 메모리에 올리지 않고 스트림에서 바로 읽는다.
+  std::vector<size_t> buffer_lengths;
+  GltfSaxHandler handler(model, &buffer_lengths);
+  if (!json::sax_parse(file, &handler))
+  {
+    (*err) += "JSON parse error: " + handler.error() + "\n";
+    return false;
+  }
+
+  const std::string base_dir = get_base_dir(filename);
+  return check_required(*model, err) &&
+    load_buffers(model, buffer_lengths, base_dir, err) &&
+    load_images(model, base_dir, err, warn, load_image, load_image_user_data) &&
+    assign_buffer_view_targets(model, err);
+}
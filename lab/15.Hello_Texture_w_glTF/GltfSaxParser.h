@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+
+#include "../glTF/tiny_gltf.h"
+
+// tinygltf::TinyGLTF::LoadASCIIFromFile()의 대안.
+//
+// tinygltf는 JSON 전체를 nlohmann::json DOM으로 만든 뒤 그것을 다시 tinygltf::Model로 옮긴다.
+// 이 파서는 JSON을 SAX 방식으로 스트리밍하면서 Model을 바로 채우므로 DOM을 만들지 않는다.
+// (node/accessor가 수만 개인 큰 glTF에서 파싱 시간과 최대 메모리 사용량이 줄어든다.)
+//
+// 렌더러가 쓰는 필드만 채운다: extras, KHR_lights_cmn 등은 건너뛰고,
+// extensions는 primitive의 KHR_draco_mesh_compression만 (tinygltf처럼 Value로) 읽는다.
+// buffer 읽기와 이미지 로딩(load_image 콜백)은 tinygltf와 같은 방식으로 한다.
+bool load_gltf_sax(tinygltf::Model* model, std::string* err, std::string* warn,
+  const std::string& filename,
+  tinygltf::LoadImageDataFunction load_image, void* load_image_user_data);
@@ -0,0 +1,134 @@
+#include "Hash.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+  const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+  const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+  const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+  const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+  const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+  inline uint64_t rotl64(uint64_t x, int r)
+  {
+    return (x << r) | (x >> (64 - r));
+  }
+
+  inline uint64_t read64(const unsigned char* p)
+  {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  inline uint32_t read32(const unsigned char* p)
+  {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  inline uint64_t round64(uint64_t acc, uint64_t input)
+  {
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    acc *= PRIME64_1;
+    return acc;
+  }
+
+  inline uint64_t merge_round64(uint64_t acc, uint64_t val)
+  {
+    val = round64(0, val);
+    acc ^= val;
+    acc = acc * PRIME64_1 + PRIME64_4;
+    return acc;
+  }
+} // namespace
+
+uint64_t hash64(const void* data, size_t size, uint64_t seed)
+{
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  const unsigned char* end = p + size;
+  uint64_t h;
+
+  if (size >= 32)
+  {
+    const unsigned char* limit = end - 32;
+    uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+    uint64_t v2 = seed + PRIME64_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - PRIME64_1;
+
+    do
+    {
+      v1 = round64(v1, read64(p));      p += 8;
+      v2 = round64(v2, read64(p));      p += 8;
+      v3 = round64(v3, read64(p));      p += 8;
+      v4 = round64(v4, read64(p));      p += 8;
+    } while (p <= limit);
+
+    h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+    h = merge_round64(h, v1);
+    h = merge_round64(h, v2);
+    h = merge_round64(h, v3);
+    h = merge_round64(h, v4);
+  }
+  else
+  {
+    h = seed + PRIME64_5;
+  }
+
+  h += static_cast<uint64_t>(size);
+
+  while (p + 8 <= end)
+  {
+    h ^= round64(0, read64(p));
+    h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+    p += 8;
+  }
+
+  if (p + 4 <= end)
+  {
+    h ^= static_cast<uint64_t>(read32(p)) * PRIME64_1;
+    h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+    p += 4;
+  }
+
+  while (p < end)
+  {
+    h ^= (*p) * PRIME64_5;
+    h = rotl64(h, 11) * PRIME64_1;
+    ++p;
+  }
+
+  h ^= h >> 33;
+  h *= PRIME64_2;
+  h ^= h >> 29;
+  h *= PRIME64_3;
+  h ^= h >> 32;
+
+  return h;
+}
+
+uint64_t hash_combine(uint64_t seed, uint64_t value)
+{
+  return hash64(&value, sizeof(value), seed);
+}
+
+bool hash_file(const std::string& filename, uint64_t* hash)
+{
+  std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+  if (!file)
+    return false;
+
+  // istreambuf_iterator로 한 글자씩 읽으면 수 MB 파일에서 눈에 띄게 느리다.
+  std::vector<char> data(static_cast<size_t>(file.tellg()));
+  file.seekg(0, std::ios::beg);
+  if (!data.empty() && !file.read(&data[0], std::streamsize(data.size())))
+    return false;
+
+  *hash = hash64(data.empty() ? nullptr : &data[0], data.size());
+  return true;
+}
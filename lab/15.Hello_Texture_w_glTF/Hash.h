@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64-bit 내용 해시 (xxHash64 알고리즘).
+// 캐시 키나 중복 리소스 검사처럼 암호학적 안전성이 필요 없는 곳에 쓴다.
+uint64_t hash64(const void* data, size_t size, uint64_t seed = 0);
+
+// 두 해시 값을 하나로 합친다. (순서에 따라 결과가 달라짐)
+uint64_t hash_combine(uint64_t seed, uint64_t value);
+
+// 파일 전체 내용의 해시. 파일을 읽지 못하면 false.
+bool hash_file(const std::string& filename, uint64_t* hash);
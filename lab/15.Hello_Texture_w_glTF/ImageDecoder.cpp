@@ -0,0 +1,63 @@
+#include "ImageDecoder.h"
+#include "ThreadPool.h"
+
+#include <vector>
+
+bool record_encoded_image(tinygltf::Image* image, const int image_idx,
+  std::string* err, std::string* warn, int req_width, int req_height,
+  const unsigned char* bytes, int size, void* user_data)
+{
+  (void)image_idx;
+  (void)err;
+  (void)warn;
+  (void)user_data;
+
+  if (req_width > 0)  image->width = req_width;
+  if (req_height > 0) image->height = req_height;
+
+  image->image.assign(bytes, bytes + size);
+  image->as_is = true;
+
+  return true;
+}
+
+bool decode_image(tinygltf::Image& image, const int image_idx, std::string* err)
+{
+  if (!image.as_is || image.image.empty())
+    return true;
+
+  // LoadImageData가 image.image를 덮어쓰므로 인코딩된 바이트는 따로 옮겨 둔다.
+  std::vector<unsigned char> encoded;
+  encoded.swap(image.image);
+
+  std::string warn;
+  bool res = tinygltf::LoadImageData(&image, image_idx, err, &warn, 0, 0,
+    &encoded.at(0), static_cast<int>(encoded.size()), nullptr);
+  image.as_is = false;
+
+  return res;
+}
+
+bool decode_images(tinygltf::Model& model, ThreadPool& pool, std::string* err)
+{
+  std::vector<tinygltf::Image>& images = model.images;
+
+  // 에러 메시지는 이미지마다 따로 모은 뒤 순서대로 합친다.
+  std::vector<std::string> errors(images.size());
+  std::vector<char> results(images.size(), 1);
+
+  pool.parallel_for(images.size(), [&](size_t i) {
+    results[i] = decode_image(images[i], static_cast<int>(i), &errors[i]) ? 1 : 0;
+  });
+
+  bool res = true;
+  for (size_t i = 0; i < images.size(); ++i)
+  {
+    if (err)
+      (*err) += errors[i];
+    if (!results[i])
+      res = false;
+  }
+
+  return res;
+}
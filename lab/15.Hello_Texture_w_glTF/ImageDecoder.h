@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+
+#include "../glTF/tiny_gltf.h"
+
+class ThreadPool;
+
+// tinygltf의 LoadImageDataFunction 형식을 따르는 이미지 로더 콜백.
+// TinyGLTF::SetImageLoader()로 등록하면 stb_image 디코딩을 하지 않고
+// 인코딩된(JPEG/PNG) 바이트를 image->image에 그대로 담아 둔다 (image->as_is = true).
+bool record_encoded_image(tinygltf::Image* image, const int image_idx,
+  std::string* err, std::string* warn, int req_width, int req_height,
+  const unsigned char* bytes, int size, void* user_data);
+
+// as_is 상태로 남아 있는 model.images를 스레드 풀에서 동시에 디코딩한다.
+// 디코딩 결과는 tinygltf::LoadImageData와 같은 형식(RGBA, 8/16 bit)이다.
+bool decode_images(tinygltf::Model& model, ThreadPool& pool, std::string* err);
+
+// 이미지 하나를 디코딩한다. (decode_images의 작업 단위)
+bool decode_image(tinygltf::Image& image, const int image_idx, std::string* err);
@@ -0,0 +1,546 @@
+#include "KtxTexture.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+// 구현은 tiny_gltf.cpp에 있다. (zlib 압축 풀기만 쓴다)
+#include "../glTF/stb_image.h"
+
+#ifdef USE_BASISU
+#include "basisu_transcoder.h"
+#include "zstd.h"
+#endif
+
+namespace {
+  const char*         BASISU_EXTENSION = "KHR_texture_basisu";
+  const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+  const size_t        KTX2_HEADER_SIZE = 80;      // identifier + header + index
+  const size_t        KTX2_LEVEL_SIZE = 24;       // level index의 항목 하나
+
+  enum Supercompression
+  {
+    SUPERCOMPRESSION_NONE = 0,
+    SUPERCOMPRESSION_BASISLZ = 1,
+    SUPERCOMPRESSION_ZSTD = 2,
+    SUPERCOMPRESSION_ZLIB = 3,
+  };
+
+  // Data Format Descriptor의 color model
+  const uint32_t DF_MODEL_UASTC = 166;
+
+  struct Ktx2Level
+  {
+    uint64_t offset;
+    uint64_t length;
+    uint64_t uncompressed_length;
+  };
+
+  struct Ktx2Header
+  {
+    uint32_t vk_format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint32_t layers;
+    uint32_t faces;
+    uint32_t supercompression;
+    uint32_t dfd_offset;
+    uint32_t dfd_length;
+    std::vector<Ktx2Level> levels;
+  };
+
+  uint32_t read_u32(const unsigned char* p)
+  {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  uint64_t read_u64(const unsigned char* p)
+  {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  void write_u32(std::vector<unsigned char>* out, uint32_t v)
+  {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&v);
+    out->insert(out->end(), p, p + sizeof(v));
+  }
+
+  void write_u64(std::vector<unsigned char>* out, uint64_t v)
+  {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&v);
+    out->insert(out->end(), p, p + sizeof(v));
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// vkFormat
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // sRGB 형식도 지금의 렌더러처럼 linear 형식으로 올린다.
+  TextureCodec codec_of_vk_format(uint32_t vk_format)
+  {
+    switch (vk_format)
+    {
+    case 131: case 132: case 133: case 134: return TEXTURE_CODEC_BC1;  // BC1_RGB(A)_UNORM/SRGB
+    case 137: case 138:                     return TEXTURE_CODEC_BC3;
+    case 139:                               return TEXTURE_CODEC_BC4;
+    case 141:                               return TEXTURE_CODEC_BC5;
+    case 145: case 146:                     return TEXTURE_CODEC_BC7;
+    case 147: case 148:                     return TEXTURE_CODEC_ETC2_RGB;
+    case 151: case 152:                     return TEXTURE_CODEC_ETC2_RGBA;
+    case 153:                               return TEXTURE_CODEC_EAC_R11;
+    case 155:                               return TEXTURE_CODEC_EAC_RG11;
+    default:                                return TEXTURE_CODEC_NONE;
+    }
+  }
+
+  uint32_t vk_format_of_codec(TextureCodec codec)
+  {
+    switch (codec)
+    {
+    case TEXTURE_CODEC_BC1:       return 131;
+    case TEXTURE_CODEC_BC3:       return 137;
+    case TEXTURE_CODEC_BC4:       return 139;
+    case TEXTURE_CODEC_BC5:       return 141;
+    case TEXTURE_CODEC_BC7:       return 145;
+    case TEXTURE_CODEC_ETC2_RGB:  return 147;
+    case TEXTURE_CODEC_ETC2_RGBA: return 151;
+    case TEXTURE_CODEC_EAC_R11:   return 153;
+    case TEXTURE_CODEC_EAC_RG11:  return 155;
+    default:                      return 0;
+    }
+  }
+
+  // R8/RG8/RGB8/RGBA8 (UNORM, SRGB)의 채널 수. 그 밖에는 0
+  int components_of_vk_format(uint32_t vk_format)
+  {
+    switch (vk_format)
+    {
+    case 9:  case 15: return 1;
+    case 16: case 22: return 2;
+    case 23: case 29: return 3;
+    case 37: case 43: return 4;
+    default:          return 0;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// 헤더
+  ////////////////////////////////////////////////////////////////////////////////
+  bool read_header(const std::vector<unsigned char>& data, Ktx2Header* header, std::string* err)
+  {
+    if (!is_ktx2(data.data(), data.size()) || data.size() < KTX2_HEADER_SIZE)
+    {
+      *err = "not a KTX2 file";
+      return false;
+    }
+
+    const unsigned char* p = &data[12];
+    header->vk_format = read_u32(p + 0);
+    header->width = read_u32(p + 8);
+    header->height = read_u32(p + 12);
+    header->depth = read_u32(p + 16);
+    header->layers = read_u32(p + 20);
+    header->faces = read_u32(p + 24);
+    const uint32_t num_levels = std::max<uint32_t>(read_u32(p + 28), 1);
+    header->supercompression = read_u32(p + 32);
+    header->dfd_offset = read_u32(p + 36);
+    header->dfd_length = read_u32(p + 40);
+
+    if (header->width == 0 || header->height == 0 || header->width > 16384 || header->height > 16384 ||
+      header->depth > 1 || header->layers > 1 || header->faces != 1)
+    {
+      *err = "only 2D KTX2 textures are supported";
+      return false;
+    }
+    if (num_levels > 32 || KTX2_HEADER_SIZE + num_levels * KTX2_LEVEL_SIZE > data.size() ||
+      uint64_t(header->dfd_offset) + header->dfd_length > data.size())
+    {
+      *err = "truncated KTX2 header";
+      return false;
+    }
+
+    header->levels.resize(num_levels);
+    for (uint32_t i = 0; i < num_levels; ++i)
+    {
+      const unsigned char* q = &data[KTX2_HEADER_SIZE + i * KTX2_LEVEL_SIZE];
+      Ktx2Level& level = header->levels[i];
+      level.offset = read_u64(q);
+      level.length = read_u64(q + 8);
+      level.uncompressed_length = read_u64(q + 16);
+      if (level.offset > data.size() || level.length > data.size() - level.offset)
+      {
+        *err = "truncated KTX2 level data";
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // vkFormat이 UNDEFINED이면 Basis Universal (BasisLZ면 ETC1S, DFD의 color model이 UASTC면 UASTC)
+  bool is_basis(const std::vector<unsigned char>& data, const Ktx2Header& header)
+  {
+    if (header.vk_format != 0)
+      return false;
+    if (header.supercompression == SUPERCOMPRESSION_BASISLZ)
+      return true;
+    return header.dfd_length >= 16 && data[header.dfd_offset + 12] == DF_MODEL_UASTC;
+  }
+
+  // supercompression을 푼 level 데이터
+  bool level_data(const std::vector<unsigned char>& data, const Ktx2Header& header, size_t index,
+    std::vector<unsigned char>* out, std::string* err)
+  {
+    const Ktx2Level& level = header.levels[index];
+    const unsigned char* src = &data[0] + level.offset;
+
+    switch (header.supercompression)
+    {
+    case SUPERCOMPRESSION_NONE:
+      out->assign(src, src + level.length);
+      return true;
+
+    case SUPERCOMPRESSION_ZLIB:
+    {
+      if (level.uncompressed_length > (1u << 30))
+        break;
+      out->resize(size_t(level.uncompressed_length));
+      int n = stbi_zlib_decode_buffer(reinterpret_cast<char*>(out->data()), int(out->size()),
+        reinterpret_cast<const char*>(src), int(level.length));
+      if (n != int(out->size()))
+        break;
+      return true;
+    }
+
+#ifdef USE_BASISU
+    case SUPERCOMPRESSION_ZSTD:
+    {
+      if (level.uncompressed_length > (1u << 30))
+        break;
+      out->resize(size_t(level.uncompressed_length));
+      size_t n = ZSTD_decompress(out->data(), out->size(), src, size_t(level.length));
+      if (ZSTD_isError(n) || n != out->size())
+        break;
+      return true;
+    }
+#endif
+
+    default:
+      *err = "unsupported KTX2 supercompression scheme " + std::to_string(header.supercompression);
+      return false;
+    }
+
+    *err = "corrupt KTX2 level " + std::to_string(index);
+    return false;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// Basis Universal
+  ////////////////////////////////////////////////////////////////////////////////
+#ifdef USE_BASISU
+  bool transcode_basis(tinygltf::Image& image, unsigned supported_codecs, CompressedTexture* out, std::string* err)
+  {
+    static std::once_flag init;
+    std::call_once(init, [] { basist::basisu_transcoder_init(); });
+
+    const std::vector<unsigned char>& data = image.image;
+    basist::ktx2_transcoder transcoder;
+    if (!transcoder.init(data.data(), uint32_t(data.size())) || !transcoder.start_transcoding())
+    {
+      *err = "failed to initialize the Basis Universal transcoder";
+      return false;
+    }
+
+    // GPU가 지원하는 형식 중에서 BC7 > ETC2 > BC3/BC1 순으로 고른다.
+    const bool alpha = transcoder.get_has_alpha();
+    basist::transcoder_texture_format format = basist::transcoder_texture_format::cTFRGBA32;
+    TextureCodec codec = TEXTURE_CODEC_NONE;
+    if (supported_codecs & texture_codec_bit(TEXTURE_CODEC_BC7))
+    {
+      format = basist::transcoder_texture_format::cTFBC7_RGBA;
+      codec = TEXTURE_CODEC_BC7;
+    }
+    else if (supported_codecs & texture_codec_bit(alpha ? TEXTURE_CODEC_ETC2_RGBA : TEXTURE_CODEC_ETC2_RGB))
+    {
+      // ETC1 블록은 ETC2 RGB 디코더로 그대로 읽힌다.
+      format = alpha ? basist::transcoder_texture_format::cTFETC2_RGBA : basist::transcoder_texture_format::cTFETC1_RGB;
+      codec = alpha ? TEXTURE_CODEC_ETC2_RGBA : TEXTURE_CODEC_ETC2_RGB;
+    }
+    else if (supported_codecs & texture_codec_bit(alpha ? TEXTURE_CODEC_BC3 : TEXTURE_CODEC_BC1))
+    {
+      format = alpha ? basist::transcoder_texture_format::cTFBC3_RGBA : basist::transcoder_texture_format::cTFBC1_RGB;
+      codec = alpha ? TEXTURE_CODEC_BC3 : TEXTURE_CODEC_BC1;
+    }
+
+    // 압축 형식을 쓸 수 없으면 level 0만 RGBA로 풀고 mip chain은 GL이 만든다.
+    const uint32_t num_levels = (codec == TEXTURE_CODEC_NONE) ? 1 : transcoder.get_levels();
+    std::vector<CompressedLevel> levels(num_levels);
+    for (uint32_t i = 0; i < num_levels; ++i)
+    {
+      basist::ktx2_image_level_info info;
+      if (!transcoder.get_image_level_info(info, i, 0, 0))
+      {
+        *err = "invalid Basis Universal level " + std::to_string(i);
+        return false;
+      }
+
+      const uint32_t units = (codec == TEXTURE_CODEC_NONE) ? info.m_orig_width * info.m_orig_height : info.m_total_blocks;
+      levels[i].width = int(info.m_orig_width);
+      levels[i].height = int(info.m_orig_height);
+      levels[i].data.resize(size_t(units) * basist::basis_get_bytes_per_block_or_pixel(format));
+      if (!transcoder.transcode_image_level(i, 0, 0, levels[i].data.data(), units, format))
+      {
+        *err = "failed to transcode Basis Universal level " + std::to_string(i);
+        return false;
+      }
+    }
+
+    if (codec == TEXTURE_CODEC_NONE)
+    {
+      image.width = levels[0].width;
+      image.height = levels[0].height;
+      image.component = 4;
+      image.bits = 8;
+      image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+      image.image.swap(levels[0].data);
+      image.as_is = false;
+      return true;
+    }
+
+    out->codec = codec;
+    out->levels.swap(levels);
+    out->from_ktx2 = true;
+    return true;
+  }
+#endif
+}
+
+int basisu_texture_source(const tinygltf::Texture& texture)
+{
+  tinygltf::ExtensionMap::const_iterator it = texture.extensions.find(BASISU_EXTENSION);
+  if (it == texture.extensions.end() || !it->second.IsObject() || !it->second.Has("source"))
+    return -1;
+
+  const tinygltf::Value& source = it->second.Get("source");
+  return source.IsInt() ? source.Get<int>() : -1;
+}
+
+bool is_ktx2(const unsigned char* data, size_t size)
+{
+  return size >= sizeof(KTX2_IDENTIFIER) && std::memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+}
+
+bool can_load_ktx2(const std::vector<unsigned char>& data, unsigned supported_codecs, std::string* reason)
+{
+  Ktx2Header header;
+  if (!read_header(data, &header, reason))
+    return false;
+
+  if (is_basis(data, header))
+  {
+#ifdef USE_BASISU
+    return true;
+#else
+    *reason = "built without the Basis Universal transcoder (rebuild with make BASISU=1)";
+    return false;
+#endif
+  }
+
+#ifndef USE_BASISU
+  if (header.supercompression == SUPERCOMPRESSION_ZSTD)
+  {
+    *reason = "zstd supercompression needs the Basis Universal build (make BASISU=1)";
+    return false;
+  }
+#endif
+  if (header.supercompression != SUPERCOMPRESSION_NONE && header.supercompression != SUPERCOMPRESSION_ZLIB &&
+    header.supercompression != SUPERCOMPRESSION_ZSTD)
+  {
+    *reason = "unsupported KTX2 supercompression scheme " + std::to_string(header.supercompression);
+    return false;
+  }
+
+  TextureCodec codec = codec_of_vk_format(header.vk_format);
+  if (codec != TEXTURE_CODEC_NONE)
+  {
+    if (supported_codecs & texture_codec_bit(codec))
+      return true;
+    *reason = std::string("GPU does not support ") + texture_codec_name(codec);
+    return false;
+  }
+  if (components_of_vk_format(header.vk_format) > 0)
+    return true;
+
+  *reason = "unsupported KTX2 vkFormat " + std::to_string(header.vk_format);
+  return false;
+}
+
+bool decode_ktx2_image(tinygltf::Image& image, unsigned supported_codecs, CompressedTexture* out, std::string* err)
+{
+  Ktx2Header header;
+  std::string reason;
+  if (!read_header(image.image, &header, &reason))
+  {
+    *err = "image " + image.name + ": " + reason;
+    return false;
+  }
+
+  if (is_basis(image.image, header))
+  {
+#ifdef USE_BASISU
+    if (!transcode_basis(image, supported_codecs, out, &reason))
+    {
+      *err = "image " + image.name + ": " + reason;
+      return false;
+    }
+    return true;
+#else
+    (void)supported_codecs;
+    *err = "image " + image.name + ": built without the Basis Universal transcoder (rebuild with make BASISU=1)";
+    return false;
+#endif
+  }
+
+  const TextureCodec codec = codec_of_vk_format(header.vk_format);
+  const int components = components_of_vk_format(header.vk_format);
+  if (codec == TEXTURE_CODEC_NONE && components == 0)
+  {
+    *err = "image " + image.name + ": unsupported KTX2 vkFormat " + std::to_string(header.vk_format);
+    return false;
+  }
+
+  // 압축되지 않은 형식은 level 0만 쓰고 mip chain은 GL이 만든다.
+  const size_t num_levels = (codec == TEXTURE_CODEC_NONE) ? 1 : header.levels.size();
+  std::vector<CompressedLevel> levels(num_levels);
+  for (size_t i = 0; i < num_levels; ++i)
+  {
+    CompressedLevel& level = levels[i];
+    level.width = std::max(1, int(header.width >> i));
+    level.height = std::max(1, int(header.height >> i));
+    if (!level_data(image.image, header, i, &level.data, &reason))
+    {
+      *err = "image " + image.name + ": " + reason;
+      return false;
+    }
+
+    const size_t expected = (codec == TEXTURE_CODEC_NONE) ?
+      size_t(level.width) * level.height * components : compressed_level_bytes(codec, level.width, level.height);
+    if (level.data.size() != expected)
+    {
+      *err = "image " + image.name + ": KTX2 level " + std::to_string(i) + " has a wrong size";
+      return false;
+    }
+  }
+
+  if (codec == TEXTURE_CODEC_NONE)
+  {
+    image.width = levels[0].width;
+    image.height = levels[0].height;
+    image.component = components;
+    image.bits = 8;
+    image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+    image.image.swap(levels[0].data);
+    image.as_is = false;
+    return true;
+  }
+
+  out->codec = codec;
+  out->levels.swap(levels);
+  out->from_ktx2 = true;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// 쓰기
+////////////////////////////////////////////////////////////////////////////////
+
+// Data Format Descriptor는 블록 압축 형식의 basic descriptor block 하나로 만든다.
+bool write_ktx2(const CompressedTexture& texture, std::vector<unsigned char>* out)
+{
+  const uint32_t vk_format = vk_format_of_codec(texture.codec);
+  if (vk_format == 0 || texture.levels.empty())
+    return false;
+
+  // color model과 sample (channel, bit offset, bit 수)
+  struct Sample { uint32_t channel, offset, bits; };
+  static const Sample BC1[] = { { 0, 0, 64 } };
+  static const Sample BC3[] = { { 15, 0, 64 }, { 0, 64, 64 } };
+  static const Sample BC5[] = { { 0, 0, 64 }, { 1, 64, 64 } };
+  static const Sample BC7[] = { { 0, 0, 128 } };
+  static const Sample ETC2_RGB[] = { { 2, 0, 64 } };
+  static const Sample ETC2_RGBA[] = { { 15, 0, 64 }, { 2, 64, 64 } };
+  uint32_t model = 0;
+  const Sample* samples = nullptr;
+  uint32_t num_samples = 0;
+  switch (texture.codec)
+  {
+  case TEXTURE_CODEC_BC1:       model = 128; samples = BC1; num_samples = 1; break;
+  case TEXTURE_CODEC_BC3:       model = 130; samples = BC3; num_samples = 2; break;
+  case TEXTURE_CODEC_BC4:       model = 131; samples = BC1; num_samples = 1; break;
+  case TEXTURE_CODEC_BC5:       model = 132; samples = BC5; num_samples = 2; break;
+  case TEXTURE_CODEC_BC7:       model = 134; samples = BC7; num_samples = 1; break;
+  case TEXTURE_CODEC_ETC2_RGB:  model = 161; samples = ETC2_RGB; num_samples = 1; break;
+  case TEXTURE_CODEC_ETC2_RGBA: model = 161; samples = ETC2_RGBA; num_samples = 2; break;
+  case TEXTURE_CODEC_EAC_R11:   model = 161; samples = BC1; num_samples = 1; break;
+  case TEXTURE_CODEC_EAC_RG11:  model = 161; samples = BC5; num_samples = 2; break;
+  default: return false;
+  }
+  const uint32_t block_size = uint32_t(compressed_level_bytes(texture.codec, 4, 4));
+
+  const uint32_t num_levels = uint32_t(texture.levels.size());
+  const uint32_t dfd_offset = uint32_t(KTX2_HEADER_SIZE + num_levels * KTX2_LEVEL_SIZE);
+  const uint32_t dfd_length = 4 + 24 + 16 * num_samples;
+
+  out->clear();
+  out->insert(out->end(), KTX2_IDENTIFIER, KTX2_IDENTIFIER + sizeof(KTX2_IDENTIFIER));
+  write_u32(out, vk_format);
+  write_u32(out, 1);                                // typeSize
+  write_u32(out, uint32_t(texture.levels[0].width));
+  write_u32(out, uint32_t(texture.levels[0].height));
+  write_u32(out, 0);                                // pixelDepth
+  write_u32(out, 0);                                // layerCount
+  write_u32(out, 1);                                // faceCount
+  write_u32(out, num_levels);
+  write_u32(out, SUPERCOMPRESSION_NONE);
+  write_u32(out, dfd_offset);
+  write_u32(out, dfd_length);
+  write_u32(out, 0);                                // key/value data
+  write_u32(out, 0);
+  write_u64(out, 0);                                // supercompression global data
+  write_u64(out, 0);
+
+  // level 데이터는 작은 level부터 블록 크기에 맞춰 놓는다. 위치는 아래에서 채운다.
+  const size_t level_index = out->size();
+  out->resize(out->size() + num_levels * KTX2_LEVEL_SIZE, 0);
+
+  write_u32(out, dfd_length);
+  write_u32(out, 0);                                // vendorId, descriptorType
+  write_u32(out, 2 | ((24 + 16 * num_samples) << 16));  // versionNumber, descriptorBlockSize
+  write_u32(out, model | (1u << 8) | (1u << 16));   // BT709 primaries, linear transfer, straight alpha
+  write_u32(out, 3 | (3u << 8));                    // 4x4 텍셀 블록
+  write_u32(out, block_size);                       // bytesPlane0
+  write_u32(out, 0);
+  for (const Sample* s = samples; s != samples + num_samples; ++s)
+  {
+    write_u32(out, s->offset | ((s->bits - 1) << 16) | (s->channel << 24));
+    write_u32(out, 0);                              // samplePosition
+    write_u32(out, 0);                              // sampleLower
+    write_u32(out, 0xFFFFFFFFu);                    // sampleUpper
+  }
+
+  for (uint32_t i = num_levels; i-- > 0;)
+  {
+    const CompressedLevel& level = texture.levels[i];
+    out->resize((out->size() + block_size - 1) / block_size * block_size, 0);
+    unsigned char* entry = &(*out)[level_index + i * KTX2_LEVEL_SIZE];
+    const uint64_t info[3] = { out->size(), level.data.size(), level.data.size() };
+    std::memcpy(entry, info, sizeof(info));
+    out->insert(out->end(), level.data.begin(), level.data.end());
+  }
+  return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "../glTF/tiny_gltf.h"
+#include "TextureCompressor.h"
+
+// KHR_texture_basisu 텍스처의 KTX2 컨테이너 읽기.
+//
+// 블록 압축 형식(BC1/3/4/5/7, ETC2/EAC)으로 저장된 KTX2는 level 데이터를 그대로 CompressedTexture로 넘기고,
+// R8/RG8/RGB8/RGBA8은 디코딩된 이미지처럼 tinygltf::Image의 픽셀로 바꾼다.
+// zlib supercompression은 stb_image로 푼다.
+// Basis Universal(ETC1S/UASTC)과 zstd는 Basis Universal 트랜스코더(https://github.com/BinomialLLC/basis_universal)로
+// 풀기 때문에 make BASISU=1로 빌드해야 한다. 트랜스코딩할 형식은 GPU가 지원하는 형식 중에서
+// BC7, ETC2, BC3/BC1 순으로 고르고, 어느 것도 안 되면 RGBA 픽셀로 푼다.
+// (USE_BASISU 경로는 트랜스코더 없이 작성한 것으로, 아직 빌드하거나 실행해 보지 않았다.)
+// 2D 텍스처만 다룬다. (cube map, array, 3D 텍스처는 지원하지 않음)
+
+// GPU가 지원하는 형식을 나타내는 bitmask의 한 bit
+inline unsigned texture_codec_bit(TextureCodec codec) { return 1u << codec; }
+
+// KHR_texture_basisu extension의 source. 없으면 -1
+int basisu_texture_source(const tinygltf::Texture& texture);
+
+bool is_ktx2(const unsigned char* data, size_t size);
+
+// 헤더만 보고 이 빌드와 GPU(supported_codecs)로 올릴 수 있는 파일인지 확인한다.
+bool can_load_ktx2(const std::vector<unsigned char>& data, unsigned supported_codecs, std::string* reason);
+
+// 인코딩된 채로 있는(as_is) KTX2 이미지를 읽는다.
+// 블록 압축 형식이면 out을 채우고 image는 그대로 두며, 아니면 image를 디코딩된 RGBA8 등의 픽셀로 바꾼다.
+bool decode_ktx2_image(tinygltf::Image& image, unsigned supported_codecs, CompressedTexture* out, std::string* err);
+
+// 압축된 텍스처를 supercompression 없는 KTX2 파일로 만든다. (벤치마크와 변환용)
+bool write_ktx2(const CompressedTexture& texture, std::vector<unsigned char>* out);
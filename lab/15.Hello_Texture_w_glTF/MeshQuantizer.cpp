@@ -0,0 +1,433 @@
+#include "MeshQuantizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+
+namespace {
+  bool is_integer(int component_type)
+  {
+    return component_type == TINYGLTF_COMPONENT_TYPE_BYTE || component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE ||
+      component_type == TINYGLTF_COMPONENT_TYPE_SHORT || component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+  }
+
+  bool starts_with(const std::string& s, const char* prefix)
+  {
+    return s.compare(0, std::strlen(prefix), prefix) == 0;
+  }
+
+  // accessor의 i번째 원소를 float로 읽는다. normalized면 glTF 규칙대로 [-1, 1] 또는 [0, 1]로 바꾼다.
+  void read_element(const tinygltf::Model& model, const tinygltf::Accessor& accessor, size_t i, float* out)
+  {
+    const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+    const unsigned char* p = model.buffers[view.buffer].data.data() +
+      view.byteOffset + accessor.byteOffset + i * accessor.ByteStride(view);
+    const int n = tinygltf::GetTypeSizeInBytes(uint32_t(accessor.type));
+    const bool norm = accessor.normalized;
+
+    for (int c = 0; c < n; ++c)
+    {
+      switch (accessor.componentType)
+      {
+      case TINYGLTF_COMPONENT_TYPE_BYTE:
+        { int8_t v; std::memcpy(&v, p + c, 1); out[c] = norm ? std::max(v / 127.0f, -1.0f) : v; } break;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        { uint8_t v = p[c]; out[c] = norm ? v / 255.0f : v; } break;
+      case TINYGLTF_COMPONENT_TYPE_SHORT:
+        { int16_t v; std::memcpy(&v, p + 2 * c, 2); out[c] = norm ? std::max(v / 32767.0f, -1.0f) : v; } break;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        { uint16_t v; std::memcpy(&v, p + 2 * c, 2); out[c] = norm ? v / 65535.0f : v; } break;
+      case TINYGLTF_COMPONENT_TYPE_FLOAT:
+        std::memcpy(&out[c], p + 4 * c, 4); break;
+      default:
+        out[c] = 0.0f;
+      }
+    }
+  }
+
+  bool is_readable(const tinygltf::Model& model, const tinygltf::Accessor& accessor)
+  {
+    return !accessor.sparse.isSparse && accessor.bufferView >= 0 &&
+      size_t(accessor.bufferView) < model.bufferViews.size() &&
+      accessor.ByteStride(model.bufferViews[accessor.bufferView]) > 0;
+  }
+
+  // 양자화 결과를 모아 두는 buffer. 요소마다 4바이트 정렬을 지킨다.
+  struct Output
+  {
+    tinygltf::Model&  model;
+    int               buffer;
+
+    // 새 bufferView와 그것을 가리키는 accessor를 만들고 데이터를 쓸 위치를 반환한다.
+    unsigned char* append(const tinygltf::Accessor& source, int component_type, bool normalized, int type,
+      size_t stride, int* accessor_index)
+    {
+      std::vector<unsigned char>& data = model.buffers[buffer].data;
+      size_t offset = data.size();
+      data.resize(offset + stride * source.count);
+
+      tinygltf::BufferView view;
+      view.buffer = buffer;
+      view.byteOffset = offset;
+      view.byteLength = stride * source.count;
+      view.byteStride = stride;
+      view.target = TINYGLTF_TARGET_ARRAY_BUFFER;
+      model.bufferViews.push_back(view);
+
+      tinygltf::Accessor accessor;
+      accessor.name = source.name;
+      accessor.bufferView = int(model.bufferViews.size() - 1);
+      accessor.byteOffset = 0;
+      accessor.componentType = component_type;
+      accessor.normalized = normalized;
+      accessor.count = source.count;
+      accessor.type = type;
+      model.accessors.push_back(accessor);
+      *accessor_index = int(model.accessors.size() - 1);
+
+      return data.data() + offset;
+    }
+  };
+
+  uint16_t quantize_unorm16(float v)
+  {
+    return static_cast<uint16_t>(std::floor(std::min(std::max(v, 0.0f), 1.0f) * 65535.0f + 0.5f));
+  }
+
+  int16_t quantize_snorm16(float v)
+  {
+    return static_cast<int16_t>(std::floor(std::min(std::max(v, -1.0f), 1.0f) * 32767.0f + 0.5f));
+  }
+
+  // octahedral 인코딩: 단위 벡터를 팔면체에 투영해서 2개의 값으로 표현한다.
+  void oct_encode(const float* n, int16_t* out)
+  {
+    float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    float x = l1 > 0.0f ? n[0] / l1 : 0.0f;
+    float y = l1 > 0.0f ? n[1] / l1 : 0.0f;
+    if (n[2] < 0.0f)
+    {
+      float ox = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+      float oy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+      x = ox;
+      y = oy;
+    }
+    out[0] = quantize_snorm16(x);
+    out[1] = quantize_snorm16(y);
+  }
+
+  int quantize_positions(Output& output, const tinygltf::Accessor& source, const MeshDequantization& dq)
+  {
+    int index;
+    // unsigned short x3 = 6바이트지만 정점마다 4바이트 정렬이 필요하므로 stride는 8
+    unsigned char* dst = output.append(source, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, false, TINYGLTF_TYPE_VEC3, 8, &index);
+
+    tinygltf::Accessor& accessor = output.model.accessors[index];
+    accessor.minValues.assign(3, 65535.0);
+    accessor.maxValues.assign(3, 0.0);
+    for (size_t i = 0; i < source.count; ++i)
+    {
+      float p[3];
+      read_element(output.model, source, i, p);
+      uint16_t q[4] = { 0, 0, 0, 0 };
+      for (int c = 0; c < 3; ++c)
+      {
+        q[c] = dq.scale[c] > 0.0f ? quantize_unorm16((p[c] - dq.offset[c]) / (dq.scale[c] * 65535.0f)) : 0;
+        accessor.minValues[c] = std::min(accessor.minValues[c], double(q[c]));
+        accessor.maxValues[c] = std::max(accessor.maxValues[c], double(q[c]));
+      }
+      std::memcpy(dst + 8 * i, q, 8);
+    }
+    return index;
+  }
+
+  int quantize_normals(Output& output, const tinygltf::Accessor& source)
+  {
+    int index;
+    unsigned char* dst = output.append(source, TINYGLTF_COMPONENT_TYPE_SHORT, true, TINYGLTF_TYPE_VEC2, 4, &index);
+    for (size_t i = 0; i < source.count; ++i)
+    {
+      float n[3];
+      read_element(output.model, source, i, n);
+      int16_t q[2];
+      oct_encode(n, q);
+      std::memcpy(dst + 4 * i, q, 4);
+    }
+    return index;
+  }
+
+  // [0, 1] 밖의 값이 있으면 -1 (원래 accessor를 그대로 쓴다)
+  int quantize_texcoords(Output& output, const tinygltf::Accessor& source)
+  {
+    for (size_t i = 0; i < source.count; ++i)
+    {
+      float uv[2];
+      read_element(output.model, source, i, uv);
+      if (uv[0] < 0.0f || uv[0] > 1.0f || uv[1] < 0.0f || uv[1] > 1.0f)
+        return -1;
+    }
+
+    int index;
+    unsigned char* dst = output.append(source, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, true, TINYGLTF_TYPE_VEC2, 4, &index);
+    for (size_t i = 0; i < source.count; ++i)
+    {
+      float uv[2];
+      read_element(output.model, source, i, uv);
+      uint16_t q[2] = { quantize_unorm16(uv[0]), quantize_unorm16(uv[1]) };
+      std::memcpy(dst + 4 * i, q, 4);
+    }
+    return index;
+  }
+
+  // 메시 안의 모든 POSITION을 감싸는 bounding box로 dequantization 변환을 정한다.
+  bool compute_dequantization(const tinygltf::Model& model, const tinygltf::Mesh& mesh, MeshDequantization* dq)
+  {
+    float lo[3] = { HUGE_VALF, HUGE_VALF, HUGE_VALF };
+    float hi[3] = { -HUGE_VALF, -HUGE_VALF, -HUGE_VALF };
+    bool found = false;
+
+    for (const tinygltf::Primitive& primitive : mesh.primitives)
+    {
+      std::map<std::string, int>::const_iterator it = primitive.attributes.find("POSITION");
+      if (it == primitive.attributes.end())
+        continue;
+      const tinygltf::Accessor& accessor = model.accessors[it->second];
+      for (size_t i = 0; i < accessor.count; ++i)
+      {
+        float p[3];
+        read_element(model, accessor, i, p);
+        for (int c = 0; c < 3; ++c)
+        {
+          lo[c] = std::min(lo[c], p[c]);
+          hi[c] = std::max(hi[c], p[c]);
+        }
+      }
+      found = found || accessor.count > 0;
+    }
+    if (!found)
+      return false;
+
+    for (int c = 0; c < 3; ++c)
+    {
+      dq->offset[c] = lo[c];
+      dq->scale[c] = (hi[c] - lo[c]) / 65535.0f;
+    }
+    return true;
+  }
+
+  bool can_quantize(const tinygltf::Model& model, const tinygltf::Mesh& mesh)
+  {
+    for (const tinygltf::Primitive& primitive : mesh.primitives)
+    {
+      if (!primitive.targets.empty())
+        return false;
+      std::map<std::string, int>::const_iterator position = primitive.attributes.find("POSITION");
+      if (position != primitive.attributes.end() &&
+        model.accessors[position->second].componentType != TINYGLTF_COMPONENT_TYPE_FLOAT)
+        return false;
+      for (std::map<std::string, int>::const_iterator it = primitive.attributes.begin(); it != primitive.attributes.end(); ++it)
+      {
+        if (!is_readable(model, model.accessors[it->second]))
+          return false;
+      }
+    }
+    return true;
+  }
+} // namespace
+
+bool is_valid_attribute_format(const std::string& name, const tinygltf::Accessor& accessor)
+{
+  const int ct = accessor.componentType;
+  const bool norm = accessor.normalized;
+  const bool is_float = ct == TINYGLTF_COMPONENT_TYPE_FLOAT;
+  const bool is_signed = ct == TINYGLTF_COMPONENT_TYPE_BYTE || ct == TINYGLTF_COMPONENT_TYPE_SHORT;
+  const bool is_unsigned = ct == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE || ct == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+
+  if (name == "POSITION")
+    return accessor.type == TINYGLTF_TYPE_VEC3 && (is_float || is_integer(ct));
+  if (name == "NORMAL")   // VEC2는 quantize_meshes()가 만든 octahedral 인코딩
+    return (accessor.type == TINYGLTF_TYPE_VEC3 && (is_float || (is_signed && norm))) ||
+      (accessor.type == TINYGLTF_TYPE_VEC2 && ct == TINYGLTF_COMPONENT_TYPE_SHORT && norm);
+  if (name == "TANGENT")
+    return accessor.type == TINYGLTF_TYPE_VEC4 && (is_float || (is_signed && norm));
+  if (starts_with(name, "TEXCOORD_"))
+    return accessor.type == TINYGLTF_TYPE_VEC2 && (is_float || is_integer(ct));
+  if (starts_with(name, "COLOR_"))
+    return (accessor.type == TINYGLTF_TYPE_VEC3 || accessor.type == TINYGLTF_TYPE_VEC4) &&
+      (is_float || (is_unsigned && norm));
+  if (starts_with(name, "JOINTS_"))
+    return accessor.type == TINYGLTF_TYPE_VEC4 && is_unsigned && !norm;
+  if (starts_with(name, "WEIGHTS_"))
+    return accessor.type == TINYGLTF_TYPE_VEC4 && (is_float || (is_unsigned && norm));
+  return true;
+}
+
+void quantize_meshes(tinygltf::Model& model, std::vector<MeshDequantization>* dequant)
+{
+  dequant->assign(model.meshes.size(), MeshDequantization());
+
+  Output output = { model, int(model.buffers.size()) };
+  model.buffers.push_back(tinygltf::Buffer());
+
+  // NORMAL, TEXCOORD는 메시와 상관없으므로 공유하는 accessor는 한 번만 양자화한다.
+  std::map<int, int> shared;
+  for (size_t m = 0; m < model.meshes.size(); ++m)
+  {
+    tinygltf::Mesh& mesh = model.meshes[m];
+    MeshDequantization dq;
+    if (!can_quantize(model, mesh) || !compute_dequantization(model, mesh, &dq))
+      continue;
+    (*dequant)[m] = dq;
+
+    std::map<int, int> positions;
+    for (tinygltf::Primitive& primitive : mesh.primitives)
+    {
+      for (std::map<std::string, int>::iterator it = primitive.attributes.begin(); it != primitive.attributes.end(); ++it)
+      {
+        const int source_index = it->second;
+        const tinygltf::Accessor source = model.accessors[source_index];   // push_back으로 참조가 깨지므로 복사
+
+        if (it->first == "POSITION")
+        {
+          if (positions.find(source_index) == positions.end())
+            positions[source_index] = quantize_positions(output, source, dq);
+          it->second = positions[source_index];
+          continue;
+        }
+
+        std::map<int, int>::iterator found = shared.find(source_index);
+        if (found != shared.end())
+        {
+          it->second = found->second;
+          continue;
+        }
+
+        // 이미 byte/short인 attribute는 그대로 둔다.
+        int quantized = -1;
+        if (source.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+        {
+          if (it->first == "NORMAL" && source.type == TINYGLTF_TYPE_VEC3)
+            quantized = quantize_normals(output, source);
+          else if (starts_with(it->first, "TEXCOORD_") && source.type == TINYGLTF_TYPE_VEC2)
+            quantized = quantize_texcoords(output, source);
+        }
+
+        if (quantized < 0)
+          quantized = source_index;
+        shared[source_index] = quantized;
+        it->second = quantized;
+      }
+    }
+  }
+}
+
+size_t vertex_attribute_bytes(const tinygltf::Model& model)
+{
+  std::set<int> views;
+  for (const tinygltf::Mesh& mesh : model.meshes)
+  {
+    for (const tinygltf::Primitive& primitive : mesh.primitives)
+    {
+      for (std::map<std::string, int>::const_iterator it = primitive.attributes.begin(); it != primitive.attributes.end(); ++it)
+      {
+        int view = model.accessors[it->second].bufferView;
+        if (view >= 0)
+          views.insert(view);
+      }
+    }
+  }
+
+  size_t bytes = 0;
+  for (int view : views)
+    bytes += model.bufferViews[view].byteLength;
+  return bytes;
+}
+
+bool measure_primitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive, int texcoord,
+  PrimitiveExtent* out)
+{
+  std::map<std::string, int>::const_iterator position = primitive.attributes.find("POSITION");
+  if (position == primitive.attributes.end() || !is_readable(model, model.accessors[position->second]))
+    return false;
+  const tinygltf::Accessor& positions = model.accessors[position->second];
+  if (positions.type != TINYGLTF_TYPE_VEC3 || positions.count == 0)
+    return false;
+
+  std::vector<float> p(positions.count * 3);
+  float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+  float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+  for (size_t i = 0; i < positions.count; ++i)
+  {
+    read_element(model, positions, i, &p[i * 3]);
+    for (int c = 0; c < 3; ++c)
+    {
+      lo[c] = std::min(lo[c], p[i * 3 + c]);
+      hi[c] = std::max(hi[c], p[i * 3 + c]);
+    }
+  }
+  float r2 = 0.0f;
+  for (int c = 0; c < 3; ++c)
+  {
+    out->center[c] = 0.5f * (lo[c] + hi[c]);
+    r2 += 0.25f * (hi[c] - lo[c]) * (hi[c] - lo[c]);
+  }
+  out->radius = std::sqrt(r2);
+  out->uv_density = 0.0f;
+
+  std::map<std::string, int>::const_iterator uv = primitive.attributes.find("TEXCOORD_" + std::to_string(texcoord));
+  if (uv == primitive.attributes.end() || !is_readable(model, model.accessors[uv->second]) ||
+    model.accessors[uv->second].count != positions.count || primitive.mode != TINYGLTF_MODE_TRIANGLES)
+    return true;
+  const tinygltf::Accessor& uvs = model.accessors[uv->second];
+
+  std::vector<uint32_t> indices;
+  if (primitive.indices >= 0)
+  {
+    const tinygltf::Accessor& accessor = model.accessors[primitive.indices];
+    if (!is_readable(model, accessor))
+      return true;
+    indices.resize(accessor.count);
+    for (size_t i = 0; i < accessor.count; ++i)
+    {
+      float v;
+      read_element(model, accessor, i, &v);
+      indices[i] = uint32_t(v);
+    }
+  }
+  else
+  {
+    indices.resize(positions.count);
+    for (size_t i = 0; i < indices.size(); ++i)
+      indices[i] = uint32_t(i);
+  }
+
+  // 삼각형마다 3D 면적과 UV 면적을 더한다.
+  double area = 0.0, uv_area = 0.0;
+  for (size_t t = 0; t + 2 < indices.size(); t += 3)
+  {
+    const uint32_t a = indices[t], b = indices[t + 1], c = indices[t + 2];
+    if (a >= positions.count || b >= positions.count || c >= positions.count)
+      continue;
+
+    const float* pa = &p[a * 3];
+    const float* pb = &p[b * 3];
+    const float* pc = &p[c * 3];
+    const double e1[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+    const double e2[3] = { pc[0] - pa[0], pc[1] - pa[1], pc[2] - pa[2] };
+    const double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+    area += 0.5 * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+    float ta[2], tb[2], tc[2];
+    read_element(model, uvs, a, ta);
+    read_element(model, uvs, b, tb);
+    read_element(model, uvs, c, tc);
+    uv_area += 0.5 * std::fabs(double(tb[0] - ta[0]) * (tc[1] - ta[1]) - double(tc[0] - ta[0]) * (tb[1] - ta[1]));
+  }
+  if (area > 0.0)
+    out->uv_density = float(std::sqrt(uv_area / area));
+  return true;
+}
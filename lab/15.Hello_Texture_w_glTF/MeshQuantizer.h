@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "../glTF/tiny_gltf.h"
+
+// 정점 attribute 양자화.
+//
+// KHR_mesh_quantization으로 들어온 byte/short attribute는 그대로 GPU에 올리고 (glVertexAttribPointer가 변환),
+// float attribute는 quantize_meshes()로 로딩 시에 줄일 수 있다.
+//   POSITION   : unsigned short x3 (메시마다 bounding box로 정규화, MeshDequantization으로 되돌림)
+//   NORMAL     : octahedral 인코딩한 normalized short x2 (셰이더에서 vec3로 디코딩)
+//   TEXCOORD_n : [0, 1] 안에 있으면 normalized unsigned short x2
+
+// 양자화된 POSITION을 메시 좌표로 되돌리는 변환: position = offset + scale * q
+struct MeshDequantization
+{
+  float scale[3];
+  float offset[3];
+
+  MeshDequantization()
+  {
+    scale[0] = scale[1] = scale[2] = 1.0f;
+    offset[0] = offset[1] = offset[2] = 0.0f;
+  }
+};
+
+// attribute의 componentType/normalized/type이 glTF(KHR_mesh_quantization 포함)에서 허용되는 조합인가
+bool is_valid_attribute_format(const std::string& name, const tinygltf::Accessor& accessor);
+
+// POSITION/NORMAL/TEXCOORD_n을 양자화한 새 buffer 하나를 추가하고 accessor를 그쪽으로 바꾼다.
+// dequant에는 model.meshes와 같은 순서로 메시마다의 변환이 들어간다.
+// morph target이나 sparse accessor가 있는 메시는 양자화하지 않는다. (dequant는 항등 변환)
+void quantize_meshes(tinygltf::Model& model, std::vector<MeshDequantization>* dequant);
+
+// primitive들이 쓰는 정점 attribute bufferView의 크기 합 (GPU에 올라가는 양, 공유하는 bufferView는 한 번만)
+size_t vertex_attribute_bytes(const tinygltf::Model& model);
+
+// primitive의 bounding sphere와 UV 밀도 (메시 좌표, 텍스처 streaming의 mip 추정용)
+struct PrimitiveExtent
+{
+  float center[3];
+  float radius;
+  float uv_density;     // 메시 좌표 길이 1당 UV 길이 (삼각형 면적 합의 비의 제곱근, 잴 수 없으면 0)
+};
+
+// POSITION으로 bounding sphere를, TEXCOORD_<texcoord>와 삼각형으로 UV 밀도를 잰다.
+// POSITION을 읽을 수 없으면 false (TRIANGLES가 아니면 uv_density는 0)
+bool measure_primitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive, int texcoord,
+  PrimitiveExtent* out);
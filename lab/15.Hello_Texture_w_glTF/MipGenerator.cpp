@@ -0,0 +1,491 @@
+#include "MipGenerator.h"
+#include "KtxTexture.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define MIPGEN_X86 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MIPGEN_TARGET(x)
+#else
+#define MIPGEN_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+namespace {
+  const double  PI = 3.14159265358979323846;
+  const int     LINEAR_STEPS = 16384;     // 선형 -> sRGB 표의 칸 수 (어두운 쪽에서도 0.1 단계 이내)
+  const double  KAISER_RADIUS = 3.0;      // 다음 level의 픽셀 단위
+  const double  KAISER_ALPHA = 4.0;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// sRGB 변환 표
+  ////////////////////////////////////////////////////////////////////////////////
+
+  struct SrgbTables
+  {
+    float         to_linear[256];
+    unsigned char from_linear[LINEAR_STEPS + 1];
+  };
+
+  double srgb_to_linear(double c)
+  {
+    return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+  }
+
+  double linear_to_srgb(double l)
+  {
+    return l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+  }
+
+  SrgbTables make_srgb_tables()
+  {
+    SrgbTables t;
+    for (int i = 0; i < 256; ++i)
+      t.to_linear[i] = float(srgb_to_linear(i / 255.0));
+    for (int i = 0; i <= LINEAR_STEPS; ++i)
+      t.from_linear[i] = static_cast<unsigned char>(linear_to_srgb(double(i) / LINEAR_STEPS) * 255.0 + 0.5);
+    return t;
+  }
+
+  const SrgbTables& srgb_tables()
+  {
+    static const SrgbTables tables = make_srgb_tables();
+    return tables;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// 필터 weight
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // 한 축의 출력 픽셀마다 taps개의 (입력 인덱스, weight). 모자라는 tap은 weight 0
+  struct AxisTaps
+  {
+    int                 taps;
+    std::vector<int>    index;
+    std::vector<float>  weight;
+  };
+
+  double bessel_i0(double x)
+  {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; ++k)
+    {
+      term *= (x / (2.0 * k)) * (x / (2.0 * k));
+      sum += term;
+    }
+    return sum;
+  }
+
+  double kaiser_sinc(double x)
+  {
+    if (std::fabs(x) >= KAISER_RADIUS)
+      return 0.0;
+    const double sinc = (x == 0.0) ? 1.0 : std::sin(PI * x) / (PI * x);
+    const double r = x / KAISER_RADIUS;
+    return sinc * bessel_i0(KAISER_ALPHA * std::sqrt(1.0 - r * r)) / bessel_i0(KAISER_ALPHA);
+  }
+
+  // src 픽셀을 dst 픽셀로 줄이는 weight. 픽셀 i는 [i, i + 1) 구간이다.
+  void make_taps(MipFilter filter, int src, int dst, AxisTaps* out)
+  {
+    const double scale = double(src) / dst;
+    const double radius = (filter == MIP_FILTER_KAISER) ? KAISER_RADIUS * scale : 0.5 * scale;
+    const int max_taps = int(std::ceil(2.0 * radius)) + 1;
+
+    std::vector<int> first(dst);
+    std::vector<double> w(size_t(dst) * max_taps);
+    out->taps = 1;
+    for (int i = 0; i < dst; ++i)
+    {
+      const double center = (i + 0.5) * scale;
+      first[i] = int(std::floor(center - radius));
+      double* wi = &w[size_t(i) * max_taps];
+      double sum = 0.0;
+      for (int k = 0; k < max_taps; ++k)
+      {
+        const int j = first[i] + k;
+        if (filter == MIP_FILTER_KAISER)   // 입력 픽셀 중심에서 샘플링
+          wi[k] = kaiser_sinc((j + 0.5 - center) / scale);
+        else                              // 출력 픽셀 영역과 겹치는 길이
+          wi[k] = std::max(0.0, std::min(j + 1.0, center + radius) - std::max(double(j), center - radius));
+        sum += wi[k];
+        if (wi[k] != 0.0)
+          out->taps = std::max(out->taps, k + 1);
+      }
+      for (int k = 0; k < max_taps; ++k)
+        wi[k] /= sum;
+    }
+
+    // 모든 출력 픽셀에서 0인 뒤쪽 tap은 뺀다. (box는 2x2가 된다)
+    out->index.resize(size_t(dst) * out->taps);
+    out->weight.resize(size_t(dst) * out->taps);
+    for (int i = 0; i < dst; ++i)
+    {
+      for (int k = 0; k < out->taps; ++k)
+      {
+        out->index[size_t(i) * out->taps + k] = std::min(std::max(first[i] + k, 0), src - 1);
+        out->weight[size_t(i) * out->taps + k] = float(w[size_t(i) * max_taps + k]);
+      }
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// 한 level 줄이기 (RGBA float)
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // 가로: 출력 픽셀 하나에 tap만큼 입력 픽셀을 더한다. (한 행)
+  void filter_row_scalar(const float* row, const AxisTaps& taps, int dst_w, float* out)
+  {
+    for (int x = 0; x < dst_w; ++x)
+    {
+      float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+      for (int k = 0; k < taps.taps; ++k)
+      {
+        const float w = taps.weight[size_t(x) * taps.taps + k];
+        const float* p = row + size_t(taps.index[size_t(x) * taps.taps + k]) * 4;
+        for (int ch = 0; ch < 4; ++ch)
+          acc[ch] = acc[ch] + w * p[ch];
+      }
+      std::memcpy(out + size_t(x) * 4, acc, sizeof(acc));
+    }
+  }
+
+  // 세로: 가로로 줄인 입력 행 tap개에 weight를 곱해 출력 행 하나를 만든다. (행 전체를 이어서 처리)
+  void filter_column_scalar(const float* const* rows, const float* weights, int taps, int width, float* out)
+  {
+    const size_t n = size_t(width) * 4;
+    std::fill(out, out + n, 0.0f);
+    for (int k = 0; k < taps; ++k)
+    {
+      const float w = weights[k];
+      const float* row = rows[k];
+      for (size_t i = 0; i < n; ++i)
+        out[i] = out[i] + w * row[i];
+    }
+  }
+
+#ifdef MIPGEN_X86
+  MIPGEN_TARGET("sse2")
+  void filter_row_sse2(const float* row, const AxisTaps& taps, int dst_w, float* out)
+  {
+    for (int x = 0; x < dst_w; ++x)
+    {
+      __m128 acc = _mm_setzero_ps();
+      for (int k = 0; k < taps.taps; ++k)
+      {
+        const __m128 w = _mm_set1_ps(taps.weight[size_t(x) * taps.taps + k]);
+        const __m128 p = _mm_loadu_ps(row + size_t(taps.index[size_t(x) * taps.taps + k]) * 4);
+        acc = _mm_add_ps(acc, _mm_mul_ps(w, p));
+      }
+      _mm_storeu_ps(out + size_t(x) * 4, acc);
+    }
+  }
+
+  MIPGEN_TARGET("sse2")
+  void filter_column_sse2(const float* const* rows, const float* weights, int taps, int width, float* out)
+  {
+    const size_t n = size_t(width) * 4;     // 픽셀 단위이므로 항상 4의 배수
+    for (size_t i = 0; i < n; i += 4)
+    {
+      __m128 acc = _mm_setzero_ps();
+      for (int k = 0; k < taps; ++k)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+      _mm_storeu_ps(out + i, acc);
+    }
+  }
+
+  bool cpu_has_sse2()
+  {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+  }
+#endif // MIPGEN_X86
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// RGBA8 <-> float
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void to_float(const unsigned char* rgba, size_t count, bool srgb, float* out)
+  {
+    const float* to_linear = srgb_tables().to_linear;
+    for (size_t i = 0; i < count; ++i, rgba += 4, out += 4)
+    {
+      for (int ch = 0; ch < 3; ++ch)
+        out[ch] = srgb ? to_linear[rgba[ch]] : rgba[ch] * (1.0f / 255.0f);
+      out[3] = rgba[3] * (1.0f / 255.0f);
+    }
+  }
+
+  // 반올림은 +0.5 후 버림으로 해서 SIMD/스칼라 결과를 맞춘다.
+  void to_rgba8_scalar(const float* src, size_t count, bool srgb, unsigned char* out)
+  {
+    const SrgbTables& t = srgb_tables();
+    for (size_t i = 0; i < count * 4; ++i)
+    {
+      const float v = std::min(std::max(src[i], 0.0f), 1.0f);
+      out[i] = (srgb && i % 4 != 3) ? t.from_linear[int(v * float(LINEAR_STEPS) + 0.5f)] :
+        static_cast<unsigned char>(int(v * 255.0f + 0.5f));
+    }
+  }
+
+#ifdef MIPGEN_X86
+  MIPGEN_TARGET("sse2")
+  void to_rgba8_sse2(const float* src, size_t count, bool srgb, unsigned char* out)
+  {
+    const SrgbTables& t = srgb_tables();
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f);
+    const __m128 scale = srgb ? _mm_setr_ps(float(LINEAR_STEPS), float(LINEAR_STEPS), float(LINEAR_STEPS), 255.0f) :
+      _mm_set1_ps(255.0f);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i * 4), zero), one);
+      int q[4];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(q), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half)));
+      unsigned char* p = out + i * 4;
+      if (srgb)
+      {
+        p[0] = t.from_linear[q[0]];
+        p[1] = t.from_linear[q[1]];
+        p[2] = t.from_linear[q[2]];
+      }
+      else
+      {
+        p[0] = static_cast<unsigned char>(q[0]);
+        p[1] = static_cast<unsigned char>(q[1]);
+        p[2] = static_cast<unsigned char>(q[2]);
+      }
+      p[3] = static_cast<unsigned char>(q[3]);
+    }
+  }
+#endif // MIPGEN_X86
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// 구현 선택
+  ////////////////////////////////////////////////////////////////////////////////
+
+  struct Impl
+  {
+    void (*filter_row)(const float*, const AxisTaps&, int, float*);
+    void (*filter_column)(const float* const*, const float*, int, int, float*);
+    void (*to_rgba8)(const float*, size_t, bool, unsigned char*);
+    const char* name;
+  };
+
+  Impl best_impl()
+  {
+#ifdef MIPGEN_X86
+    if (cpu_has_sse2())
+      return Impl{ filter_row_sse2, filter_column_sse2, to_rgba8_sse2, "sse2" };
+#endif
+    return Impl{ filter_row_scalar, filter_column_scalar, to_rgba8_scalar, "scalar" };
+  }
+
+  const Impl simd_impl = best_impl();
+  std::atomic<bool> simd_enabled(true);
+
+  const Impl& current_impl()
+  {
+    static const Impl scalar = { filter_row_scalar, filter_column_scalar, to_rgba8_scalar, "scalar" };
+    return simd_enabled ? simd_impl : scalar;
+  }
+
+  void mark_texture(const tinygltf::Model& model, int texture_index, std::vector<bool>* srgb)
+  {
+    if (size_t(texture_index) >= model.textures.size())
+      return;
+    const tinygltf::Texture& texture = model.textures[texture_index];
+    const int sources[2] = { texture.source, basisu_texture_source(texture) };
+    for (int source : sources)
+    {
+      if (size_t(source) < srgb->size())
+        (*srgb)[source] = true;
+    }
+  }
+} // namespace
+
+bool parse_mip_filter(const std::string& name, MipFilter* filter)
+{
+  if (name == "box")
+    *filter = MIP_FILTER_BOX;
+  else if (name == "kaiser")
+    *filter = MIP_FILTER_KAISER;
+  else
+    return false;
+  return true;
+}
+
+const char* mip_filter_name(MipFilter filter)
+{
+  switch (filter)
+  {
+  case MIP_FILTER_BOX:    return "box";
+  case MIP_FILTER_KAISER: return "kaiser";
+  default:                return "none";
+  }
+}
+
+std::vector<bool> srgb_images(const tinygltf::Model& model)
+{
+  std::vector<bool> srgb(model.images.size(), false);
+  for (const tinygltf::Material& material : model.materials)
+  {
+    tinygltf::ParameterMap::const_iterator base = material.values.find("baseColorTexture");
+    if (base != material.values.end())
+      mark_texture(model, base->second.TextureIndex(), &srgb);
+    tinygltf::ParameterMap::const_iterator emissive = material.additionalValues.find("emissiveTexture");
+    if (emissive != material.additionalValues.end())
+      mark_texture(model, emissive->second.TextureIndex(), &srgb);
+  }
+  return srgb;
+}
+
+void generate_mip_chain(const unsigned char* rgba, int width, int height, MipFilter filter, bool srgb,
+  std::vector<MipLevel>* levels)
+{
+  const Impl& impl = current_impl();
+  if (filter == MIP_FILTER_NONE)
+    filter = MIP_FILTER_BOX;
+
+  levels->assign(1, MipLevel());
+  levels->back().width = width;
+  levels->back().height = height;
+  levels->back().data.assign(rgba, rgba + size_t(width) * height * 4);
+
+  // 가로로 줄인 행은 세로 tap 수만큼의 ring에만 둔다. (세로 tap의 입력 행 번호는 출력 행을 따라 늘어나기만 한다)
+  // level 0은 행마다 float로 바꿔 가며 읽고, 그 다음부터는 앞 level의 float 결과를 읽는다.
+  std::vector<float> cur, next, row0(size_t(width) * 4), ring;
+  std::vector<int> ring_rows;
+  std::vector<const float*> tap_rows;
+  AxisTaps taps_x, taps_y;
+  while (width > 1 || height > 1)
+  {
+    const int w = std::max(1, width / 2), h = std::max(1, height / 2);
+    make_taps(filter, width, w, &taps_x);
+    make_taps(filter, height, h, &taps_y);
+
+    const size_t n = size_t(w) * 4;
+    ring.resize(n * taps_y.taps);
+    ring_rows.assign(taps_y.taps, -1);
+    tap_rows.resize(taps_y.taps);
+    next.resize(n * h);
+
+    levels->push_back(MipLevel());
+    MipLevel& level = levels->back();
+    level.width = w;
+    level.height = h;
+    level.data.resize(size_t(w) * h * 4);
+
+    for (int y = 0; y < h; ++y)
+    {
+      for (int k = 0; k < taps_y.taps; ++k)
+      {
+        const int src_y = taps_y.index[size_t(y) * taps_y.taps + k];
+        const int slot = src_y % taps_y.taps;
+        if (ring_rows[slot] != src_y)
+        {
+          const float* row = &row0[0];
+          if (cur.empty())
+            to_float(rgba + size_t(src_y) * width * 4, size_t(width), srgb, &row0[0]);
+          else
+            row = &cur[size_t(src_y) * width * 4];
+          impl.filter_row(row, taps_x, w, &ring[slot * n]);
+          ring_rows[slot] = src_y;
+        }
+        tap_rows[k] = &ring[slot * n];
+      }
+      impl.filter_column(&tap_rows[0], &taps_y.weight[size_t(y) * taps_y.taps], taps_y.taps, w, &next[y * n]);
+      impl.to_rgba8(&next[y * n], size_t(w), srgb, &level.data[size_t(y) * w * 4]);
+    }
+
+    cur.swap(next);
+    width = w;
+    height = h;
+  }
+}
+
+size_t mip_chain_bytes(const std::vector<MipLevel>& levels)
+{
+  size_t total = 0;
+  for (const MipLevel& level : levels)
+    total += level.data.size();
+  return total;
+}
+
+void reference_mip_level(const unsigned char* rgba, int width, int height, int level, bool srgb, MipLevel* out)
+{
+  int w = width, h = height;
+  for (int l = 0; l < level; ++l)
+  {
+    w = std::max(1, w / 2);
+    h = std::max(1, h / 2);
+  }
+  out->width = w;
+  out->height = h;
+  out->data.resize(size_t(w) * h * 4);
+
+  for (int y = 0; y < h; ++y)
+  {
+    const int y0 = int(int64_t(y) * height / h), y1 = int(int64_t(y + 1) * height / h);
+    for (int x = 0; x < w; ++x)
+    {
+      const int x0 = int(int64_t(x) * width / w), x1 = int(int64_t(x + 1) * width / w);
+      double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+      for (int sy = y0; sy < y1; ++sy)
+      {
+        for (int sx = x0; sx < x1; ++sx)
+        {
+          const unsigned char* p = rgba + (size_t(sy) * width + sx) * 4;
+          for (int ch = 0; ch < 4; ++ch)
+            sum[ch] += (srgb && ch != 3) ? srgb_to_linear(p[ch] / 255.0) : p[ch] / 255.0;
+        }
+      }
+      const double n = double(y1 - y0) * (x1 - x0);
+      for (int ch = 0; ch < 4; ++ch)
+      {
+        const double v = (srgb && ch != 3) ? linear_to_srgb(sum[ch] / n) : sum[ch] / n;
+        out->data[(size_t(y) * w + x) * 4 + ch] = static_cast<unsigned char>(v * 255.0 + 0.5);
+      }
+    }
+  }
+}
+
+double mip_level_psnr(const MipLevel& a, const MipLevel& b)
+{
+  if (a.width != b.width || a.height != b.height || a.data.size() != b.data.size())
+    return 0.0;
+
+  double error = 0.0;
+  for (size_t i = 0; i < a.data.size(); ++i)
+  {
+    if (i % 4 == 3)
+      continue;
+    const double d = double(a.data[i]) - double(b.data[i]);
+    error += d * d;
+  }
+  if (error == 0.0)
+    return 99.0;
+  const double mse = error / (double(a.data.size()) / 4 * 3);
+  return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+void mip_generator_use_simd(bool enable)
+{
+  simd_enabled = enable;
+}
+
+const char* mip_generator_impl_name()
+{
+  return current_impl().name;
+}
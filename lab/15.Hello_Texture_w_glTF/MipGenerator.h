@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "../glTF/tiny_gltf.h"
+
+// 디코딩된 RGBA8 이미지의 mip chain을 CPU에서 만든다.
+//
+// glGenerateMipmap은 렌더링 스레드에서 텍스처마다 차례로 돌고, 저장된 값(감마 공간)을 그대로 평균하므로
+// sRGB 색 텍스처는 작은 level로 갈수록 어두워진다. 여기서는 로더의 worker 스레드가 이미지마다 하나씩 만들고,
+// sRGB 이미지는 RGB를 선형 공간으로 바꿔 평균한 뒤 다시 sRGB로 되돌린다. (alpha는 항상 선형)
+// level 사이는 float로 이어서 계산하므로 양자화 오차가 쌓이지 않는다.
+// 필터는 가로/세로로 나누어 적용하고, 픽셀 하나(RGBA float 4개)를 SSE 레지스터 하나로 처리한다.
+// 크기 규칙은 GL과 같다. (다음 level은 max(1, 크기 / 2), 가장자리는 clamp)
+// OpenGL 호출은 하지 않는다.
+
+enum MipFilter
+{
+  MIP_FILTER_NONE,      // CPU에서 만들지 않음 (glGenerateMipmap, 압축은 2x2 평균)
+  MIP_FILTER_BOX,       // 2x2 평균 (홀수 크기는 면적 비율)
+  MIP_FILTER_KAISER,    // Kaiser 창을 씌운 sinc (반지름 3, alpha 4). 더 선명하지만 가장자리에 약한 ringing이 있다.
+};
+
+// RGBA8 level 하나
+struct MipLevel
+{
+  int width;
+  int height;
+  std::vector<unsigned char> data;
+};
+
+// "--mip-filter=kaiser" 같은 옵션 값을 읽는다. ("box", "kaiser")
+bool parse_mip_filter(const std::string& name, MipFilter* filter);
+const char* mip_filter_name(MipFilter filter);
+
+// glTF에서 sRGB로 저장되는 이미지 (baseColor, emissive 텍스처). 이미지 인덱스별
+std::vector<bool> srgb_images(const tinygltf::Model& model);
+
+// rgba (width x height, RGBA8)에서 1x1까지의 mip chain을 만든다. (levels[0]은 원본 복사)
+void generate_mip_chain(const unsigned char* rgba, int width, int height, MipFilter filter, bool srgb,
+  std::vector<MipLevel>* levels);
+
+// 모든 level의 바이트 수
+size_t mip_chain_bytes(const std::vector<MipLevel>& levels);
+
+// 품질 비교용: 원본의 각 영역을 (sRGB면 선형 공간에서) double로 평균한 level. box 필터의 참값이다.
+void reference_mip_level(const unsigned char* rgba, int width, int height, int level, bool srgb, MipLevel* out);
+
+// 크기가 같은 두 level의 RGB PSNR (dB). 완전히 같으면 99
+double mip_level_psnr(const MipLevel& a, const MipLevel& b);
+
+// 벤치마크용: false면 SIMD 경로를 쓰지 않는다.
+void mip_generator_use_simd(bool enable);
+
+// 현재 쓰이는 구현 이름 ("sse2", "scalar")
+const char* mip_generator_impl_name();
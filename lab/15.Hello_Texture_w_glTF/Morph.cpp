@@ -0,0 +1,302 @@
+#include "Morph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <numeric>
+
+#include "Animation.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define MORPH_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MORPH_TARGET(x)
+#else
+#define MORPH_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+namespace {
+  // accessor 하나를 스트림으로 푼다. bufferView가 없는 sparse accessor는 sparse 부분만 읽고,
+  // 나머지(dense, 또는 bufferView 위에 sparse를 덮은 것)는 전부 읽어서 0이 아닌 delta만 남긴다.
+  bool read_stream(const tinygltf::Model& model, int accessor_index, size_t num_vertices, MorphStream* out)
+  {
+    out->indices.clear();
+    out->deltas.clear();
+    if (accessor_index < 0 || size_t(accessor_index) >= model.accessors.size())
+      return false;
+    const tinygltf::Accessor& accessor = model.accessors[accessor_index];
+    if (accessor.type != TINYGLTF_TYPE_VEC3 || accessor.count != num_vertices)
+      return false;
+
+    std::vector<uint32_t> indices;
+    std::vector<float> values;
+    if (accessor.sparse.isSparse && accessor.bufferView < 0)
+    {
+      if (!read_sparse_accessor(model, accessor, &indices, &values))
+        return false;
+    }
+    else
+    {
+      if (!read_accessor_floats(model, accessor, &values))
+        return false;
+      indices.resize(num_vertices);
+      std::iota(indices.begin(), indices.end(), 0u);
+    }
+
+    // sparse 인덱스는 오름차순이어야 하지만 어긋난 파일도 같은 결과가 되도록 정렬한다.
+    std::vector<size_t> order(indices.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    if (!std::is_sorted(indices.begin(), indices.end()))
+      std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return indices[a] < indices[b]; });
+
+    for (size_t i : order)
+    {
+      // 같은 인덱스가 또 나오면 뒤의 값을 쓴다. (read_accessor_floats와 같음, SIMD 경로는 인덱스가 겹치지 않아야 한다)
+      if (!out->indices.empty() && out->indices.back() == indices[i])
+      {
+        out->indices.pop_back();
+        out->deltas.resize(out->deltas.size() - 4);
+      }
+      const float* v = &values[i * 3];
+      if (v[0] == 0.0f && v[1] == 0.0f && v[2] == 0.0f)
+        continue;
+      out->indices.push_back(indices[i]);
+      out->deltas.insert(out->deltas.end(), { v[0], v[1], v[2], 0.0f });
+    }
+    return true;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// 스트림 하나를 weight를 곱해 더한다.
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void add_stream_scalar(const MorphStream& stream, float weight, float* out)
+  {
+    for (size_t i = 0; i < stream.indices.size(); ++i)
+    {
+      float* o = out + size_t(stream.indices[i]) * 3;
+      const float* d = &stream.deltas[i * 4];
+      o[0] += weight * d[0];
+      o[1] += weight * d[1];
+      o[2] += weight * d[2];
+    }
+  }
+
+#ifdef MORPH_X86
+  // 인덱스가 이어지는 정점 4개는 출력이 float 12개로 붙어 있으므로 delta(x, y, z, 0) 4개를 (xyzx, yzxy, zxyz)로 모아
+  // 세 번에 더한다. (정점 하나씩 16바이트로 읽고 쓰면 다음 정점과 겹쳐 store forwarding이 막힌다)
+  // 떨어진 정점은 scalar로 더한다.
+  MORPH_TARGET("sse2")
+  void add_stream_sse(const MorphStream& stream, float weight, float* out)
+  {
+    const __m128 w = _mm_set1_ps(weight);
+    const size_t count = stream.indices.size();
+    size_t i = 0;
+    while (i < count)
+    {
+      const size_t index = stream.indices[i];
+      const float* d = &stream.deltas[i * 4];
+      float* o = out + index * 3;
+      if (i + 3 < count && stream.indices[i + 3] == index + 3)
+      {
+        const __m128 d0 = _mm_loadu_ps(d), d1 = _mm_loadu_ps(d + 4), d2 = _mm_loadu_ps(d + 8), d3 = _mm_loadu_ps(d + 12);
+        const __m128 z0x1 = _mm_shuffle_ps(d0, d1, _MM_SHUFFLE(0, 0, 2, 2));
+        const __m128 z2x3 = _mm_shuffle_ps(d2, d3, _MM_SHUFFLE(0, 0, 2, 2));
+        const __m128 p0 = _mm_shuffle_ps(d0, z0x1, _MM_SHUFFLE(2, 0, 1, 0));
+        const __m128 p1 = _mm_shuffle_ps(d1, d2, _MM_SHUFFLE(1, 0, 2, 1));
+        const __m128 p2 = _mm_shuffle_ps(z2x3, d3, _MM_SHUFFLE(2, 1, 2, 0));
+        _mm_storeu_ps(o, _mm_add_ps(_mm_loadu_ps(o), _mm_mul_ps(w, p0)));
+        _mm_storeu_ps(o + 4, _mm_add_ps(_mm_loadu_ps(o + 4), _mm_mul_ps(w, p1)));
+        _mm_storeu_ps(o + 8, _mm_add_ps(_mm_loadu_ps(o + 8), _mm_mul_ps(w, p2)));
+        i += 4;
+      }
+      else
+      {
+        o[0] += weight * d[0];
+        o[1] += weight * d[1];
+        o[2] += weight * d[2];
+        ++i;
+      }
+    }
+  }
+
+  bool cpu_has_sse2()
+  {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+  }
+#endif // MORPH_X86
+
+  struct Impl
+  {
+    void (*add_stream)(const MorphStream& stream, float weight, float* out);
+    const char* name;
+  };
+
+  Impl best_impl()
+  {
+#ifdef MORPH_X86
+    if (cpu_has_sse2())
+      return Impl{ add_stream_sse, "sse" };
+#endif
+    return Impl{ add_stream_scalar, "scalar" };
+  }
+
+  const Impl simd_impl = best_impl();
+  std::atomic<bool> simd_enabled(true);
+
+  const Impl& current_impl()
+  {
+    static const Impl scalar = { add_stream_scalar, "scalar" };
+    return simd_enabled ? simd_impl : scalar;
+  }
+
+  // build_morph_texels: 정점 하나에 붙는 (target, position delta, normal delta)
+  struct TexelEntry
+  {
+    uint32_t vertex;
+    uint32_t target;
+    const float* position;      // nullptr이면 0
+    const float* normal;
+  };
+} // namespace
+
+size_t MorphTargets::num_deltas() const
+{
+  size_t count = 0;
+  for (const MorphStream& stream : positions)
+    count += stream.indices.size();
+  for (const MorphStream& stream : normals)
+    count += stream.indices.size();
+  return count;
+}
+
+bool build_morph_targets(const tinygltf::Model& model, const tinygltf::Primitive& primitive, MorphTargets* out,
+  std::string* err)
+{
+  out->num_vertices = 0;
+  out->positions.clear();
+  out->normals.clear();
+  std::map<std::string, int>::const_iterator position = primitive.attributes.find("POSITION");
+  if (primitive.targets.empty() || position == primitive.attributes.end() ||
+    size_t(position->second) >= model.accessors.size())
+    return false;
+
+  const size_t num_vertices = model.accessors[position->second].count;
+  bool has_normals = false;
+  for (const std::map<std::string, int>& target : primitive.targets)
+    has_normals = has_normals || target.count("NORMAL") > 0;
+
+  out->num_vertices = num_vertices;
+  out->positions.resize(primitive.targets.size());
+  out->normals.resize(has_normals ? primitive.targets.size() : 0);
+  for (size_t t = 0; t < primitive.targets.size(); ++t)
+  {
+    const std::map<std::string, int>& target = primitive.targets[t];
+    std::map<std::string, int>::const_iterator p = target.find("POSITION");
+    std::map<std::string, int>::const_iterator n = target.find("NORMAL");
+    const bool ok = (p == target.end() || read_stream(model, p->second, num_vertices, &out->positions[t])) &&
+      (n == target.end() || read_stream(model, n->second, num_vertices, &out->normals[t]));
+    if (!ok)
+    {
+      *err += "cannot read morph target " + std::to_string(t) + "\n";
+      out->positions.clear();
+      out->normals.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+void build_morph_texels(const MorphTargets& targets, bool with_normals, std::vector<float>* texels)
+{
+  const size_t num_vertices = targets.num_vertices;
+  with_normals = with_normals && !targets.normals.empty();
+
+  // target마다 position과 normal 스트림을 정점 인덱스로 합친다. (둘 중 하나만 0이 아닐 수 있다)
+  std::vector<TexelEntry> entries;
+  for (size_t t = 0; t < targets.positions.size(); ++t)
+  {
+    static const MorphStream empty;
+    const MorphStream& p = targets.positions[t];
+    const MorphStream& n = with_normals ? targets.normals[t] : empty;
+    size_t i = 0, j = 0;
+    while (i < p.indices.size() || j < n.indices.size())
+    {
+      const uint32_t vp = (i < p.indices.size()) ? p.indices[i] : UINT32_MAX;
+      const uint32_t vn = (j < n.indices.size()) ? n.indices[j] : UINT32_MAX;
+      const uint32_t vertex = std::min(vp, vn);
+      entries.push_back(TexelEntry{ vertex, uint32_t(t), vp == vertex ? &p.deltas[i++ * 4] : nullptr,
+        vn == vertex ? &n.deltas[j++ * 4] : nullptr });
+    }
+  }
+
+  // 정점별로 모은다. (정점 안에서는 target 순서)
+  std::stable_sort(entries.begin(), entries.end(),
+    [](const TexelEntry& a, const TexelEntry& b) { return a.vertex < b.vertex; });
+  const size_t stride = with_normals ? 2 : 1;
+  texels->assign((num_vertices + entries.size() * stride) * 4, 0.0f);
+  float* header = texels->data();
+  float* body = texels->data() + num_vertices * 4;
+  for (size_t e = 0; e < entries.size(); ++e)
+  {
+    const TexelEntry& entry = entries[e];
+    float* h = header + size_t(entry.vertex) * 4;
+    if (h[1] == 0.0f)
+      h[0] = float(num_vertices + e * stride);
+    h[1] += 1.0f;
+
+    float* texel = body + e * stride * 4;
+    if (entry.position)
+      std::copy(entry.position, entry.position + 3, texel);
+    texel[3] = float(entry.target);
+    if (with_normals && entry.normal)
+      std::copy(entry.normal, entry.normal + 3, texel + 4);
+  }
+}
+
+void apply_morph_targets(const float* base, size_t num_vertices, const std::vector<MorphStream>& streams,
+  const float* weights, size_t num_weights, float* out)
+{
+  if (out != base)
+    std::memcpy(out, base, num_vertices * 3 * sizeof(float));
+  const Impl& impl = current_impl();
+  for (size_t t = 0; t < std::min(streams.size(), num_weights); ++t)
+  {
+    if (weights[t] != 0.0f)
+      impl.add_stream(streams[t], weights[t], out);
+  }
+}
+
+void apply_morph_targets_reference(const float* base, size_t num_vertices, const std::vector<std::vector<float>>& deltas,
+  const float* weights, size_t num_weights, float* out)
+{
+  if (out != base)
+    std::memcpy(out, base, num_vertices * 3 * sizeof(float));
+  for (size_t t = 0; t < std::min(deltas.size(), num_weights); ++t)
+  {
+    if (deltas[t].size() != num_vertices * 3)
+      continue;
+    for (size_t i = 0; i < num_vertices * 3; ++i)
+      out[i] += weights[t] * deltas[t][i];
+  }
+}
+
+void morph_use_simd(bool enable)
+{
+  simd_enabled = enable;
+}
+
+const char* morph_impl_name()
+{
+  return current_impl().name;
+}
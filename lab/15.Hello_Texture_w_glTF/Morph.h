@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../glTF/tiny_gltf.h"
+
+// glTF morph target: primitive.targets의 POSITION/NORMAL delta.
+//
+// 로딩할 때 target마다 0이 아닌 delta만 (정점 인덱스, delta) 스트림으로 풀어 둔다. sparse accessor는 sparse 부분을 그대로 쓴다.
+// GPU는 스트림을 정점별로 다시 묶은 표(build_morph_texels)를 텍스처 buffer로 읽고 weight는 draw마다 uniform으로 받는다.
+// CPU fallback은 weight가 0이 아닌 target의 스트림만 더한다.
+// OpenGL 호출은 하지 않는다.
+
+// target 하나의 attribute 하나
+struct MorphStream
+{
+  std::vector<uint32_t> indices;        // 정점 인덱스 (오름차순)
+  std::vector<float> deltas;            // indices.size() * 4 (x, y, z, 0: SIMD로 한 번에 읽는다)
+};
+
+struct MorphTargets
+{
+  size_t num_vertices = 0;
+  std::vector<MorphStream> positions;   // target별
+  std::vector<MorphStream> normals;     // target별 (NORMAL target이 하나도 없으면 비어 있음)
+
+  size_t num_deltas() const;            // 모든 스트림의 delta 수
+};
+
+// primitive의 targets를 스트림으로 푼다. target이 없거나 읽을 수 없는 target이 있으면 false (읽을 수 없으면 err에 적음)
+bool build_morph_targets(const tinygltf::Model& model, const tinygltf::Primitive& primitive, MorphTargets* out,
+  std::string* err);
+
+// GPU용 표 (RGBA32F 텍셀 * 4 float): 정점마다 (첫 항목의 텍셀, 항목 수, 0, 0)이 num_vertices개 있고 그 뒤에 항목들이 온다.
+// 항목은 (position delta xyz, target) 텍셀 하나와, with_normals면 (normal delta xyz, 0) 텍셀이 뒤따른다.
+void build_morph_texels(const MorphTargets& targets, bool with_normals, std::vector<float>* texels);
+
+// CPU fallback: out = base + Σ weights[t] * streams[t] (정점 * 3). weight가 0인 target의 스트림은 읽지 않는다.
+// SSE가 있으면 인덱스가 이어지는 정점 4개의 delta를 세 번에 더한다.
+void apply_morph_targets(const float* base, size_t num_vertices, const std::vector<MorphStream>& streams,
+  const float* weights, size_t num_weights, float* out);
+
+// 기준 구현: target마다 dense delta(정점 * 3)를 모든 정점에 더한다. (검증과 벤치마크용)
+void apply_morph_targets_reference(const float* base, size_t num_vertices, const std::vector<std::vector<float>>& deltas,
+  const float* weights, size_t num_weights, float* out);
+
+// 벤치마크용: false면 SIMD 경로를 쓰지 않는다.
+void morph_use_simd(bool enable);
+
+// 현재 쓰이는 구현 이름 ("sse", "scalar")
+const char* morph_impl_name();
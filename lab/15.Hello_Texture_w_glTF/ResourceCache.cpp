@@ -0,0 +1,143 @@
+#include "ResourceCache.h"
+#include "Hash.h"
+
+ResourceCache::ResourceCache()
+  : buffer_hits_(0), texture_hits_(0), buffer_bytes_saved_(0)
+{
+}
+
+GLuint ResourceCache::acquire_buffer(GLenum target, const void* data, size_t size)
+{
+  bool created;
+  return acquire_buffer(target, data, size, data, &created);
+}
+
+GLuint ResourceCache::acquire_buffer(GLenum target, const void* data, size_t size, bool* created)
+{
+  return acquire_buffer(target, data, size, nullptr, created);
+}
+
+GLuint ResourceCache::acquire_buffer(GLenum target, const void* data, size_t size, const void* initial, bool* created)
+{
+  // 같은 바이트라도 target(index/vertex)이 다르면 따로 만든다.
+  uint64_t key = hash_combine(hash64(data, size), (uint64_t(target) << 48) ^ size);
+
+  std::unordered_map<uint64_t, Entry>::iterator it = buffers_.find(key);
+  if (it != buffers_.end())
+  {
+    ++it->second.refs;
+    ++buffer_hits_;
+    buffer_bytes_saved_ += size;
+    *created = false;
+    return it->second.name;
+  }
+
+  Entry entry = { 0, 1 };
+  glGenBuffers(1, &entry.name);
+  glBindBuffer(target, entry.name);
+  glBufferData(target, size, initial, GL_STATIC_DRAW);
+
+  buffers_[key] = entry;
+  buffer_keys_[entry.name] = key;
+  *created = true;
+  return entry.name;
+}
+
+void ResourceCache::release_buffer(GLuint buffer)
+{
+  std::unordered_map<GLuint, uint64_t>::iterator key = buffer_keys_.find(buffer);
+  if (key == buffer_keys_.end())
+    return;
+
+  std::unordered_map<uint64_t, Entry>::iterator it = buffers_.find(key->second);
+  if (--it->second.refs > 0)
+    return;
+
+  glDeleteBuffers(1, &buffer);
+  buffers_.erase(it);
+  buffer_keys_.erase(key);
+}
+
+GLuint ResourceCache::acquire_texture(uint64_t key, bool* created)
+{
+  std::unordered_map<uint64_t, Entry>::iterator it = textures_.find(key);
+  if (it != textures_.end())
+  {
+    ++it->second.refs;
+    ++texture_hits_;
+    *created = false;
+    return it->second.name;
+  }
+
+  Entry entry = { 0, 1 };
+  glGenTextures(1, &entry.name);
+
+  textures_[key] = entry;
+  texture_keys_[entry.name] = key;
+  *created = true;
+  return entry.name;
+}
+
+bool ResourceCache::release_texture(GLuint texture)
+{
+  std::unordered_map<GLuint, uint64_t>::iterator key = texture_keys_.find(texture);
+  if (key == texture_keys_.end())
+    return false;
+
+  std::unordered_map<uint64_t, Entry>::iterator it = textures_.find(key->second);
+  if (--it->second.refs > 0)
+    return false;
+
+  glDeleteTextures(1, &texture);
+  textures_.erase(it);
+  texture_keys_.erase(key);
+  return true;
+}
+
+GLuint ResourceCache::acquire_sampler(const tinygltf::Sampler& sampler)
+{
+  const uint64_t key = sampler_key(sampler);
+  std::unordered_map<uint64_t, Entry>::iterator it = samplers_.find(key);
+  if (it != samplers_.end())
+  {
+    ++it->second.refs;
+    return it->second.name;
+  }
+
+  Entry entry = { 0, 1 };
+  glGenSamplers(1, &entry.name);
+  glSamplerParameteri(entry.name, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
+  glSamplerParameteri(entry.name, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+  glSamplerParameteri(entry.name, GL_TEXTURE_WRAP_S, sampler.wrapS);
+  glSamplerParameteri(entry.name, GL_TEXTURE_WRAP_T, sampler.wrapT);
+
+  samplers_[key] = entry;
+  sampler_keys_[entry.name] = key;
+  return entry.name;
+}
+
+void ResourceCache::release_sampler(GLuint sampler)
+{
+  std::unordered_map<GLuint, uint64_t>::iterator key = sampler_keys_.find(sampler);
+  if (key == sampler_keys_.end())
+    return;
+
+  std::unordered_map<uint64_t, Entry>::iterator it = samplers_.find(key->second);
+  if (--it->second.refs > 0)
+    return;
+
+  glDeleteSamplers(1, &sampler);
+  samplers_.erase(it);
+  sampler_keys_.erase(key);
+}
+
+uint64_t ResourceCache::texture_key(uint64_t image_hash, const tinygltf::Sampler& sampler)
+{
+  return hash_combine(image_hash, sampler_key(sampler));
+}
+
+uint64_t ResourceCache::sampler_key(const tinygltf::Sampler& sampler)
+{
+  const int state[4] = { sampler.minFilter, sampler.magFilter, sampler.wrapS, sampler.wrapT };
+  return hash64(state, sizeof(state));
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "../glTF/tiny_gltf.h"
+
+// 내용이 같은 GL buffer/texture를 한 번만 만들고 여러 모델이 참조 횟수로 공유하는 캐시.
+//
+// 키는 내용의 64-bit 해시(Hash.h)이다. 같은 해시면 같은 내용으로 보고 비교하지 않는다.
+// glTF sampler는 상태(필터, wrap)가 같으면 GL sampler 객체 하나를 같이 쓴다.
+// 렌더링 스레드에서만 쓴다.
+class ResourceCache
+{
+public:
+  ResourceCache();
+
+  // 같은 내용의 buffer가 있으면 그것을, 없으면 새로 만들어 data를 올린다. (참조 +1)
+  GLuint acquire_buffer(GLenum target, const void* data, size_t size);
+
+  // 위와 같지만 새로 만든 buffer는 size만큼 자리만 잡는다. 이때 *created가 true이고 내용은 호출한 쪽이 채운다.
+  GLuint acquire_buffer(GLenum target, const void* data, size_t size, bool* created);
+  void release_buffer(GLuint buffer);
+
+  // key(texture_key())가 같은 텍스처가 있으면 그것을, 없으면 새 텍스처 이름을 만든다. (참조 +1)
+  // 새로 만든 경우 *created가 true이고, 내용과 파라미터는 호출한 쪽이 채운다.
+  GLuint acquire_texture(uint64_t key, bool* created);
+  bool release_texture(GLuint texture);   // 마지막 참조여서 지웠으면 true
+
+  // 상태가 같은 GL sampler 객체가 있으면 그것을, 없으면 만들어서 반환한다. (참조 +1, GL 3.3 / ARB_sampler_objects)
+  GLuint acquire_sampler(const tinygltf::Sampler& sampler);
+  void release_sampler(GLuint sampler);
+
+  // 이미지 내용 해시와 sampler 상태로 텍스처 키를 만든다.
+  static uint64_t texture_key(uint64_t image_hash, const tinygltf::Sampler& sampler);
+
+  // sampler 상태(필터, wrap)의 키
+  static uint64_t sampler_key(const tinygltf::Sampler& sampler);
+
+  size_t num_buffers() const { return buffers_.size(); }
+  size_t num_textures() const { return textures_.size(); }
+  size_t num_samplers() const { return samplers_.size(); }
+  size_t buffer_hits() const { return buffer_hits_; }       // 공유해서 만들지 않은 횟수
+  size_t texture_hits() const { return texture_hits_; }
+  size_t buffer_bytes_saved() const { return buffer_bytes_saved_; }
+
+private:
+  ResourceCache(const ResourceCache&);
+  ResourceCache& operator=(const ResourceCache&);
+
+  // 새로 만든 buffer는 initial로 채운다. (nullptr면 자리만)
+  GLuint acquire_buffer(GLenum target, const void* data, size_t size, const void* initial, bool* created);
+
+  struct Entry
+  {
+    GLuint  name;
+    int     refs;
+  };
+
+  std::unordered_map<uint64_t, Entry>   buffers_;
+  std::unordered_map<uint64_t, Entry>   textures_;
+  std::unordered_map<uint64_t, Entry>   samplers_;
+  std::unordered_map<GLuint, uint64_t>  buffer_keys_;     // GL 이름 -> 키 (release용)
+  std::unordered_map<GLuint, uint64_t>  texture_keys_;
+  std::unordered_map<GLuint, uint64_t>  sampler_keys_;
+
+  size_t  buffer_hits_;
+  size_t  texture_hits_;
+  size_t  buffer_bytes_saved_;
+};
@@ -0,0 +1,705 @@
+#include "SceneCache.h"
+#include "Hash.h"
+#include "KtxTexture.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#define getpid _getpid
+#endif
+
+namespace {
+  const char      CACHE_MAGIC[8] = { 'G', 'L', 'T', 'F', 'C', 'A', 'C', 'H' };
+  const uint32_t  CACHE_VERSION = 4;     // 4: 3까지는 --quantize로 양자화한 geometry가 저장될 수 있었다.
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// 쓰기
+  ////////////////////////////////////////////////////////////////////////////////
+  class Writer
+  {
+  public:
+    explicit Writer(std::ofstream& out) : out_(out) {}
+
+    void bytes(const void* data, size_t size)
+    {
+      if (size > 0)
+        out_.write(static_cast<const char*>(data), std::streamsize(size));
+    }
+
+    template <typename T>
+    void pod(const T& value) { bytes(&value, sizeof(T)); }
+
+    void i32(int value)          { pod(static_cast<int32_t>(value)); }
+    void u64(uint64_t value)     { pod(value); }
+    void f64(double value)       { pod(value); }
+    void boolean(bool value)     { pod(static_cast<uint8_t>(value ? 1 : 0)); }
+
+    void str(const std::string& s)
+    {
+      u64(s.size());
+      bytes(s.data(), s.size());
+    }
+
+    template <typename T>
+    void pod_array(const std::vector<T>& v)
+    {
+      u64(v.size());
+      bytes(v.empty() ? nullptr : &v[0], v.size() * sizeof(T));
+    }
+
+    void int_array(const std::vector<int>& v)
+    {
+      u64(v.size());
+      for (int i : v) i32(i);
+    }
+
+    void int_map(const std::map<std::string, int>& m)
+    {
+      u64(m.size());
+      for (const auto& it : m) { str(it.first); i32(it.second); }
+    }
+
+    void parameter_map(const tinygltf::ParameterMap& m)
+    {
+      u64(m.size());
+      for (const auto& it : m)
+      {
+        const tinygltf::Parameter& p = it.second;
+        str(it.first);
+        boolean(p.bool_value);
+        boolean(p.has_number_value);
+        str(p.string_value);
+        pod_array(p.number_array);
+        u64(p.json_double_value.size());
+        for (const auto& jt : p.json_double_value) { str(jt.first); f64(jt.second); }
+        f64(p.number_value);
+      }
+    }
+
+    bool good() const { return out_.good(); }
+
+  private:
+    std::ofstream& out_;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// 읽기 (mmap된 메모리에서 직접 읽음)
+  ////////////////////////////////////////////////////////////////////////////////
+  class Reader
+  {
+  public:
+    Reader(const unsigned char* data, size_t size)
+      : p_(data), end_(data + size), ok_(true) {}
+
+    bool bytes(void* dst, size_t size)
+    {
+      if (!ok_ || size_t(end_ - p_) < size) { ok_ = false; return false; }
+      if (size > 0) std::memcpy(dst, p_, size);
+      p_ += size;
+      return true;
+    }
+
+    template <typename T>
+    T pod() { T value = T(); bytes(&value, sizeof(T)); return value; }
+
+    int       i32()     { return pod<int32_t>(); }
+    uint64_t  u64()     { return pod<uint64_t>(); }
+    double    f64()     { return pod<double>(); }
+    bool      boolean() { return pod<uint8_t>() != 0; }
+
+    // 남은 크기보다 큰 배열 길이는 깨진 파일로 본다.
+    size_t count(size_t element_size)
+    {
+      uint64_t n = u64();
+      if (!ok_ || (element_size > 0 && n > size_t(end_ - p_) / element_size)) { ok_ = false; return 0; }
+      return size_t(n);
+    }
+
+    std::string str()
+    {
+      size_t n = count(1);
+      std::string s(n, '\0');
+      if (n > 0) bytes(&s[0], n);
+      return s;
+    }
+
+    template <typename T>
+    void pod_array(std::vector<T>& v)
+    {
+      v.resize(count(sizeof(T)));
+      if (!v.empty()) bytes(&v[0], v.size() * sizeof(T));
+    }
+
+    void int_array(std::vector<int>& v)
+    {
+      v.resize(count(sizeof(int32_t)));
+      for (int& i : v) i = i32();
+    }
+
+    void int_map(std::map<std::string, int>& m)
+    {
+      size_t n = count(1);
+      for (size_t i = 0; i < n && ok_; ++i)
+      {
+        std::string key = str();
+        m[key] = i32();
+      }
+    }
+
+    void parameter_map(tinygltf::ParameterMap& m)
+    {
+      size_t n = count(1);
+      for (size_t i = 0; i < n && ok_; ++i)
+      {
+        tinygltf::Parameter& p = m[str()];
+        p.bool_value = boolean();
+        p.has_number_value = boolean();
+        p.string_value = str();
+        pod_array(p.number_array);
+        size_t num_json = count(1);
+        for (size_t j = 0; j < num_json && ok_; ++j)
+        {
+          std::string key = str();
+          p.json_double_value[key] = f64();
+        }
+        p.number_value = f64();
+      }
+    }
+
+    bool ok() const { return ok_; }
+
+  private:
+    const unsigned char* p_;
+    const unsigned char* end_;
+    bool ok_;
+  };
+
+  void write_model(Writer& w, const tinygltf::Model& model, const std::vector<tinygltf::Buffer>& buffers,
+    size_t num_buffers, const std::vector<tinygltf::Image>& images)
+  {
+    w.u64(num_buffers);
+    for (size_t i = 0; i < num_buffers; ++i)
+    {
+      const tinygltf::Buffer& buffer = buffers[i];
+      w.str(buffer.name);
+      w.str(buffer.uri);
+      w.pod_array(buffer.data);
+    }
+
+    w.u64(model.bufferViews.size());
+    for (const tinygltf::BufferView& view : model.bufferViews)
+    {
+      w.str(view.name);
+      w.i32(view.buffer);
+      w.u64(view.byteOffset);
+      w.u64(view.byteLength);
+      w.u64(view.byteStride);
+      w.i32(view.target);
+      w.boolean(view.dracoDecoded);
+    }
+
+    w.u64(model.accessors.size());
+    for (const tinygltf::Accessor& accessor : model.accessors)
+    {
+      w.str(accessor.name);
+      w.i32(accessor.bufferView);
+      w.u64(accessor.byteOffset);
+      w.boolean(accessor.normalized);
+      w.i32(accessor.componentType);
+      w.u64(accessor.count);
+      w.i32(accessor.type);
+      w.pod_array(accessor.minValues);
+      w.pod_array(accessor.maxValues);
+      w.boolean(accessor.sparse.isSparse);
+      w.i32(accessor.sparse.count);
+      w.i32(accessor.sparse.indices.byteOffset);
+      w.i32(accessor.sparse.indices.bufferView);
+      w.i32(accessor.sparse.indices.componentType);
+      w.i32(accessor.sparse.values.bufferView);
+      w.i32(accessor.sparse.values.byteOffset);
+    }
+
+    w.u64(model.meshes.size());
+    for (const tinygltf::Mesh& mesh : model.meshes)
+    {
+      w.str(mesh.name);
+      w.pod_array(mesh.weights);
+      w.u64(mesh.primitives.size());
+      for (const tinygltf::Primitive& primitive : mesh.primitives)
+      {
+        w.int_map(primitive.attributes);
+        w.i32(primitive.material);
+        w.i32(primitive.indices);
+        w.i32(primitive.mode);
+        w.u64(primitive.targets.size());
+        for (const std::map<std::string, int>& target : primitive.targets)
+          w.int_map(target);
+      }
+    }
+
+    w.u64(model.materials.size());
+    for (const tinygltf::Material& material : model.materials)
+    {
+      w.str(material.name);
+      w.parameter_map(material.values);
+      w.parameter_map(material.additionalValues);
+    }
+
+    w.u64(model.textures.size());
+    for (const tinygltf::Texture& texture : model.textures)
+    {
+      w.str(texture.name);
+      w.i32(texture.sampler);
+      w.i32(texture.source);
+      w.i32(basisu_texture_source(texture));  // KHR_texture_basisu (없으면 -1)
+    }
+
+    w.u64(model.samplers.size());
+    for (const tinygltf::Sampler& sampler : model.samplers)
+    {
+      w.str(sampler.name);
+      w.i32(sampler.minFilter);
+      w.i32(sampler.magFilter);
+      w.i32(sampler.wrapS);
+      w.i32(sampler.wrapT);
+      w.i32(sampler.wrapR);
+    }
+
+    w.u64(images.size());
+    for (const tinygltf::Image& image : images)
+    {
+      w.str(image.name);
+      w.str(image.uri);
+      w.str(image.mimeType);
+      w.i32(image.bufferView);
+      w.i32(image.width);
+      w.i32(image.height);
+      w.i32(image.component);
+      w.i32(image.bits);
+      w.i32(image.pixel_type);
+      w.i32(image.as_is ? 1 : 0);   // 중복이라 디코딩하지 않은 이미지는 인코딩된 채로 남아 있다.
+      w.pod_array(image.image);
+    }
+
+    w.u64(model.nodes.size());
+    for (const tinygltf::Node& node : model.nodes)
+    {
+      w.str(node.name);
+      w.i32(node.camera);
+      w.i32(node.skin);
+      w.i32(node.mesh);
+      w.int_array(node.children);
+      w.pod_array(node.rotation);
+      w.pod_array(node.scale);
+      w.pod_array(node.translation);
+      w.pod_array(node.matrix);
+      w.pod_array(node.weights);
+    }
+
+    w.u64(model.scenes.size());
+    for (const tinygltf::Scene& scene : model.scenes)
+    {
+      w.str(scene.name);
+      w.int_array(scene.nodes);
+    }
+    w.i32(model.defaultScene);
+
+    w.u64(model.cameras.size());
+    for (const tinygltf::Camera& camera : model.cameras)
+    {
+      w.str(camera.name);
+      w.str(camera.type);
+      w.f64(camera.perspective.aspectRatio);
+      w.f64(camera.perspective.yfov);
+      w.f64(camera.perspective.zfar);
+      w.f64(camera.perspective.znear);
+      w.f64(camera.orthographic.xmag);
+      w.f64(camera.orthographic.ymag);
+      w.f64(camera.orthographic.zfar);
+      w.f64(camera.orthographic.znear);
+    }
+
+    w.u64(model.skins.size());
+    for (const tinygltf::Skin& skin : model.skins)
+    {
+      w.str(skin.name);
+      w.i32(skin.inverseBindMatrices);
+      w.i32(skin.skeleton);
+      w.int_array(skin.joints);
+    }
+
+    w.u64(model.animations.size());
+    for (const tinygltf::Animation& animation : model.animations)
+    {
+      w.str(animation.name);
+      w.u64(animation.channels.size());
+      for (const tinygltf::AnimationChannel& channel : animation.channels)
+      {
+        w.i32(channel.sampler);
+        w.i32(channel.target_node);
+        w.str(channel.target_path);
+      }
+      w.u64(animation.samplers.size());
+      for (const tinygltf::AnimationSampler& sampler : animation.samplers)
+      {
+        w.i32(sampler.input);
+        w.i32(sampler.output);
+        w.str(sampler.interpolation);
+      }
+    }
+
+    w.u64(model.extensionsUsed.size());
+    for (const std::string& ext : model.extensionsUsed)
+      w.str(ext);
+  }
+
+  bool read_model(Reader& r, tinygltf::Model& model)
+  {
+    model.buffers.resize(r.count(1));
+    for (tinygltf::Buffer& buffer : model.buffers)
+    {
+      buffer.name = r.str();
+      buffer.uri = r.str();
+      r.pod_array(buffer.data);
+    }
+
+    model.bufferViews.resize(r.count(1));
+    for (tinygltf::BufferView& view : model.bufferViews)
+    {
+      view.name = r.str();
+      view.buffer = r.i32();
+      view.byteOffset = size_t(r.u64());
+      view.byteLength = size_t(r.u64());
+      view.byteStride = size_t(r.u64());
+      view.target = r.i32();
+      view.dracoDecoded = r.boolean();
+    }
+
+    model.accessors.resize(r.count(1));
+    for (tinygltf::Accessor& accessor : model.accessors)
+    {
+      accessor.name = r.str();
+      accessor.bufferView = r.i32();
+      accessor.byteOffset = size_t(r.u64());
+      accessor.normalized = r.boolean();
+      accessor.componentType = r.i32();
+      accessor.count = size_t(r.u64());
+      accessor.type = r.i32();
+      r.pod_array(accessor.minValues);
+      r.pod_array(accessor.maxValues);
+      accessor.sparse.isSparse = r.boolean();
+      accessor.sparse.count = r.i32();
+      accessor.sparse.indices.byteOffset = r.i32();
+      accessor.sparse.indices.bufferView = r.i32();
+      accessor.sparse.indices.componentType = r.i32();
+      accessor.sparse.values.bufferView = r.i32();
+      accessor.sparse.values.byteOffset = r.i32();
+    }
+
+    model.meshes.resize(r.count(1));
+    for (tinygltf::Mesh& mesh : model.meshes)
+    {
+      mesh.name = r.str();
+      r.pod_array(mesh.weights);
+      mesh.primitives.resize(r.count(1));
+      for (tinygltf::Primitive& primitive : mesh.primitives)
+      {
+        r.int_map(primitive.attributes);
+        primitive.material = r.i32();
+        primitive.indices = r.i32();
+        primitive.mode = r.i32();
+        primitive.targets.resize(r.count(1));
+        for (std::map<std::string, int>& target : primitive.targets)
+          r.int_map(target);
+      }
+    }
+
+    model.materials.resize(r.count(1));
+    for (tinygltf::Material& material : model.materials)
+    {
+      material.name = r.str();
+      r.parameter_map(material.values);
+      r.parameter_map(material.additionalValues);
+    }
+
+    model.textures.resize(r.count(1));
+    for (tinygltf::Texture& texture : model.textures)
+    {
+      texture.name = r.str();
+      texture.sampler = r.i32();
+      texture.source = r.i32();
+      int basisu_source = r.i32();
+      if (basisu_source >= 0)
+      {
+        tinygltf::Value::Object extension;
+        extension["source"] = tinygltf::Value(basisu_source);
+        texture.extensions["KHR_texture_basisu"] = tinygltf::Value(extension);
+      }
+    }
+
+    model.samplers.resize(r.count(1));
+    for (tinygltf::Sampler& sampler : model.samplers)
+    {
+      sampler.name = r.str();
+      sampler.minFilter = r.i32();
+      sampler.magFilter = r.i32();
+      sampler.wrapS = r.i32();
+      sampler.wrapT = r.i32();
+      sampler.wrapR = r.i32();
+    }
+
+    model.images.resize(r.count(1));
+    for (tinygltf::Image& image : model.images)
+    {
+      image.name = r.str();
+      image.uri = r.str();
+      image.mimeType = r.str();
+      image.bufferView = r.i32();
+      image.width = r.i32();
+      image.height = r.i32();
+      image.component = r.i32();
+      image.bits = r.i32();
+      image.pixel_type = r.i32();
+      image.as_is = r.i32() != 0;
+      r.pod_array(image.image);
+    }
+
+    model.nodes.resize(r.count(1));
+    for (tinygltf::Node& node : model.nodes)
+    {
+      node.name = r.str();
+      node.camera = r.i32();
+      node.skin = r.i32();
+      node.mesh = r.i32();
+      r.int_array(node.children);
+      r.pod_array(node.rotation);
+      r.pod_array(node.scale);
+      r.pod_array(node.translation);
+      r.pod_array(node.matrix);
+      r.pod_array(node.weights);
+    }
+
+    model.scenes.resize(r.count(1));
+    for (tinygltf::Scene& scene : model.scenes)
+    {
+      scene.name = r.str();
+      r.int_array(scene.nodes);
+    }
+    model.defaultScene = r.i32();
+
+    model.cameras.resize(r.count(1));
+    for (tinygltf::Camera& camera : model.cameras)
+    {
+      camera.name = r.str();
+      camera.type = r.str();
+      camera.perspective.aspectRatio = r.f64();
+      camera.perspective.yfov = r.f64();
+      camera.perspective.zfar = r.f64();
+      camera.perspective.znear = r.f64();
+      camera.orthographic.xmag = r.f64();
+      camera.orthographic.ymag = r.f64();
+      camera.orthographic.zfar = r.f64();
+      camera.orthographic.znear = r.f64();
+    }
+
+    model.skins.resize(r.count(1));
+    for (tinygltf::Skin& skin : model.skins)
+    {
+      skin.name = r.str();
+      skin.inverseBindMatrices = r.i32();
+      skin.skeleton = r.i32();
+      r.int_array(skin.joints);
+    }
+
+    model.animations.resize(r.count(1));
+    for (tinygltf::Animation& animation : model.animations)
+    {
+      animation.name = r.str();
+      animation.channels.resize(r.count(1));
+      for (tinygltf::AnimationChannel& channel : animation.channels)
+      {
+        channel.sampler = r.i32();
+        channel.target_node = r.i32();
+        channel.target_path = r.str();
+      }
+      animation.samplers.resize(r.count(1));
+      for (tinygltf::AnimationSampler& sampler : animation.samplers)
+      {
+        sampler.input = r.i32();
+        sampler.output = r.i32();
+        sampler.interpolation = r.str();
+      }
+    }
+
+    model.extensionsUsed.resize(r.count(1));
+    for (std::string& ext : model.extensionsUsed)
+      ext = r.str();
+
+    return r.ok();
+  }
+
+  std::string get_base_dir(const std::string& filename)
+  {
+    size_t pos = filename.find_last_of("/\\");
+    return pos == std::string::npos ? "" : filename.substr(0, pos + 1);
+  }
+
+  // 캐시의 유효성을 결정하는 파일들: glTF 파일 자신과 외부 buffer/이미지 파일.
+  // (data URI는 glTF 파일 내용에 이미 들어 있다.)
+  std::vector<std::string> get_dependencies(const tinygltf::Model& model, const std::string& filename)
+  {
+    const std::string base_dir = get_base_dir(filename);
+    std::vector<std::string> files(1, filename);
+
+    for (const tinygltf::Buffer& buffer : model.buffers)
+      if (!buffer.uri.empty() && buffer.uri.compare(0, 5, "data:") != 0)
+        files.push_back(base_dir + buffer.uri);
+
+    for (const tinygltf::Image& image : model.images)
+      if (!image.uri.empty() && image.uri.compare(0, 5, "data:") != 0)
+        files.push_back(base_dir + image.uri);
+
+    return files;
+  }
+} // namespace
+
+void hash_scene_dependencies(const tinygltf::Model& model, const std::string& filename, SceneCacheDependencies* deps)
+{
+  deps->files = get_dependencies(model, filename);
+  // 없는 파일(예: 찾지 못한 이미지)은 해시 0으로 기록해 두고, 나중에 생기면 캐시를 버린다.
+  deps->hashes.assign(deps->files.size(), 0);
+  for (size_t i = 0; i < deps->files.size(); ++i)
+    hash_file(deps->files[i], &deps->hashes[i]);
+}
+
+std::string scene_cache_path(const std::string& filename)
+{
+  return filename + ".scenecache";
+}
+
+bool load_scene_cache(tinygltf::Model& model, const std::string& filename)
+{
+  const std::string cache_path = scene_cache_path(filename);
+  bool res = false;
+
+#ifndef _WIN32
+  int fd = open(cache_path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < off_t(sizeof(CACHE_MAGIC) + 12))
+  {
+    close(fd);
+    return false;
+  }
+
+  size_t size = size_t(st.st_size);
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED)
+    return false;
+
+  // 앞에서부터 한 번 훑어 읽으므로 커널에 미리 알려 준다.
+  madvise(mapped, size, MADV_SEQUENTIAL | MADV_WILLNEED);
+  const unsigned char* data = static_cast<const unsigned char*>(mapped);
+#else
+  std::ifstream file(cache_path.c_str(), std::ios::binary);
+  if (!file)
+    return false;
+  std::vector<unsigned char> contents(
+    (std::istreambuf_iterator<char>(file)),
+    std::istreambuf_iterator<char>());
+  size_t size = contents.size();
+  const unsigned char* data = contents.empty() ? nullptr : &contents[0];
+#endif
+
+  Reader r(data, size);
+  char magic[sizeof(CACHE_MAGIC)];
+  r.bytes(magic, sizeof(magic));
+  uint32_t version = r.pod<uint32_t>();
+
+  bool is_valid = r.ok() && std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) == 0 &&
+    version == CACHE_VERSION;
+
+  // 의존 파일의 내용이 저장할 때와 같은지 확인한다.
+  size_t num_files = is_valid ? r.count(1) : 0;
+  for (size_t i = 0; i < num_files && is_valid; ++i)
+  {
+    std::string path = r.str();
+    uint64_t hash = r.u64();
+    uint64_t current = 0;
+    hash_file(path, &current);
+    is_valid = r.ok() && current == hash;
+  }
+
+  if (is_valid)
+  {
+    res = read_model(r, model);
+    if (!res)
+      model = tinygltf::Model();
+  }
+
+#ifndef _WIN32
+  munmap(mapped, size);
+#endif
+
+  return res;
+}
+
+bool save_scene_cache(const tinygltf::Model& model, const std::string& filename)
+{
+  SceneCacheDependencies deps;
+  hash_scene_dependencies(model, filename, &deps);
+  return save_scene_cache(model, model.buffers, model.buffers.size(), model.images, deps, filename);
+}
+
+bool save_scene_cache(const tinygltf::Model& model, const std::vector<tinygltf::Buffer>& buffers, size_t num_buffers,
+  const std::vector<tinygltf::Image>& images, const SceneCacheDependencies& deps, const std::string& filename)
+{
+  const std::string cache_path = scene_cache_path(filename);
+
+  // 다른 프로세스가 쓰다 만 파일을 읽지 않도록 임시 파일에 쓴 뒤 이름을 바꾼다.
+  // 같은 파일을 읽은 모델 여럿(다른 프로세스 포함)이 동시에 저장할 수 있으므로 프로세스와 스레드마다 다른 임시 파일에 쓴다.
+  const std::string tmp_path = cache_path + ".tmp" + std::to_string(getpid()) + "-" +
+    std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  {
+    std::ofstream out(tmp_path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out)
+      return false;
+
+    Writer w(out);
+    w.bytes(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    w.pod(CACHE_VERSION);
+
+    w.u64(deps.files.size());
+    for (size_t i = 0; i < deps.files.size(); ++i)
+    {
+      w.str(deps.files[i]);
+      w.u64(deps.hashes[i]);
+    }
+
+    write_model(w, model, buffers, num_buffers, images);
+
+    if (!w.good())
+    {
+      out.close();
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+  }
+
+  std::remove(cache_path.c_str());
+  return std::rename(tmp_path.c_str(), cache_path.c_str()) == 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../glTF/tiny_gltf.h"
+
+// 로딩이 끝난 (buffer를 읽고 이미지를 디코딩한) tinygltf::Model을 바이너리 파일로 저장해 두고,
+// 다음 실행에서는 JSON 파싱, base64/파일 읽기, 이미지 디코딩 없이 그 파일을 mmap해서 읽어 온다.
+//
+// 캐시 파일은 "<glTF 파일>.scenecache"에 만들어진다.
+// 캐시에는 glTF 파일과 그 파일이 참조하는 외부 파일(.bin, 이미지)의 경로와 내용 해시가 함께 저장되어,
+// 어느 하나라도 바뀌면 캐시는 무시된다. (검사할 때 JSON을 다시 파싱하지 않는다.)
+//
+// 저장하는 내용: buffer/bufferView/accessor, mesh, material, texture/sampler,
+// 디코딩된 이미지 픽셀, node/scene/camera/skin/animation.
+// (extensions, extras는 저장하지 않는다.)
+
+std::string scene_cache_path(const std::string& filename);
+
+// 캐시의 유효성을 결정하는 파일들(glTF 파일 자신과 외부 buffer/이미지 파일)과 그 내용 해시
+struct SceneCacheDependencies
+{
+  std::vector<std::string> files;
+  std::vector<uint64_t>    hashes;    // 없는 파일은 0
+};
+
+// filename에서 읽은 model이 참조하는 파일들을 지금 해시한다.
+// 파싱 직후에 불러 두면 저장하기 전에 파일이 바뀌어도 캐시가 읽은 내용과 어긋나지 않는다.
+void hash_scene_dependencies(const tinygltf::Model& model, const std::string& filename, SceneCacheDependencies* deps);
+
+// filename에 대한 유효한 캐시가 있으면 model을 채우고 true를 반환한다.
+bool load_scene_cache(tinygltf::Model& model, const std::string& filename);
+
+// filename에서 읽은 model을 캐시 파일로 저장한다. (디코딩하지 않은 이미지는 인코딩된 채로 저장됨)
+bool save_scene_cache(const tinygltf::Model& model, const std::string& filename);
+
+// model.buffers 대신 buffers의 앞 num_buffers개를, model.images 대신 images를 저장하고
+// 의존 파일은 파싱할 때 hash_scene_dependencies()로 구해 둔 deps를 기록한다.
+// (buffer와 이미지 없이 떼어 둔 model 사본에 넘겨준 model의 buffer와 디코딩된 이미지를 합쳐 저장할 때)
+bool save_scene_cache(const tinygltf::Model& model, const std::vector<tinygltf::Buffer>& buffers, size_t num_buffers,
+  const std::vector<tinygltf::Image>& images, const SceneCacheDependencies& deps, const std::string& filename);
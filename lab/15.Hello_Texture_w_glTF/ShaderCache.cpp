@@ -0,0 +1,384 @@
+#include "ShaderCache.h"
+#include "Hash.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+  const char      BINARY_MAGIC[8] = { 'G', 'L', 'T', 'F', 'P', 'R', 'O', 'G' };
+  const uint32_t  BINARY_VERSION = 1;
+} // namespace
+
+ShaderCache::ShaderCache(ShaderSourceGenerator generator)
+  : generator_(generator), parallel_(false), driver_hash_(0), hits_(0), compiled_(0), compile_ms_(0.0),
+    binary_loads_(0), binary_rejects_(0), binary_ms_(0.0)
+{
+}
+
+const ShaderProgram& ShaderCache::acquire(unsigned features)
+{
+  std::unordered_map<unsigned, ShaderProgram>::iterator it = programs_.find(features);
+  if (it != programs_.end())
+  {
+    ++hits_;
+    return it->second;
+  }
+
+  submit(features);
+  return programs_[features];
+}
+
+const ShaderProgram& ShaderCache::acquire_now(unsigned features)
+{
+  const ShaderProgram& shader = acquire(features);
+  for (size_t i = 0; i < pending_.size(); ++i)
+  {
+    if (pending_[i].features == features)
+    {
+      finish(pending_[i]);
+      pending_.erase(pending_.begin() + i);
+      break;
+    }
+  }
+  return shader;
+}
+
+size_t ShaderCache::update()
+{
+  size_t finished = 0;
+  for (size_t i = 0; i < pending_.size(); )
+  {
+    GLint is_done = GL_TRUE;
+    if (parallel_)
+      glGetProgramiv(pending_[i].program, GL_COMPLETION_STATUS_KHR, &is_done);
+    if (is_done != GL_TRUE)
+    {
+      ++i;
+      continue;
+    }
+    finish(pending_[i]);
+    pending_.erase(pending_.begin() + i);
+    ++finished;
+  }
+  return finished;
+}
+
+void ShaderCache::release()
+{
+  for (const Pending& pending : pending_)
+  {
+    glDeleteShader(pending.vertex_shader);
+    glDeleteShader(pending.fragment_shader);
+    glDeleteProgram(pending.program);
+  }
+  pending_.clear();
+
+  for (std::unordered_map<unsigned, ShaderProgram>::iterator it = programs_.begin(); it != programs_.end(); ++it)
+  {
+    if (it->second.program != 0)
+      glDeleteProgram(it->second.program);
+  }
+  programs_.clear();
+}
+
+bool ShaderCache::enable_parallel_compile()
+{
+  // 스레드 수는 드라이버가 정한다.
+  if (GLEW_KHR_parallel_shader_compile)
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+  else if (GLEW_ARB_parallel_shader_compile)
+    glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+  else
+    return false;
+  parallel_ = true;
+  return true;
+}
+
+// binary가 있으면 바로 프로그램을 만들고, 없으면 컴파일과 링크 명령만 내고 pending_에 넣는다.
+void ShaderCache::submit(unsigned features)
+{
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  std::string vertex_code, fragment_code;
+  generator_(features, &vertex_code, &fragment_code);
+  const uint64_t key = hash_combine(hash_combine(driver_hash_, hash64(vertex_code.data(), vertex_code.size())),
+    hash64(fragment_code.data(), fragment_code.size()));
+
+  ShaderProgram& shader = programs_[features];
+  shader = ShaderProgram();
+  const GLuint binary = binary_cache_enabled() ? load_binary(key) : 0;
+  if (binary != 0)
+  {
+    read_locations(binary, &shader);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    ++binary_loads_;
+    binary_ms_ += ms;
+    std::printf("shader variant 0x%02x: program %u (binary cache, %.1f ms)\n", features, binary, ms);
+    return;
+  }
+
+  Pending pending;
+  pending.features = features;
+  pending.key = key;
+  const GLchar* vertex_src = vertex_code.c_str();
+  const GLchar* fragment_src = fragment_code.c_str();
+  pending.vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(pending.vertex_shader, 1, &vertex_src, NULL);
+  glCompileShader(pending.vertex_shader);
+  pending.fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(pending.fragment_shader, 1, &fragment_src, NULL);
+  glCompileShader(pending.fragment_shader);
+
+  // 컴파일 결과를 기다리지 않고 링크까지 낸다. (컴파일에 실패하면 링크도 실패하고 finish()가 로그를 남김)
+  pending.program = glCreateProgram();
+  glAttachShader(pending.program, pending.vertex_shader);
+  glAttachShader(pending.program, pending.fragment_shader);
+  if (binary_cache_enabled())
+    glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glLinkProgram(pending.program);
+  pending_.push_back(pending);
+
+  compile_ms_ += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// 링크 결과를 확인해서 프로그램을 채운다. (parallel_shader_compile이 없으면 여기서 컴파일을 기다린다)
+void ShaderCache::finish(const Pending& pending)
+{
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  ShaderProgram& shader = programs_[pending.features];
+
+  GLint is_linked;
+  glGetProgramiv(pending.program, GL_LINK_STATUS, &is_linked);
+  if (is_linked != GL_TRUE)
+  {
+    const bool vertex_ok = check_shader(pending.vertex_shader);
+    const bool fragment_ok = check_shader(pending.fragment_shader);
+    if (vertex_ok && fragment_ok)
+    {
+      std::cout << "Shader LINK error: " << std::endl;
+
+      GLint buf_len;
+      glGetProgramiv(pending.program, GL_INFO_LOG_LENGTH, &buf_len);
+
+      std::string log_string(1 + buf_len, '\0');
+      glGetProgramInfoLog(pending.program, buf_len, 0, (GLchar *)log_string.c_str());
+
+      std::cout << "error_log: " << log_string << std::endl;
+    }
+    glDeleteProgram(pending.program);
+  }
+  else
+  {
+    read_locations(pending.program, &shader);
+    if (binary_cache_enabled())
+      save_binary(pending.key, pending.program);
+  }
+  // 프로그램에 붙어 있는 동안은 남아 있다가 프로그램과 같이 지워진다.
+  glDeleteShader(pending.vertex_shader);
+  glDeleteShader(pending.fragment_shader);
+
+  const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+  ++compiled_;
+  compile_ms_ += ms;
+  std::printf("shader variant 0x%02x: program %u (compiled, %.1f ms waiting)\n", pending.features, shader.program, ms);
+}
+
+// 컴파일에 실패했으면 로그를 남기고 false
+bool ShaderCache::check_shader(GLuint shader)
+{
+  GLint is_compiled;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compiled);
+  if (is_compiled == GL_TRUE)
+    return true;
+
+  std::cout << "Shader COMPILE error: " << std::endl;
+
+  GLint buf_len;
+  glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &buf_len);
+
+  std::string log_string(1 + buf_len, '\0');
+  glGetShaderInfoLog(shader, buf_len, 0, (GLchar *)log_string.c_str());
+
+  std::cout << "error_log: " << log_string << std::endl;
+  return false;
+}
+
+void ShaderCache::read_locations(GLuint program, ShaderProgram* shader)
+{
+  shader->program = program;
+  shader->loc_a_position = glGetAttribLocation(program, "a_position");
+  shader->loc_a_normal = glGetAttribLocation(program, "a_normal");
+  shader->loc_a_texcoord = glGetAttribLocation(program, "a_texcoord");
+  shader->loc_a_color = glGetAttribLocation(program, "a_color");
+  shader->loc_a_joints = glGetAttribLocation(program, "a_joints");
+  shader->loc_a_weights = glGetAttribLocation(program, "a_weights");
+  shader->loc_a_instance = glGetAttribLocation(program, "a_instance");
+
+  shader->loc_u_PVM = glGetUniformLocation(program, "u_PVM");
+  shader->loc_u_M = glGetUniformLocation(program, "u_M");
+
+  shader->loc_u_view_position_wc = glGetUniformLocation(program, "u_view_position_wc");
+  shader->loc_u_light_position_wc = glGetUniformLocation(program, "u_light_position_wc");
+  shader->loc_u_light_ambient = glGetUniformLocation(program, "u_light_ambient");
+  shader->loc_u_light_diffuse = glGetUniformLocation(program, "u_light_diffuse");
+  shader->loc_u_light_specular = glGetUniformLocation(program, "u_light_specular");
+  shader->loc_u_material_ambient = glGetUniformLocation(program, "u_material_ambient");
+  shader->loc_u_material_specular = glGetUniformLocation(program, "u_material_specular");
+  shader->loc_u_material_shininess = glGetUniformLocation(program, "u_material_shininess");
+
+  shader->loc_u_diffuse_texture = glGetUniformLocation(program, "u_diffuse_texture");
+  shader->loc_u_color = glGetUniformLocation(program, "u_color");
+  shader->loc_u_dequant = glGetUniformLocation(program, "u_dequant");
+  shader->loc_u_normal_oct = glGetUniformLocation(program, "u_normal_oct");
+  shader->loc_u_layer = glGetUniformLocation(program, "u_layer");
+  shader->loc_u_uv_transform = glGetUniformLocation(program, "u_uv_transform");
+  shader->loc_u_atlas = glGetUniformLocation(program, "u_atlas");
+  shader->loc_u_joint_texture = glGetUniformLocation(program, "u_joint_texture");
+  shader->loc_u_morph_texture = glGetUniformLocation(program, "u_morph_texture");
+  shader->loc_u_morph_weights = glGetUniformLocation(program, "u_morph_weights");
+  shader->loc_u_morph_normals = glGetUniformLocation(program, "u_morph_normals");
+  shader->loc_u_vat_texture = glGetUniformLocation(program, "u_vat_texture");
+  shader->loc_u_vat_first = glGetUniformLocation(program, "u_vat_first");
+  shader->loc_u_vat_vertices = glGetUniformLocation(program, "u_vat_vertices");
+  shader->loc_u_vat_frames = glGetUniformLocation(program, "u_vat_frames");
+  shader->loc_u_vat_time = glGetUniformLocation(program, "u_vat_time");
+  shader->loc_u_vat_packed = glGetUniformLocation(program, "u_vat_packed");
+  shader->loc_u_vat_min = glGetUniformLocation(program, "u_vat_min");
+  shader->loc_u_vat_extent = glGetUniformLocation(program, "u_vat_extent");
+
+  // block binding은 프로그램 상태이므로 binary로 읽은 프로그램에도 다시 정한다.
+  if (GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object)
+  {
+    const GLuint block = glGetUniformBlockIndex(program, "JointPalette");
+    if (block != GL_INVALID_INDEX)
+      glUniformBlockBinding(program, block, JOINT_PALETTE_BINDING);
+  }
+}
+
+bool ShaderCache::enable_binary_cache(const std::string& dir)
+{
+  GLint num_formats = 0;
+  if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+  if (num_formats < 1)
+    return false;
+
+  // 드라이버가 바뀌면 binary를 쓸 수 없으므로 키에 넣는다.
+  const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+  const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  driver_hash_ = hash_combine(hash64(renderer, renderer ? std::strlen(renderer) : 0),
+    hash64(version, version ? std::strlen(version) : 0));
+
+#ifdef _WIN32
+  _mkdir(dir.c_str());
+#else
+  mkdir(dir.c_str(), 0755);
+#endif
+  binary_dir_ = dir;
+  return true;
+}
+
+std::string ShaderCache::binary_path(uint64_t key) const
+{
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+  return binary_dir_ + "/" + name;
+}
+
+// 저장해 둔 binary로 프로그램을 만든다. 없거나 드라이버가 받지 않으면 0
+GLuint ShaderCache::load_binary(uint64_t key)
+{
+  const std::string path = binary_path(key);
+  std::vector<char> data;
+  uint32_t format = 0;
+  {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in)
+      return 0;
+
+    char magic[sizeof(BINARY_MAGIC)];
+    uint32_t version = 0, size = 0;
+    uint64_t stored_key = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&stored_key), sizeof(stored_key));
+    in.read(reinterpret_cast<char*>(&format), sizeof(format));
+    in.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if (in && std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0 && version == BINARY_VERSION &&
+      stored_key == key && size > 0)
+    {
+      data.resize(size);
+      in.read(&data[0], std::streamsize(size));
+      if (!in)
+        data.clear();
+    }
+  }
+
+  GLuint program = 0;
+  GLint is_linked = GL_FALSE;
+  if (!data.empty())
+  {
+    program = glCreateProgram();
+    glProgramBinary(program, format, &data[0], GLsizei(data.size()));
+    glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+  }
+  if (is_linked != GL_TRUE)
+  {
+    // 드라이버가 업데이트되었거나 파일이 깨졌다. 지우고 다시 컴파일한다.
+    if (program != 0)
+      glDeleteProgram(program);
+    std::remove(path.c_str());
+    ++binary_rejects_;
+    return 0;
+  }
+  return program;
+}
+
+bool ShaderCache::save_binary(uint64_t key, GLuint program) const
+{
+  GLint size = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+  if (size <= 0)
+    return false;
+
+  std::vector<char> data(size);
+  GLenum format = 0;
+  GLsizei length = 0;
+  glGetProgramBinary(program, size, &length, &format, &data[0]);
+  if (length <= 0)
+    return false;
+
+  const std::string path = binary_path(key);
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out)
+      return false;
+
+    const uint32_t format32 = format, size32 = uint32_t(length);
+    out.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    out.write(reinterpret_cast<const char*>(&BINARY_VERSION), sizeof(BINARY_VERSION));
+    out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    out.write(reinterpret_cast<const char*>(&format32), sizeof(format32));
+    out.write(reinterpret_cast<const char*>(&size32), sizeof(size32));
+    out.write(&data[0], std::streamsize(length));
+    if (!out.good())
+    {
+      out.close();
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+  }
+
+  std::remove(path.c_str());
+  return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
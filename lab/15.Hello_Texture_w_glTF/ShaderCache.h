@@ -0,0 +1,166 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 쉐이더 variant의 기능 bit. primitive마다 쓰는 기능을 모은 bitmask가 ShaderCache의 키이다.
+enum ShaderFeature
+{
+  SHADER_COLOR          = 1 << 0,   // COLOR_0
+  SHADER_TEXTURE        = 1 << 1,   // baseColorTexture (TEXCOORD_0)
+  SHADER_FACTOR         = 1 << 2,   // baseColorFactor
+  SHADER_NORMAL         = 1 << 3,   // NORMAL
+  SHADER_QUANTIZED      = 1 << 4,   // --quantize: u_dequant와 octahedral normal
+  SHADER_TEXTURE_ARRAY  = 1 << 5,   // --texture-array: sampler2DArray와 layer/uv 변환
+  SHADER_SKIN           = 1 << 6,   // JOINTS_0/WEIGHTS_0: joint 행렬을 JointPalette uniform block에서 읽음
+  SHADER_SKIN_BUFFER    = 1 << 7,   // SHADER_SKIN과 같이: joint 행렬을 텍스처 buffer(u_joint_texture)에서 읽음
+  SHADER_MORPH          = 1 << 8,   // targets: 정점별 morph delta를 텍스처 buffer(u_morph_texture)에서 읽어 u_morph_weights로 섞음
+  SHADER_VAT            = 1 << 9,   // --crowd: position/normal을 vertex animation texture(u_vat_texture)에서 읽고 a_instance로 옮김
+};
+
+// JointPalette uniform block의 binding point와 행렬 수 (joint가 더 많은 skin은 SHADER_SKIN_BUFFER)
+const GLuint  JOINT_PALETTE_BINDING = 0;
+const int     MAX_PALETTE_JOINTS = 128;
+
+// SHADER_MORPH로 섞을 수 있는 target 수 (더 많은 primitive는 CPU에서 섞는다)
+const int     MAX_MORPH_WEIGHTS = 32;
+
+// 쉐이더 프로그램과 그 uniform/attribute 위치 (없는 것은 -1)
+struct ShaderProgram
+{
+  GLuint  program;          // 쉐이더 프로그램 객체의 레퍼런스 값 (컴파일/링크에 실패하면 0)
+  GLint   loc_a_position;
+  GLint   loc_a_normal;
+  GLint   loc_a_texcoord;
+  GLint   loc_a_color;
+  GLint   loc_a_joints;
+  GLint   loc_a_weights;
+  GLint   loc_a_instance;
+
+  GLint   loc_u_PVM;
+  GLint   loc_u_M;
+
+  GLint   loc_u_view_position_wc;
+  GLint   loc_u_light_position_wc;
+
+  GLint   loc_u_light_ambient;
+  GLint   loc_u_light_diffuse;
+  GLint   loc_u_light_specular;
+
+  GLint   loc_u_material_ambient;
+  GLint   loc_u_material_specular;
+  GLint   loc_u_material_shininess;
+
+  GLint   loc_u_diffuse_texture;
+  GLint   loc_u_color;
+  GLint   loc_u_dequant;
+  GLint   loc_u_normal_oct;
+  GLint   loc_u_layer;
+  GLint   loc_u_uv_transform;
+  GLint   loc_u_atlas;
+  GLint   loc_u_joint_texture;
+  GLint   loc_u_morph_texture;
+  GLint   loc_u_morph_weights;
+  GLint   loc_u_morph_normals;
+  GLint   loc_u_vat_texture;
+  GLint   loc_u_vat_first;
+  GLint   loc_u_vat_vertices;
+  GLint   loc_u_vat_frames;
+  GLint   loc_u_vat_time;
+  GLint   loc_u_vat_packed;
+  GLint   loc_u_vat_min;
+  GLint   loc_u_vat_extent;
+};
+
+// 기능 bitmask로 vertex/fragment 쉐이더 소스를 만드는 함수
+typedef void (*ShaderSourceGenerator)(unsigned features, std::string* vertex_code, std::string* fragment_code);
+
+// 기능 bitmask마다 프로그램을 한 번만 컴파일해 두고 모든 모델이 같이 쓰는 캐시.
+//
+// 소스는 generator가 메모리에서 만들고 파일을 거치지 않는다.
+// 프로그램은 release()까지 지우지 않으므로 acquire()가 돌려준 포인터는 그때까지 쓸 수 있다.
+//
+// enable_binary_cache()를 부르면 링크한 프로그램의 binary(glGetProgramBinary)를 "<dir>/<키>.bin"에 저장하고
+// 다음 실행에서는 컴파일 없이 glProgramBinary로 읽는다. 키는 소스 해시와 GL_RENDERER/GL_VERSION으로 만들며,
+// 드라이버가 binary를 받지 않으면(링크 실패) 그 파일을 지우고 다시 컴파일해서 저장한다.
+//
+// 컴파일은 기다리지 않는다. acquire()는 컴파일과 링크 명령만 내고, 상태는 update()가 나중에 한꺼번에 확인한다.
+// (KHR/ARB_parallel_shader_compile이 있으면 드라이버의 스레드에서 컴파일되고 끝난 것만 확인한다)
+// 그동안 program은 0이므로 그리는 쪽은 acquire_now()로 준비해 둔 fallback 프로그램으로 그린다.
+// 렌더링 스레드에서만 쓴다.
+class ShaderCache
+{
+public:
+  explicit ShaderCache(ShaderSourceGenerator generator);
+
+  // features의 프로그램. 처음이면 컴파일을 시작하고, 링크가 끝날 때까지 program은 0이다.
+  // 실패한 프로그램도 program이 0이다. (다시 컴파일하지 않음)
+  const ShaderProgram& acquire(unsigned features);
+
+  // 위와 같지만 링크가 끝날 때까지 기다린다. (fallback용)
+  const ShaderProgram& acquire_now(unsigned features);
+
+  // 컴파일이 끝난 프로그램을 마무리하고 그 수를 반환한다. 프레임마다 호출
+  // parallel_shader_compile이 없으면 남은 프로그램을 모두 기다린다.
+  size_t update();
+  size_t pending() const { return pending_.size(); }
+
+  void release();               // 모든 프로그램을 지운다.
+
+  // 드라이버의 컴파일 스레드를 쓴다. (KHR/ARB_parallel_shader_compile, 지원하지 않으면 false)
+  bool enable_parallel_compile();
+  bool parallel_compile() const { return parallel_; }
+
+  // 프로그램 binary를 dir에 저장하고 읽는다. (GL 4.1 / ARB_get_program_binary, 지원하지 않으면 false)
+  bool enable_binary_cache(const std::string& dir);
+  bool binary_cache_enabled() const { return !binary_dir_.empty(); }
+
+  size_t num_programs() const { return programs_.size(); }
+  size_t hits() const { return hits_; }
+  size_t compiled() const { return compiled_; }
+  double compile_ms() const { return compile_ms_; }   // 컴파일 명령과 상태 확인에 렌더링 스레드가 쓴 시간 (누적)
+  size_t binary_loads() const { return binary_loads_; }
+  size_t binary_rejects() const { return binary_rejects_; }   // 드라이버가 받지 않아 다시 컴파일한 binary
+  double binary_ms() const { return binary_ms_; }     // binary를 읽어 링크한 시간 (누적)
+
+private:
+  ShaderCache(const ShaderCache&);
+  ShaderCache& operator=(const ShaderCache&);
+
+  // 컴파일과 링크 명령을 냈지만 아직 상태를 확인하지 않은 프로그램
+  struct Pending
+  {
+    unsigned  features;
+    uint64_t  key;            // binary 캐시 키
+    GLuint    program;
+    GLuint    vertex_shader;
+    GLuint    fragment_shader;
+  };
+
+  void submit(unsigned features);
+  void finish(const Pending& pending);
+  static bool check_shader(GLuint shader);
+  static void read_locations(GLuint program, ShaderProgram* shader);
+
+  std::string binary_path(uint64_t key) const;
+  GLuint load_binary(uint64_t key);
+  bool save_binary(uint64_t key, GLuint program) const;
+
+private:
+  ShaderSourceGenerator generator_;
+  std::unordered_map<unsigned, ShaderProgram> programs_;
+  std::vector<Pending> pending_;
+  bool  parallel_;
+  std::string binary_dir_;      // 비어 있으면 binary 캐시를 쓰지 않는다.
+  uint64_t  driver_hash_;       // GL_RENDERER, GL_VERSION
+  size_t  hits_;
+  size_t  compiled_;
+  double  compile_ms_;
+  size_t  binary_loads_;
+  size_t  binary_rejects_;
+  double  binary_ms_;
+};
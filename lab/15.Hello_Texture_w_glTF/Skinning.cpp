@@ -0,0 +1,586 @@
+#include "Skinning.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "ThreadPool.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SKINNING_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SKINNING_TARGET(x)
+#else
+#define SKINNING_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+namespace {
+  const float IDENTITY[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// 4x4 행렬 (column-major)
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // out = a * b (out은 a, b와 겹치면 안 됨). 열마다 a의 네 열을 b의 성분으로 더하는 순서를 SIMD와 맞춘다.
+  void multiply_scalar(const float* a, const float* b, float* out)
+  {
+    for (int j = 0; j < 4; ++j)
+    {
+      for (int r = 0; r < 4; ++r)
+        out[j * 4 + r] = a[r] * b[j * 4] + a[4 + r] * b[j * 4 + 1] + a[8 + r] * b[j * 4 + 2] + a[12 + r] * b[j * 4 + 3];
+    }
+  }
+
+#ifdef SKINNING_X86
+  SKINNING_TARGET("sse2")
+  void multiply_sse(const float* a, const float* b, float* out)
+  {
+    const __m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+    for (int j = 0; j < 4; ++j)
+    {
+      __m128 column = _mm_mul_ps(a0, _mm_set1_ps(b[j * 4]));
+      column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(b[j * 4 + 1])));
+      column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(b[j * 4 + 2])));
+      column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(b[j * 4 + 3])));
+      _mm_storeu_ps(out + j * 4, column);
+    }
+  }
+
+#endif // SKINNING_X86
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// 정점 skinning: [first, first + count) 정점을 out에 쓰고 그 AABB를 낸다.
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void reset_bounds(SkinBounds* bounds)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      bounds->min[c] = FLT_MAX;
+      bounds->max[c] = -FLT_MAX;
+    }
+  }
+
+  void merge_bounds(const SkinBounds& a, SkinBounds* out)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      out->min[c] = std::min(out->min[c], a.min[c]);
+      out->max[c] = std::max(out->max[c], a.max[c]);
+    }
+  }
+
+  // joint가 범위를 벗어나거나 weight가 0인 influence는 건너뛴다. (skin_vertices_reference와 같음)
+  inline bool use_influence(const SkinnedVertices& in, size_t i, size_t num_joints)
+  {
+    return in.joints[i] < num_joints && in.weights[i] != 0.0f;
+  }
+
+  void skin_range_scalar(const SkinnedVertices& in, size_t first, size_t count, const float* joint_matrices,
+    size_t num_joints, float* out, SkinBounds* bounds)
+  {
+    const bool has_normals = !in.normals.empty();
+    SkinBounds box;
+    reset_bounds(&box);
+    for (size_t v = first; v < first + count; ++v)
+    {
+      float m[16] = { 0.0f };
+      for (size_t i = v * 4; i < v * 4 + 4; ++i)
+      {
+        if (!use_influence(in, i, num_joints))
+          continue;
+        const float w = in.weights[i];
+        const float* jm = joint_matrices + in.joints[i] * 16;
+        for (int k = 0; k < 16; ++k)
+          m[k] += w * jm[k];
+      }
+
+      // out은 매핑된 buffer일 수 있으므로 한 번에 쓴다.
+      float result[SKINNED_VERTEX_FLOATS] = { 0.0f };
+      const float* p = &in.positions[v * 3];
+      for (int r = 0; r < 3; ++r)
+      {
+        result[r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r];
+        box.min[r] = std::min(box.min[r], result[r]);
+        box.max[r] = std::max(box.max[r], result[r]);
+      }
+      if (has_normals)
+      {
+        const float* n = &in.normals[v * 3];
+        for (int r = 0; r < 3; ++r)
+          result[3 + r] = m[r] * n[0] + m[4 + r] * n[1] + m[8 + r] * n[2];
+        const float len = std::sqrt(result[3] * result[3] + result[4] * result[4] + result[5] * result[5]);
+        for (int r = 3; r < 6; ++r)
+          result[r] = (len > 0.0f) ? result[r] / len : 0.0f;
+      }
+      std::memcpy(out + v * SKINNED_VERTEX_FLOATS, result, sizeof(result));
+    }
+    *bounds = box;
+  }
+
+#ifdef SKINNING_X86
+  // 섞은 행렬의 열 네 개로 position과 normal을 변환해서 쓴다. (SSE, AVX2 경로 공통)
+  SKINNING_TARGET("sse2")
+  inline void transform_sse(const SkinnedVertices& in, size_t v, bool has_normals, __m128 c0, __m128 c1, __m128 c2,
+    __m128 c3, float* out, __m128* lo, __m128* hi)
+  {
+    const float* p = &in.positions[v * 3];
+    __m128 position = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p[0])), _mm_mul_ps(c1, _mm_set1_ps(p[1]))),
+      _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p[2])), c3));
+    *lo = _mm_min_ps(*lo, position);
+    *hi = _mm_max_ps(*hi, position);
+
+    // 마지막 정점에서 buffer 끝을 넘지 않도록 4개씩 쓰지 않는다.
+    float result[8];
+    _mm_storeu_ps(result, position);
+    if (has_normals)
+    {
+      const float* n = &in.normals[v * 3];
+      __m128 normal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(n[0])), _mm_mul_ps(c1, _mm_set1_ps(n[1]))),
+        _mm_mul_ps(c2, _mm_set1_ps(n[2])));
+      _mm_storeu_ps(result + 4, normal);
+      const float len = std::sqrt(result[4] * result[4] + result[5] * result[5] + result[6] * result[6]);
+      const float scale = (len > 0.0f) ? 1.0f / len : 0.0f;
+      result[3] = result[4] * scale;
+      result[4] = result[5] * scale;
+      result[5] = result[6] * scale;
+    }
+    else
+      result[3] = result[4] = result[5] = 0.0f;
+    std::memcpy(out + v * SKINNED_VERTEX_FLOATS, result, SKINNED_VERTEX_FLOATS * sizeof(float));
+  }
+
+  SKINNING_TARGET("sse2")
+  void store_bounds_sse(__m128 lo, __m128 hi, SkinBounds* bounds)
+  {
+    float l[4], h[4];
+    _mm_storeu_ps(l, lo);
+    _mm_storeu_ps(h, hi);
+    for (int c = 0; c < 3; ++c)
+    {
+      bounds->min[c] = l[c];
+      bounds->max[c] = h[c];
+    }
+  }
+
+  // 행렬을 열 하나(4 float)씩 섞는다.
+  SKINNING_TARGET("sse2")
+  void skin_range_sse(const SkinnedVertices& in, size_t first, size_t count, const float* joint_matrices,
+    size_t num_joints, float* out, SkinBounds* bounds)
+  {
+    const bool has_normals = !in.normals.empty();
+    __m128 lo = _mm_set1_ps(FLT_MAX), hi = _mm_set1_ps(-FLT_MAX);
+    for (size_t v = first; v < first + count; ++v)
+    {
+      __m128 c0 = _mm_setzero_ps(), c1 = _mm_setzero_ps(), c2 = _mm_setzero_ps(), c3 = _mm_setzero_ps();
+      for (size_t i = v * 4; i < v * 4 + 4; ++i)
+      {
+        if (!use_influence(in, i, num_joints))
+          continue;
+        const __m128 w = _mm_set1_ps(in.weights[i]);
+        const float* jm = joint_matrices + in.joints[i] * 16;
+        c0 = _mm_add_ps(c0, _mm_mul_ps(w, _mm_loadu_ps(jm)));
+        c1 = _mm_add_ps(c1, _mm_mul_ps(w, _mm_loadu_ps(jm + 4)));
+        c2 = _mm_add_ps(c2, _mm_mul_ps(w, _mm_loadu_ps(jm + 8)));
+        c3 = _mm_add_ps(c3, _mm_mul_ps(w, _mm_loadu_ps(jm + 12)));
+      }
+      transform_sse(in, v, has_normals, c0, c1, c2, c3, out, &lo, &hi);
+    }
+    store_bounds_sse(lo, hi, bounds);
+  }
+
+  // 행렬을 두 열(8 float)씩 FMA로 섞는다.
+  SKINNING_TARGET("avx2,fma")
+  void skin_range_avx2(const SkinnedVertices& in, size_t first, size_t count, const float* joint_matrices,
+    size_t num_joints, float* out, SkinBounds* bounds)
+  {
+    const bool has_normals = !in.normals.empty();
+    __m128 lo = _mm_set1_ps(FLT_MAX), hi = _mm_set1_ps(-FLT_MAX);
+    for (size_t v = first; v < first + count; ++v)
+    {
+      __m256 c01 = _mm256_setzero_ps(), c23 = _mm256_setzero_ps();
+      for (size_t i = v * 4; i < v * 4 + 4; ++i)
+      {
+        if (!use_influence(in, i, num_joints))
+          continue;
+        const __m256 w = _mm256_set1_ps(in.weights[i]);
+        const float* jm = joint_matrices + in.joints[i] * 16;
+        c01 = _mm256_fmadd_ps(w, _mm256_loadu_ps(jm), c01);
+        c23 = _mm256_fmadd_ps(w, _mm256_loadu_ps(jm + 8), c23);
+      }
+      transform_sse(in, v, has_normals, _mm256_castps256_ps128(c01), _mm256_extractf128_ps(c01, 1),
+        _mm256_castps256_ps128(c23), _mm256_extractf128_ps(c23, 1), out, &lo, &hi);
+    }
+    store_bounds_sse(lo, hi, bounds);
+  }
+
+  bool cpu_has_sse2()
+  {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    return __builtin_cpu_supports("sse2");
+#endif
+  }
+
+  bool cpu_has_avx2_fma()
+  {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma || (_xgetbv(0) & 0x6) != 0x6)
+      return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+  }
+#endif // SKINNING_X86
+
+  typedef void (*SkinFunction)(const SkinnedVertices&, size_t, size_t, const float*, size_t, float*, SkinBounds*);
+
+  struct Impl
+  {
+    void (*multiply)(const float* a, const float* b, float* out);
+    SkinFunction skin;
+    const char* name;
+  };
+
+  Impl best_impl()
+  {
+#ifdef SKINNING_X86
+#ifndef _MSC_VER
+    __builtin_cpu_init();     // 정적 초기화 중에 호출되므로 먼저 불러야 한다.
+#endif
+    if (cpu_has_avx2_fma())
+      return Impl{ multiply_sse, skin_range_avx2, "avx2" };
+    if (cpu_has_sse2())
+      return Impl{ multiply_sse, skin_range_sse, "sse" };
+#endif
+    return Impl{ multiply_scalar, skin_range_scalar, "scalar" };
+  }
+
+  const Impl simd_impl = best_impl();
+  std::atomic<bool> simd_enabled(true);
+
+  const Impl& current_impl()
+  {
+    static const Impl scalar = { multiply_scalar, skin_range_scalar, "scalar" };
+    return simd_enabled ? simd_impl : scalar;
+  }
+
+  // 역행렬 (여인수 전개). 역행렬이 없으면 단위 행렬
+  void invert(const float* m, float* out)
+  {
+    float inv[16];
+    inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+    inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+    inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+    inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+    inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+    inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+    inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+    inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+    const float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+    if (det == 0.0f)
+    {
+      std::copy(IDENTITY, IDENTITY + 16, out);
+      return;
+    }
+    for (int i = 0; i < 16; ++i)
+      out[i] = inv[i] / det;
+  }
+
+  // T * R * S (rotation은 x, y, z, w)
+  void compose_trs(const float* t, const float* q, const float* s, float* out)
+  {
+    const float x = q[0], y = q[1], z = q[2], w = q[3];
+    out[0] = (1.0f - 2.0f * (y * y + z * z)) * s[0];
+    out[1] = 2.0f * (x * y + z * w) * s[0];
+    out[2] = 2.0f * (x * z - y * w) * s[0];
+    out[3] = 0.0f;
+    out[4] = 2.0f * (x * y - z * w) * s[1];
+    out[5] = (1.0f - 2.0f * (x * x + z * z)) * s[1];
+    out[6] = 2.0f * (y * z + x * w) * s[1];
+    out[7] = 0.0f;
+    out[8] = 2.0f * (x * z + y * w) * s[2];
+    out[9] = 2.0f * (y * z - x * w) * s[2];
+    out[10] = (1.0f - 2.0f * (x * x + y * y)) * s[2];
+    out[11] = 0.0f;
+    out[12] = t[0];
+    out[13] = t[1];
+    out[14] = t[2];
+    out[15] = 1.0f;
+  }
+
+  void add_node(const tinygltf::Model& model, int node, std::vector<bool>* visited, NodeHierarchy* hierarchy)
+  {
+    if (node < 0 || size_t(node) >= model.nodes.size() || (*visited)[node])
+      return;
+    (*visited)[node] = true;
+    hierarchy->order.push_back(node);
+    for (int child : model.nodes[node].children)
+    {
+      if (child >= 0 && size_t(child) < model.nodes.size() && !(*visited)[child])
+        hierarchy->parents[child] = node;
+      add_node(model, child, visited, hierarchy);
+    }
+  }
+} // namespace
+
+void build_node_hierarchy(const tinygltf::Model& model, NodeHierarchy* hierarchy)
+{
+  const size_t num_nodes = model.nodes.size();
+  hierarchy->order.clear();
+  hierarchy->parents.assign(num_nodes, -1);
+
+  // 씬의 root부터 (씬이 없거나 씬에 없는 node는 부모가 없는 node부터) 부모를 자식보다 먼저 넣는다.
+  std::vector<bool> visited(num_nodes, false);
+  for (const tinygltf::Scene& scene : model.scenes)
+  {
+    for (int root : scene.nodes)
+      add_node(model, root, &visited, hierarchy);
+  }
+  std::vector<bool> is_child(num_nodes, false);
+  for (const tinygltf::Node& node : model.nodes)
+  {
+    for (int child : node.children)
+    {
+      if (child >= 0 && size_t(child) < num_nodes)
+        is_child[child] = true;
+    }
+  }
+  for (size_t i = 0; i < num_nodes; ++i)
+  {
+    if (!is_child[i])
+      add_node(model, int(i), &visited, hierarchy);
+  }
+}
+
+void compute_world_matrices(const tinygltf::Model& model, const NodeHierarchy& hierarchy, const AnimationPose& pose,
+  std::vector<float>* world)
+{
+  const Impl& impl = current_impl();
+  world->resize(model.nodes.size() * 16);
+  float local[16];
+  for (int node : hierarchy.order)
+  {
+    const tinygltf::Node& n = model.nodes[node];
+    if (pose.is_matrix[node])
+    {
+      for (int i = 0; i < 16; ++i)
+        local[i] = float(n.matrix[i]);
+    }
+    else
+      compose_trs(&pose.translations[node * 3], &pose.rotations[node * 4], &pose.scales[node * 3], local);
+
+    float* out = &(*world)[node * 16];
+    const int parent = hierarchy.parents[node];
+    if (parent >= 0)
+      impl.multiply(&(*world)[parent * 16], local, out);
+    else
+      std::copy(local, local + 16, out);
+  }
+}
+
+bool build_skin_palettes(const tinygltf::Model& model, std::vector<SkinPalette>* palettes, std::string* err)
+{
+  size_t skipped = 0;
+  palettes->clear();
+  for (size_t i = 0; i < model.nodes.size(); ++i)
+  {
+    const tinygltf::Node& node = model.nodes[i];
+    if (node.skin < 0 || node.mesh < 0)
+      continue;
+
+    bool ok = size_t(node.skin) < model.skins.size();
+    SkinPalette palette;
+    palette.node = int(i);
+    palette.skin = node.skin;
+    if (ok)
+    {
+      const tinygltf::Skin& skin = model.skins[node.skin];
+      palette.joints = skin.joints;
+      for (int joint : skin.joints)
+        ok = ok && joint >= 0 && size_t(joint) < model.nodes.size();
+
+      // inverseBindMatrices가 없으면 모두 단위 행렬
+      const size_t num_joints = skin.joints.size();
+      palette.inverse_bind.resize(num_joints * 16);
+      for (size_t j = 0; j < num_joints; ++j)
+        std::copy(IDENTITY, IDENTITY + 16, &palette.inverse_bind[j * 16]);
+      if (ok && skin.inverseBindMatrices >= 0)
+      {
+        std::vector<float> matrices;
+        ok = size_t(skin.inverseBindMatrices) < model.accessors.size() &&
+          model.accessors[skin.inverseBindMatrices].type == TINYGLTF_TYPE_MAT4 &&
+          read_accessor_floats(model, model.accessors[skin.inverseBindMatrices], &matrices) &&
+          matrices.size() >= num_joints * 16;
+        if (ok)
+          std::copy(matrices.begin(), matrices.begin() + num_joints * 16, palette.inverse_bind.begin());
+      }
+      palette.matrices = palette.inverse_bind;
+    }
+
+    if (!ok || palette.joints.empty())
+    {
+      ++skipped;
+      continue;
+    }
+    palettes->push_back(std::move(palette));
+  }
+
+  if (skipped > 0 && err)
+    *err = std::to_string(skipped) + " skinned nodes have an invalid skin";
+  return skipped == 0;
+}
+
+void compute_joint_matrices(const std::vector<float>& world, SkinPalette* palette)
+{
+  const Impl& impl = current_impl();
+  float inverse_node[16], joint_world[16];
+  invert(&world[palette->node * 16], inverse_node);
+
+  palette->matrices.resize(palette->joints.size() * 16);
+  for (size_t j = 0; j < palette->joints.size(); ++j)
+  {
+    impl.multiply(inverse_node, &world[palette->joints[j] * 16], joint_world);
+    impl.multiply(joint_world, &palette->inverse_bind[j * 16], &palette->matrices[j * 16]);
+  }
+}
+
+bool read_skinned_vertices(const tinygltf::Model& model, const tinygltf::Primitive& primitive, SkinnedVertices* out)
+{
+  std::map<std::string, int>::const_iterator position = primitive.attributes.find("POSITION");
+  std::map<std::string, int>::const_iterator normal = primitive.attributes.find("NORMAL");
+  std::map<std::string, int>::const_iterator joints = primitive.attributes.find("JOINTS_0");
+  std::map<std::string, int>::const_iterator weights = primitive.attributes.find("WEIGHTS_0");
+  if (position == primitive.attributes.end() || joints == primitive.attributes.end() ||
+    weights == primitive.attributes.end())
+    return false;
+
+  std::vector<float> joint_values;
+  bool ok = read_accessor_floats(model, model.accessors[position->second], &out->positions) &&
+    read_accessor_floats(model, model.accessors[joints->second], &joint_values) &&
+    read_accessor_floats(model, model.accessors[weights->second], &out->weights);
+  out->normals.clear();
+  if (ok && normal != primitive.attributes.end())
+    ok = read_accessor_floats(model, model.accessors[normal->second], &out->normals);
+
+  const size_t count = out->positions.size() / 3;
+  ok = ok && model.accessors[position->second].type == TINYGLTF_TYPE_VEC3 &&
+    joint_values.size() == count * 4 && out->weights.size() == count * 4 &&
+    (out->normals.empty() || out->normals.size() == count * 3);
+  if (!ok)
+    return false;
+
+  out->joints.resize(joint_values.size());
+  for (size_t i = 0; i < joint_values.size(); ++i)
+    out->joints[i] = uint16_t(joint_values[i]);
+  return true;
+}
+
+void skin_vertices_reference(const SkinnedVertices& in, const float* joint_matrices, size_t num_joints,
+  std::vector<float>* positions, std::vector<float>* normals)
+{
+  const size_t count = in.size();
+  const bool has_normals = !in.normals.empty();
+  positions->resize(count * 3);
+  normals->resize(has_normals ? count * 3 : 0);
+
+  for (size_t v = 0; v < count; ++v)
+  {
+    // weight로 섞은 행렬 하나를 만들어 곱한다. (쉐이더와 같은 순서)
+    float m[16] = { 0.0f };
+    for (int k = 0; k < 4; ++k)
+    {
+      const size_t joint = in.joints[v * 4 + k];
+      const float w = in.weights[v * 4 + k];
+      if (joint >= num_joints || w == 0.0f)
+        continue;
+      const float* jm = joint_matrices + joint * 16;
+      for (int i = 0; i < 16; ++i)
+        m[i] += w * jm[i];
+    }
+
+    const float* p = &in.positions[v * 3];
+    for (int r = 0; r < 3; ++r)
+      (*positions)[v * 3 + r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r];
+
+    if (!has_normals)
+      continue;
+    const float* n = &in.normals[v * 3];
+    float out[3];
+    for (int r = 0; r < 3; ++r)
+      out[r] = m[r] * n[0] + m[4 + r] * n[1] + m[8 + r] * n[2];
+    const float len = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+    for (int r = 0; r < 3; ++r)
+      (*normals)[v * 3 + r] = (len > 0.0f) ? out[r] / len : 0.0f;
+  }
+}
+
+void skin_vertices(const SkinnedVertices& in, const float* joint_matrices, size_t num_joints, float* out,
+  SkinBounds* bounds)
+{
+  current_impl().skin(in, 0, in.size(), joint_matrices, num_joints, out, bounds);
+}
+
+void skin_vertices_jobs(std::vector<SkinJob>& jobs, ThreadPool& pool)
+{
+  // 큰 primitive 하나가 worker 하나를 붙잡지 않도록 정점 묶음 단위로 나눈다.
+  struct Batch
+  {
+    size_t job;
+    size_t first;
+    size_t count;
+    SkinBounds bounds;
+  };
+  std::vector<Batch> batches;
+  for (size_t j = 0; j < jobs.size(); ++j)
+  {
+    const size_t count = jobs[j].vertices->size();
+    for (size_t first = 0; first < count; first += SKIN_BATCH_VERTICES)
+      batches.push_back(Batch{ j, first, std::min(SKIN_BATCH_VERTICES, count - first), SkinBounds() });
+  }
+
+  const SkinFunction skin = current_impl().skin;
+  pool.parallel_for(batches.size(), [&](size_t b) {
+    Batch& batch = batches[b];
+    const SkinJob& job = jobs[batch.job];
+    skin(*job.vertices, batch.first, batch.count, job.joint_matrices, job.num_joints, job.out, &batch.bounds);
+  });
+
+  for (SkinJob& job : jobs)
+    reset_bounds(&job.bounds);
+  for (const Batch& batch : batches)
+    merge_bounds(batch.bounds, &jobs[batch.job].bounds);
+}
+
+void skinning_use_simd(bool enable)
+{
+  simd_enabled = enable;
+}
+
+const char* skinning_impl_name()
+{
+  return current_impl().name;
+}
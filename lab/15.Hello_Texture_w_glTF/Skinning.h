@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../glTF/tiny_gltf.h"
+#include "Animation.h"
+
+class ThreadPool;
+
+// glTF skin: node 변환으로 joint 행렬(palette)을 만들고, CPU에서 정점을 skinning한다. (검증용 기준 구현과 SIMD/스레드 경로)
+//
+// 행렬은 glTF와 같은 column-major float[16]이다. (GL에 그대로 올린다)
+// joint 행렬은 inverse(world(mesh node)) * world(joint) * inverseBindMatrix로 만든다.
+// 그리는 쪽이 mesh node의 변환을 곱해도 씬 root 기준의 skinning 결과가 되도록 mesh node의 변환을 미리 뺀다.
+// OpenGL 호출은 하지 않는다.
+
+// node 계층: 씬에서 닿는 node를 부모가 자식보다 앞에 오도록 편 순서
+struct NodeHierarchy
+{
+  std::vector<int> order;
+  std::vector<int> parents;     // node별 부모 (-1이면 root)
+};
+
+void build_node_hierarchy(const tinygltf::Model& model, NodeHierarchy* hierarchy);
+
+// node별 씬 root 기준 변환 (node * 16). matrix가 없는 node는 pose의 T * R * S로 만든다.
+void compute_world_matrices(const tinygltf::Model& model, const NodeHierarchy& hierarchy, const AnimationPose& pose,
+  std::vector<float>* world);
+
+// skin을 쓰는 mesh node 하나의 joint palette
+struct SkinPalette
+{
+  int node = -1;                      // mesh와 skin을 가진 node
+  int skin = -1;
+  std::vector<int> joints;            // joint node 인덱스
+  std::vector<float> inverse_bind;    // joint * 16 (없으면 단위 행렬)
+  std::vector<float> matrices;        // joint * 16: compute_joint_matrices()의 결과
+};
+
+// mesh와 skin을 모두 가진 node마다 palette를 만든다. 잘못된 skin은 빼고 false와 함께 err에 적는다.
+bool build_skin_palettes(const tinygltf::Model& model, std::vector<SkinPalette>* palettes, std::string* err);
+
+// world(compute_world_matrices의 결과)로 palette->matrices를 채운다. SSE가 있으면 행렬 곱을 4열씩 한다.
+void compute_joint_matrices(const std::vector<float>& world, SkinPalette* palette);
+
+// CPU skinning의 입력: primitive 하나의 정점 (JOINTS_0/WEIGHTS_0의 influence 4개까지)
+struct SkinnedVertices
+{
+  std::vector<float> positions;       // vertex * 3
+  std::vector<float> normals;         // vertex * 3 (NORMAL이 없으면 비어 있음)
+  std::vector<uint16_t> joints;       // vertex * 4 (skin.joints의 인덱스)
+  std::vector<float> weights;         // vertex * 4
+
+  size_t size() const { return positions.size() / 3; }
+};
+
+// POSITION, NORMAL, JOINTS_0, WEIGHTS_0을 float로 읽는다. (양자화 전의 데이터, sparse accessor는 풀어서) 없거나 읽을 수 없으면 false
+bool read_skinned_vertices(const tinygltf::Model& model, const tinygltf::Primitive& primitive, SkinnedVertices* out);
+
+// 기준 구현: 정점마다 weight로 joint 행렬을 섞어 position과 normal(정규화)을 mesh 좌표로 낸다.
+// joint 인덱스가 num_joints를 넘는 influence는 무시한다.
+void skin_vertices_reference(const SkinnedVertices& in, const float* joint_matrices, size_t num_joints,
+  std::vector<float>* positions, std::vector<float>* normals);
+
+// CPU skinning 출력: 정점마다 position 3개, normal 3개를 이어서 쓴다. (NORMAL이 없으면 normal은 0)
+// GL_ARRAY_BUFFER에 그대로 올려 stride 24, offset 0/12로 읽는다.
+const size_t SKINNED_VERTEX_FLOATS = 6;
+
+// skinning한 position의 AABB (mesh 좌표)
+struct SkinBounds
+{
+  float min[3];
+  float max[3];
+};
+
+// skin_vertices_reference()와 같은 계산을 out(in.size() * SKINNED_VERTEX_FLOATS, 매핑된 buffer여도 됨)에 쓰고
+// position의 AABB를 bounds에 낸다. AVX2(+FMA)가 있으면 행렬을 섞는 것을 8개씩, 없으면 SSE로 4개씩 한다.
+// (곱셈 순서가 달라 기준 구현과 float 오차만큼 다를 수 있다)
+void skin_vertices(const SkinnedVertices& in, const float* joint_matrices, size_t num_joints, float* out,
+  SkinBounds* bounds);
+
+// primitive(또는 instance) 하나의 CPU skinning 작업
+struct SkinJob
+{
+  const SkinnedVertices* vertices = nullptr;
+  const float* joint_matrices = nullptr;
+  size_t num_joints = 0;
+  float* out = nullptr;                 // vertices->size() * SKINNED_VERTEX_FLOATS
+  SkinBounds bounds;                    // skin_vertices_jobs()의 결과
+};
+
+// jobs를 정점 SKIN_BATCH_VERTICES개 묶음으로 나눠 pool의 worker들이 skinning하고, 묶음의 AABB를 job마다 합친다.
+const size_t SKIN_BATCH_VERTICES = 4096;
+void skin_vertices_jobs(std::vector<SkinJob>& jobs, ThreadPool& pool);
+
+// 벤치마크용: false면 SIMD 경로를 쓰지 않는다.
+void skinning_use_simd(bool enable);
+
+// 현재 쓰이는 구현 이름 ("avx2", "sse", "scalar")
+const char* skinning_impl_name();
@@ -0,0 +1,145 @@
+#include "StagingRing.h"
+
+#include <algorithm>
+
+StagingRing::StagingRing()
+  : buffer_(0), mapped_(nullptr), capacity_(0), head_(0), next_serial_(1), completed_serial_(0),
+    peak_bytes_(0), staged_bytes_(0), allocations_(0), full_count_(0)
+{
+}
+
+bool StagingRing::init(size_t capacity)
+{
+  if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage)
+    return false;
+
+  const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glGenBuffers(1, &buffer_);
+  glBindBuffer(GL_COPY_READ_BUFFER, buffer_);
+  glBufferStorage(GL_COPY_READ_BUFFER, capacity, nullptr, flags);
+  mapped_ = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, capacity, flags));
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  if (!mapped_)
+  {
+    glDeleteBuffers(1, &buffer_);
+    buffer_ = 0;
+    return false;
+  }
+
+  capacity_ = capacity;
+  return true;
+}
+
+void StagingRing::release()
+{
+  if (buffer_ == 0)
+    return;
+
+  for (const Fence& fence : fences_)
+  {
+    glClientWaitSync(fence.sync, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(fence.sync);
+  }
+  fences_.clear();
+  regions_.clear();
+
+  glBindBuffer(GL_COPY_READ_BUFFER, buffer_);
+  glUnmapBuffer(GL_COPY_READ_BUFFER);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glDeleteBuffers(1, &buffer_);
+  buffer_ = 0;
+  mapped_ = nullptr;
+}
+
+bool StagingRing::allocate(size_t size, size_t* offset)
+{
+  size = (std::max<size_t>(size, 1) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  if (buffer_ == 0 || size > capacity_)
+    return false;
+
+  // 가장 오래된 자리(tail)부터 head_ 앞까지가 쓰는 중이다. head_ <= tail이면 끝에서 0으로 돌아온 상태
+  if (regions_.empty())
+    head_ = 0;
+  const size_t tail = regions_.empty() ? 0 : regions_.front().offset;
+  const bool wrapped = !regions_.empty() && head_ <= tail;
+
+  size_t at;
+  if (!wrapped && head_ + size <= capacity_)
+    at = head_;
+  else if (!wrapped && size <= tail)
+    at = 0;
+  else if (wrapped && head_ + size <= tail)
+    at = head_;
+  else
+  {
+    ++full_count_;
+    return false;
+  }
+
+  Region region = { at, size, NOT_SUBMITTED };
+  regions_.push_back(region);
+  head_ = at + size;
+  *offset = at;
+
+  staged_bytes_ += size;
+  ++allocations_;
+  peak_bytes_ = std::max(peak_bytes_, used_bytes());
+  return true;
+}
+
+void StagingRing::submit(size_t offset)
+{
+  for (Region& region : regions_)
+  {
+    if (region.offset == offset && region.fence == NOT_SUBMITTED)
+    {
+      region.fence = NOT_FENCED;
+      return;
+    }
+  }
+}
+
+void StagingRing::end_frame()
+{
+  if (buffer_ == 0)
+    return;
+
+  // 이번 프레임에 submit한 자리는 지금까지 낸 명령 뒤의 fence 하나로 기다린다.
+  bool has_unfenced = false;
+  for (const Region& region : regions_)
+    has_unfenced = has_unfenced || region.fence == NOT_FENCED;
+  if (has_unfenced)
+  {
+    Fence fence = { glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), next_serial_++ };
+    fences_.push_back(fence);
+    for (Region& region : regions_)
+    {
+      if (region.fence == NOT_FENCED)
+        region.fence = fence.serial;
+    }
+  }
+
+  // 기다리지 않고 GPU가 지난 fence만 확인한다.
+  while (!fences_.empty())
+  {
+    GLenum status = glClientWaitSync(fences_.front().sync, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+      break;
+    completed_serial_ = fences_.front().serial;
+    glDeleteSync(fences_.front().sync);
+    fences_.pop_front();
+  }
+
+  // 앞에서부터 복사가 끝난 자리를 돌려받는다. (중간에 아직 쓰는 자리가 있으면 거기서 멈춤)
+  while (!regions_.empty() && regions_.front().fence != NOT_SUBMITTED && regions_.front().fence != NOT_FENCED &&
+    regions_.front().fence <= completed_serial_)
+    regions_.pop_front();
+}
+
+size_t StagingRing::used_bytes() const
+{
+  if (regions_.empty())
+    return 0;
+  const size_t tail = regions_.front().offset;
+  return (head_ > tail) ? head_ - tail : capacity_ - tail + head_;
+}
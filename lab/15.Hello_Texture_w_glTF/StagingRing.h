@@ -0,0 +1,80 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// GPU로 올릴 픽셀/정점 데이터를 거쳐 가는 persistent-mapped 버퍼 하나를 링으로 나눠 쓴다. (GL 4.4 / ARB_buffer_storage)
+//
+// 렌더링 스레드가 allocate()로 자리를 잡아 주면 worker 스레드가 data()에 바로 쓰고,
+// 렌더링 스레드는 다 쓴 자리를 GL_PIXEL_UNPACK_BUFFER(PBO)나 glCopyBufferSubData의 원본으로 복사 명령만 낸다.
+// (coherent mapping이므로 flush는 필요 없고, 쓰기가 끝난 것은 호출한 쪽이 worker와 동기화해서 알아야 한다)
+// 복사 명령을 낸 자리는 submit()하고, end_frame()이 건 fence를 GPU가 지난 뒤에 다시 쓴다.
+// allocate/submit/end_frame은 렌더링 스레드에서만 호출한다.
+class StagingRing
+{
+public:
+  static const size_t ALIGNMENT = 64;   // 자리의 시작 위치 (PBO offset은 픽셀 형식의 크기로 나누어떨어져야 함)
+
+  StagingRing();
+
+  // capacity 바이트의 버퍼를 만들어 mapping한다. 지원하지 않으면 false
+  bool init(size_t capacity);
+  void release();               // GL 객체를 놓는다. (GPU가 쓰고 있으면 기다림)
+
+  bool enabled() const { return buffer_ != 0; }
+  GLuint buffer() const { return buffer_; }
+  size_t capacity() const { return capacity_; }
+
+  // size 바이트의 자리를 잡아 그 위치를 offset에 넣는다. 자리가 없으면 false (앞의 복사가 끝나면 다시 시도)
+  bool allocate(size_t size, size_t* offset);
+  unsigned char* data(size_t offset) const { return mapped_ + offset; }
+
+  // offset 자리의 복사 명령을 냈다. (명령을 내지 않고 버리는 경우도)
+  void submit(size_t offset);
+
+  // 프레임마다 한 번: submit한 자리에 fence를 걸고, GPU가 지난 fence의 자리를 돌려받는다.
+  void end_frame();
+
+  size_t used_bytes() const;
+  size_t peak_bytes() const { return peak_bytes_; }
+  size_t staged_bytes() const { return staged_bytes_; }     // allocate한 바이트 (누적)
+  size_t allocations() const { return allocations_; }
+  size_t full_count() const { return full_count_; }         // 자리가 없어 allocate가 실패한 횟수
+
+private:
+  StagingRing(const StagingRing&);
+  StagingRing& operator=(const StagingRing&);
+
+  static const uint64_t NOT_SUBMITTED = 0;
+  static const uint64_t NOT_FENCED = ~uint64_t(0);
+
+  struct Region
+  {
+    size_t    offset;
+    size_t    size;
+    uint64_t  fence;      // 이 자리를 읽는 복사 명령 뒤의 fence 번호 (NOT_SUBMITTED, NOT_FENCED)
+  };
+
+  struct Fence
+  {
+    GLsync    sync;
+    uint64_t  serial;
+  };
+
+private:
+  GLuint          buffer_;
+  unsigned char*  mapped_;
+  size_t          capacity_;
+  size_t          head_;              // 다음 자리를 잡을 위치
+  std::deque<Region> regions_;        // 잡은 순서 (앞이 가장 오래됨)
+  std::deque<Fence>  fences_;
+  uint64_t        next_serial_;
+  uint64_t        completed_serial_;  // GPU가 지난 마지막 fence
+
+  size_t          peak_bytes_;
+  size_t          staged_bytes_;
+  size_t          allocations_;
+  size_t          full_count_;
+};
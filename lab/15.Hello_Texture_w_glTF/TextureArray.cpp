@@ -0,0 +1,198 @@
+#include "TextureArray.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+namespace {
+  struct ShelfPosition
+  {
+    int layer;
+    int x;
+    int y;
+  };
+
+  // 높이가 큰 것부터 선반(shelf) 단위로 채운다. 사용한 layer 수를 반환한다.
+  int pack_shelves(const std::vector<TextureArrayInput>& inputs, const std::vector<size_t>& order, int size,
+    std::vector<ShelfPosition>* positions)
+  {
+    const int g = TEXTURE_ATLAS_GUTTER;
+    positions->assign(order.size(), ShelfPosition());
+
+    int layer = 0, x = 0, y = 0, shelf_height = 0;
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+      const int w = inputs[order[i]].width + 2 * g, h = inputs[order[i]].height + 2 * g;
+      if (x + w > size)
+      {
+        x = 0;
+        y += shelf_height;
+        shelf_height = 0;
+      }
+      if (y + h > size)
+      {
+        ++layer;
+        x = y = shelf_height = 0;
+      }
+      (*positions)[i].layer = layer;
+      (*positions)[i].x = x + g;
+      (*positions)[i].y = y + g;
+      x += w;
+      shelf_height = std::max(shelf_height, h);
+    }
+    return order.empty() ? 0 : layer + 1;
+  }
+
+  // layer가 max_layers를 넘으면 배열을 나눈다.
+  void add_arrays(const TextureArrayDesc& desc, int max_layers, std::vector<TextureArrayDesc>* arrays)
+  {
+    for (int first = 0; first < desc.layers; first += max_layers)
+    {
+      TextureArrayDesc part = desc;
+      part.layers = std::min(max_layers, desc.layers - first);
+      arrays->push_back(part);
+    }
+  }
+
+  // 크기, 형식, sampler가 같은 텍스처를 layer 순서대로 넣는다.
+  void plan_group(const std::vector<TextureArrayInput>& inputs, const std::vector<size_t>& members, int max_layers,
+    TextureArrayPlan* plan)
+  {
+    const TextureArrayInput& first = inputs[members[0]];
+
+    TextureArrayDesc desc;
+    desc.width = first.width;
+    desc.height = first.height;
+    desc.codec = first.codec;
+    desc.levels = first.levels;
+    desc.layers = int(members.size());
+    desc.atlas = false;
+    desc.first_input = members[0];
+
+    const int first_array = int(plan->arrays.size());
+    add_arrays(desc, max_layers, &plan->arrays);
+
+    for (size_t i = 0; i < members.size(); ++i)
+    {
+      TexturePlacement& p = plan->placements[members[i]];
+      p.array = first_array + int(i) / max_layers;
+      p.layer = int(i) % max_layers;
+    }
+  }
+
+  // 짝이 없는 RGBA8 텍스처를 선반 방식으로 아틀라스 layer에 모은다.
+  void plan_atlas(const std::vector<TextureArrayInput>& inputs, std::vector<size_t> order, int max_layers,
+    int atlas_size, TextureArrayPlan* plan)
+  {
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return inputs[a].height > inputs[b].height;
+    });
+
+    // 한 layer에 다 들어가는 가장 작은 크기를 쓴다.
+    std::vector<ShelfPosition> positions;
+    int size = 256;
+    for (size_t i : order)
+    {
+      while (size < inputs[i].width + 2 * TEXTURE_ATLAS_GUTTER || size < inputs[i].height + 2 * TEXTURE_ATLAS_GUTTER)
+        size *= 2;
+    }
+    while (size < atlas_size && pack_shelves(inputs, order, size, &positions) > 1)
+      size *= 2;
+    size = std::min(size, atlas_size);
+    const int layers = pack_shelves(inputs, order, size, &positions);
+
+    // 아래쪽 빈 선반은 잘라낸다. (mip level TEXTURE_ATLAS_MAX_LEVEL까지 나누어떨어지게)
+    const int align = 1 << TEXTURE_ATLAS_MAX_LEVEL;
+    int height = 0;
+    for (size_t i = 0; i < order.size(); ++i)
+      height = std::max(height, positions[i].y + inputs[order[i]].height + TEXTURE_ATLAS_GUTTER);
+    height = std::min(size, (height + align - 1) / align * align);
+
+    TextureArrayDesc desc;
+    desc.width = size;
+    desc.height = height;
+    desc.codec = TEXTURE_CODEC_NONE;
+    desc.levels = 0;
+    desc.layers = layers;
+    desc.atlas = true;
+    desc.first_input = order[0];
+
+    const int first_array = int(plan->arrays.size());
+    add_arrays(desc, max_layers, &plan->arrays);
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+      const TextureArrayInput& input = inputs[order[i]];
+      TexturePlacement& p = plan->placements[order[i]];
+      p.array = first_array + positions[i].layer / max_layers;
+      p.layer = positions[i].layer % max_layers;
+      p.x = positions[i].x;
+      p.y = positions[i].y;
+      p.uv_transform[0] = float(p.x) / size;
+      p.uv_transform[1] = float(p.y) / height;
+      p.uv_transform[2] = float(input.width) / size;
+      p.uv_transform[3] = float(input.height) / height;
+    }
+  }
+}
+
+void plan_texture_arrays(const std::vector<TextureArrayInput>& inputs, int max_layers, int atlas_size,
+  TextureArrayPlan* plan)
+{
+  plan->arrays.clear();
+  plan->placements.assign(inputs.size(), TexturePlacement());
+
+  typedef std::tuple<int, int, int, int, uint64_t> GroupKey;   // codec, width, height, levels, sampler
+  std::map<GroupKey, std::vector<size_t>> groups;
+  for (size_t i = 0; i < inputs.size(); ++i)
+  {
+    const TextureArrayInput& in = inputs[i];
+    groups[GroupKey(in.codec, in.width, in.height, in.levels, in.sampler_key)].push_back(i);
+  }
+
+  // 짝이 없는 텍스처 중 아틀라스 반 변보다 작은 것은 필터 상태별 아틀라스로 보낸다.
+  const int max_atlas_entry = atlas_size / 2 - 2 * TEXTURE_ATLAS_GUTTER;
+  std::map<uint64_t, std::vector<size_t>> atlases;
+
+  for (const std::pair<const GroupKey, std::vector<size_t>>& group : groups)
+  {
+    const std::vector<size_t>& members = group.second;
+    const TextureArrayInput& first = inputs[members[0]];
+    if (members.size() == 1 && first.can_atlas && first.width <= max_atlas_entry && first.height <= max_atlas_entry)
+    {
+      atlases[first.filter_key].push_back(members[0]);
+      continue;
+    }
+
+    plan_group(inputs, members, max_layers, plan);
+  }
+
+  // 아틀라스에 하나만 들어가면 배열 하나로 두는 것이 작다.
+  for (const std::pair<const uint64_t, std::vector<size_t>>& atlas : atlases)
+  {
+    if (atlas.second.size() == 1)
+      plan_group(inputs, atlas.second, max_layers, plan);
+    else
+      plan_atlas(inputs, atlas.second, max_layers, atlas_size, plan);
+  }
+}
+
+void blit_to_atlas(const unsigned char* rgba, int width, int height, int x, int y,
+  unsigned char* atlas, int atlas_size)
+{
+  const int g = TEXTURE_ATLAS_GUTTER;
+  for (int dy = -g; dy < height + g; ++dy)
+  {
+    const int sy = std::min(std::max(dy, 0), height - 1);
+    unsigned char* row = atlas + (size_t(y + dy) * atlas_size + x) * 4;
+    const unsigned char* src = rgba + size_t(sy) * width * 4;
+
+    std::memcpy(row, src, size_t(width) * 4);
+    for (int dx = 1; dx <= g; ++dx)
+    {
+      std::memcpy(row - dx * 4, src, 4);
+      std::memcpy(row + (width + dx - 1) * 4, src + (width - 1) * 4, 4);
+    }
+  }
+}
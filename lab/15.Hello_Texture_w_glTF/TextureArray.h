@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TextureCompressor.h"
+
+// 텍스처를 GL_TEXTURE_2D_ARRAY 몇 개로 묶는 배치 계획.
+//
+// 크기, 형식, sampler 상태가 같은 텍스처는 한 배열의 layer가 되고,
+// 짝이 없는 크기의 RGBA8 텍스처는 아틀라스 layer에 모아서 UV를 offset/scale로 바꿔 읽는다.
+// 아틀라스의 텍스처 둘레에는 GUTTER 픽셀만큼 가장자리를 반복해 두어 mip level TEXTURE_ATLAS_MAX_LEVEL까지는 번지지 않게 한다.
+// 쉐이더는 텍스처마다 배열 하나와 layer 번호만 받으므로 텍스처 수에 제한이 없고 bind 횟수는 배열 수만큼이다.
+// OpenGL 호출은 하지 않는다. (계획대로 올리는 것은 렌더링 쪽의 몫)
+
+const int TEXTURE_ATLAS_GUTTER = 4;
+const int TEXTURE_ATLAS_MAX_LEVEL = 2;    // log2(GUTTER)
+
+struct TextureArrayInput
+{
+  int           width;
+  int           height;
+  TextureCodec  codec;          // TEXTURE_CODEC_NONE이면 RGBA8
+  int           levels;         // 압축 텍스처의 mip level 수 (RGBA8은 0, mip chain은 GL이 만든다)
+  uint64_t      sampler_key;    // 필터와 wrap 상태. 같은 배열의 텍스처는 sampler를 공유한다.
+  uint64_t      filter_key;     // 필터 상태만 (아틀라스는 wrap을 쉐이더에서 하므로)
+  bool          can_atlas;      // RGBA8이고 wrap이 MIRRORED_REPEAT가 아님
+};
+
+struct TextureArrayDesc
+{
+  int           width;
+  int           height;
+  TextureCodec  codec;
+  int           levels;
+  int           layers;
+  bool          atlas;
+  size_t        first_input;    // sampler 상태를 가져올 입력
+};
+
+struct TexturePlacement
+{
+  int   array = -1;             // TextureArrayPlan::arrays의 인덱스
+  int   layer = 0;
+  int   x = 0;                  // 아틀라스 안의 위치 (gutter 안쪽, 픽셀)
+  int   y = 0;
+  float uv_transform[4] = { 0.0f, 0.0f, 1.0f, 1.0f };   // 아틀라스: offset.xy, scale.zw
+};
+
+struct TextureArrayPlan
+{
+  std::vector<TextureArrayDesc> arrays;
+  std::vector<TexturePlacement> placements;   // 입력 순서
+};
+
+// max_layers: 배열 하나의 최대 layer 수, atlas_size: 아틀라스 layer의 최대 한 변 (픽셀, 높이는 쓴 만큼 잘라낸다)
+void plan_texture_arrays(const std::vector<TextureArrayInput>& inputs, int max_layers, int atlas_size,
+  TextureArrayPlan* plan);
+
+// RGBA8 이미지를 아틀라스 layer (폭 atlas_size, RGBA8)의 (x, y)에 복사하고 둘레의 gutter를 가장자리 픽셀로 채운다.
+void blit_to_atlas(const unsigned char* rgba, int width, int height, int x, int y,
+  unsigned char* atlas, int atlas_size);
@@ -0,0 +1,1093 @@
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define TEXCOMP_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TEXCOMP_TARGET(x)
+#else
+#define TEXCOMP_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+namespace {
+  const char      CACHE_DIR[] = "texture_cache";
+  const char      CACHE_MAGIC[8] = { 'G', 'L', 'T', 'F', 'T', 'E', 'X', 'C' };
+  const uint32_t  CACHE_VERSION = 1;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// 4x4 블록과 팔레트
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // 채널별로 모아 둔 16픽셀 (SIMD로 4픽셀씩 읽기 좋게). 픽셀 i = y*4 + x
+  struct Block
+  {
+    int c[4][16];
+  };
+
+  struct Palette
+  {
+    int c[16][4];
+  };
+
+  // 쓰지 않는 채널은 블록과 팔레트 모두 0으로 두면 오차에 들어가지 않는다.
+  Block channels_of(const Block& block, bool r, bool g, bool b, bool a)
+  {
+    Block out = block;
+    const bool keep[4] = { r, g, b, a };
+    for (int ch = 0; ch < 4; ++ch)
+    {
+      if (!keep[ch])
+        std::memset(out.c[ch], 0, sizeof(out.c[ch]));
+    }
+    return out;
+  }
+
+  // 픽셀마다 가장 가까운 팔레트 색(제곱 오차)을 고르고 오차의 합을 반환한다.
+  // 오차가 같으면 앞의 색을 고른다. (SIMD/스칼라 결과가 같도록)
+  int select_indices_scalar(const Block& block, const Palette& palette, int n, unsigned char* indices)
+  {
+    int total = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+      int best = INT_MAX;
+      int best_k = 0;
+      for (int k = 0; k < n; ++k)
+      {
+        int d = 0;
+        for (int ch = 0; ch < 4; ++ch)
+        {
+          int diff = block.c[ch][i] - palette.c[k][ch];
+          d += diff * diff;
+        }
+        if (d < best)
+        {
+          best = d;
+          best_k = k;
+        }
+      }
+      indices[i] = static_cast<unsigned char>(best_k);
+      total += best;
+    }
+    return total;
+  }
+
+#ifdef TEXCOMP_X86
+  TEXCOMP_TARGET("sse4.1")
+  int select_indices_sse41(const Block& block, const Palette& palette, int n, unsigned char* indices)
+  {
+    __m128i total = _mm_setzero_si128();
+    for (int i = 0; i < 16; i += 4)
+    {
+      const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block.c[0] + i));
+      const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block.c[1] + i));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block.c[2] + i));
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block.c[3] + i));
+
+      __m128i best = _mm_set1_epi32(INT_MAX);
+      __m128i best_k = _mm_setzero_si128();
+      for (int k = 0; k < n; ++k)
+      {
+        const __m128i dr = _mm_sub_epi32(r, _mm_set1_epi32(palette.c[k][0]));
+        const __m128i dg = _mm_sub_epi32(g, _mm_set1_epi32(palette.c[k][1]));
+        const __m128i db = _mm_sub_epi32(b, _mm_set1_epi32(palette.c[k][2]));
+        const __m128i da = _mm_sub_epi32(a, _mm_set1_epi32(palette.c[k][3]));
+        const __m128i d = _mm_add_epi32(
+          _mm_add_epi32(_mm_mullo_epi32(dr, dr), _mm_mullo_epi32(dg, dg)),
+          _mm_add_epi32(_mm_mullo_epi32(db, db), _mm_mullo_epi32(da, da)));
+
+        const __m128i less = _mm_cmplt_epi32(d, best);
+        best = _mm_min_epi32(d, best);
+        best_k = _mm_blendv_epi8(best_k, _mm_set1_epi32(k), less);
+      }
+
+      // 인덱스는 0 ~ 15이므로 각 32-bit 값의 하위 바이트만 모은다.
+      const __m128i packed = _mm_shuffle_epi8(best_k, _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+      int four = _mm_cvtsi128_si32(packed);
+      std::memcpy(indices + i, &four, 4);
+      total = _mm_add_epi32(total, best);
+    }
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(1, 0, 3, 2)));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(total);
+  }
+
+  bool cpu_has_sse41()
+  {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 19)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1");
+#endif
+  }
+#endif // TEXCOMP_X86
+
+  typedef int (*SelectFunction)(const Block&, const Palette&, int, unsigned char*);
+
+  struct Impl
+  {
+    SelectFunction  select;
+    const char*     name;
+  };
+
+  Impl best_impl()
+  {
+#ifdef TEXCOMP_X86
+    if (cpu_has_sse41())
+      return Impl{ select_indices_sse41, "sse4.1" };
+#endif
+    return Impl{ select_indices_scalar, "scalar" };
+  }
+
+  const Impl simd_impl = best_impl();
+  std::atomic<bool> simd_enabled(true);
+
+  const Impl& current_impl()
+  {
+    static const Impl scalar = { select_indices_scalar, "scalar" };
+    return simd_enabled ? simd_impl : scalar;
+  }
+
+  int select_indices(const Block& block, const Palette& palette, int n, unsigned char* indices)
+  {
+    return current_impl().select(block, palette, n, indices);
+  }
+
+  int clamp255(int v)
+  {
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+  }
+
+  int round_clamp(float v, int max_value)
+  {
+    int i = static_cast<int>(std::floor(v + 0.5f));
+    return i < 0 ? 0 : (i > max_value ? max_value : i);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// endpoint 찾기: 주성분 축 위의 양 끝 + 최소제곱 보정
+  ////////////////////////////////////////////////////////////////////////////////
+  void principal_endpoints(const Block& block, int channels, float e0[4], float e1[4])
+  {
+    float mean[4] = { 0, 0, 0, 0 };
+    for (int ch = 0; ch < channels; ++ch)
+    {
+      for (int i = 0; i < 16; ++i)
+        mean[ch] += block.c[ch][i];
+      mean[ch] /= 16.0f;
+    }
+
+    float cov[4][4] = {};
+    for (int i = 0; i < 16; ++i)
+    {
+      float d[4] = { 0, 0, 0, 0 };
+      for (int ch = 0; ch < channels; ++ch)
+        d[ch] = block.c[ch][i] - mean[ch];
+      for (int r = 0; r < channels; ++r)
+        for (int c = 0; c < channels; ++c)
+          cov[r][c] += d[r] * d[c];
+    }
+
+    // power iteration
+    float axis[4] = { 1, 1, 1, 1 };
+    for (int iter = 0; iter < 8; ++iter)
+    {
+      float next[4] = { 0, 0, 0, 0 };
+      float len = 0.0f;
+      for (int r = 0; r < channels; ++r)
+      {
+        for (int c = 0; c < channels; ++c)
+          next[r] += cov[r][c] * axis[c];
+        len = std::max(len, std::fabs(next[r]));
+      }
+      if (len < 1e-6f)
+        break;
+      for (int r = 0; r < channels; ++r)
+        axis[r] = next[r] / len;
+    }
+    float len2 = 0.0f;
+    for (int ch = 0; ch < channels; ++ch)
+      len2 += axis[ch] * axis[ch];
+
+    float tmin = 0.0f, tmax = 0.0f;
+    if (len2 > 1e-12f)
+    {
+      tmin = 1e30f;
+      tmax = -1e30f;
+      for (int i = 0; i < 16; ++i)
+      {
+        float t = 0.0f;
+        for (int ch = 0; ch < channels; ++ch)
+          t += (block.c[ch][i] - mean[ch]) * axis[ch];
+        tmin = std::min(tmin, t);
+        tmax = std::max(tmax, t);
+      }
+      tmin /= len2;
+      tmax /= len2;
+    }
+
+    for (int ch = 0; ch < 4; ++ch)
+    {
+      e0[ch] = ch < channels ? std::min(255.0f, std::max(0.0f, mean[ch] + axis[ch] * tmin)) : 0.0f;
+      e1[ch] = ch < channels ? std::min(255.0f, std::max(0.0f, mean[ch] + axis[ch] * tmax)) : 0.0f;
+    }
+  }
+
+  // 인덱스를 고정하고 (1-w)*e0 + w*e1이 픽셀에 가장 가깝도록 endpoint를 다시 구한다.
+  bool refine_endpoints(const Block& block, int channels, const unsigned char* indices,
+    const float* weights, float e0[4], float e1[4])
+  {
+    float aa = 0, bb = 0, ab = 0;
+    float ax[4] = { 0, 0, 0, 0 }, bx[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < 16; ++i)
+    {
+      float w = weights[indices[i]];
+      float a = 1.0f - w;
+      aa += a * a;
+      bb += w * w;
+      ab += a * w;
+      for (int ch = 0; ch < channels; ++ch)
+      {
+        ax[ch] += a * block.c[ch][i];
+        bx[ch] += w * block.c[ch][i];
+      }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f)
+      return false;
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+      e0[ch] = std::min(255.0f, std::max(0.0f, (ax[ch] * bb - bx[ch] * ab) / det));
+      e1[ch] = std::min(255.0f, std::max(0.0f, (bx[ch] * aa - ax[ch] * ab) / det));
+    }
+    return true;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// BC1 (BC3의 색 블록도 같음)
+  ////////////////////////////////////////////////////////////////////////////////
+  int to565(const float c[4])
+  {
+    return (round_clamp(c[0] * 31.0f / 255.0f, 31) << 11) |
+      (round_clamp(c[1] * 63.0f / 255.0f, 63) << 5) |
+      round_clamp(c[2] * 31.0f / 255.0f, 31);
+  }
+
+  void from565(int c, int out[4])
+  {
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+    out[3] = 0;
+  }
+
+  // c0 > c1 인 4색 모드로 팔레트를 만들어 인덱스를 고른다.
+  int evaluate_bc1(const Block& block, int* c0, int* c1, unsigned char* indices)
+  {
+    if (*c0 < *c1)
+      std::swap(*c0, *c1);
+
+    Palette palette;
+    from565(*c0, palette.c[0]);
+    from565(*c1, palette.c[1]);
+    if (*c0 == *c1)
+    {
+      std::memset(indices, 0, 16);
+      return select_indices(block, palette, 1, indices);
+    }
+    for (int ch = 0; ch < 4; ++ch)
+    {
+      palette.c[2][ch] = (2 * palette.c[0][ch] + palette.c[1][ch]) / 3;
+      palette.c[3][ch] = (palette.c[0][ch] + 2 * palette.c[1][ch]) / 3;
+    }
+    return select_indices(block, palette, 4, indices);
+  }
+
+  void encode_bc1_block(const Block& rgba, unsigned char* out)
+  {
+    static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    const Block block = channels_of(rgba, true, true, true, false);
+
+    float e0[4], e1[4];
+    principal_endpoints(block, 3, e0, e1);
+
+    unsigned char indices[16];
+    int c0 = to565(e1), c1 = to565(e0);
+    int err = evaluate_bc1(block, &c0, &c1, indices);
+
+    if (err > 0 && refine_endpoints(block, 3, indices, weights, e0, e1))
+    {
+      unsigned char refined[16];
+      int r0 = to565(e0), r1 = to565(e1);
+      if (evaluate_bc1(block, &r0, &r1, refined) < err)
+      {
+        c0 = r0;
+        c1 = r1;
+        std::memcpy(indices, refined, 16);
+      }
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; ++i)
+      bits |= uint32_t(indices[i]) << (2 * i);
+
+    out[0] = static_cast<unsigned char>(c0);
+    out[1] = static_cast<unsigned char>(c0 >> 8);
+    out[2] = static_cast<unsigned char>(c1);
+    out[3] = static_cast<unsigned char>(c1 >> 8);
+    for (int i = 0; i < 4; ++i)
+      out[4 + i] = static_cast<unsigned char>(bits >> (8 * i));
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// BC4 (BC3의 alpha, BC5의 각 채널)
+  ////////////////////////////////////////////////////////////////////////////////
+  void encode_bc4_block(const Block& rgba, int channel, unsigned char* out)
+  {
+    Block block;
+    std::memset(&block, 0, sizeof(block));
+    std::memcpy(block.c[0], rgba.c[channel], sizeof(block.c[0]));
+
+    int lo = 255, hi = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+      lo = std::min(lo, block.c[0][i]);
+      hi = std::max(hi, block.c[0][i]);
+    }
+
+    unsigned char indices[16] = {};
+    if (lo != hi)
+    {
+      // a0 > a1: 8단계 모드
+      Palette palette;
+      std::memset(&palette, 0, sizeof(palette));
+      palette.c[0][0] = hi;
+      palette.c[1][0] = lo;
+      for (int i = 1; i < 7; ++i)
+        palette.c[i + 1][0] = ((7 - i) * hi + i * lo) / 7;
+      select_indices(block, palette, 8, indices);
+    }
+
+    out[0] = static_cast<unsigned char>(hi);
+    out[1] = static_cast<unsigned char>(lo);
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; ++i)
+      bits |= uint64_t(indices[i]) << (3 * i);
+    for (int i = 0; i < 6; ++i)
+      out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// BC7: mode 6 (subset 1개, RGBA 7+p bit endpoint, 4-bit 인덱스)만 쓴다.
+  ////////////////////////////////////////////////////////////////////////////////
+  const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+  struct Bc7Mode6
+  {
+    int e[2][4];      // 7-bit endpoint
+    int p[2];         // endpoint별 p-bit
+    unsigned char indices[16];
+    int err;
+  };
+
+  void evaluate_bc7(const Block& block, const float e0[4], const float e1[4], Bc7Mode6* best)
+  {
+    const float* e[2] = { e0, e1 };
+    for (int pbits = 0; pbits < 4; ++pbits)
+    {
+      Bc7Mode6 m;
+      m.p[0] = pbits & 1;
+      m.p[1] = pbits >> 1;
+
+      int q[2][4];
+      for (int j = 0; j < 2; ++j)
+      {
+        for (int ch = 0; ch < 4; ++ch)
+        {
+          m.e[j][ch] = round_clamp((e[j][ch] - m.p[j]) * 0.5f, 127);
+          q[j][ch] = (m.e[j][ch] << 1) | m.p[j];
+        }
+      }
+
+      Palette palette;
+      for (int k = 0; k < 16; ++k)
+      {
+        for (int ch = 0; ch < 4; ++ch)
+          palette.c[k][ch] = ((64 - BC7_WEIGHTS4[k]) * q[0][ch] + BC7_WEIGHTS4[k] * q[1][ch] + 32) >> 6;
+      }
+      m.err = select_indices(block, palette, 16, m.indices);
+      if (m.err < best->err)
+        *best = m;
+    }
+  }
+
+  class BitWriter
+  {
+  public:
+    explicit BitWriter(unsigned char* out) : out_(out), pos_(0) { std::memset(out, 0, 16); }
+
+    void write(uint32_t value, int bits)
+    {
+      for (int i = 0; i < bits; ++i, ++pos_)
+      {
+        if (value & (1u << i))
+          out_[pos_ >> 3] |= static_cast<unsigned char>(1 << (pos_ & 7));
+      }
+    }
+
+  private:
+    unsigned char*  out_;
+    int             pos_;
+  };
+
+  void encode_bc7_block(const Block& block, unsigned char* out)
+  {
+    float weights[16];
+    for (int k = 0; k < 16; ++k)
+      weights[k] = BC7_WEIGHTS4[k] / 64.0f;
+
+    float e0[4], e1[4];
+    principal_endpoints(block, 4, e0, e1);
+
+    Bc7Mode6 best;
+    best.err = INT_MAX;
+    evaluate_bc7(block, e0, e1, &best);
+    if (best.err > 0 && refine_endpoints(block, 4, best.indices, weights, e0, e1))
+      evaluate_bc7(block, e0, e1, &best);
+
+    // 첫 픽셀(anchor)의 인덱스 최상위 비트는 0이어야 하므로 필요하면 endpoint를 뒤집는다.
+    if (best.indices[0] & 8)
+    {
+      for (int ch = 0; ch < 4; ++ch)
+        std::swap(best.e[0][ch], best.e[1][ch]);
+      std::swap(best.p[0], best.p[1]);
+      for (int i = 0; i < 16; ++i)
+        best.indices[i] = static_cast<unsigned char>(15 - best.indices[i]);
+    }
+
+    BitWriter w(out);
+    w.write(1 << 6, 7);
+    for (int ch = 0; ch < 4; ++ch)
+    {
+      w.write(best.e[0][ch], 7);
+      w.write(best.e[1][ch], 7);
+    }
+    w.write(best.p[0], 1);
+    w.write(best.p[1], 1);
+    w.write(best.indices[0], 3);
+    for (int i = 1; i < 16; ++i)
+      w.write(best.indices[i], 4);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// ETC2 RGB: ETC1 호환 모드(individual/differential)만 쓴다.
+  ////////////////////////////////////////////////////////////////////////////////
+  const int ETC1_TABLES[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 },
+  };
+  // 픽셀 인덱스 값 → ETC1_TABLES의 modifier (+a, +b, -a, -b)
+  const int ETC1_MODIFIER_SIGN[4] = { 1, 1, -1, -1 };
+  const int ETC1_MODIFIER_SLOT[4] = { 0, 1, 0, 1 };
+
+  struct EtcHalf
+  {
+    int table;
+    unsigned char indices[8];
+    int err;
+  };
+
+  // base 색과 sub-block의 8픽셀로 가장 좋은 table과 픽셀 인덱스를 고른다.
+  EtcHalf fit_etc_half(const Block& block, const int* pixels, const int base[3])
+  {
+    EtcHalf best;
+    best.err = INT_MAX;
+    for (int t = 0; t < 8; ++t)
+    {
+      EtcHalf h;
+      h.table = t;
+      h.err = 0;
+      for (int j = 0; j < 8 && h.err < best.err; ++j)
+      {
+        int i = pixels[j];
+        int pixel_best = INT_MAX;
+        for (int k = 0; k < 4; ++k)
+        {
+          int mod = ETC1_MODIFIER_SIGN[k] * ETC1_TABLES[t][ETC1_MODIFIER_SLOT[k]];
+          int d = 0;
+          for (int ch = 0; ch < 3; ++ch)
+          {
+            int diff = clamp255(base[ch] + mod) - block.c[ch][i];
+            d += diff * diff;
+          }
+          if (d < pixel_best)
+          {
+            pixel_best = d;
+            h.indices[j] = static_cast<unsigned char>(k);
+          }
+        }
+        h.err += pixel_best;
+      }
+      if (h.err < best.err)
+        best = h;
+    }
+    return best;
+  }
+
+  void encode_etc2_rgb_block(const Block& block, unsigned char* out)
+  {
+    int best_err = INT_MAX;
+    for (int flip = 0; flip < 2; ++flip)
+    {
+      // flip 0: 왼쪽/오른쪽 2x4, flip 1: 위/아래 4x2
+      int pixels[2][8];
+      for (int h = 0; h < 2; ++h)
+      {
+        int n = 0;
+        for (int y = 0; y < 4; ++y)
+          for (int x = 0; x < 4; ++x)
+            if ((flip ? y / 2 : x / 2) == h)
+              pixels[h][n++] = y * 4 + x;
+      }
+
+      float avg[2][3] = {};
+      for (int h = 0; h < 2; ++h)
+        for (int ch = 0; ch < 3; ++ch)
+        {
+          for (int j = 0; j < 8; ++j)
+            avg[h][ch] += block.c[ch][pixels[h][j]];
+          avg[h][ch] /= 8.0f;
+        }
+
+      for (int diff = 0; diff < 2; ++diff)
+      {
+        int q[2][3], base[2][3];
+        bool ok = true;
+        for (int h = 0; h < 2; ++h)
+        {
+          for (int ch = 0; ch < 3; ++ch)
+          {
+            if (diff)
+            {
+              q[h][ch] = round_clamp(avg[h][ch] * 31.0f / 255.0f, 31);
+              base[h][ch] = (q[h][ch] << 3) | (q[h][ch] >> 2);
+            }
+            else
+            {
+              q[h][ch] = round_clamp(avg[h][ch] * 15.0f / 255.0f, 15);
+              base[h][ch] = (q[h][ch] << 4) | q[h][ch];
+            }
+          }
+        }
+        // differential 모드는 두 색의 차이가 -4 ~ 3이어야 한다.
+        for (int ch = 0; ch < 3 && diff; ++ch)
+          ok = ok && q[1][ch] - q[0][ch] >= -4 && q[1][ch] - q[0][ch] <= 3;
+        if (!ok)
+          continue;
+
+        EtcHalf half[2] = { fit_etc_half(block, pixels[0], base[0]), fit_etc_half(block, pixels[1], base[1]) };
+        int err = half[0].err + half[1].err;
+        if (err >= best_err)
+          continue;
+        best_err = err;
+
+        for (int ch = 0; ch < 3; ++ch)
+        {
+          if (diff)
+            out[ch] = static_cast<unsigned char>((q[0][ch] << 3) | ((q[1][ch] - q[0][ch]) & 7));
+          else
+            out[ch] = static_cast<unsigned char>((q[0][ch] << 4) | q[1][ch]);
+        }
+        out[3] = static_cast<unsigned char>((half[0].table << 5) | (half[1].table << 2) | (diff << 1) | flip);
+
+        // 픽셀 (x, y)의 인덱스 비트는 x*4 + y 번째. 상위 비트 16개, 하위 비트 16개 순서 (big-endian)
+        uint32_t msb = 0, lsb = 0;
+        for (int h = 0; h < 2; ++h)
+        {
+          for (int j = 0; j < 8; ++j)
+          {
+            int i = pixels[h][j];
+            int bit = (i % 4) * 4 + i / 4;
+            msb |= uint32_t(half[h].indices[j] >> 1) << bit;
+            lsb |= uint32_t(half[h].indices[j] & 1) << bit;
+          }
+        }
+        out[4] = static_cast<unsigned char>(msb >> 8);
+        out[5] = static_cast<unsigned char>(msb);
+        out[6] = static_cast<unsigned char>(lsb >> 8);
+        out[7] = static_cast<unsigned char>(lsb);
+      }
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// EAC: ETC2 RGBA의 alpha, R11/RG11의 각 채널 (8-bit 값으로 인코딩)
+  ////////////////////////////////////////////////////////////////////////////////
+  const int EAC_TABLES[16][8] = {
+    { -3, -6,  -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5,  -8, -13, 1, 4, 7, 12 },
+    { -2, -4,  -6, -13, 1, 3, 5, 12 },
+    { -3, -6,  -8, -12, 2, 5, 7, 11 },
+    { -3, -7,  -9, -11, 2, 6, 8, 10 },
+    { -4, -7,  -8, -11, 3, 6, 7, 10 },
+    { -3, -5,  -8, -11, 2, 4, 7, 10 },
+    { -2, -6,  -8, -10, 1, 5, 7,  9 },
+    { -2, -5,  -8, -10, 1, 4, 7,  9 },
+    { -2, -4,  -8, -10, 1, 3, 7,  9 },
+    { -2, -5,  -7, -10, 1, 4, 6,  9 },
+    { -3, -4,  -7, -10, 2, 3, 6,  9 },
+    { -1, -2,  -3, -10, 0, 1, 2,  9 },
+    { -4, -6,  -8,  -9, 3, 5, 7,  8 },
+    { -3, -5,  -7,  -9, 2, 4, 6,  8 },
+  };
+
+  void encode_eac_block(const Block& rgba, int channel, unsigned char* out)
+  {
+    Block block;
+    std::memset(&block, 0, sizeof(block));
+    std::memcpy(block.c[0], rgba.c[channel], sizeof(block.c[0]));
+
+    int lo = 255, hi = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+      lo = std::min(lo, block.c[0][i]);
+      hi = std::max(hi, block.c[0][i]);
+    }
+
+    // 한 가지 값이면 table 13의 modifier 0으로 정확히 표현된다.
+    int best_base = lo, best_mult = 1, best_table = 13;
+    unsigned char best_indices[16];
+    std::memset(best_indices, 4, 16);
+
+    if (lo != hi)
+    {
+      int best_err = INT_MAX;
+      for (int t = 0; t < 16; ++t)
+      {
+        const int span = EAC_TABLES[t][7] - EAC_TABLES[t][3];
+        const int guess = round_clamp(float(hi - lo) / span, 15);
+        for (int mult = std::max(1, guess - 1); mult <= std::min(15, guess + 1); ++mult)
+        {
+          const int base = round_clamp((hi + lo) * 0.5f - (EAC_TABLES[t][7] + EAC_TABLES[t][3]) * mult * 0.5f, 255);
+
+          Palette palette;
+          std::memset(&palette, 0, sizeof(palette));
+          for (int k = 0; k < 8; ++k)
+            palette.c[k][0] = clamp255(base + EAC_TABLES[t][k] * mult);
+
+          unsigned char indices[16];
+          int err = select_indices(block, palette, 8, indices);
+          if (err < best_err)
+          {
+            best_err = err;
+            best_base = base;
+            best_mult = mult;
+            best_table = t;
+            std::memcpy(best_indices, indices, 16);
+          }
+        }
+      }
+    }
+
+    out[0] = static_cast<unsigned char>(best_base);
+    out[1] = static_cast<unsigned char>((best_mult << 4) | best_table);
+    // 픽셀 (x, y)는 x*4 + y 번째, 첫 픽셀이 최상위 3비트 (big-endian)
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+      int j = (i % 4) * 4 + i / 4;
+      bits |= uint64_t(best_indices[i]) << (45 - 3 * j);
+    }
+    for (int i = 0; i < 6; ++i)
+      out[2 + i] = static_cast<unsigned char>(bits >> (40 - 8 * i));
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// 이미지 단위
+  ////////////////////////////////////////////////////////////////////////////////
+  size_t block_bytes(TextureCodec codec)
+  {
+    switch (codec)
+    {
+    case TEXTURE_CODEC_BC1:
+    case TEXTURE_CODEC_BC4:
+    case TEXTURE_CODEC_ETC2_RGB:
+    case TEXTURE_CODEC_EAC_R11:
+      return 8;
+    default:
+      return 16;
+    }
+  }
+
+  void encode_block(TextureCodec codec, const Block& block, unsigned char* out)
+  {
+    switch (codec)
+    {
+    case TEXTURE_CODEC_BC1:       encode_bc1_block(block, out); break;
+    case TEXTURE_CODEC_BC3:       encode_bc4_block(block, 3, out); encode_bc1_block(block, out + 8); break;
+    case TEXTURE_CODEC_BC4:       encode_bc4_block(block, 0, out); break;
+    case TEXTURE_CODEC_BC5:       encode_bc4_block(block, 0, out); encode_bc4_block(block, 1, out + 8); break;
+    case TEXTURE_CODEC_BC7:       encode_bc7_block(block, out); break;
+    case TEXTURE_CODEC_ETC2_RGB:  encode_etc2_rgb_block(block, out); break;
+    case TEXTURE_CODEC_ETC2_RGBA: encode_eac_block(block, 3, out); encode_etc2_rgb_block(block, out + 8); break;
+    case TEXTURE_CODEC_EAC_R11:   encode_eac_block(block, 0, out); break;
+    case TEXTURE_CODEC_EAC_RG11:  encode_eac_block(block, 0, out); encode_eac_block(block, 1, out + 8); break;
+    default: break;
+    }
+  }
+
+  // 가장자리 블록은 마지막 픽셀을 반복해서 채운다.
+  void encode_level(TextureCodec codec, const std::vector<unsigned char>& rgba, int width, int height,
+    CompressedLevel* level)
+  {
+    const int bw = (width + 3) / 4, bh = (height + 3) / 4;
+    const size_t bytes = block_bytes(codec);
+    level->width = width;
+    level->height = height;
+    level->data.assign(size_t(bw) * bh * bytes, 0);
+
+    Block block;
+    for (int by = 0; by < bh; ++by)
+    {
+      for (int bx = 0; bx < bw; ++bx)
+      {
+        for (int i = 0; i < 16; ++i)
+        {
+          int x = std::min(bx * 4 + i % 4, width - 1);
+          int y = std::min(by * 4 + i / 4, height - 1);
+          const unsigned char* p = &rgba[(size_t(y) * width + x) * 4];
+          for (int ch = 0; ch < 4; ++ch)
+            block.c[ch][i] = p[ch];
+        }
+        encode_block(codec, block, &level->data[(size_t(by) * bw + bx) * bytes]);
+      }
+    }
+  }
+
+  // 2x2 평균. 홀수 크기에서는 마지막 행/열을 반복한다.
+  void downsample(const std::vector<unsigned char>& src, int width, int height,
+    std::vector<unsigned char>* dst, int* out_width, int* out_height)
+  {
+    const int w = std::max(1, width / 2), h = std::max(1, height / 2);
+    dst->resize(size_t(w) * h * 4);
+    for (int y = 0; y < h; ++y)
+    {
+      const int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+      for (int x = 0; x < w; ++x)
+      {
+        const int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+        for (int ch = 0; ch < 4; ++ch)
+        {
+          int sum = src[(size_t(y0) * width + x0) * 4 + ch] + src[(size_t(y0) * width + x1) * 4 + ch] +
+            src[(size_t(y1) * width + x0) * 4 + ch] + src[(size_t(y1) * width + x1) * 4 + ch];
+          (*dst)[(size_t(y) * w + x) * 4 + ch] = static_cast<unsigned char>((sum + 2) / 4);
+        }
+      }
+    }
+    *out_width = w;
+    *out_height = h;
+  }
+
+  // 1 ~ 4채널, 8/16 bit 이미지를 RGBA8로 바꾼다. (없는 채널은 0, alpha는 255)
+  bool to_rgba8(const tinygltf::Image& image, std::vector<unsigned char>* rgba, bool* has_alpha)
+  {
+    const int n = image.component;
+    const int bytes = image.bits == 16 ? 2 : 1;
+    const size_t count = size_t(image.width) * image.height;
+    if (n < 1 || n > 4 || image.image.size() < count * n * bytes)
+      return false;
+
+    rgba->resize(count * 4);
+    *has_alpha = false;
+    for (size_t i = 0; i < count; ++i)
+    {
+      for (int ch = 0; ch < 4; ++ch)
+      {
+        unsigned char v = ch == 3 ? 255 : 0;
+        if (ch < n)     // 16 bit는 상위 바이트 (little-endian)
+          v = image.image[(i * n + ch) * bytes + bytes - 1];
+        (*rgba)[i * 4 + ch] = v;
+      }
+      *has_alpha = *has_alpha || (*rgba)[i * 4 + 3] != 255;
+    }
+    return true;
+  }
+
+  TextureCodec choose_codec(TextureCompression mode, int components, bool has_alpha)
+  {
+    if (mode == TEXTURE_COMPRESSION_NONE)
+      return TEXTURE_CODEC_NONE;
+
+    const bool etc = mode == TEXTURE_COMPRESSION_ETC2;
+    if (components == 1)
+      return etc ? TEXTURE_CODEC_EAC_R11 : TEXTURE_CODEC_BC4;
+    if (components == 2)
+      return etc ? TEXTURE_CODEC_EAC_RG11 : TEXTURE_CODEC_BC5;
+    if (mode == TEXTURE_COMPRESSION_BC7)
+      return TEXTURE_CODEC_BC7;
+    if (etc)
+      return has_alpha ? TEXTURE_CODEC_ETC2_RGBA : TEXTURE_CODEC_ETC2_RGB;
+    return has_alpha ? TEXTURE_CODEC_BC3 : TEXTURE_CODEC_BC1;
+  }
+
+  void make_cache_dir()
+  {
+#ifdef _WIN32
+    _mkdir(CACHE_DIR);
+#else
+    mkdir(CACHE_DIR, 0755);
+#endif
+  }
+} // namespace
+
+size_t CompressedTexture::size() const
+{
+  size_t total = 0;
+  for (const CompressedLevel& level : levels)
+    total += level.data.size();
+  return total;
+}
+
+bool parse_texture_compression(const std::string& name, TextureCompression* mode)
+{
+  if (name == "bc")
+    *mode = TEXTURE_COMPRESSION_BC;
+  else if (name == "bc7")
+    *mode = TEXTURE_COMPRESSION_BC7;
+  else if (name == "etc2")
+    *mode = TEXTURE_COMPRESSION_ETC2;
+  else
+    return false;
+  return true;
+}
+
+const char* texture_compression_name(TextureCompression mode)
+{
+  switch (mode)
+  {
+  case TEXTURE_COMPRESSION_BC:    return "bc";
+  case TEXTURE_COMPRESSION_BC7:   return "bc7";
+  case TEXTURE_COMPRESSION_ETC2:  return "etc2";
+  default:                        return "none";
+  }
+}
+
+const char* texture_codec_name(TextureCodec codec)
+{
+  switch (codec)
+  {
+  case TEXTURE_CODEC_BC1:       return "BC1";
+  case TEXTURE_CODEC_BC3:       return "BC3";
+  case TEXTURE_CODEC_BC4:       return "BC4";
+  case TEXTURE_CODEC_BC5:       return "BC5";
+  case TEXTURE_CODEC_BC7:       return "BC7";
+  case TEXTURE_CODEC_ETC2_RGB:  return "ETC2_RGB";
+  case TEXTURE_CODEC_ETC2_RGBA: return "ETC2_RGBA";
+  case TEXTURE_CODEC_EAC_R11:   return "EAC_R11";
+  case TEXTURE_CODEC_EAC_RG11:  return "EAC_RG11";
+  default:                      return "none";
+  }
+}
+
+int texture_codec_channels(TextureCodec codec)
+{
+  switch (codec)
+  {
+  case TEXTURE_CODEC_BC4:
+  case TEXTURE_CODEC_EAC_R11:   return 1;
+  case TEXTURE_CODEC_BC5:
+  case TEXTURE_CODEC_EAC_RG11:  return 2;
+  case TEXTURE_CODEC_BC1:
+  case TEXTURE_CODEC_ETC2_RGB:  return 3;
+  default:                      return 4;
+  }
+}
+
+bool compress_texture(const tinygltf::Image& image, TextureCompression mode, CompressedTexture* out,
+  const std::vector<MipLevel>* mips)
+{
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+  std::vector<unsigned char> rgba;
+  bool has_alpha;
+  if (image.width < 1 || image.height < 1 || !to_rgba8(image, &rgba, &has_alpha))
+    return false;
+
+  out->codec = choose_codec(mode, image.component, has_alpha);
+  out->levels.clear();
+  out->from_cache = false;
+  if (out->codec == TEXTURE_CODEC_NONE)
+    return false;
+
+  if (mips && !mips->empty())
+  {
+    for (const MipLevel& level : *mips)
+    {
+      out->levels.push_back(CompressedLevel());
+      encode_level(out->codec, level.data, level.width, level.height, &out->levels.back());
+    }
+    out->encode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    return true;
+  }
+
+  int width = image.width, height = image.height;
+  std::vector<unsigned char> next;
+  while (true)
+  {
+    out->levels.push_back(CompressedLevel());
+    encode_level(out->codec, rgba, width, height, &out->levels.back());
+    if (width == 1 && height == 1)
+      break;
+    downsample(rgba, width, height, &next, &width, &height);
+    rgba.swap(next);
+  }
+
+  out->encode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+  return true;
+}
+
+bool convert_to_rgba8(const tinygltf::Image& image, std::vector<unsigned char>* rgba)
+{
+  bool has_alpha;
+  return image.width > 0 && image.height > 0 && to_rgba8(image, rgba, &has_alpha);
+}
+
+size_t compressed_level_bytes(TextureCodec codec, int width, int height)
+{
+  return size_t((width + 3) / 4) * ((height + 3) / 4) * block_bytes(codec);
+}
+
+size_t uncompressed_texture_bytes(int width, int height, int bytes_per_pixel)
+{
+  size_t total = 0;
+  while (true)
+  {
+    total += size_t(width) * height * bytes_per_pixel;
+    if (width == 1 && height == 1)
+      break;
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  return total;
+}
+
+std::string texture_cache_path(uint64_t image_hash, TextureCompression mode)
+{
+  char name[64];
+  std::snprintf(name, sizeof(name), "%016llx_%s.tex",
+    static_cast<unsigned long long>(image_hash), texture_compression_name(mode));
+  return std::string(CACHE_DIR) + "/" + name;
+}
+
+bool load_compressed_texture(uint64_t image_hash, TextureCompression mode, CompressedTexture* out)
+{
+  std::ifstream in(texture_cache_path(image_hash, mode).c_str(), std::ios::binary);
+  if (!in)
+    return false;
+
+  char magic[sizeof(CACHE_MAGIC)];
+  uint32_t version = 0, codec = 0, num_levels = 0;
+  in.read(magic, sizeof(magic));
+  in.read(reinterpret_cast<char*>(&version), sizeof(version));
+  in.read(reinterpret_cast<char*>(&codec), sizeof(codec));
+  in.read(reinterpret_cast<char*>(&num_levels), sizeof(num_levels));
+  if (!in || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || version != CACHE_VERSION ||
+    codec == TEXTURE_CODEC_NONE || codec > TEXTURE_CODEC_EAC_RG11 || num_levels == 0 || num_levels > 32)
+    return false;
+
+  out->codec = static_cast<TextureCodec>(codec);
+  out->levels.resize(num_levels);
+  for (CompressedLevel& level : out->levels)
+  {
+    int32_t size[2] = { 0, 0 };
+    uint64_t bytes = 0;
+    in.read(reinterpret_cast<char*>(size), sizeof(size));
+    in.read(reinterpret_cast<char*>(&bytes), sizeof(bytes));
+    const uint64_t expected = compressed_level_bytes(out->codec, size[0], size[1]);
+    if (!in || size[0] < 1 || size[1] < 1 || bytes != expected)
+      return false;
+
+    level.width = size[0];
+    level.height = size[1];
+    level.data.resize(size_t(bytes));
+    in.read(reinterpret_cast<char*>(&level.data[0]), std::streamsize(bytes));
+  }
+  if (!in)
+    return false;
+
+  out->from_cache = true;
+  out->encode_ms = 0.0;
+  return true;
+}
+
+bool save_compressed_texture(uint64_t image_hash, TextureCompression mode, const CompressedTexture& texture)
+{
+  make_cache_dir();
+  const std::string path = texture_cache_path(image_hash, mode);
+
+  // 같은 이미지를 여러 로더가 동시에 저장할 수 있으므로 스레드마다 다른 임시 파일에 쓴 뒤 이름을 바꾼다.
+  const std::string tmp_path = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  {
+    std::ofstream out(tmp_path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out)
+      return false;
+
+    const uint32_t codec = texture.codec;
+    const uint32_t num_levels = static_cast<uint32_t>(texture.levels.size());
+    out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    out.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
+    out.write(reinterpret_cast<const char*>(&codec), sizeof(codec));
+    out.write(reinterpret_cast<const char*>(&num_levels), sizeof(num_levels));
+    for (const CompressedLevel& level : texture.levels)
+    {
+      const int32_t size[2] = { level.width, level.height };
+      const uint64_t bytes = level.data.size();
+      out.write(reinterpret_cast<const char*>(size), sizeof(size));
+      out.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+      out.write(reinterpret_cast<const char*>(level.data.data()), std::streamsize(bytes));
+    }
+
+    if (!out.good())
+    {
+      out.close();
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+  }
+
+  std::remove(path.c_str());
+  return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+void texture_compressor_use_simd(bool enable)
+{
+  simd_enabled = enable;
+}
+
+const char* texture_compressor_impl_name()
+{
+  return current_impl().name;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../glTF/tiny_gltf.h"
+#include "MipGenerator.h"
+
+// 로딩 중에 디코딩된 이미지를 GPU 블록 압축 형식(BC1/3/4/5/7, ETC2/EAC)으로 인코딩한다.
+//
+// 인코딩은 느리므로 결과(mip chain 전체)를 이미지 내용 해시로 디스크에 저장해 두고,
+// 다음 실행에서는 이미지를 디코딩하지 않고 그 파일을 읽어 glCompressedTexImage2D로 바로 올린다.
+// 블록마다 팔레트에서 가장 가까운 색을 고르는 부분은 CPU가 지원하면 SSE4.1로 16픽셀을 한꺼번에 처리한다.
+// OpenGL 호출은 하지 않는다. (GL 형식으로 바꾸는 것은 렌더링 쪽의 몫)
+
+// 사용자가 고르는 압축 방식. 실제 형식은 이미지의 채널 수와 alpha에 따라 정해진다.
+enum TextureCompression
+{
+  TEXTURE_COMPRESSION_NONE,
+  TEXTURE_COMPRESSION_BC,       // 1채널 BC4, 2채널 BC5, 불투명 BC1, alpha가 있으면 BC3
+  TEXTURE_COMPRESSION_BC7,      // 색 이미지는 BC7 (mode 6), 1/2채널은 BC4/BC5
+  TEXTURE_COMPRESSION_ETC2,     // 1채널 EAC R11, 2채널 EAC RG11, 불투명 ETC2 RGB, alpha가 있으면 ETC2 RGBA (EAC)
+};
+
+enum TextureCodec
+{
+  TEXTURE_CODEC_NONE,
+  TEXTURE_CODEC_BC1,
+  TEXTURE_CODEC_BC3,
+  TEXTURE_CODEC_BC4,
+  TEXTURE_CODEC_BC5,
+  TEXTURE_CODEC_BC7,
+  TEXTURE_CODEC_ETC2_RGB,
+  TEXTURE_CODEC_ETC2_RGBA,
+  TEXTURE_CODEC_EAC_R11,
+  TEXTURE_CODEC_EAC_RG11,
+};
+
+struct CompressedLevel
+{
+  int width;
+  int height;
+  std::vector<unsigned char> data;
+};
+
+// 압축된 mip chain (levels[0]이 원본 크기)
+struct CompressedTexture
+{
+  TextureCodec codec = TEXTURE_CODEC_NONE;
+  std::vector<CompressedLevel> levels;
+  bool from_cache = false;      // 디스크 캐시에서 읽음 (인코딩하지 않음)
+  bool from_ktx2 = false;       // KTX2 파일의 데이터 (KtxTexture.h, 인코딩하지 않음)
+  double encode_ms = 0.0;       // 인코딩에 걸린 시간
+
+  size_t size() const;          // 모든 level의 바이트 수
+};
+
+// "--compress=bc7" 같은 옵션 값을 읽는다. ("bc", "bc7", "etc2")
+bool parse_texture_compression(const std::string& name, TextureCompression* mode);
+const char* texture_compression_name(TextureCompression mode);
+const char* texture_codec_name(TextureCodec codec);
+
+// codec이 담는 채널 수 (BC4/EAC R11은 1, BC5/EAC RG11은 2, BC1/ETC2 RGB는 3, 나머지는 4)
+int texture_codec_channels(TextureCodec codec);
+
+// 디코딩된 이미지(1 ~ 4채널, 8/16 bit)를 mode에 맞는 형식으로 인코딩한다.
+// mips가 있으면 그 level들(MipGenerator.h)을 인코딩하고, 없으면 mip chain을 2x2 평균으로 만든다.
+bool compress_texture(const tinygltf::Image& image, TextureCompression mode, CompressedTexture* out,
+  const std::vector<MipLevel>* mips = nullptr);
+
+// codec으로 압축한 width x height level 하나의 바이트 수
+size_t compressed_level_bytes(TextureCodec codec, int width, int height);
+
+// 디코딩된 이미지(1 ~ 4채널, 8/16 bit)를 RGBA8로 바꾼다. (없는 채널은 0, alpha는 255)
+bool convert_to_rgba8(const tinygltf::Image& image, std::vector<unsigned char>* rgba);
+
+// 같은 크기의 RGBA8 텍스처 (mip chain 포함)가 차지하는 바이트 수. (압축하지 않을 때와 비교용)
+// 다른 비압축 형식은 픽셀당 바이트 수를 준다.
+size_t uncompressed_texture_bytes(int width, int height, int bytes_per_pixel = 4);
+
+// 디스크 캐시: texture_cache/<이미지 해시>_<mode>.tex
+std::string texture_cache_path(uint64_t image_hash, TextureCompression mode);
+bool load_compressed_texture(uint64_t image_hash, TextureCompression mode, CompressedTexture* out);
+bool save_compressed_texture(uint64_t image_hash, TextureCompression mode, const CompressedTexture& texture);
+
+// 벤치마크용: false면 SIMD 경로를 쓰지 않는다.
+void texture_compressor_use_simd(bool enable);
+
+// 현재 쓰이는 구현 이름 ("sse4.1", "scalar")
+const char* texture_compressor_impl_name();
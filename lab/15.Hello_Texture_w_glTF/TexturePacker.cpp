@@ -0,0 +1,210 @@
+#include "TexturePacker.h"
+#include "KtxTexture.h"
+
+namespace {
+  const unsigned CHANNELS_RGB = TEXTURE_CHANNEL_R | TEXTURE_CHANNEL_G | TEXTURE_CHANNEL_B;
+  const unsigned CHANNELS_ROUGHNESS_METALLIC = TEXTURE_CHANNEL_G | TEXTURE_CHANNEL_B;
+
+  // material의 텍스처 슬롯과 그 슬롯이 읽는 채널
+  struct MaterialSlot
+  {
+    const char* name;
+    bool additional;      // material.additionalValues에 있음
+    unsigned usage;
+  };
+
+  const MaterialSlot BASE_COLOR = { "baseColorTexture", false, TEXTURE_CHANNEL_ALL };
+  const MaterialSlot METALLIC_ROUGHNESS = { "metallicRoughnessTexture", false, CHANNELS_ROUGHNESS_METALLIC };
+  const MaterialSlot NORMAL = { "normalTexture", true, CHANNELS_RGB };
+  const MaterialSlot OCCLUSION = { "occlusionTexture", true, TEXTURE_CHANNEL_R };
+  const MaterialSlot EMISSIVE = { "emissiveTexture", true, CHANNELS_RGB };
+  const MaterialSlot* const material_slots[] = { &BASE_COLOR, &METALLIC_ROUGHNESS, &NORMAL, &OCCLUSION, &EMISSIVE };
+
+  const tinygltf::Parameter* find_texture(const tinygltf::Material& material, const MaterialSlot& slot)
+  {
+    const tinygltf::ParameterMap& values = slot.additional ? material.additionalValues : material.values;
+    tinygltf::ParameterMap::const_iterator it = values.find(slot.name);
+    return (it != values.end() && it->second.TextureIndex() > -1) ? &it->second : nullptr;
+  }
+
+  int texture_source(const tinygltf::Model& model, int texture_index)
+  {
+    if (size_t(texture_index) >= model.textures.size())
+      return -1;
+    const int source = model.textures[texture_index].source;
+    return (size_t(source) < model.images.size()) ? source : -1;
+  }
+
+  // i번째 픽셀의 ch 채널 (없는 채널은 0, alpha는 최댓값, 16 bit는 little-endian)
+  unsigned read_channel(const tinygltf::Image& image, size_t i, int ch)
+  {
+    const int n = image.component;
+    if (ch >= n)
+      return ch == 3 ? (image.bits == 16 ? 65535u : 255u) : 0u;
+    if (image.bits == 16)
+      return image.image[(i * n + ch) * 2] | (unsigned(image.image[(i * n + ch) * 2 + 1]) << 8);
+    return image.image[i * n + ch];
+  }
+
+  bool is_valid(const tinygltf::Image& image)
+  {
+    const size_t bytes = image.bits == 16 ? 2 : 1;
+    return image.component >= 1 && image.component <= 4 && image.width > 0 && image.height > 0 &&
+      image.image.size() >= size_t(image.width) * image.height * image.component * bytes;
+  }
+
+  // 모든 픽셀이 R = G = B이고, alpha를 읽는다면 불투명한가
+  bool is_gray(const tinygltf::Image& image, unsigned usage)
+  {
+    const size_t count = size_t(image.width) * image.height;
+    const unsigned opaque = image.bits == 16 ? 65535u : 255u;
+    for (size_t i = 0; i < count; ++i)
+    {
+      const unsigned r = read_channel(image, i, 0);
+      if (read_channel(image, i, 1) != r || read_channel(image, i, 2) != r)
+        return false;
+      if ((usage & TEXTURE_CHANNEL_A) && read_channel(image, i, 3) != opaque)
+        return false;
+    }
+    return true;
+  }
+} // namespace
+
+void plan_texture_packing(const tinygltf::Model& model, TexturePackPlan* plan)
+{
+  const size_t num_images = model.images.size();
+  plan->usage.assign(num_images, 0);
+  plan->occlusion.assign(num_images, -1);
+  plan->packed_into.assign(num_images, -1);
+
+  std::vector<bool> referenced(model.textures.size(), false);
+  for (const tinygltf::Material& material : model.materials)
+  {
+    for (const MaterialSlot* slot : material_slots)
+    {
+      const tinygltf::Parameter* parameter = find_texture(material, *slot);
+      if (!parameter || size_t(parameter->TextureIndex()) >= model.textures.size())
+        continue;
+      referenced[parameter->TextureIndex()] = true;
+
+      const int source = texture_source(model, parameter->TextureIndex());
+      if (source < 0)
+        continue;
+      plan->usage[source] |= slot->usage;
+    }
+  }
+
+  // 어디서 어떻게 읽는지 모르는 이미지와 KTX2를 대신하는 이미지는 모든 채널을 둔다.
+  for (size_t t = 0; t < model.textures.size(); ++t)
+  {
+    const int source = texture_source(model, int(t));
+    if (source >= 0 && (!referenced[t] || basisu_texture_source(model.textures[t]) >= 0))
+      plan->usage[source] = TEXTURE_CHANNEL_ALL;
+  }
+
+  // occlusion 이미지마다 같은 material의 metallicRoughness 이미지를 찾는다. (-2: 짝이 여럿이거나 없음)
+  std::vector<int> mr_of(num_images, -1), occlusion_of(num_images, -1);
+  for (const tinygltf::Material& material : model.materials)
+  {
+    const tinygltf::Parameter* occlusion = find_texture(material, OCCLUSION);
+    const int o = occlusion ? texture_source(model, occlusion->TextureIndex()) : -1;
+    if (o < 0)
+      continue;
+
+    const tinygltf::Parameter* mr = find_texture(material, METALLIC_ROUGHNESS);
+    const int m = mr ? texture_source(model, mr->TextureIndex()) : -1;
+    if (m < 0 || m == o || mr->TextureTexCoord() != occlusion->TextureTexCoord())
+    {
+      mr_of[o] = -2;
+      continue;
+    }
+    mr_of[o] = (mr_of[o] == -1 || mr_of[o] == m) ? m : -2;
+    occlusion_of[m] = (occlusion_of[m] == -1 || occlusion_of[m] == o) ? o : -2;
+  }
+
+  // 두 이미지가 다른 곳에서는 쓰이지 않을 때만 합친다.
+  for (size_t o = 0; o < num_images; ++o)
+  {
+    const int m = mr_of[o];
+    if (m < 0 || occlusion_of[m] != int(o) || plan->usage[o] != TEXTURE_CHANNEL_R ||
+      plan->usage[m] != CHANNELS_ROUGHNESS_METALLIC)
+      continue;
+    plan->occlusion[m] = int(o);
+    plan->packed_into[o] = m;
+    plan->usage[m] |= TEXTURE_CHANNEL_R;
+  }
+}
+
+bool pack_texture_image(const tinygltf::Image& image, const tinygltf::Image* occlusion, unsigned usage,
+  tinygltf::Image* out)
+{
+  if (usage == 0 || !is_valid(image) || (occlusion && !is_valid(*occlusion)))
+    return false;
+
+  // out의 채널마다 읽을 image의 채널 (-1은 occlusion의 R)
+  std::vector<int> channels;
+  if (occlusion)
+    channels = { -1, 1, 2 };
+  else if (usage == TEXTURE_CHANNEL_R)
+    channels = { 0 };
+  else if ((usage & ~CHANNELS_ROUGHNESS_METALLIC) == 0)
+    channels = { 1, 2 };
+  else if (image.component >= 3 && is_gray(image, usage))
+    channels = { 0 };
+  if (channels.empty() || (!occlusion && int(channels.size()) >= image.component))
+    return false;
+
+  const int n = int(channels.size());
+  const size_t bytes = image.bits == 16 ? 2 : 1;
+  out->width = image.width;
+  out->height = image.height;
+  out->component = n;
+  out->bits = image.bits;
+  out->pixel_type = image.pixel_type;
+  out->as_is = false;
+  out->image.resize(size_t(image.width) * image.height * n * bytes);
+
+  size_t i = 0;
+  for (int y = 0; y < image.height; ++y)
+  {
+    for (int x = 0; x < image.width; ++x, ++i)
+    {
+      for (int c = 0; c < n; ++c)
+      {
+        unsigned v;
+        if (channels[c] >= 0)
+        {
+          v = read_channel(image, i, channels[c]);
+        }
+        else
+        {
+          const size_t oi = size_t(y * occlusion->height / image.height) * occlusion->width +
+            x * occlusion->width / image.width;
+          v = read_channel(*occlusion, oi, 0);
+          if (occlusion->bits != image.bits)
+            v = (bytes == 2) ? v * 257 : v >> 8;
+        }
+
+        if (bytes == 2)
+        {
+          out->image[(i * n + c) * 2] = (unsigned char)(v & 0xff);
+          out->image[(i * n + c) * 2 + 1] = (unsigned char)(v >> 8);
+        }
+        else
+        {
+          out->image[i * n + c] = (unsigned char)v;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+TextureSwizzle texture_swizzle(unsigned usage, int channels)
+{
+  if (channels == 1)
+    return usage == TEXTURE_CHANNEL_R ? TEXTURE_SWIZZLE_NONE : TEXTURE_SWIZZLE_GRAY;
+  if (channels == 2 && usage != 0 && (usage & ~CHANNELS_ROUGHNESS_METALLIC) == 0)
+    return TEXTURE_SWIZZLE_ROUGHNESS_METALLIC;
+  return TEXTURE_SWIZZLE_NONE;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+
+#include "../glTF/tiny_gltf.h"
+
+// 디코딩된 이미지를 material이 실제로 읽는 채널만 남긴 작은 이미지로 바꾼다. (--pack-textures)
+//
+// 디코더는 모든 이미지를 RGBA로 풀기 때문에 occlusion(R), metallicRoughness(G, B) 같은 맵도
+// RGBA 텍스처 하나씩을 차지한다. 여기서는
+//  - occlusion만 읽는 이미지는 R 1채널로, metallicRoughness만 읽는 이미지는 (G, B) 2채널로 줄이고,
+//  - 한 material의 occlusion과 metallicRoughness가 서로 다른 이미지면 occlusion을 metallicRoughness 이미지의
+//    R에 넣어 텍스처 하나로 합치고 (glTF의 ORM 배치),
+//  - 그 밖에 회색조(R = G = B)이고 alpha를 읽지 않거나 불투명한 이미지는 1채널로 줄인다.
+// 줄인 텍스처는 GL swizzle(TextureSwizzle)로 원래 이미지를 읽을 때와 같은 값이 나온다.
+// 8/16 bit는 그대로 둔다. OpenGL 호출은 하지 않는다.
+
+// material이 이미지에서 읽는 채널 (bitmask)
+enum TextureChannel
+{
+  TEXTURE_CHANNEL_R = 1,
+  TEXTURE_CHANNEL_G = 2,
+  TEXTURE_CHANNEL_B = 4,
+  TEXTURE_CHANNEL_A = 8,
+  TEXTURE_CHANNEL_ALL = 15,
+};
+
+// 줄인 텍스처를 읽을 때 채널을 되돌리는 방법
+enum TextureSwizzle
+{
+  TEXTURE_SWIZZLE_NONE,                 // (R, G, B, A) 그대로
+  TEXTURE_SWIZZLE_GRAY,                 // (R, R, R, 1)
+  TEXTURE_SWIZZLE_ROUGHNESS_METALLIC,   // (0, R, G, 1)
+};
+
+// 모델의 이미지 인덱스별로 읽는 채널과 합칠 짝
+struct TexturePackPlan
+{
+  std::vector<unsigned> usage;          // TextureChannel bitmask (0이면 material이 읽지 않으므로 건드리지 않음)
+  std::vector<int> occlusion;           // 이 metallicRoughness 이미지의 R에 넣을 occlusion 이미지 (없으면 -1)
+  std::vector<int> packed_into;         // 이 occlusion 이미지를 넣은 metallicRoughness 이미지 (없으면 -1)
+
+  bool packable(int image_index) const
+  {
+    return size_t(image_index) < usage.size() && usage[image_index] != 0;
+  }
+};
+
+// material을 보고 plan을 만든다.
+// material의 기본 슬롯이 아닌 곳(확장, KHR_texture_basisu)에서 쓰는 텍스처의 이미지는 모든 채널을 읽는 것으로 본다.
+void plan_texture_packing(const tinygltf::Model& model, TexturePackPlan* plan);
+
+// 디코딩된 image(1 ~ 4채널, 8/16 bit)를 usage대로 줄여 out에 담는다.
+// occlusion이 있으면 그 R을 out의 R에 넣는다. (크기가 다르면 가장 가까운 픽셀)
+// 줄일 것이 없으면 false
+bool pack_texture_image(const tinygltf::Image& image, const tinygltf::Image* occlusion, unsigned usage,
+  tinygltf::Image* out);
+
+// 채널 수가 channels인 텍스처(줄인 이미지나 그것을 압축한 것)의 swizzle
+TextureSwizzle texture_swizzle(unsigned usage, int channels);
@@ -0,0 +1,202 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+TextureStreamer::TextureStreamer(size_t budget)
+{
+  stats_.budget = budget;
+}
+
+int TextureStreamer::add_texture(unsigned id, int width, int height, const std::vector<size_t>& level_bytes)
+{
+  remove_texture(id);
+  if (level_bytes.empty())
+    return 0;
+
+  Texture texture;
+  texture.level_bytes = level_bytes;
+  texture.tail = int(level_bytes.size()) - 1;
+  for (int level = 0; level < int(level_bytes.size()); ++level)
+  {
+    if (std::max(std::max(width >> level, 1), std::max(height >> level, 1)) <= TAIL_SIZE)
+    {
+      texture.tail = level;
+      break;
+    }
+  }
+  texture.resident = texture.tail;
+  texture.requested = -1;
+  texture.size = 0;
+  for (size_t level = texture.tail; level < level_bytes.size(); ++level)
+    texture.size += level_bytes[level];
+
+  lru_.push_front(id);
+  texture.lru = lru_.begin();
+
+  stats_.resident_bytes += texture.size;
+  stats_.tail_bytes += texture.size;
+  for (size_t bytes : level_bytes)
+    stats_.full_bytes += bytes;
+  const int tail = texture.tail;
+  textures_[id] = texture;
+  stats_.textures = textures_.size();
+  return tail;
+}
+
+void TextureStreamer::remove_texture(unsigned id)
+{
+  std::unordered_map<unsigned, Texture>::iterator it = textures_.find(id);
+  if (it == textures_.end())
+    return;
+
+  const Texture& texture = it->second;
+  stats_.resident_bytes -= texture.size;
+  for (size_t level = 0; level < texture.level_bytes.size(); ++level)
+  {
+    stats_.full_bytes -= texture.level_bytes[level];
+    if (int(level) >= texture.tail)
+      stats_.tail_bytes -= texture.level_bytes[level];
+  }
+  lru_.erase(texture.lru);
+  textures_.erase(it);
+  stats_.textures = textures_.size();
+}
+
+void TextureStreamer::request(unsigned id, int level)
+{
+  std::unordered_map<unsigned, Texture>::iterator it = textures_.find(id);
+  if (it == textures_.end())
+    return;
+
+  Texture& texture = it->second;
+  level = std::min(std::max(level, 0), texture.tail);
+  texture.requested = (texture.requested < 0) ? level : std::min(texture.requested, level);
+  lru_.splice(lru_.begin(), lru_, texture.lru);
+}
+
+int TextureStreamer::resident_level(unsigned id) const
+{
+  std::unordered_map<unsigned, Texture>::const_iterator it = textures_.find(id);
+  return (it != textures_.end()) ? it->second.resident : -1;
+}
+
+// 상주 level을 바꾸고 통계에 더한다. 이번 update()에서 처음 바뀌면 원래 level을 old_levels에 남긴다.
+void TextureStreamer::set_resident(unsigned id, Texture& texture, int level, std::unordered_map<unsigned, int>* old_levels)
+{
+  old_levels->insert(std::make_pair(id, texture.resident));
+
+  for (int l = level; l < texture.resident; ++l)
+  {
+    texture.size += texture.level_bytes[l];
+    stats_.resident_bytes += texture.level_bytes[l];
+    stats_.loaded_bytes += texture.level_bytes[l];
+    ++stats_.loads;
+  }
+  for (int l = texture.resident; l < level; ++l)
+  {
+    texture.size -= texture.level_bytes[l];
+    stats_.resident_bytes -= texture.level_bytes[l];
+    stats_.evicted_bytes += texture.level_bytes[l];
+    ++stats_.evictions;
+  }
+  texture.resident = level;
+}
+
+// bytes를 더 올려도 budget을 넘지 않도록 내린다. 자리를 만들지 못하면 false
+bool TextureStreamer::make_room(size_t bytes, std::unordered_map<unsigned, int>* old_levels)
+{
+  // 이번 프레임에 쓰지 않은 텍스처를 오래된 것부터 tail로
+  for (std::list<unsigned>::reverse_iterator it = lru_.rbegin(); it != lru_.rend(); ++it)
+  {
+    if (stats_.resident_bytes + bytes <= stats_.budget)
+      return true;
+    Texture& texture = textures_[*it];
+    if (texture.requested < 0 && texture.resident < texture.tail)
+      set_resident(*it, texture, texture.tail, old_levels);
+  }
+
+  // 쓰고 있는 텍스처는 필요한 level까지만
+  for (std::list<unsigned>::reverse_iterator it = lru_.rbegin(); it != lru_.rend(); ++it)
+  {
+    if (stats_.resident_bytes + bytes <= stats_.budget)
+      return true;
+    Texture& texture = textures_[*it];
+    if (texture.requested >= 0 && texture.resident < texture.requested)
+      set_resident(*it, texture, texture.requested, old_levels);
+  }
+  return stats_.resident_bytes + bytes <= stats_.budget;
+}
+
+void TextureStreamer::update(size_t upload_budget, std::vector<TextureStreamChange>* changes)
+{
+  std::unordered_map<unsigned, int> old_levels;
+
+  // budget이 줄었으면 먼저 맞춘다.
+  make_room(0, &old_levels);
+
+  // 필요한 level과 차이가 큰 텍스처부터 한 level씩 올린다. (멀리 있는 텍스처가 가까운 것을 막지 않도록)
+  std::vector<std::pair<int, unsigned> > wanting;
+  size_t uploaded = 0;
+  bool progress = true;
+  while (progress)
+  {
+    progress = false;
+    wanting.clear();
+    for (std::unordered_map<unsigned, Texture>::const_iterator it = textures_.begin(); it != textures_.end(); ++it)
+    {
+      if (it->second.requested >= 0 && it->second.requested < it->second.resident)
+        wanting.push_back(std::make_pair(it->second.resident - it->second.requested, it->first));
+    }
+    std::sort(wanting.begin(), wanting.end(), std::greater<std::pair<int, unsigned> >());
+
+    for (const std::pair<int, unsigned>& w : wanting)
+    {
+      if (uploaded > 0 && uploaded >= upload_budget)
+        break;
+      Texture& texture = textures_[w.second];
+      const size_t bytes = texture.level_bytes[texture.resident - 1];
+      if (!make_room(bytes, &old_levels))
+        continue;
+      set_resident(w.second, texture, texture.resident - 1, &old_levels);
+      uploaded += bytes;
+      progress = true;
+    }
+  }
+
+  stats_.requested = 0;
+  stats_.satisfied = 0;
+  for (std::unordered_map<unsigned, Texture>::iterator it = textures_.begin(); it != textures_.end(); ++it)
+  {
+    if (it->second.requested >= 0)
+    {
+      ++stats_.requested;
+      stats_.satisfied += (it->second.resident <= it->second.requested) ? 1 : 0;
+    }
+    it->second.requested = -1;
+  }
+
+  changes->clear();
+  for (std::unordered_map<unsigned, int>::const_iterator it = old_levels.begin(); it != old_levels.end(); ++it)
+  {
+    const int new_level = textures_[it->first].resident;
+    if (new_level != it->second)
+    {
+      TextureStreamChange change = { it->first, it->second, new_level };
+      changes->push_back(change);
+    }
+  }
+}
+
+int texture_mip_demand(float texels_per_unit, float distance, float pixels_per_unit)
+{
+  if (!(texels_per_unit > 0.0f) || !(pixels_per_unit > 0.0f))
+    return 0;
+
+  // 화면의 픽셀 하나가 덮는 level 0의 텍셀 수
+  const float ratio = texels_per_unit * std::max(distance, 1e-4f) / pixels_per_unit;
+  if (!(ratio > 1.0f))
+    return 0;
+  return std::min(int(std::floor(std::log2(ratio))), 30);
+}
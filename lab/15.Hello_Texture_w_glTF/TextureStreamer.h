@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// 텍스처 mip level의 상주(residency)를 메모리 budget 안에서 관리한다. (--texture-budget)
+//
+// 텍스처는 작은 mip tail(가로/세로가 TAIL_SIZE 이하인 level들)만 올린 채로 시작하고,
+// 그릴 때 화면에서 필요한 level(texture_mip_demand())을 request()로 알려 주면 update()가 한 level씩 올린다.
+// 상주한 level의 합이 budget을 넘으면 이번 프레임에 쓰지 않은 텍스처를 오래 쓰지 않은 것(LRU)부터 tail로 내리고,
+// 그래도 모자라면 쓰고 있지만 필요보다 높은 level을 가진 텍스처를 필요한 level까지 내린다.
+// 쓰고 있는 텍스처를 필요한 level 아래로 내리지는 않는다. (자리가 없으면 올리지 않고 기다린다)
+// tail은 내리지 않으므로 tail의 합이 budget보다 크면 그만큼은 넘는다.
+//
+// level 0이 가장 크다. "level을 올린다"는 더 큰 (번호가 작은) level을 GPU에 올린다는 뜻이다.
+// 실제 업로드와 해제는 update()가 돌려준 변경 목록으로 호출한 쪽이 한다. OpenGL 호출은 하지 않는다.
+
+// 상주 level이 바뀐 텍스처 하나. new_level < old_level이면 new_level ~ old_level - 1을 올리고,
+// new_level > old_level이면 old_level ~ new_level - 1을 놓는다.
+struct TextureStreamChange
+{
+  unsigned  id;
+  int       old_level;
+  int       new_level;
+};
+
+struct TextureStreamerStats
+{
+  size_t  budget = 0;
+  size_t  resident_bytes = 0;     // 지금 올라가 있는 level의 합
+  size_t  tail_bytes = 0;         // 그중 항상 올라가 있는 tail
+  size_t  full_bytes = 0;         // 모든 level을 올렸을 때
+  size_t  textures = 0;
+  size_t  requested = 0;          // 이번 프레임에 그린 텍스처
+  size_t  satisfied = 0;          // 그중 필요한 level까지 올라간 것
+  size_t  loads = 0;              // 올린 level 수 (누적)
+  size_t  evictions = 0;          // 놓은 level 수 (누적)
+  size_t  loaded_bytes = 0;
+  size_t  evicted_bytes = 0;
+};
+
+class TextureStreamer
+{
+public:
+  static const int TAIL_SIZE = 64;
+
+  explicit TextureStreamer(size_t budget = 0);
+
+  void set_budget(size_t budget) { stats_.budget = budget; }
+  size_t budget() const { return stats_.budget; }
+
+  // 텍스처를 등록하고 처음부터 올려 둘 tail level을 반환한다.
+  // level_bytes[i]는 level i의 바이트 수, width/height는 level 0의 크기
+  int add_texture(unsigned id, int width, int height, const std::vector<size_t>& level_bytes);
+  void remove_texture(unsigned id);
+  bool has_texture(unsigned id) const { return textures_.find(id) != textures_.end(); }
+
+  // 이번 프레임에 이 텍스처를 level 이상의 해상도로 그리려 한다. (여러 번 부르면 가장 큰 level 0 쪽)
+  void request(unsigned id, int level);
+
+  // 요청을 보고 상주 level을 정한다. 새로 올리는 양은 upload_budget 바이트까지 (적어도 한 level)
+  // 바뀐 텍스처를 changes에 넣고, 이번 프레임의 요청은 비운다.
+  void update(size_t upload_budget, std::vector<TextureStreamChange>* changes);
+
+  int resident_level(unsigned id) const;
+  const TextureStreamerStats& stats() const { return stats_; }
+
+private:
+  struct Texture
+  {
+    std::vector<size_t> level_bytes;
+    int   tail;                 // 항상 올라가 있는 level
+    int   resident;             // 올라가 있는 가장 큰 level (resident ~ 마지막 level이 올라가 있음)
+    int   requested;            // 이번 프레임에 필요한 level (그리지 않았으면 -1)
+    size_t size;                // resident 이상의 level 합
+    std::list<unsigned>::iterator lru;
+  };
+
+  void set_resident(unsigned id, Texture& texture, int level, std::unordered_map<unsigned, int>* old_levels);
+  bool make_room(size_t bytes, std::unordered_map<unsigned, int>* old_levels);
+
+private:
+  std::unordered_map<unsigned, Texture> textures_;
+  std::list<unsigned>   lru_;     // 앞이 최근에 쓴 텍스처
+  TextureStreamerStats  stats_;
+};
+
+// 화면에서 필요한 mip level: 텍셀 하나가 픽셀 하나보다 작아지지 않는 가장 작은 level
+// texels_per_unit은 월드 단위 길이당 level 0의 텍셀 수 (UV 밀도 x 텍스처 크기),
+// pixels_per_unit은 거리 1에서 월드 단위 길이가 덮는 픽셀 수 (투영 행렬과 viewport로 구함)
+int texture_mip_demand(float texels_per_unit, float distance, float pixels_per_unit);
@@ -0,0 +1,104 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned int num_threads)
+  : pending_(0), stop_(false)
+{
+  if (num_threads == 0)
+    num_threads = default_thread_count();
+
+  for (unsigned int i = 0; i < num_threads; ++i)
+    workers_.push_back(std::thread(&ThreadPool::worker_loop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  task_cv_.notify_all();
+
+  for (std::thread& worker : workers_)
+    worker.join();
+}
+
+unsigned int ThreadPool::default_thread_count()
+{
+  unsigned int n = std::thread::hardware_concurrency();
+  return n == 0 ? 1 : n;
+}
+
+void ThreadPool::enqueue(const Task& task)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push(task);
+    ++pending_;
+  }
+  task_cv_.notify_one();
+}
+
+void ThreadPool::wait()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return pending_ == 0; });
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& func)
+{
+  if (count == 0)
+    return;
+
+  // 작업 크기가 제각각(예: 이미지 해상도)이므로 인덱스를 하나씩 가져가게 한다.
+  std::atomic<size_t> next(0);
+  size_t num_tasks = std::min<size_t>(count, workers_.size());
+
+  // 다른 스레드(다른 모델의 로더)가 넣은 작업까지 기다리지 않도록 여기서 넣은 작업만 센다.
+  std::mutex done_mutex;
+  std::condition_variable done_cv;
+  size_t remaining = num_tasks;
+
+  for (size_t t = 0; t < num_tasks; ++t)
+  {
+    enqueue([&next, count, &func, &done_mutex, &done_cv, &remaining] {
+      for (size_t i = next++; i < count; i = next++)
+        func(i);
+
+      std::lock_guard<std::mutex> lock(done_mutex);
+      if (--remaining == 0)
+        done_cv.notify_all();
+    });
+  }
+
+  std::unique_lock<std::mutex> lock(done_mutex);
+  done_cv.wait(lock, [&remaining] { return remaining == 0; });
+}
+
+void ThreadPool::worker_loop()
+{
+  for (;;)
+  {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+      if (stop_ && tasks_.empty())
+        return;
+
+      task = tasks_.front();
+      tasks_.pop();
+    }
+
+    task();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --pending_;
+      if (pending_ == 0)
+        done_cv_.notify_all();
+    }
+  }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// 고정 개수의 worker 스레드로 작업을 처리하는 간단한 스레드 풀.
+// 로더(이미지 디코딩 등)에서 CPU 작업을 여러 코어로 나누는 데 사용한다.
+class ThreadPool
+{
+public:
+  typedef std::function<void()> Task;
+
+public:
+  // num_threads가 0이면 std::thread::hardware_concurrency()개를 사용한다.
+  explicit ThreadPool(unsigned int num_threads = 0);
+  ~ThreadPool();
+
+  void enqueue(const Task& task);
+  void wait();      // 지금까지 넣은 작업이 모두 끝날 때까지 대기
+
+  // [0, count) 구간을 worker들에게 나누어 func(i)를 호출하고 끝날 때까지 대기
+  // (여기서 넣은 작업만 기다리므로 여러 스레드에서 동시에 호출해도 된다. worker 안에서는 호출하지 말 것)
+  void parallel_for(size_t count, const std::function<void(size_t)>& func);
+
+  unsigned int size() const { return static_cast<unsigned int>(workers_.size()); }
+
+  static unsigned int default_thread_count();
+
+private:
+  ThreadPool(const ThreadPool&);
+  ThreadPool& operator=(const ThreadPool&);
+
+  void worker_loop();
+
+private:
+  std::vector<std::thread>  workers_;
+  std::queue<Task>          tasks_;
+
+  std::mutex                mutex_;
+  std::condition_variable   task_cv_;     // 새 작업 / 종료 신호
+  std::condition_variable   done_cv_;     // 작업 완료 신호
+
+  size_t  pending_;   // 큐에 있거나 실행 중인 작업 수
+  bool    stop_;
+};
@@ -0,0 +1,230 @@
+#include "VertexAnimation.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "Skinning.h"
+#include "ThreadPool.h"
+
+namespace {
+  // octahedral 인코딩을 8비트 두 개로: 쉐이더는 w * 65535를 256으로 나눈 몫과 나머지로 되돌린다.
+  uint16_t pack_normal(const float* n)
+  {
+    const float length = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    float x = 0.0f, y = 0.0f;
+    if (length > 0.0f)
+    {
+      x = n[0] / length;
+      y = n[1] / length;
+      if (n[2] < 0.0f)
+      {
+        const float ox = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float oy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = ox;
+        y = oy;
+      }
+    }
+    const int ex = int(std::floor((x * 0.5f + 0.5f) * 255.0f + 0.5f));
+    const int ey = int(std::floor((y * 0.5f + 0.5f) * 255.0f + 0.5f));
+    return uint16_t(ex * 256 + ey);
+  }
+
+  void unpack_normal(uint16_t packed, float* n)
+  {
+    const float x = float(packed / 256) / 255.0f * 2.0f - 1.0f;
+    const float y = float(packed % 256) / 255.0f * 2.0f - 1.0f;
+    n[0] = x;
+    n[1] = y;
+    n[2] = 1.0f - std::fabs(x) - std::fabs(y);
+    if (n[2] < 0.0f)
+    {
+      n[0] = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+      n[1] = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    }
+  }
+
+  // frame 하나의 정점 vertex를 position, normal로 (정규화하지 않음)
+  void read_frame(const VertexAnimation& vat, int frame, size_t vertex, float* position, float* normal)
+  {
+    const size_t texel = size_t(frame) * vat.num_vertices + vertex;
+    if (vat.format == VAT_FLOAT)
+    {
+      const float* t = &vat.texels_float[texel * 8];
+      std::copy(t, t + 3, position);
+      std::copy(t + 4, t + 7, normal);
+      return;
+    }
+    const uint16_t* t = &vat.texels_packed[texel * 4];
+    for (int c = 0; c < 3; ++c)
+      position[c] = vat.bounds_min[c] + float(t[c]) / 65535.0f * (vat.bounds_max[c] - vat.bounds_min[c]);
+    unpack_normal(t[3], normal);
+  }
+} // namespace
+
+size_t VertexAnimation::num_texels() const
+{
+  return size_t(frames) * num_vertices * (format == VAT_FLOAT ? 2 : 1);
+}
+
+size_t VertexAnimation::bytes() const
+{
+  return num_texels() * (format == VAT_FLOAT ? 4 * sizeof(float) : 4 * sizeof(uint16_t));
+}
+
+bool bake_vertex_animation(const tinygltf::Model& model, const AnimationClip& clip, float fps, VatFormat format,
+  ThreadPool& pool, VertexAnimation* out, std::string* err)
+{
+  *out = VertexAnimation();
+  std::vector<SkinPalette> palettes;
+  build_skin_palettes(model, &palettes, err);
+
+  std::vector<SkinnedVertices> vertices;
+  for (size_t i = 0; i < palettes.size(); ++i)
+  {
+    const tinygltf::Mesh& mesh = model.meshes[model.nodes[palettes[i].node].mesh];
+    for (size_t j = 0; j < mesh.primitives.size(); ++j)
+    {
+      SkinnedVertices sv;
+      if (!read_skinned_vertices(model, mesh.primitives[j], &sv) || sv.size() == 0)
+        continue;
+      VatPrimitive vp;
+      vp.palette = int(i);
+      vp.node = palettes[i].node;
+      vp.primitive = int(j);
+      vp.first_vertex = out->num_vertices;
+      vp.num_vertices = sv.size();
+      out->primitives.push_back(vp);
+      out->num_vertices += sv.size();
+      vertices.push_back(std::move(sv));
+    }
+  }
+  if (vertices.empty())
+    return false;
+
+  // clip 길이를 frame 수로 나눠 떨어지게 한다. (마지막 frame 다음이 clip.start의 frame)
+  const float duration = clip.end - clip.start;
+  out->format = format;
+  out->frames = (duration > 0.0f) ? std::max(1, int(std::ceil(duration * fps - 1e-3f))) : 1;
+  out->fps = (duration > 0.0f) ? out->frames / duration : fps;
+
+  NodeHierarchy hierarchy;
+  build_node_hierarchy(model, &hierarchy);
+  AnimationPose rest;
+  init_animation_pose(model, &rest);
+
+  // frame f의 pose -> joint 행렬 -> skin_vertices로 frame 하나를 scratch에 skinning하고 AABB를 bounds에 낸다.
+  // 모든 frame을 한꺼번에 들고 있지 않도록 worker마다 frame 하나 크기의 scratch에 skinning해서 바로 텍셀로 바꾼다.
+  const size_t num_vertices = out->num_vertices;
+  auto skin_frame = [&](size_t f, std::vector<float>* scratch, SkinBounds* bounds) {
+    AnimationPose pose = rest;
+    sample_animation(clip, clip.start + float(f) / out->fps, nullptr, &pose);
+    std::vector<float> world;
+    compute_world_matrices(model, hierarchy, pose, &world);
+    std::vector<SkinPalette> frame_palettes = palettes;
+    for (SkinPalette& palette : frame_palettes)
+      compute_joint_matrices(world, &palette);
+
+    scratch->resize(num_vertices * SKINNED_VERTEX_FLOATS);
+    std::fill(bounds->min, bounds->min + 3, FLT_MAX);
+    std::fill(bounds->max, bounds->max + 3, -FLT_MAX);
+    for (size_t p = 0; p < out->primitives.size(); ++p)
+    {
+      const VatPrimitive& vp = out->primitives[p];
+      const SkinPalette& palette = frame_palettes[vp.palette];
+      SkinBounds b;
+      skin_vertices(vertices[p], &palette.matrices[0], palette.joints.size(),
+        &(*scratch)[vp.first_vertex * SKINNED_VERTEX_FLOATS], &b);
+      for (int c = 0; c < 3; ++c)
+      {
+        bounds->min[c] = std::min(bounds->min[c], b.min[c]);
+        bounds->max[c] = std::max(bounds->max[c], b.max[c]);
+      }
+    }
+  };
+
+  // VAT_FLOAT는 bounds를 양자화에 쓰지 않으므로 한 번에 굽는다. VAT_PACKED는 모든 frame의 AABB를 먼저 구하고
+  // 다시 skinning하면서 양자화한다. (skinning을 두 번 하는 대신 frame마다의 결과를 들고 있지 않음)
+  const size_t count = size_t(out->frames) * num_vertices;
+  std::vector<SkinBounds> frame_bounds(out->frames);
+  if (format == VAT_FLOAT)
+  {
+    out->texels_float.assign(count * 8, 0.0f);
+    pool.parallel_for(size_t(out->frames), [&](size_t f) {
+      std::vector<float> scratch;
+      skin_frame(f, &scratch, &frame_bounds[f]);
+      float* t = &out->texels_float[f * num_vertices * 8];
+      for (size_t v = 0; v < num_vertices; ++v)
+      {
+        const float* s = &scratch[v * SKINNED_VERTEX_FLOATS];
+        std::copy(s, s + 3, t + v * 8);
+        std::copy(s + 3, s + 6, t + v * 8 + 4);
+      }
+    });
+  }
+  else
+  {
+    pool.parallel_for(size_t(out->frames), [&](size_t f) {
+      std::vector<float> scratch;
+      skin_frame(f, &scratch, &frame_bounds[f]);
+    });
+  }
+
+  std::copy(frame_bounds[0].min, frame_bounds[0].min + 3, out->bounds_min);
+  std::copy(frame_bounds[0].max, frame_bounds[0].max + 3, out->bounds_max);
+  for (const SkinBounds& b : frame_bounds)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      out->bounds_min[c] = std::min(out->bounds_min[c], b.min[c]);
+      out->bounds_max[c] = std::max(out->bounds_max[c], b.max[c]);
+    }
+  }
+  if (format == VAT_FLOAT)
+    return true;
+
+  float scale[3];
+  for (int c = 0; c < 3; ++c)
+  {
+    const float extent = out->bounds_max[c] - out->bounds_min[c];
+    scale[c] = (extent > 0.0f) ? 65535.0f / extent : 0.0f;
+  }
+  out->texels_packed.resize(count * 4);
+  pool.parallel_for(size_t(out->frames), [&](size_t f) {
+    std::vector<float> scratch;
+    SkinBounds bounds;
+    skin_frame(f, &scratch, &bounds);
+    uint16_t* t = &out->texels_packed[f * num_vertices * 4];
+    for (size_t v = 0; v < num_vertices; ++v, t += 4)
+    {
+      const float* s = &scratch[v * SKINNED_VERTEX_FLOATS];
+      for (int c = 0; c < 3; ++c)
+        t[c] = uint16_t(std::min(65535.0f, std::floor((s[c] - out->bounds_min[c]) * scale[c] + 0.5f)));
+      t[3] = pack_normal(s + 3);
+    }
+  });
+  return true;
+}
+
+void sample_vertex_animation(const VertexAnimation& vat, float seconds, size_t vertex, float position[3],
+  float normal[3])
+{
+  const float frame = std::fmod(std::max(0.0f, seconds) * vat.fps, float(vat.frames));
+  const int f0 = std::min(int(frame), vat.frames - 1);
+  const int f1 = (f0 + 1 < vat.frames) ? f0 + 1 : 0;
+  const float t = frame - float(f0);
+
+  float p0[3], n0[3], p1[3], n1[3];
+  read_frame(vat, f0, vertex, p0, n0);
+  read_frame(vat, f1, vertex, p1, n1);
+  float length = 0.0f;
+  for (int c = 0; c < 3; ++c)
+  {
+    position[c] = p0[c] + (p1[c] - p0[c]) * t;
+    normal[c] = n0[c] + (n1[c] - n0[c]) * t;
+    length += normal[c] * normal[c];
+  }
+  length = std::sqrt(length);
+  for (int c = 0; c < 3 && length > 0.0f; ++c)
+    normal[c] /= length;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../glTF/tiny_gltf.h"
+#include "Animation.h"
+
+class ThreadPool;
+
+// vertex animation texture (VAT): skinned mesh의 clip을 일정한 간격으로 샘플링해 skinning한 position, normal을 frame마다 구워 둔다.
+//
+// 그리는 쪽은 joint 없이 gl_VertexID와 재생 시각으로 이웃한 두 frame을 읽어 보간하므로, instance가 많아도 skinning을 하지 않는다.
+// 정점은 palette(skin을 쓰는 mesh node), primitive 순서로 이어 붙이고 frame f의 정점 v는 f * num_vertices + v 번째이다.
+// 마지막 frame 다음은 첫 frame이다. (반복 재생)
+// OpenGL 호출은 하지 않는다.
+
+enum VatFormat
+{
+  VAT_FLOAT,    // 정점마다 RGBA32F 텍셀 두 개: (position, 0), (normal, 0) - 32바이트
+  VAT_PACKED,   // 정점마다 RGBA16 텍셀 하나: bounds 안의 16비트 position, w는 8비트 octahedral normal 두 개 - 8바이트
+};
+
+// 구운 primitive 하나
+struct VatPrimitive
+{
+  int palette = -1;                     // build_skin_palettes()의 순서
+  int node = -1;                        // palette의 mesh node
+  int primitive = -1;                   // mesh의 primitive 인덱스
+  size_t first_vertex = 0;
+  size_t num_vertices = 0;
+};
+
+struct VertexAnimation
+{
+  VatFormat format = VAT_PACKED;
+  float fps = 0.0f;                     // 실제 간격 (clip 길이가 frame 수로 나눠 떨어지게 맞춘 것)
+  int frames = 0;
+  size_t num_vertices = 0;              // frame 하나의 정점 수
+  std::vector<VatPrimitive> primitives;
+  float bounds_min[3];                  // 모든 frame의 position AABB (mesh 좌표, VAT_PACKED의 역양자화)
+  float bounds_max[3];
+  std::vector<float> texels_float;      // VAT_FLOAT: frames * num_vertices * 8
+  std::vector<uint16_t> texels_packed;  // VAT_PACKED: frames * num_vertices * 4 (GPU에 올린 뒤에는 비워도 됨)
+
+  size_t num_texels() const;            // 텍스처 buffer의 텍셀 수
+  size_t bytes() const;                 // 텍스처 buffer의 크기 (텍셀을 비운 뒤에도 유효)
+};
+
+// model의 skin을 모두 clip으로 fps마다 굽는다. frame들은 pool의 worker들이 나눠 skinning한다. (skin_vertices)
+// 메모리는 결과 텍셀과 worker마다 frame 하나 크기의 scratch만 쓴다. (VAT_PACKED는 bounds를 먼저 구하느라 두 번 skinning함)
+// pool의 worker 안에서는 호출하지 말 것 (ThreadPool::parallel_for)
+// 구울 primitive가 없으면 false (읽을 수 없는 skin은 err에 적음)
+bool bake_vertex_animation(const tinygltf::Model& model, const AnimationClip& clip, float fps, VatFormat format,
+  ThreadPool& pool, VertexAnimation* out, std::string* err);
+
+// 쉐이더와 같은 계산: clip 시작에서 seconds 뒤의 정점 vertex (두 frame의 선형 보간, normal은 정규화)
+void sample_vertex_animation(const VertexAnimation& vat, float seconds, size_t vertex, float position[3],
+  float normal[3]);
@@ -0,0 +1,1975 @@
+﻿// 로딩 성능 측정용 프로그램 (OpenGL 컨텍스트 없이 CPU 작업만 측정)
+//
+//   make bench
+//   ./bench_loader                      # test_models의 모든 glTF
+//   ./bench_loader Sponza.gltf Duck.gltf
+//   ./bench_loader -j 16 Sponza.gltf    # 1 ~ 16 스레드까지 측정
+//   ./bench_loader --synthetic 100      # JSON 파서 비교에 100MB짜리 합성 glTF 추가
+//   ./bench_loader --base64             # 1 ~ 100MB 버퍼가 data URI로 들어 있는 glTF로 base64 디코딩 측정
+//                                       # (블록 안의 '='/잘못된 글자를 포함해 SIMD와 scalar 결과가 다르면 종료 코드 1)
+//   ./bench_loader --draco              # glTF와 glTF-Draco 버전의 크기/로딩 시간 비교 (make DRACO=1 필요)
+//   ./bench_loader --quantize           # quantize_meshes() 전후의 정점 attribute 크기
+//   ./bench_loader --compress           # 텍스처 블록 압축(BC/BC7/ETC2)의 크기와 인코딩 속도
+//   ./bench_loader --ktx2               # 이미지를 KTX2로 바꿨을 때와 JPEG/PNG 디코딩의 로딩 시간, VRAM 비교
+//   ./bench_loader --mips               # CPU mip 생성(box/Kaiser, sRGB)의 속도와 PSNR (glGenerateMipmap과는 final_lab --mip-bench)
+//   ./bench_loader --stream             # 텍스처 streaming의 budget 스트레스 테스트 (합성 씬, 불변식이 깨지면 종료 코드 1)
+//   ./bench_loader --animation          # animation 샘플링: cursor와 이진 탐색, 수천 instance의 스레드 분할 (결과가 다르면 종료 코드 1)
+//   ./bench_loader --skinning           # joint palette(scalar/SSE)와 CPU skinning(기준/AVX2/스레드, instance 100개)의 속도
+//                                       # (palette나 skinning 결과가 다르면 종료 코드 1)
+//   ./bench_loader --morph              # morph target: dense/sparse accessor를 푼 스트림과 dense 기준 구현의 크기, 속도
+//                                       # (합성 mesh, 스트림이나 GPU 표의 결과가 다르면 종료 코드 1)
+//   ./bench_loader --vat                # vertex animation texture: 굽는 간격/형식별 크기, 굽는 시간, 보간 오차
+//                                       # (frame 시각의 값이 skinning 결과와 다르면 종료 코드 1)
+//   ./bench_loader --cache-snapshot     # AsyncLoader가 저장한 scene cache가 넘겨준 뒤 고친(양자화한) model이 아닌지 확인
+//                                       # (캐시의 accessor가 파싱한 것과 다르면 종료 코드 1)
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "../glTF/tiny_gltf.h"
+
+#include "ThreadPool.h"
+#include "AsyncLoader.h"
+#include "ImageDecoder.h"
+#include "SceneCache.h"
+#include "GltfSaxParser.h"
+#include "Base64.h"
+#include "DracoDecoder.h"
+#include "MeshQuantizer.h"
+#include "TextureCompressor.h"
+#include "KtxTexture.h"
+#include "MipGenerator.h"
+#include "TextureStreamer.h"
+#include "Animation.h"
+#include "Skinning.h"
+#include "Morph.h"
+#include "VertexAnimation.h"
+
+// tinygltf 안의 원래 (std::string) 디코더. 비교용으로만 쓴다.
+namespace tinygltf {
+  std::string base64_decode(std::string const& encoded_string);
+}
+
+typedef std::chrono::high_resolution_clock bench_clock;
+
+static double elapsed_ms(const bench_clock::time_point& begin)
+{
+  return std::chrono::duration<double, std::milli>(bench_clock::now() - begin).count();
+}
+
+static const char* default_models[] = {
+  "TriangleWithoutIndices.gltf", "Cameras.gltf", "Box.gltf", "BoxTextured.gltf",
+  "BoxVertexColors.gltf", "Duck.gltf", "BrainStem.gltf", "Lantern.gltf",
+  "TextureSettingsTest.gltf", "Sponza.gltf",
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// 이미지 디코딩: 1 ~ N 스레드
+////////////////////////////////////////////////////////////////////////////////
+static void bench_image_decode(const std::vector<std::string>& models, unsigned int max_threads)
+{
+  std::vector<unsigned int> thread_counts;
+  for (unsigned int n = 1; n < max_threads; n *= 2)
+    thread_counts.push_back(n);
+  thread_counts.push_back(max_threads);
+
+  std::printf("[image decode]\n");
+  std::printf("%-28s %7s %10s %8s %12s %12s %8s\n",
+    "model", "images", "MB(enc)", "threads", "parse(ms)", "decode(ms)", "speedup");
+
+  for (const std::string& name : models)
+  {
+    double serial_ms = 0.0;
+    for (unsigned int num_threads : thread_counts)
+    {
+      tinygltf::Model model;
+      tinygltf::TinyGLTF loader;
+      std::string err, warn;
+      loader.SetImageLoader(record_encoded_image, nullptr);
+
+      bench_clock::time_point begin = bench_clock::now();
+      if (!loader.LoadASCIIFromFile(&model, &err, &warn, "test_models/" + name))
+      {
+        std::printf("%-28s failed to load: %s\n", name.c_str(), err.c_str());
+        break;
+      }
+      double parse_ms = elapsed_ms(begin);
+
+      size_t encoded_bytes = 0;
+      for (const tinygltf::Image& image : model.images)
+        encoded_bytes += image.image.size();
+
+      ThreadPool pool(num_threads);
+      begin = bench_clock::now();
+      decode_images(model, pool, &err);
+      double decode_ms = elapsed_ms(begin);
+
+      if (num_threads == 1)
+        serial_ms = decode_ms;
+
+      std::printf("%-28s %7zu %10.2f %8u %12.2f %12.2f %7.2fx\n",
+        name.c_str(), model.images.size(), encoded_bytes / (1024.0 * 1024.0),
+        num_threads, parse_ms, decode_ms,
+        decode_ms > 0.0 ? serial_ms / decode_ms : 1.0);
+
+      if (model.images.empty())
+        break;
+    }
+  }
+  std::printf("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// scene cache: cold (파싱 + 디코딩) vs warm (캐시 mmap)
+////////////////////////////////////////////////////////////////////////////////
+static void bench_scene_cache(const std::vector<std::string>& models, unsigned int num_threads)
+{
+  std::printf("[scene cache] threads = %u\n", num_threads);
+  std::printf("%-28s %10s %12s %12s %12s %8s\n",
+    "model", "cache(MB)", "cold(ms)", "save(ms)", "warm(ms)", "speedup");
+
+  ThreadPool pool(num_threads);
+  for (const std::string& name : models)
+  {
+    const std::string filename = "test_models/" + name;
+    const std::string cache_path = scene_cache_path(filename);
+
+    tinygltf::Model cold;
+    tinygltf::TinyGLTF loader;
+    std::string err, warn;
+    loader.SetImageLoader(record_encoded_image, nullptr);
+
+    bench_clock::time_point begin = bench_clock::now();
+    if (!loader.LoadASCIIFromFile(&cold, &err, &warn, filename))
+    {
+      std::printf("%-28s failed to load: %s\n", name.c_str(), err.c_str());
+      continue;
+    }
+    decode_images(cold, pool, &err);
+    double cold_ms = elapsed_ms(begin);
+
+    begin = bench_clock::now();
+    save_scene_cache(cold, filename);
+    double save_ms = elapsed_ms(begin);
+
+    // warm 시간에는 의존 파일의 해시 검사가 포함된다.
+    tinygltf::Model warm;
+    begin = bench_clock::now();
+    bool res = load_scene_cache(warm, filename);
+    double warm_ms = elapsed_ms(begin);
+
+    std::ifstream cache_file(cache_path.c_str(), std::ios::binary | std::ios::ate);
+    double cache_mb = cache_file ? double(cache_file.tellg()) / (1024.0 * 1024.0) : 0.0;
+    cache_file.close();
+    std::remove(cache_path.c_str());
+
+    if (!res)
+    {
+      std::printf("%-28s failed to read cache\n", name.c_str());
+      continue;
+    }
+
+    std::printf("%-28s %10.2f %12.2f %12.2f %12.2f %7.2fx\n",
+      name.c_str(), cache_mb, cold_ms, save_ms, warm_ms, cold_ms / warm_ms);
+  }
+  std::printf("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// scene cache: 넘겨준 model을 고쳐도 캐시는 파싱한 그대로
+////////////////////////////////////////////////////////////////////////////////
+static bool load_with(bool sax, tinygltf::Model* model, const std::string& filename, std::string* err);
+
+static bool same_accessor(const tinygltf::Accessor& a, const tinygltf::Accessor& b)
+{
+  return a.bufferView == b.bufferView && a.byteOffset == b.byteOffset && a.normalized == b.normalized &&
+    a.componentType == b.componentType && a.count == b.count && a.type == b.type &&
+    a.minValues == b.minValues && a.maxValues == b.maxValues && a.sparse.isSparse == b.sparse.isSparse;
+}
+
+// AsyncLoader로 읽어 final_lab --quantize처럼 넘겨받은 model을 양자화하고 attribute 하나를 뺀 뒤(init_buffer_objects)
+// 디코딩을 끝내 캐시를 저장하게 한다. 다시 읽은 캐시의 buffer, accessor, primitive가 tinygltf로 새로 읽은 것과 같아야 한다.
+static bool bench_cache_snapshot(const std::vector<std::string>& models, unsigned int num_threads)
+{
+  std::printf("[cache-snapshot] scene cache saved after quantize_meshes() on the handed-over model\n");
+  std::printf("%-28s %10s %10s %10s\n", "model", "accessors", "modified", "cache");
+
+  ThreadPool pool(num_threads);
+  bool ok = true;
+  for (const std::string& name : models)
+  {
+    const std::string filename = "test_models/" + name;
+    const std::string cache_path = scene_cache_path(filename);
+    std::remove(cache_path.c_str());
+
+    tinygltf::Model reference;
+    std::string err;
+    if (!load_with(false, &reference, filename, &err) ||
+      (has_draco_primitives(reference) && !decode_draco_primitives(reference, pool, &err)))
+    {
+      std::printf("%-28s failed to load: %s\n", name.c_str(), err.c_str());
+      continue;
+    }
+
+    size_t modified = 0;
+    {
+      tinygltf::Model model;      // loader보다 먼저 만들어 나중에 지운다. (소멸자가 캐시 저장을 기다림)
+      AsyncLoader loader(pool);
+      loader.start(filename);
+      while (!loader.poll_model(model) && !loader.failed())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      if (loader.failed())
+        continue;
+
+      std::vector<MeshDequantization> dequant;
+      quantize_meshes(model, &dequant);
+      for (tinygltf::Mesh& mesh : model.meshes)
+      {
+        if (!mesh.primitives.empty() && mesh.primitives[0].attributes.size() > 1)
+        {
+          mesh.primitives[0].attributes.erase(mesh.primitives[0].attributes.begin());
+          break;
+        }
+      }
+      for (size_t i = 0; i < model.accessors.size(); ++i)
+        modified += (i >= reference.accessors.size() || !same_accessor(model.accessors[i], reference.accessors[i])) ? 1 : 0;
+      modified += model.accessors.size() < reference.accessors.size() ? reference.accessors.size() - model.accessors.size() : 0;
+
+      loader.start_decoding(std::vector<bool>(model.images.size(), true));
+    }
+
+    tinygltf::Model warm;
+    const bool loaded = load_scene_cache(warm, filename);
+    std::remove(cache_path.c_str());
+
+    bool same = loaded && warm.accessors.size() == reference.accessors.size() &&
+      warm.buffers.size() == reference.buffers.size() && warm.meshes.size() == reference.meshes.size();
+    for (size_t i = 0; same && i < warm.buffers.size(); ++i)
+      same = warm.buffers[i].data == reference.buffers[i].data;
+    for (size_t i = 0; same && i < warm.accessors.size(); ++i)
+      same = same_accessor(warm.accessors[i], reference.accessors[i]);
+    for (size_t i = 0; same && i < warm.meshes.size(); ++i)
+    {
+      same = warm.meshes[i].primitives.size() == reference.meshes[i].primitives.size();
+      for (size_t j = 0; same && j < warm.meshes[i].primitives.size(); ++j)
+        same = warm.meshes[i].primitives[j].attributes == reference.meshes[i].primitives[j].attributes;
+    }
+    ok = ok && same;
+
+    std::printf("%-28s %10zu %10zu %10s\n", name.c_str(), reference.accessors.size(), modified,
+      !loaded ? "missing" : (same ? "ok" : "MISMATCH"));
+  }
+  std::printf("\n");
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// JSON 파싱: tinygltf(DOM) vs load_gltf_sax(SAX)
+////////////////////////////////////////////////////////////////////////////////
+// 이미지는 디코딩하지 않고 인코딩된 바이트만 받는다. (두 경우 모두 같음)
+static bool load_with(bool sax, tinygltf::Model* model, const std::string& filename, std::string* err)
+{
+  std::string warn;
+  if (sax)
+    return load_gltf_sax(model, err, &warn, filename, record_encoded_image, nullptr);
+
+  tinygltf::TinyGLTF loader;
+  loader.SetImageLoader(record_encoded_image, nullptr);
+  return loader.LoadASCIIFromFile(model, err, &warn, filename);
+}
+
+// 로딩하는 동안 늘어난 최대 RSS(MB). 프로세스의 최대값은 줄어들지 않으므로 fork한 자식에서 잰다.
+static double peak_memory_mb(bool sax, const std::string& filename)
+{
+#ifndef _WIN32
+  int fds[2];
+  if (pipe(fds) != 0)
+    return -1.0;
+
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    close(fds[0]);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long before = usage.ru_maxrss;
+
+    tinygltf::Model model;
+    std::string err;
+    double mb = -1.0;
+    if (load_with(sax, &model, filename, &err))
+    {
+      getrusage(RUSAGE_SELF, &usage);
+      mb = (usage.ru_maxrss - before) / 1024.0;     // ru_maxrss는 KB 단위
+    }
+    ssize_t written = write(fds[1], &mb, sizeof(mb));
+    (void)written;
+    _exit(0);
+  }
+
+  close(fds[1]);
+  double mb = -1.0;
+  if (pid < 0 || read(fds[0], &mb, sizeof(mb)) != sizeof(mb))
+    mb = -1.0;
+  close(fds[0]);
+  if (pid > 0)
+    waitpid(pid, nullptr, 0);
+  return mb;
+#else
+  (void)sax; (void)filename;
+  return -1.0;
+#endif
+}
+
+static void bench_json_parse(const std::vector<std::string>& files)
+{
+  std::printf("[json parse] DOM = tinygltf, SAX = load_gltf_sax\n");
+  std::printf("%-28s %9s %10s %10s %8s %12s %12s\n",
+    "model", "JSON(MB)", "DOM(ms)", "SAX(ms)", "speedup", "DOM peak(MB)", "SAX peak(MB)");
+
+  // 최대 메모리는 이 프로세스가 아무것도 읽기 전에 잰다.
+  // (먼저 읽고 해제한 메모리가 힙에 남아 있으면 자식이 그 페이지를 재사용해서 적게 나온다.)
+  std::vector<double> dom_peak, sax_peak;
+  for (const std::string& filename : files)
+  {
+    dom_peak.push_back(peak_memory_mb(false, filename));
+    sax_peak.push_back(peak_memory_mb(true, filename));
+  }
+
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    const std::string& filename = files[i];
+    std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+    double json_mb = file ? double(file.tellg()) / (1024.0 * 1024.0) : 0.0;
+    file.close();
+
+    double ms[2];
+    bool ok = true;
+    std::string err;
+    for (int sax = 0; sax < 2 && ok; ++sax)
+    {
+      tinygltf::Model model;
+      bench_clock::time_point begin = bench_clock::now();
+      ok = load_with(sax != 0, &model, filename, &err);
+      ms[sax] = elapsed_ms(begin);
+    }
+
+    std::string name = filename.substr(filename.find_last_of("/\\") + 1);
+    if (!ok)
+    {
+      std::printf("%-28s failed to load: %s\n", name.c_str(), err.c_str());
+      continue;
+    }
+
+    std::printf("%-28s %9.2f %10.2f %10.2f %7.2fx %12.1f %12.1f\n",
+      name.c_str(), json_mb, ms[0], ms[1], ms[0] / ms[1],
+      dom_peak[i], sax_peak[i]);
+  }
+  std::printf("\n");
+}
+
+// node/mesh/accessor가 아주 많은 (JSON이 큰) glTF를 만든다.
+// 모든 accessor는 data URI로 들어 있는 작은 buffer 하나를 공유한다.
+static bool write_synthetic_gltf(const std::string& filename, size_t target_mb)
+{
+  std::ofstream out(filename.c_str(), std::ios::binary);
+  if (!out)
+    return false;
+
+  const size_t target_bytes = target_mb * 1024 * 1024;
+  std::ostringstream nodes, meshes, accessors;
+  size_t count = 0;
+  size_t bytes = 0;
+  while (bytes < target_bytes)
+  {
+    std::ostringstream node, mesh, accessor;
+    node << (count ? "," : "") << "\n{\"name\":\"node_" << count << "\",\"mesh\":" << count
+      << ",\"translation\":[" << (count % 100) * 0.5 << "," << (count / 100 % 100) * 0.5 << ",0.0]"
+      << ",\"rotation\":[0.0,0.0,0.0,1.0],\"scale\":[1.0,1.0,1.0]}";
+    mesh << (count ? "," : "") << "\n{\"name\":\"mesh_" << count << "\",\"primitives\":[{\"attributes\":"
+      << "{\"POSITION\":" << 2 * count << ",\"NORMAL\":" << 2 * count + 1 << "},\"material\":0}]}";
+    for (int k = 0; k < 2; ++k)
+      accessor << (count || k ? "," : "") << "\n{\"bufferView\":" << k
+        << ",\"componentType\":5126,\"count\":3,\"type\":\"VEC3\","
+        << "\"min\":[0.0,0.0,0.0],\"max\":[1.0,1.0,1.0]}";
+
+    bytes += node.str().size() + mesh.str().size() + accessor.str().size() + 8;
+    nodes << node.str();
+    meshes << mesh.str();
+    accessors << accessor.str();
+    ++count;
+  }
+
+  // 위치 3개 + 노말 3개 (float3 * 6 = 72 bytes), 값은 쓰이지 않으므로 0
+  const std::string buffer_uri = "data:application/octet-stream;base64," + std::string(96, 'A');
+
+  out << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"bench_loader\"},\"scene\":0,";
+  out << "\"scenes\":[{\"nodes\":[";
+  for (size_t i = 0; i < count; ++i)
+    out << (i ? "," : "") << i;
+  out << "]}],";
+  out << "\"nodes\":[" << nodes.str() << "],";
+  out << "\"meshes\":[" << meshes.str() << "],";
+  out << "\"accessors\":[" << accessors.str() << "],";
+  out << "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":36},"
+      << "{\"buffer\":0,\"byteOffset\":36,\"byteLength\":36}],";
+  out << "\"buffers\":[{\"byteLength\":72,\"uri\":\"" << buffer_uri << "\"}],";
+  out << "\"materials\":[{\"name\":\"default\",\"pbrMetallicRoughness\":{\"baseColorFactor\":[1.0,1.0,1.0,1.0]}}]}";
+  return bool(out);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// base64: data URI로 들어 있는 buffer
+////////////////////////////////////////////////////////////////////////////////
+static std::string encode_base64(const std::vector<unsigned char>& data)
+{
+  static const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  out.reserve((data.size() + 2) / 3 * 4);
+  size_t i = 0;
+  for (; i + 3 <= data.size(); i += 3)
+  {
+    unsigned int v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+    out += chars[v >> 18];
+    out += chars[(v >> 12) & 63];
+    out += chars[(v >> 6) & 63];
+    out += chars[v & 63];
+  }
+  if (i < data.size())
+  {
+    unsigned int v = data[i] << 16;
+    if (i + 1 < data.size())
+      v |= data[i + 1] << 8;
+    out += chars[v >> 18];
+    out += chars[(v >> 12) & 63];
+    out += (i + 1 < data.size()) ? chars[(v >> 6) & 63] : '=';
+    out += '=';
+  }
+  return out;
+}
+
+// SIMD 블록 안의 '='과 base64가 아닌 글자: 128글자까지의 모든 길이와 위치에 넣어 scalar, SIMD, tinygltf가 같은 곳에서
+// 멈추는지 본다. (AVX2 32글자, SSSE3 16글자 블록 안의 모든 offset)
+static bool check_base64_edges()
+{
+  std::vector<unsigned char> data(96);
+  unsigned int seed = 7;
+  for (unsigned char& c : data)
+    c = static_cast<unsigned char>((seed = seed * 1103515245u + 12345u) >> 16);
+  const std::string encoded = encode_base64(data);
+  static const char bad_chars[] = { '=', '!', '\n', '\x80' };
+
+  std::vector<unsigned char> decoded[2];
+  size_t failures = 0;
+  for (char bad : bad_chars)
+  {
+    for (size_t len = 1; len <= encoded.size(); ++len)
+    {
+      for (size_t pos = 0; pos < len; ++pos)
+      {
+        std::string in = encoded.substr(0, len);
+        in[pos] = bad;
+        size_t size[2];
+        for (int simd = 0; simd < 2; ++simd)
+        {
+          base64_use_simd(simd != 0);
+          decoded[simd].assign(base64_decoded_max_size(in.size()), 0);
+          size[simd] = decode_base64(in.data(), in.size(), decoded[simd].data());
+        }
+        const std::string legacy = tinygltf::base64_decode(in);
+        if (size[0] != size[1] || legacy.size() != size[0] ||
+          !std::equal(decoded[0].begin(), decoded[0].begin() + size[0], decoded[1].begin()) ||
+          (size[0] != 0 && std::memcmp(legacy.data(), decoded[0].data(), size[0]) != 0))
+        {
+          if (failures++ < 8)
+            std::printf("base64 mismatch: char 0x%02x at %zu of %zu (scalar %zu, SIMD %zu, tinygltf %zu bytes)\n",
+              unsigned(static_cast<unsigned char>(bad)), pos, len, size[0], size[1], legacy.size());
+        }
+      }
+    }
+  }
+  base64_use_simd(true);
+  std::printf("edge cases ('=', invalid byte at every offset): %s\n", failures == 0 ? "ok" : "MISMATCH");
+  return failures == 0;
+}
+
+// 디코더만 (MB/s), 그리고 buffer가 data URI인 glTF 전체 로딩 시간을 잰다. 디코딩 결과가 다르면 false
+static bool bench_base64()
+{
+  static const size_t sizes_mb[] = { 1, 10, 100 };
+  const std::string filename = "bench_base64.gltf";
+
+  std::printf("[base64] SIMD = %s\n", base64_impl_name());
+  bool ok = check_base64_edges();
+  std::printf("%-8s %14s %14s %14s %14s %14s\n",
+    "MB", "tinygltf(MB/s)", "scalar(MB/s)", "SIMD(MB/s)", "load s(ms)", "load SIMD(ms)");
+
+  for (size_t mb : sizes_mb)
+  {
+    std::vector<unsigned char> data(mb * 1024 * 1024);
+    unsigned int seed = 1;
+    for (unsigned char& c : data)
+      c = static_cast<unsigned char>((seed = seed * 1103515245u + 12345u) >> 16);
+    const std::string encoded = encode_base64(data);
+
+    bench_clock::time_point begin = bench_clock::now();
+    std::string legacy = tinygltf::base64_decode(encoded);
+    double legacy_ms = elapsed_ms(begin);
+
+    double decode_ms[2];
+    std::vector<unsigned char> decoded(base64_decoded_max_size(encoded.size()));
+    for (int simd = 0; simd < 2; ++simd)
+    {
+      base64_use_simd(simd != 0);
+      begin = bench_clock::now();
+      size_t size = decode_base64(encoded.data(), encoded.size(), decoded.data());
+      decode_ms[simd] = elapsed_ms(begin);
+      if (size != data.size() || !std::equal(data.begin(), data.end(), decoded.begin()) ||
+        legacy.size() != data.size())
+      {
+        std::printf("%-8zu decoded data mismatch\n", mb);
+        ok = false;
+      }
+    }
+
+    {
+      std::ofstream out(filename.c_str(), std::ios::binary);
+      out << "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":" << data.size()
+        << ",\"uri\":\"data:application/octet-stream;base64," << encoded << "\"}]}";
+    }
+
+    double load_ms[2];
+    for (int simd = 0; simd < 2; ++simd)
+    {
+      base64_use_simd(simd != 0);
+      tinygltf::Model model;
+      tinygltf::TinyGLTF loader;
+      std::string err, warn;
+      begin = bench_clock::now();
+      if (!loader.LoadASCIIFromFile(&model, &err, &warn, filename))
+        std::printf("%-8zu failed to load: %s\n", mb, err.c_str());
+      load_ms[simd] = elapsed_ms(begin);
+    }
+    base64_use_simd(true);
+    std::remove(filename.c_str());
+
+    std::printf("%-8zu %14.1f %14.1f %14.1f %14.2f %14.2f\n", mb,
+      mb * 1000.0 / legacy_ms, mb * 1000.0 / decode_ms[0], mb * 1000.0 / decode_ms[1],
+      load_ms[0], load_ms[1]);
+  }
+  std::printf("\n");
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Draco: 같은 모델의 glTF / glTF-Draco 버전 비교
+////////////////////////////////////////////////////////////////////////////////
+#ifdef USE_DRACO
+static const char* draco_models[] = {
+  "03_Box/glTF%s/Box.gltf", "06_Duck/glTF%s/Duck.gltf",
+  "07_BrainStem/glTF%s/BrainStem.gltf", "08_Lantern/glTF%s/Lantern.gltf",
+};
+
+static size_t file_size(const std::string& filename)
+{
+  std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+  return file ? static_cast<size_t>(file.tellg()) : 0;
+}
+
+// .gltf와 외부 .bin 파일의 크기 합 (이미지는 두 버전이 같으므로 뺀다)
+static size_t geometry_bytes(const tinygltf::Model& model, const std::string& filename)
+{
+  std::string dir = filename.substr(0, filename.find_last_of("/\\") + 1);
+  size_t bytes = file_size(filename);
+  for (const tinygltf::Buffer& buffer : model.buffers)
+  {
+    if (!buffer.uri.empty() && !tinygltf::IsDataURI(buffer.uri))
+      bytes += file_size(dir + buffer.uri);
+  }
+  return bytes;
+}
+#endif
+
+static void bench_draco(unsigned int num_threads)
+{
+#ifndef USE_DRACO
+  std::printf("[draco] built without the Draco decoder (make DRACO=1 bench)\n\n");
+  (void)num_threads;
+#else
+  ThreadPool pool(num_threads);
+  std::printf("[draco] %u threads, parse = tinygltf, decode = decode_draco_primitives\n", num_threads);
+  std::printf("%-16s %-8s %12s %10s %10s %10s\n", "model", "variant", "bytes", "parse(ms)", "decode(ms)", "total(ms)");
+
+  for (const char* pattern : draco_models)
+  {
+    for (int draco = 0; draco < 2; ++draco)
+    {
+      char path[256];
+      std::snprintf(path, sizeof(path), pattern, draco ? "-Draco" : "");
+      std::string filename = std::string("test_models/") + path;
+
+      tinygltf::Model model;
+      std::string err;
+      bench_clock::time_point begin = bench_clock::now();
+      bool ok = load_with(false, &model, filename, &err);
+      double parse_ms = elapsed_ms(begin);
+      size_t bytes = ok ? geometry_bytes(model, filename) : 0;
+
+      begin = bench_clock::now();
+      if (ok && has_draco_primitives(model))
+        ok = decode_draco_primitives(model, pool, &err);
+      double decode_ms = elapsed_ms(begin);
+
+      std::string name = filename.substr(filename.find_last_of("/\\") + 1);
+      if (!ok)
+      {
+        std::printf("%-16s %-8s failed to load: %s\n", name.c_str(), draco ? "draco" : "plain", err.c_str());
+        continue;
+      }
+      std::printf("%-16s %-8s %12zu %10.2f %10.2f %10.2f\n", name.c_str(), draco ? "draco" : "plain",
+        bytes, parse_ms, decode_ms, parse_ms + decode_ms);
+    }
+  }
+  std::printf("\n");
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// 정점 attribute 양자화: GPU에 올라가는 크기
+////////////////////////////////////////////////////////////////////////////////
+static void bench_quantize(const std::vector<std::string>& models)
+{
+  std::printf("[quantize] vertex attribute bytes (POSITION/NORMAL/TEXCOORD_n)\n");
+  std::printf("%-28s %12s %12s %8s %10s\n", "model", "float", "quantized", "ratio", "time(ms)");
+
+  for (const std::string& name : models)
+  {
+    tinygltf::Model model;
+    std::string err;
+    if (!load_with(false, &model, "test_models/" + name, &err))
+    {
+      std::printf("%-28s failed to load: %s\n", name.c_str(), err.c_str());
+      continue;
+    }
+
+    size_t before = vertex_attribute_bytes(model);
+    std::vector<MeshDequantization> dequant;
+    bench_clock::time_point begin = bench_clock::now();
+    quantize_meshes(model, &dequant);
+    double ms = elapsed_ms(begin);
+    size_t after = vertex_attribute_bytes(model);
+
+    std::printf("%-28s %12zu %12zu %7.2fx %10.2f\n", name.c_str(), before, after,
+      after > 0 ? double(before) / after : 0.0, ms);
+  }
+  std::printf("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// 텍스처 압축: 크기, scalar/SIMD 인코딩 속도, 스레드 수
+////////////////////////////////////////////////////////////////////////////////
+static void bench_compress(const std::vector<std::string>& models, unsigned int num_threads)
+{
+  static const TextureCompression modes[] = { TEXTURE_COMPRESSION_BC, TEXTURE_COMPRESSION_BC7, TEXTURE_COMPRESSION_ETC2 };
+
+  ThreadPool pool(num_threads);
+  std::printf("[compress] SIMD = %s, %u threads (mip chain 포함)\n", texture_compressor_impl_name(), num_threads);
+  std::printf("%-28s %-5s %8s %10s %10s %12s %12s %10s %12s\n", "model", "mode", "Mpixel", "RGBA(MB)",
+    "comp(MB)", "scalar(ms)", "simd(ms)", "Mpixel/s", "threads(ms)");
+
+  for (const std::string& name : models)
+  {
+    tinygltf::Model model;
+    std::string err;
+    if (!load_with(false, &model, "test_models/" + name, &err) || !decode_images(model, pool, &err))
+    {
+      std::printf("%-28s failed to load: %s\n", name.c_str(), err.c_str());
+      continue;
+    }
+    if (model.images.empty())
+      continue;
+
+    size_t pixels = 0, rgba_bytes = 0;
+    for (const tinygltf::Image& image : model.images)
+    {
+      pixels += size_t(image.width) * image.height;
+      rgba_bytes += uncompressed_texture_bytes(image.width, image.height);
+    }
+
+    for (TextureCompression mode : modes)
+    {
+      std::vector<CompressedTexture> scalar(model.images.size()), simd(model.images.size());
+
+      texture_compressor_use_simd(false);
+      bench_clock::time_point begin = bench_clock::now();
+      for (size_t i = 0; i < model.images.size(); ++i)
+        compress_texture(model.images[i], mode, &scalar[i]);
+      double scalar_ms = elapsed_ms(begin);
+
+      texture_compressor_use_simd(true);
+      begin = bench_clock::now();
+      for (size_t i = 0; i < model.images.size(); ++i)
+        compress_texture(model.images[i], mode, &simd[i]);
+      double simd_ms = elapsed_ms(begin);
+
+      begin = bench_clock::now();
+      pool.parallel_for(model.images.size(), [&](size_t i) {
+        CompressedTexture texture;
+        compress_texture(model.images[i], mode, &texture);
+      });
+      double threads_ms = elapsed_ms(begin);
+
+      // SIMD 경로는 스칼라와 같은 결과를 내야 한다.
+      size_t comp_bytes = 0;
+      bool same = true;
+      for (size_t i = 0; i < model.images.size(); ++i)
+      {
+        comp_bytes += simd[i].size();
+        for (size_t l = 0; l < simd[i].levels.size() && same; ++l)
+          same = simd[i].levels[l].data == scalar[i].levels[l].data;
+      }
+
+      std::printf("%-28s %-5s %8.2f %10.2f %10.2f %12.2f %12.2f %10.2f %12.2f%s\n", name.c_str(),
+        texture_compression_name(mode), pixels / 1e6, rgba_bytes / 1048576.0, comp_bytes / 1048576.0,
+        scalar_ms, simd_ms, simd_ms > 0.0 ? pixels / (simd_ms * 1000.0) : 0.0, threads_ms,
+        same ? "" : "  (SIMD/scalar mismatch)");
+    }
+  }
+  std::printf("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// KTX2: JPEG/PNG 디코딩과 (미리 압축해 둔) KTX2 읽기의 로딩 시간, 파일 크기, VRAM
+////////////////////////////////////////////////////////////////////////////////
+static void bench_ktx2(const std::vector<std::string>& models, unsigned int num_threads)
+{
+  static const TextureCompression modes[] = { TEXTURE_COMPRESSION_BC, TEXTURE_COMPRESSION_BC7, TEXTURE_COMPRESSION_ETC2 };
+  const unsigned all_codecs = ~0u;
+
+  ThreadPool pool(num_threads);
+  std::printf("[ktx2] %u threads, KTX2는 mip chain 포함 (JPEG/PNG는 GL이 mip chain을 만든다고 보고 VRAM에 포함)\n", num_threads);
+  std::printf("%-28s %-10s %10s %10s %10s\n", "model", "images", "file(MB)", "load(ms)", "VRAM(MB)");
+
+  for (const std::string& name : models)
+  {
+    tinygltf::Model model;
+    std::string err;
+    if (!load_with(false, &model, "test_models/" + name, &err))
+    {
+      std::printf("%-28s failed to load: %s\n", name.c_str(), err.c_str());
+      continue;
+    }
+    if (model.images.empty())
+      continue;
+
+    // JPEG/PNG 디코딩
+    std::vector<tinygltf::Image> decoded = model.images;
+    size_t encoded_bytes = 0, rgba_bytes = 0;
+    for (const tinygltf::Image& image : model.images)
+      encoded_bytes += image.image.size();
+
+    bench_clock::time_point begin = bench_clock::now();
+    pool.parallel_for(decoded.size(), [&](size_t i) {
+      std::string decode_err;
+      decode_image(decoded[i], int(i), &decode_err);
+    });
+    double decode_ms = elapsed_ms(begin);
+    for (const tinygltf::Image& image : decoded)
+      rgba_bytes += uncompressed_texture_bytes(image.width, image.height);
+
+    std::printf("%-28s %-10s %10.2f %10.2f %10.2f\n", name.c_str(), "jpeg/png",
+      encoded_bytes / 1048576.0, decode_ms, rgba_bytes / 1048576.0);
+
+    for (TextureCompression mode : modes)
+    {
+      // 압축 결과를 KTX2 파일로 만들어 인코딩된 이미지 자리에 넣는다.
+      std::vector<tinygltf::Image> ktx2(decoded.size());
+      size_t ktx2_bytes = 0;
+      pool.parallel_for(decoded.size(), [&](size_t i) {
+        CompressedTexture texture;
+        if (compress_texture(decoded[i], mode, &texture))
+          write_ktx2(texture, &ktx2[i].image);
+        ktx2[i].as_is = true;
+      });
+      for (const tinygltf::Image& image : ktx2)
+        ktx2_bytes += image.image.size();
+
+      std::vector<CompressedTexture> textures(ktx2.size());
+      begin = bench_clock::now();
+      pool.parallel_for(ktx2.size(), [&](size_t i) {
+        std::string ktx2_err;
+        decode_ktx2_image(ktx2[i], all_codecs, &textures[i], &ktx2_err);
+      });
+      double load_ms = elapsed_ms(begin);
+
+      size_t gpu_bytes = 0;
+      for (const CompressedTexture& texture : textures)
+        gpu_bytes += texture.size();
+
+      std::printf("%-28s %-10s %10.2f %10.2f %10.2f\n", name.c_str(),
+        (std::string("ktx2 ") + texture_compression_name(mode)).c_str(),
+        ktx2_bytes / 1048576.0, load_ms, gpu_bytes / 1048576.0);
+    }
+  }
+  std::printf("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// CPU mip 생성: 스칼라 vs SIMD vs 스레드, 선형 공간 면적 평균 대비 PSNR
+////////////////////////////////////////////////////////////////////////////////
+static void bench_mips(const std::vector<std::string>& models, unsigned int num_threads)
+{
+  // "gamma box"는 sRGB를 무시하고 저장된 값을 평균한다. (glGenerateMipmap, 기존 압축 경로와 같은 방식)
+  struct Variant { const char* name; MipFilter filter; bool srgb; };
+  static const Variant variants[] = {
+    { "gamma box", MIP_FILTER_BOX, false }, { "box", MIP_FILTER_BOX, true }, { "kaiser", MIP_FILTER_KAISER, true },
+  };
+
+  ThreadPool pool(num_threads);
+  std::printf("[mips] SIMD = %s, %u threads (PSNR: 4x4 이상 level의 평균, 참값은 sRGB 이미지면 선형 공간 평균)\n",
+    mip_generator_impl_name(), num_threads);
+  std::printf("%-28s %-10s %8s %6s %12s %12s %10s %12s %9s\n", "model", "filter", "Mpixel", "sRGB",
+    "scalar(ms)", "simd(ms)", "Mpixel/s", "threads(ms)", "PSNR(dB)");
+
+  for (const std::string& name : models)
+  {
+    tinygltf::Model model;
+    std::string err;
+    if (!load_with(false, &model, "test_models/" + name, &err) || !decode_images(model, pool, &err))
+    {
+      std::printf("%-28s failed to load: %s\n", name.c_str(), err.c_str());
+      continue;
+    }
+    if (model.images.empty())
+      continue;
+
+    const std::vector<bool> srgb = srgb_images(model);
+    std::vector<std::vector<unsigned char>> rgba(model.images.size());
+    size_t pixels = 0, srgb_count = 0;
+    for (size_t i = 0; i < model.images.size(); ++i)
+    {
+      convert_to_rgba8(model.images[i], &rgba[i]);
+      pixels += size_t(model.images[i].width) * model.images[i].height;
+      srgb_count += srgb[i] ? 1 : 0;
+    }
+
+    for (const Variant& v : variants)
+    {
+      std::vector<std::vector<MipLevel>> scalar(model.images.size()), simd(model.images.size());
+      auto generate = [&](size_t i, std::vector<MipLevel>* out) {
+        if (!rgba[i].empty())
+          generate_mip_chain(&rgba[i][0], model.images[i].width, model.images[i].height, v.filter, v.srgb && srgb[i], out);
+      };
+
+      mip_generator_use_simd(false);
+      bench_clock::time_point begin = bench_clock::now();
+      for (size_t i = 0; i < model.images.size(); ++i)
+        generate(i, &scalar[i]);
+      double scalar_ms = elapsed_ms(begin);
+
+      mip_generator_use_simd(true);
+      begin = bench_clock::now();
+      for (size_t i = 0; i < model.images.size(); ++i)
+        generate(i, &simd[i]);
+      double simd_ms = elapsed_ms(begin);
+
+      begin = bench_clock::now();
+      pool.parallel_for(model.images.size(), [&](size_t i) {
+        std::vector<MipLevel> levels;
+        generate(i, &levels);
+      });
+      double threads_ms = elapsed_ms(begin);
+
+      // SIMD 경로는 스칼라와 같은 결과를 내야 한다.
+      bool same = true;
+      double psnr = 0.0;
+      int levels = 0;
+      MipLevel reference;
+      for (size_t i = 0; i < model.images.size(); ++i)
+      {
+        for (size_t l = 0; l < simd[i].size() && same; ++l)
+          same = simd[i][l].data == scalar[i][l].data;
+        for (size_t l = 1; l < simd[i].size() && simd[i][l].width >= 4 && simd[i][l].height >= 4; ++l)
+        {
+          reference_mip_level(&rgba[i][0], model.images[i].width, model.images[i].height, int(l), srgb[i], &reference);
+          psnr += mip_level_psnr(simd[i][l], reference);
+          ++levels;
+        }
+      }
+
+      const std::string srgb_column = std::to_string(srgb_count) + "/" + std::to_string(model.images.size());
+      std::printf("%-28s %-10s %8.2f %6s %12.2f %12.2f %10.2f %12.2f %9.2f%s\n", name.c_str(), v.name,
+        pixels / 1e6, srgb_column.c_str(), scalar_ms, simd_ms, simd_ms > 0.0 ? pixels / (simd_ms * 1000.0) : 0.0,
+        threads_ms, levels > 0 ? psnr / levels : 0.0, same ? "" : "  (SIMD/scalar mismatch)");
+    }
+  }
+  std::printf("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// 텍스처 streaming: 카메라가 합성 씬을 지나가는 동안 budget과 요청 level이 지켜지는지
+////////////////////////////////////////////////////////////////////////////////
+static bool bench_stream()
+{
+  // z축을 따라 4 간격으로 놓인 물체 64개. 물체마다 256 ~ 4096 RGBA8 텍스처 하나 (2x2 면에 UV 0 ~ 1)
+  const int num_objects = 64;
+  const int num_frames = 1200;
+  const float pixels_per_unit = 1.0f / std::tan(35.0f * 3.14159265f / 180.0f) * 500.0f * 0.5f;   // fovy 70, 높이 500
+  const size_t upload_budget = 8 * 1024 * 1024;
+  const size_t budgets_mb[] = { 16, 64, 256 };
+
+  std::vector<int> sizes(num_objects);
+  std::vector<std::vector<size_t>> level_bytes(num_objects);
+  for (int k = 0; k < num_objects; ++k)
+  {
+    sizes[k] = 256 << (k % 5);
+    for (int s = sizes[k]; ; s = std::max(1, s / 2))
+    {
+      level_bytes[k].push_back(uncompressed_texture_bytes(s, s));
+      if (s == 1)
+        break;
+    }
+  }
+
+  std::printf("[stream] %d textures, %d frames, upload %zu MB/frame\n", num_objects, num_frames, upload_budget >> 20);
+  std::printf("%10s %12s %10s %12s %10s %10s %10s %12s %10s\n", "budget(MB)", "resident(MB)", "tails(MB)",
+    "all(MB)", "wanted(%)", "loads", "evictions", "loaded(MB)", "update(us)");
+
+  bool ok = true;
+  for (size_t budget_mb : budgets_mb)
+  {
+    TextureStreamer streamer(budget_mb * 1048576);
+    std::vector<int> levels(num_objects);         // 변경 목록으로 따라가는 상주 level
+    for (int k = 0; k < num_objects; ++k)
+      levels[k] = streamer.add_texture(unsigned(k), sizes[k], sizes[k], level_bytes[k]);
+
+    std::vector<TextureStreamChange> changes;
+    std::vector<int> requested(num_objects);
+    size_t max_resident = 0, wanted = 0, drawn = 0;
+    double update_ms = 0.0;
+    std::string error;
+
+    for (int frame = 0; frame < num_frames && error.empty(); ++frame)
+    {
+      // 카메라는 z = 10에서 -260까지 갔다가 돌아온다. 앞쪽 100 안에 있는 물체만 그린다.
+      const float t = float(frame) / (num_frames / 2);
+      const float camera_z = 10.0f - 270.0f * (t < 1.0f ? t : 2.0f - t);
+      for (int k = 0; k < num_objects; ++k)
+      {
+        const float distance = camera_z - (-4.0f * k) - 1.0f;
+        requested[k] = -1;
+        if (distance < -1.0f || distance > 100.0f)
+          continue;
+        requested[k] = texture_mip_demand(sizes[k] * 0.5f, distance, pixels_per_unit);
+        streamer.request(unsigned(k), requested[k]);
+      }
+
+      const std::vector<int> before = levels;
+      bench_clock::time_point begin = bench_clock::now();
+      streamer.update(upload_budget, &changes);
+      update_ms += elapsed_ms(begin);
+
+      size_t loaded = 0, largest = 0;
+      for (const TextureStreamChange& c : changes)
+      {
+        if (c.old_level != levels[c.id])
+          error = "change does not start from the resident level";
+        for (int l = c.new_level; l < c.old_level; ++l)
+        {
+          loaded += level_bytes[c.id][l];
+          largest = std::max(largest, level_bytes[c.id][l]);
+        }
+        levels[c.id] = c.new_level;
+      }
+
+      // 불변식: budget (tail은 예외), 따라간 level과 streamer의 일치, 그리는 텍스처를 필요한 level 아래로 내리지 않음
+      const TextureStreamerStats& st = streamer.stats();
+      size_t resident = 0;
+      for (int k = 0; k < num_objects; ++k)
+      {
+        for (size_t l = levels[k]; l < level_bytes[k].size(); ++l)
+          resident += level_bytes[k][l];
+        if (levels[k] != streamer.resident_level(unsigned(k)))
+          error = "resident level mismatch";
+        if (requested[k] >= 0 && levels[k] > std::max(before[k], requested[k]))
+          error = "evicted a drawn texture below its wanted level";
+        if (requested[k] >= 0)
+        {
+          ++drawn;
+          wanted += (levels[k] <= requested[k]) ? 1 : 0;
+        }
+      }
+      if (resident != st.resident_bytes)
+        error = "resident bytes mismatch";
+      if (resident > std::max(st.budget, st.tail_bytes))
+        error = "over budget";
+      if (loaded > upload_budget + largest)
+        error = "over upload budget";
+      max_resident = std::max(max_resident, resident);
+      if (!error.empty())
+        error += " (frame " + std::to_string(frame) + ")";
+    }
+
+    const TextureStreamerStats& st = streamer.stats();
+    std::printf("%10zu %12.2f %10.2f %12.2f %10.1f %10zu %10zu %12.2f %10.2f%s%s\n", budget_mb, max_resident / 1048576.0,
+      st.tail_bytes / 1048576.0, st.full_bytes / 1048576.0, drawn > 0 ? 100.0 * wanted / drawn : 0.0, st.loads,
+      st.evictions, st.loaded_bytes / 1048576.0, update_ms * 1000.0 / num_frames, error.empty() ? "" : "  FAIL: ",
+      error.c_str());
+    ok = ok && error.empty();
+  }
+  std::printf("\n");
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// animation: LINEAR clip과 그것을 STEP/CUBICSPLINE으로 바꾼 clip을 cursor/이진 탐색/스레드로 샘플링
+////////////////////////////////////////////////////////////////////////////////
+// key 값 사이의 기울기(Catmull-Rom)를 tangent로 넣어 CUBICSPLINE channel을 만든다.
+static AnimationChannel to_cubicspline(const AnimationChannel& channel)
+{
+  AnimationChannel cubic = channel;
+  cubic.interpolation = ANIMATION_CUBICSPLINE;
+  const int n = channel.components;
+  const size_t keys = channel.times.size();
+  cubic.values.assign(keys * 3 * n, 0.0f);
+  for (size_t k = 0; k < keys; ++k)
+  {
+    const size_t prev = (k > 0) ? k - 1 : k, next = (k + 1 < keys) ? k + 1 : k;
+    const float dt = channel.times[next] - channel.times[prev];
+    for (int c = 0; c < n; ++c)
+    {
+      const float slope = (dt > 0.0f) ? (channel.values[next * n + c] - channel.values[prev * n + c]) / dt : 0.0f;
+      cubic.values[(k * 3 + 0) * n + c] = slope;
+      cubic.values[(k * 3 + 1) * n + c] = channel.values[k * n + c];
+      cubic.values[(k * 3 + 2) * n + c] = slope;
+    }
+  }
+  return cubic;
+}
+
+static float max_pose_difference(const AnimationPose& a, const AnimationPose& b)
+{
+  float diff = 0.0f;
+  for (size_t i = 0; i < a.translations.size(); ++i)
+    diff = std::max(diff, std::fabs(a.translations[i] - b.translations[i]));
+  for (size_t i = 0; i < a.rotations.size(); ++i)
+    diff = std::max(diff, std::fabs(a.rotations[i] - b.rotations[i]));
+  for (size_t i = 0; i < a.scales.size(); ++i)
+    diff = std::max(diff, std::fabs(a.scales[i] - b.scales[i]));
+  for (size_t i = 0; i < a.weights.size(); ++i)
+    diff = std::max(diff, std::fabs(a.weights[i] - b.weights[i]));
+  return diff;
+}
+
+static bool bench_animation(const std::vector<std::string>& models, unsigned int num_threads)
+{
+  const size_t num_instances = 4096;
+  const int num_frames = 60;
+  const float frame_seconds = 1.0f / 60.0f;
+  static const char* interpolation_names[] = { "LINEAR", "STEP", "CUBIC" };
+
+  std::printf("[animation] %zu instances x %d frames, %u threads\n", num_instances, num_frames, num_threads);
+  std::printf("%-28s %-7s %9s %7s %12s %12s %12s %10s %10s\n", "model", "interp", "channels", "keys", "search(ms)",
+    "cursor(ms)", "threads(ms)", "Mch/s", "max diff");
+
+  ThreadPool pool(num_threads);
+  bool ok = true;
+  for (const std::string& name : models)
+  {
+    tinygltf::Model model;
+    std::string err;
+    if (!load_with(false, &model, "test_models/" + name, &err))
+    {
+      std::printf("%-28s load failed: %s\n", name.c_str(), err.c_str());
+      continue;
+    }
+    if (model.animations.empty())
+      continue;
+
+    std::vector<AnimationClip> clips;
+    if (!build_animation_clips(model, &clips, &err))
+      std::printf("%-28s %s\n", name.c_str(), err.c_str());
+    if (clips.empty() || clips[0].channels.empty())
+      continue;
+
+    AnimationPose rest;
+    init_animation_pose(model, &rest);
+
+    for (int mode = ANIMATION_LINEAR; mode <= ANIMATION_CUBICSPLINE; ++mode)
+    {
+      AnimationClip clip = clips[0];
+      for (AnimationChannel& channel : clip.channels)
+      {
+        if (mode == ANIMATION_STEP)
+          channel.interpolation = ANIMATION_STEP;
+        else if (mode == ANIMATION_CUBICSPLINE && channel.interpolation != ANIMATION_CUBICSPLINE)
+          channel = to_cubicspline(channel);
+      }
+
+      // 검증: 세 번 반복 재생하는 동안 cursor와 이진 탐색이 같은 pose를 내는지, key 시각에서 key 값을 지나는지
+      std::string error;
+      float max_diff = 0.0f;
+      AnimationInstance single;
+      single.pose = rest;
+      AnimationPose reference = rest;
+      const float length = std::max(clip.end - clip.start, frame_seconds);
+      const int check_frames = int(3.0f * length / frame_seconds) + 1;
+      for (int f = 0; f < check_frames; ++f)
+      {
+        single.time = wrap_animation_time(clip, clip.start + f * frame_seconds);
+        sample_animation(clip, single.time, &single.cursors, &single.pose);
+        sample_animation(clip, single.time, nullptr, &reference);
+        max_diff = std::max(max_diff, max_pose_difference(single.pose, reference));
+      }
+      if (max_diff != 0.0f)
+        error = "cursor and binary search differ";
+      for (const AnimationChannel& channel : clip.channels)
+      {
+        const int n = channel.components;
+        const size_t stride = (channel.interpolation == ANIMATION_CUBICSPLINE) ? 3 * n : n;
+        const size_t offset = (channel.interpolation == ANIMATION_CUBICSPLINE) ? n : 0;
+        for (size_t k = 0; k < channel.times.size() && channel.path != ANIMATION_WEIGHTS; ++k)
+        {
+          sample_animation(clip, channel.times[k], nullptr, &reference);
+          const float* out = (channel.path == ANIMATION_TRANSLATION) ? &reference.translations[channel.node * 3] :
+            (channel.path == ANIMATION_ROTATION) ? &reference.rotations[channel.node * 4] : &reference.scales[channel.node * 3];
+          for (int c = 0; c < n; ++c)
+          {
+            // slerp/cubic은 정규화하므로 rotation은 작은 오차를 허용
+            if (std::fabs(out[c] - channel.values[k * stride + offset + c]) > 1e-4f)
+              error = "key value mismatch";
+          }
+        }
+      }
+
+      // 측정: instance마다 재생 위치를 다르게 두고 프레임마다 전부 샘플링한다.
+      std::vector<AnimationInstance> instances(num_instances);
+      for (size_t i = 0; i < num_instances; ++i)
+      {
+        instances[i].time = wrap_animation_time(clip, clip.start + length * i / num_instances);
+        instances[i].pose = rest;
+      }
+
+      double search_ms = 0.0, cursor_ms = 0.0, threads_ms = 0.0;
+      for (int pass = 0; pass < 3; ++pass)
+      {
+        std::vector<AnimationInstance> run = instances;
+        bench_clock::time_point begin = bench_clock::now();
+        for (int f = 0; f < num_frames; ++f)
+        {
+          for (AnimationInstance& instance : run)
+          {
+            instance.time = wrap_animation_time(clip, instance.time + frame_seconds);
+            if (pass == 0)
+              sample_animation(clip, instance.time, nullptr, &instance.pose);
+            else if (pass == 1)
+              sample_animation(clip, instance.time, &instance.cursors, &instance.pose);
+          }
+          if (pass == 2)
+            sample_animation_instances(clip, run, pool);
+        }
+        double ms = elapsed_ms(begin) / num_frames;
+        (pass == 0 ? search_ms : pass == 1 ? cursor_ms : threads_ms) = ms;
+      }
+
+      const double channels_per_frame = double(num_instances) * clip.channels.size();
+      std::printf("%-28s %-7s %9zu %7zu %12.3f %12.3f %12.3f %10.1f %10.2g%s%s\n", name.c_str(),
+        interpolation_names[mode], clip.channels.size(), clip.num_keys(), search_ms, cursor_ms, threads_ms,
+        channels_per_frame / (threads_ms * 1000.0), max_diff, error.empty() ? "" : "  FAIL: ", error.c_str());
+      ok = ok && error.empty();
+    }
+  }
+  std::printf("\n");
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// skinning: clip을 재생하며 joint palette를 scalar/SSE로 계산하고, 그 palette로 CPU에서 정점을 skinning
+////////////////////////////////////////////////////////////////////////////////
+static bool bench_skinning(const std::vector<std::string>& models)
+{
+  const int num_poses = 256;
+  const int palette_repeats = 64;
+
+  std::printf("[skinning] %d poses, palette %s\n", num_poses, skinning_impl_name());
+  std::printf("%-28s %7s %7s %9s %12s %12s %10s %10s %12s %10s %10s\n", "model", "skins", "joints", "vertices",
+    "scalar(ms)", "simd(ms)", "Mjoint/s", "max diff", "vertex(ms)", "Mvert/s", "bind diff");
+
+  bool ok = true;
+  for (const std::string& name : models)
+  {
+    tinygltf::Model model;
+    std::string err;
+    if (!load_with(false, &model, "test_models/" + name, &err))
+    {
+      std::printf("%-28s load failed: %s\n", name.c_str(), err.c_str());
+      continue;
+    }
+    if (model.skins.empty())
+      continue;
+
+    std::vector<SkinPalette> palettes;
+    if (!build_skin_palettes(model, &palettes, &err))
+      std::printf("%-28s %s\n", name.c_str(), err.c_str());
+    if (palettes.empty())
+      continue;
+    std::vector<AnimationClip> clips;
+    build_animation_clips(model, &clips, &err);
+
+    NodeHierarchy hierarchy;
+    build_node_hierarchy(model, &hierarchy);
+    AnimationPose rest;
+    init_animation_pose(model, &rest);
+
+    // clip 전체에 고르게 놓은 pose (clip이 없으면 rest pose만)
+    std::vector<AnimationPose> poses(num_poses, rest);
+    if (!clips.empty())
+    {
+      const AnimationClip& clip = clips[0];
+      for (int p = 0; p < num_poses; ++p)
+        sample_animation(clip, clip.start + (clip.end - clip.start) * p / num_poses, nullptr, &poses[p]);
+    }
+
+    size_t num_joints = 0;
+    for (const SkinPalette& palette : palettes)
+      num_joints += palette.joints.size();
+
+    // palette: node 변환부터 joint 행렬까지. 두 구현의 마지막 pose 결과를 비교한다.
+    double palette_ms[2] = { 0.0, 0.0 };
+    std::vector<float> world;
+    std::vector<std::vector<float>> last[2];
+    for (int simd = 0; simd < 2; ++simd)
+    {
+      skinning_use_simd(simd == 1);
+      bench_clock::time_point begin = bench_clock::now();
+      for (int r = 0; r < palette_repeats; ++r)
+      {
+        for (const AnimationPose& pose : poses)
+        {
+          compute_world_matrices(model, hierarchy, pose, &world);
+          for (SkinPalette& palette : palettes)
+            compute_joint_matrices(world, &palette);
+        }
+      }
+      palette_ms[simd] = elapsed_ms(begin);
+      for (const SkinPalette& palette : palettes)
+        last[simd].push_back(palette.matrices);
+    }
+    skinning_use_simd(true);
+    float max_diff = 0.0f;
+    for (size_t i = 0; i < palettes.size(); ++i)
+      for (size_t k = 0; k < last[0][i].size(); ++k)
+        max_diff = std::max(max_diff, std::fabs(last[0][i][k] - last[1][i][k]));
+
+    // 정점: skinned primitive 전부를 pose마다 skinning
+    std::vector<std::pair<const SkinPalette*, SkinnedVertices>> inputs;
+    size_t num_vertices = 0;
+    for (const SkinPalette& palette : palettes)
+    {
+      for (const tinygltf::Primitive& primitive : model.meshes[model.nodes[palette.node].mesh].primitives)
+      {
+        SkinnedVertices vertices;
+        if (!read_skinned_vertices(model, primitive, &vertices))
+          continue;
+        num_vertices += vertices.size();
+        inputs.push_back(std::make_pair(&palette, vertices));
+      }
+    }
+
+    // rest pose의 skinning이 원래 정점에서 얼마나 벗어나는지 (inverseBindMatrices가 rest pose와 맞지 않는 모델도 있어 참고용)
+    float bind_diff = 0.0f;
+    std::vector<float> positions, normals;
+    compute_world_matrices(model, hierarchy, rest, &world);
+    for (SkinPalette& palette : palettes)
+      compute_joint_matrices(world, &palette);
+    for (const std::pair<const SkinPalette*, SkinnedVertices>& input : inputs)
+    {
+      skin_vertices_reference(input.second, &input.first->matrices[0], input.first->joints.size(), &positions, &normals);
+      for (size_t k = 0; k < positions.size(); ++k)
+        bind_diff = std::max(bind_diff, std::fabs(positions[k] - input.second.positions[k]));
+    }
+
+    const int vertex_poses = 16;
+    bench_clock::time_point begin = bench_clock::now();
+    for (int p = 0; p < vertex_poses; ++p)
+    {
+      compute_world_matrices(model, hierarchy, poses[p * num_poses / vertex_poses], &world);
+      for (SkinPalette& palette : palettes)
+        compute_joint_matrices(world, &palette);
+      for (const std::pair<const SkinPalette*, SkinnedVertices>& input : inputs)
+        skin_vertices_reference(input.second, &input.first->matrices[0], input.first->joints.size(), &positions, &normals);
+    }
+    const double vertex_ms = elapsed_ms(begin) / vertex_poses;
+
+    const double palette_updates = double(palette_repeats) * num_poses;
+    const bool same = max_diff <= 1e-5f;
+    std::printf("%-28s %7zu %7zu %9zu %12.4f %12.4f %10.1f %10.2g %12.3f %10.1f %10.2g%s\n", name.c_str(),
+      palettes.size(), num_joints, num_vertices, palette_ms[0] / palette_updates, palette_ms[1] / palette_updates,
+      palette_updates * num_joints / (palette_ms[1] * 1000.0), max_diff, vertex_ms,
+      num_vertices / (vertex_ms * 1000.0), bind_diff, same ? "" : "  FAIL: scalar and SIMD palettes differ");
+    ok = ok && same;
+  }
+  std::printf("\n");
+  return ok;
+}
+
+// instance마다 clip의 다른 시각을 재생하며, 프레임마다 palette를 계산하고 모든 primitive를 skinning해서 한 buffer에 쓴다.
+// (final_lab --cpu-skinning이 매핑한 buffer에 쓰는 것과 같은 경로)
+static bool bench_skinning_instances(const std::vector<std::string>& models, unsigned int max_threads)
+{
+  const size_t num_instances = 100;
+  const int num_frames = 10;
+
+  std::printf("[skinning x %zu instances] %d frames, %s\n", num_instances, num_frames, skinning_impl_name());
+  std::printf("%-28s %-10s %8s %10s %10s %10s %10s %10s\n", "model", "path", "threads", "vertices", "ms/frame",
+    "Mvert/s", "max diff", "bounds");
+
+  bool ok = true;
+  for (const std::string& name : models)
+  {
+    tinygltf::Model model;
+    std::string err;
+    if (!load_with(false, &model, "test_models/" + name, &err) || model.skins.empty())
+      continue;
+
+    std::vector<SkinPalette> palettes;
+    build_skin_palettes(model, &palettes, &err);
+    std::vector<AnimationClip> clips;
+    build_animation_clips(model, &clips, &err);
+    if (palettes.empty())
+      continue;
+    NodeHierarchy hierarchy;
+    build_node_hierarchy(model, &hierarchy);
+
+    std::vector<std::pair<size_t, SkinnedVertices>> primitives;   // palette 인덱스, 정점
+    size_t vertices_per_instance = 0;
+    for (size_t p = 0; p < palettes.size(); ++p)
+    {
+      for (const tinygltf::Primitive& primitive : model.meshes[model.nodes[palettes[p].node].mesh].primitives)
+      {
+        SkinnedVertices vertices;
+        if (!read_skinned_vertices(model, primitive, &vertices))
+          continue;
+        vertices_per_instance += vertices.size();
+        primitives.push_back(std::make_pair(p, vertices));
+      }
+    }
+
+    // instance별 pose와 palette (재생 위치를 고르게 나눈다)
+    std::vector<AnimationInstance> instances(num_instances);
+    std::vector<std::vector<SkinPalette>> instance_palettes(num_instances, palettes);
+    std::vector<float> world;
+    for (size_t i = 0; i < num_instances; ++i)
+    {
+      init_animation_pose(model, &instances[i].pose);
+      if (!clips.empty())
+      {
+        const AnimationClip& clip = clips[0];
+        instances[i].time = clip.start + (clip.end - clip.start) * i / num_instances;
+      }
+    }
+
+    const size_t total_vertices = vertices_per_instance * num_instances;
+    std::vector<float> output(total_vertices * SKINNED_VERTEX_FLOATS);
+    std::vector<SkinJob> jobs;
+    for (size_t i = 0; i < num_instances; ++i)
+    {
+      for (const std::pair<size_t, SkinnedVertices>& primitive : primitives)
+      {
+        SkinJob job;
+        job.vertices = &primitive.second;
+        job.joint_matrices = nullptr;   // 프레임마다 palette를 계산한 뒤 채운다.
+        job.num_joints = palettes[primitive.first].joints.size();
+        jobs.push_back(job);
+      }
+    }
+    for (size_t j = 0, offset = 0; j < jobs.size(); ++j)
+    {
+      jobs[j].out = &output[offset];
+      offset += jobs[j].vertices->size() * SKINNED_VERTEX_FLOATS;
+    }
+
+    // 한 프레임: 재생 시각을 진행하고 pose, palette를 갱신한다. (skinning 경로와 상관없는 부분)
+    auto update_palettes = [&](float seconds) {
+      for (size_t i = 0; i < num_instances; ++i)
+      {
+        AnimationInstance& instance = instances[i];
+        if (!clips.empty())
+        {
+          instance.time = wrap_animation_time(clips[0], instance.time + seconds);
+          sample_animation(clips[0], instance.time, &instance.cursors, &instance.pose);
+        }
+        compute_world_matrices(model, hierarchy, instance.pose, &world);
+        for (SkinPalette& palette : instance_palettes[i])
+          compute_joint_matrices(world, &palette);
+      }
+      for (size_t j = 0; j < jobs.size(); ++j)
+      {
+        const size_t i = j / primitives.size();
+        jobs[j].joint_matrices = &instance_palettes[i][primitives[j % primitives.size()].first].matrices[0];
+      }
+    };
+
+    // 검증: 첫 프레임을 기준 구현과 비교하고, bounds가 쓴 position을 모두 담는지 본다.
+    update_palettes(0.0f);
+    ThreadPool check_pool(max_threads);
+    skin_vertices_jobs(jobs, check_pool);
+    float max_diff = 0.0f;
+    bool bounds_ok = true;
+    std::vector<float> positions, normals;
+    for (const SkinJob& job : jobs)
+    {
+      skin_vertices_reference(*job.vertices, job.joint_matrices, job.num_joints, &positions, &normals);
+      for (size_t v = 0; v < job.vertices->size(); ++v)
+      {
+        const float* out = job.out + v * SKINNED_VERTEX_FLOATS;
+        for (int c = 0; c < 3; ++c)
+        {
+          max_diff = std::max(max_diff, std::fabs(out[c] - positions[v * 3 + c]));
+          if (!normals.empty())
+            max_diff = std::max(max_diff, std::fabs(out[3 + c] - normals[v * 3 + c]));
+          bounds_ok = bounds_ok && out[c] >= job.bounds.min[c] && out[c] <= job.bounds.max[c];
+        }
+      }
+    }
+    const bool same = max_diff <= 1e-4f;
+    ok = ok && same && bounds_ok;
+
+    // 측정: 기준 구현(한 스레드), scalar/SIMD skin_vertices(한 스레드), SIMD를 1 ~ max_threads 스레드로
+    // (기준 구현은 primitive 하나 크기의 출력 배열을 다시 쓰므로 캐시에 남고, 나머지는 전체 buffer에 쓴다)
+    struct Path { const char* name; bool simd; unsigned threads; bool reference; };
+    std::vector<Path> paths;
+    paths.push_back(Path{ "reference", false, 1, true });
+    paths.push_back(Path{ "scalar", false, 1, false });
+    for (unsigned t = 1; t <= max_threads; t *= 2)
+      paths.push_back(Path{ "simd", true, t, false });
+    if ((max_threads & (max_threads - 1)) != 0)
+      paths.push_back(Path{ "simd", true, max_threads, false });
+
+    for (const Path& path : paths)
+    {
+      skinning_use_simd(path.simd);
+      ThreadPool pool(path.threads);
+      double skin_ms = 0.0;
+      for (int f = 0; f < num_frames; ++f)
+      {
+        update_palettes(1.0f / 60.0f);
+        bench_clock::time_point begin = bench_clock::now();
+        if (path.reference)
+        {
+          for (const SkinJob& job : jobs)
+            skin_vertices_reference(*job.vertices, job.joint_matrices, job.num_joints, &positions, &normals);
+        }
+        else if (path.threads == 1)
+        {
+          for (SkinJob& job : jobs)
+            skin_vertices(*job.vertices, job.joint_matrices, job.num_joints, job.out, &job.bounds);
+        }
+        else
+          skin_vertices_jobs(jobs, pool);
+        skin_ms += elapsed_ms(begin);
+      }
+      skin_ms /= num_frames;
+      std::printf("%-28s %-10s %8u %10zu %10.2f %10.1f %10.2g %10s%s\n", name.c_str(), path.reference ? path.name :
+        skinning_impl_name(), path.threads, total_vertices, skin_ms, total_vertices / (skin_ms * 1000.0), max_diff,
+        bounds_ok ? "ok" : "FAIL", same ? "" : "  FAIL: CPU skinning differs from the reference");
+    }
+    skinning_use_simd(true);
+  }
+  std::printf("\n");
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// morph target: 합성 mesh의 dense/sparse target을 스트림으로 풀어 dense 기준 구현과 비교
+////////////////////////////////////////////////////////////////////////////////
+
+static int add_morph_view(tinygltf::Model& model, const void* data, size_t bytes)
+{
+  if (model.buffers.empty())
+    model.buffers.resize(1);
+  std::vector<unsigned char>& buffer = model.buffers[0].data;
+  tinygltf::BufferView view;
+  view.buffer = 0;
+  view.byteOffset = buffer.size();
+  view.byteLength = bytes;
+  buffer.insert(buffer.end(), static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + bytes);
+  model.bufferViews.push_back(view);
+  return int(model.bufferViews.size() - 1);
+}
+
+// values(정점 * 3)를 kind에 따라 accessor로 넣는다. 0: dense, 1: bufferView 없는 sparse, 2: base bufferView 위에 sparse
+static int add_morph_accessor(tinygltf::Model& model, const std::vector<float>& values, int kind,
+  const std::vector<float>& base)
+{
+  tinygltf::Accessor accessor;
+  accessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+  accessor.type = TINYGLTF_TYPE_VEC3;
+  accessor.count = values.size() / 3;
+  accessor.byteOffset = 0;
+  accessor.normalized = false;
+  if (kind == 0)
+    accessor.bufferView = add_morph_view(model, &values[0], values.size() * sizeof(float));
+  else
+  {
+    // base와 다른 원소만 sparse로
+    std::vector<uint32_t> indices;
+    std::vector<float> sparse_values;
+    for (size_t i = 0; i < accessor.count; ++i)
+    {
+      const float* v = &values[i * 3];
+      const float* b = (kind == 2) ? &base[i * 3] : nullptr;
+      if (b ? (v[0] != b[0] || v[1] != b[1] || v[2] != b[2]) : (v[0] != 0.0f || v[1] != 0.0f || v[2] != 0.0f))
+      {
+        indices.push_back(uint32_t(i));
+        sparse_values.insert(sparse_values.end(), v, v + 3);
+      }
+    }
+    if (kind == 2)
+      accessor.bufferView = add_morph_view(model, &base[0], base.size() * sizeof(float));
+    accessor.sparse.isSparse = true;
+    accessor.sparse.count = int(indices.size());
+    accessor.sparse.indices.bufferView = add_morph_view(model, &indices[0], indices.size() * sizeof(uint32_t));
+    accessor.sparse.indices.byteOffset = 0;
+    accessor.sparse.indices.componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
+    accessor.sparse.values.bufferView = add_morph_view(model, &sparse_values[0], sparse_values.size() * sizeof(float));
+    accessor.sparse.values.byteOffset = 0;
+  }
+  model.accessors.push_back(accessor);
+  return int(model.accessors.size() - 1);
+}
+
+// GPU 표를 쉐이더처럼 읽어 섞는다. (정점마다 header를 보고 항목을 더함)
+static void apply_morph_texels(const std::vector<float>& texels, const float* base_positions, const float* base_normals,
+  size_t num_vertices, const float* weights, float* positions, float* normals)
+{
+  for (size_t v = 0; v < num_vertices; ++v)
+  {
+    const float* header = &texels[v * 4];
+    float p[3] = { base_positions[v * 3], base_positions[v * 3 + 1], base_positions[v * 3 + 2] };
+    float n[3] = { base_normals[v * 3], base_normals[v * 3 + 1], base_normals[v * 3 + 2] };
+    for (int k = 0; k < int(header[1]); ++k)
+    {
+      const float* delta = &texels[(size_t(header[0]) + k * 2) * 4];
+      const float w = weights[int(delta[3])];
+      for (int c = 0; c < 3; ++c)
+      {
+        p[c] += w * delta[c];
+        n[c] += w * delta[4 + c];
+      }
+    }
+    std::copy(p, p + 3, positions + v * 3);
+    std::copy(n, n + 3, normals + v * 3);
+  }
+}
+
+static float max_abs_difference(const std::vector<float>& a, const std::vector<float>& b)
+{
+  float diff = (a.size() == b.size()) ? 0.0f : INFINITY;
+  for (size_t i = 0; i < std::min(a.size(), b.size()); ++i)
+    diff = std::max(diff, std::fabs(a[i] - b[i]));
+  return diff;
+}
+
+static bool bench_morph()
+{
+  // 256 x 256 격자, target 16개. target마다 정점의 1/16쯤 되는 띠만 움직인다. (얼굴 blend shape처럼 국소적인 delta)
+  // target t는 t % 3에 따라 dense / bufferView 없는 sparse / base bufferView 위에 sparse로 넣는다.
+  const size_t grid = 256;
+  const size_t num_vertices = grid * grid;
+  const size_t num_targets = 16;
+  const int num_repeats = 20;
+
+  tinygltf::Model model;
+  std::vector<float> positions(num_vertices * 3), normals(num_vertices * 3);
+  for (size_t i = 0; i < num_vertices; ++i)
+  {
+    positions[i * 3] = float(i % grid) / grid;
+    positions[i * 3 + 1] = float(i / grid) / grid;
+    positions[i * 3 + 2] = 0.0f;
+    normals[i * 3 + 2] = 1.0f;
+  }
+  tinygltf::Primitive primitive;
+  primitive.attributes["POSITION"] = add_morph_accessor(model, positions, 0, positions);
+  primitive.attributes["NORMAL"] = add_morph_accessor(model, normals, 0, normals);
+
+  std::vector<std::vector<float>> truth_positions(num_targets), truth_normals(num_targets);
+  for (size_t t = 0; t < num_targets; ++t)
+  {
+    std::vector<float>& dp = truth_positions[t];
+    std::vector<float>& dn = truth_normals[t];
+    dp.assign(num_vertices * 3, 0.0f);
+    dn.assign(num_vertices * 3, 0.0f);
+    std::vector<float> base(num_vertices * 3, 0.0f);
+    for (size_t i = 0; i < num_vertices; ++i)
+    {
+      const size_t row = i / grid;
+      if (row / 16 == t)
+      {
+        const float s = std::sin(float(i) * 0.01f + float(t));
+        dp[i * 3] = 0.01f * (t + 1);
+        dp[i * 3 + 1] = 0.1f * s;
+        dp[i * 3 + 2] = 0.05f + 0.02f * s;
+        dn[i * 3] = 0.2f * s;
+      }
+      // sparse가 덮지 않는 base 값도 결과에 남는다.
+      else if (t % 3 == 2 && (row + t) % 64 == 0)
+      {
+        dp[i * 3 + 2] = base[i * 3 + 2] = -0.03f;
+      }
+    }
+    std::map<std::string, int> target;
+    target["POSITION"] = add_morph_accessor(model, dp, int(t % 3), base);
+    target["NORMAL"] = add_morph_accessor(model, dn, int(t % 3), base);
+    primitive.targets.push_back(target);
+  }
+
+  std::printf("[morph] %zu vertices, %zu targets (dense / sparse / sparse over bufferView), %s\n", num_vertices,
+    num_targets, morph_impl_name());
+
+  // 1. accessor 읽기: read_accessor_floats(sparse를 덮은 dense)와 스트림이 만든 것이 원래 값과 같은지
+  std::string err;
+  MorphTargets targets;
+  bool ok = build_morph_targets(model, primitive, &targets, &err);
+  std::vector<std::vector<float>> dense_positions(num_targets), dense_normals(num_targets);
+  float read_diff = 0.0f, stream_diff = 0.0f;
+  for (size_t t = 0; ok && t < num_targets; ++t)
+  {
+    ok = read_accessor_floats(model, model.accessors[primitive.targets[t]["POSITION"]], &dense_positions[t]) &&
+      read_accessor_floats(model, model.accessors[primitive.targets[t]["NORMAL"]], &dense_normals[t]);
+    read_diff = std::max(read_diff, max_abs_difference(dense_positions[t], truth_positions[t]));
+    read_diff = std::max(read_diff, max_abs_difference(dense_normals[t], truth_normals[t]));
+
+    // 스트림 하나만 weight 1로 더하면 그 target의 delta
+    std::vector<float> zero(num_vertices * 3, 0.0f), out(num_vertices * 3);
+    std::vector<float> one(num_targets, 0.0f);
+    one[t] = 1.0f;
+    apply_morph_targets(&zero[0], num_vertices, targets.positions, &one[0], num_targets, &out[0]);
+    stream_diff = std::max(stream_diff, max_abs_difference(out, truth_positions[t]));
+    apply_morph_targets(&zero[0], num_vertices, targets.normals, &one[0], num_targets, &out[0]);
+    stream_diff = std::max(stream_diff, max_abs_difference(out, truth_normals[t]));
+  }
+  if (!ok)
+  {
+    std::printf("  FAIL: cannot read the synthetic targets %s\n\n", err.c_str());
+    return false;
+  }
+
+  // 2. 모든 weight를 쓴 결과: 기준 구현, 스트림(scalar/SIMD), GPU 표
+  std::vector<float> weights(num_targets);
+  for (size_t t = 0; t < num_targets; ++t)
+    weights[t] = 0.1f + 0.05f * float(t);
+  std::vector<float> reference_positions(num_vertices * 3), reference_normals(num_vertices * 3);
+  apply_morph_targets_reference(&positions[0], num_vertices, dense_positions, &weights[0], num_targets,
+    &reference_positions[0]);
+  apply_morph_targets_reference(&normals[0], num_vertices, dense_normals, &weights[0], num_targets,
+    &reference_normals[0]);
+
+  float simd_diff = 0.0f;
+  std::vector<float> out_positions(num_vertices * 3), out_normals(num_vertices * 3);
+  for (int simd = 0; simd < 2; ++simd)
+  {
+    morph_use_simd(simd != 0);
+    apply_morph_targets(&positions[0], num_vertices, targets.positions, &weights[0], num_targets, &out_positions[0]);
+    apply_morph_targets(&normals[0], num_vertices, targets.normals, &weights[0], num_targets, &out_normals[0]);
+    simd_diff = std::max(simd_diff, max_abs_difference(out_positions, reference_positions));
+    simd_diff = std::max(simd_diff, max_abs_difference(out_normals, reference_normals));
+  }
+  morph_use_simd(true);
+
+  std::vector<float> texels;
+  build_morph_texels(targets, true, &texels);
+  apply_morph_texels(texels, &positions[0], &normals[0], num_vertices, &weights[0], &out_positions[0],
+    &out_normals[0]);
+  const float texel_diff = std::max(max_abs_difference(out_positions, reference_positions),
+    max_abs_difference(out_normals, reference_normals));
+
+  // 더하는 순서가 같으므로 스트림은 기준 구현과 같아야 한다. (SIMD도 같은 곱셈과 덧셈)
+  const bool same = read_diff == 0.0f && stream_diff == 0.0f && simd_diff < 1e-6f && texel_diff < 1e-6f;
+  std::printf("  max diff: read %g, stream %g, scalar/simd %g, GPU table %g%s\n", read_diff, stream_diff, simd_diff,
+    texel_diff, same ? "" : "  FAIL: morph streams differ from the dense reference");
+
+  // 3. 크기: dense delta 전체, 스트림(인덱스 + xyz0), GPU 표
+  const size_t dense_bytes = num_targets * num_vertices * 3 * sizeof(float) * 2;
+  const size_t stream_bytes = targets.num_deltas() * (sizeof(uint32_t) + 4 * sizeof(float));
+  std::printf("  deltas: %zu non-zero of %zu, dense %.2f MB, streams %.2f MB, GPU table %.2f MB\n", targets.num_deltas(),
+    num_targets * num_vertices * 2, dense_bytes / 1048576.0, stream_bytes / 1048576.0,
+    texels.size() * sizeof(float) / 1048576.0);
+
+  // 4. 속도: weight가 모두 0이 아닐 때와 두 개만 0이 아닐 때 (position + normal)
+  std::printf("  %-14s %-10s %12s %10s\n", "weights", "path", "ms", "Mvert/s");
+  const int actives[] = { int(num_targets), 2 };
+  for (int active : actives)
+  {
+    std::vector<float> w(num_targets, 0.0f);
+    for (int t = 0; t < active; ++t)
+      w[(t * 7) % num_targets] = weights[t];
+    for (int path = 0; path < 3; ++path)
+    {
+      morph_use_simd(path == 2);
+      bench_clock::time_point begin = bench_clock::now();
+      for (int r = 0; r < num_repeats; ++r)
+      {
+        if (path == 0)
+        {
+          apply_morph_targets_reference(&positions[0], num_vertices, dense_positions, &w[0], num_targets,
+            &out_positions[0]);
+          apply_morph_targets_reference(&normals[0], num_vertices, dense_normals, &w[0], num_targets, &out_normals[0]);
+        }
+        else
+        {
+          apply_morph_targets(&positions[0], num_vertices, targets.positions, &w[0], num_targets, &out_positions[0]);
+          apply_morph_targets(&normals[0], num_vertices, targets.normals, &w[0], num_targets, &out_normals[0]);
+        }
+      }
+      const double ms = elapsed_ms(begin) / num_repeats;
+      char label[32];
+      std::snprintf(label, sizeof(label), "%d / %zu", active, num_targets);
+      std::printf("  %-14s %-10s %12.3f %10.1f\n", label, path == 0 ? "dense" : morph_impl_name(), ms,
+        num_vertices / (ms * 1000.0));
+    }
+  }
+  morph_use_simd(true);
+  std::printf("\n");
+  return same;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// vertex animation texture: 굽는 간격과 형식에 따른 크기와 오차 (skin_vertices_reference 기준)
+////////////////////////////////////////////////////////////////////////////////
+
+// time의 pose로 모든 구운 primitive를 기준 구현으로 skinning한다. (VAT의 정점 순서)
+static void skin_at_time(const tinygltf::Model& model, const NodeHierarchy& hierarchy, const AnimationClip& clip,
+  const std::vector<SkinPalette>& palettes, const VertexAnimation& vat, const std::vector<SkinnedVertices>& vertices,
+  float time, std::vector<float>* positions, std::vector<float>* normals)
+{
+  AnimationPose pose;
+  init_animation_pose(model, &pose);
+  sample_animation(clip, time, nullptr, &pose);
+  std::vector<float> world;
+  compute_world_matrices(model, hierarchy, pose, &world);
+  std::vector<SkinPalette> posed = palettes;
+  for (SkinPalette& palette : posed)
+    compute_joint_matrices(world, &palette);
+
+  positions->assign(vat.num_vertices * 3, 0.0f);
+  normals->assign(vat.num_vertices * 3, 0.0f);
+  std::vector<float> p, n;
+  for (size_t i = 0; i < vat.primitives.size(); ++i)
+  {
+    const VatPrimitive& vp = vat.primitives[i];
+    const SkinPalette& palette = posed[vp.palette];
+    skin_vertices_reference(vertices[i], &palette.matrices[0], palette.joints.size(), &p, &n);
+    std::copy(p.begin(), p.end(), positions->begin() + vp.first_vertex * 3);
+    std::copy(n.begin(), n.end(), normals->begin() + vp.first_vertex * 3);
+  }
+}
+
+static bool bench_vat(const std::vector<std::string>& models, unsigned int num_threads)
+{
+  const float rates[] = { 10.0f, 15.0f, 30.0f, 60.0f };
+  const VatFormat formats[] = { VAT_PACKED, VAT_FLOAT };
+  const int num_checks = 32;
+
+  std::printf("[vat] clip 0, %u threads, error at %d times between frames (position: %% of the bounds diagonal)\n",
+    num_threads, num_checks);
+  std::printf("%-28s %6s %-7s %7s %9s %10s %10s %10s %12s %12s\n", "model", "fps", "format", "frames", "vertices",
+    "MB", "MB/s clip", "bake(ms)", "max pos(%)", "normal(deg)");
+
+  ThreadPool pool(num_threads);
+  bool ok = true;
+  for (const std::string& name : models)
+  {
+    tinygltf::Model model;
+    std::string err;
+    if (!load_with(false, &model, "test_models/" + name, &err) || model.skins.empty())
+      continue;
+    std::vector<AnimationClip> clips;
+    build_animation_clips(model, &clips, &err);
+    std::vector<SkinPalette> palettes;
+    build_skin_palettes(model, &palettes, &err);
+    if (clips.empty() || palettes.empty())
+      continue;
+    const AnimationClip& clip = clips[0];
+    NodeHierarchy hierarchy;
+    build_node_hierarchy(model, &hierarchy);
+
+    for (float fps : rates)
+    {
+      for (VatFormat format : formats)
+      {
+        VertexAnimation vat;
+        bench_clock::time_point begin = bench_clock::now();
+        if (!bake_vertex_animation(model, clip, fps, format, pool, &vat, &err))
+          continue;
+        const double bake_ms = elapsed_ms(begin);
+
+        std::vector<SkinnedVertices> vertices(vat.primitives.size());
+        for (size_t i = 0; i < vat.primitives.size(); ++i)
+        {
+          const tinygltf::Mesh& mesh = model.meshes[model.nodes[palettes[vat.primitives[i].palette].node].mesh];
+          read_skinned_vertices(model, mesh.primitives[vat.primitives[i].primitive], &vertices[i]);
+        }
+        float diagonal = 0.0f;
+        for (int c = 0; c < 3; ++c)
+          diagonal += (vat.bounds_max[c] - vat.bounds_min[c]) * (vat.bounds_max[c] - vat.bounds_min[c]);
+        diagonal = std::max(std::sqrt(diagonal), 1e-6f);
+
+        // frame 시각에서는 양자화 오차만 있어야 한다. (VAT_FLOAT는 skin_vertices와 기준 구현의 float 오차)
+        // 그 사이의 시각에서는 보간 오차가 더해진다.
+        std::vector<float> positions, normals;
+        float frame_error = 0.0f, max_error = 0.0f;
+        double angle_sum = 0.0;
+        size_t angle_count = 0;
+        for (int k = 0; k < num_checks + 2; ++k)
+        {
+          const bool on_frame = k >= num_checks;
+          const float seconds = on_frame ? float(k - num_checks) * (vat.frames - 1) / vat.fps :
+            (k + 0.37f) / num_checks * (clip.end - clip.start);
+          skin_at_time(model, hierarchy, clip, palettes, vat, vertices, clip.start + seconds, &positions, &normals);
+          for (size_t v = 0; v < vat.num_vertices; ++v)
+          {
+            float p[3], n[3];
+            sample_vertex_animation(vat, seconds, v, p, n);
+            float error = 0.0f, dot = 0.0f;
+            for (int c = 0; c < 3; ++c)
+            {
+              error = std::max(error, std::fabs(p[c] - positions[v * 3 + c]));
+              dot += n[c] * normals[v * 3 + c];
+            }
+            (on_frame ? frame_error : max_error) = std::max(on_frame ? frame_error : max_error, error);
+            if (!on_frame)
+            {
+              angle_sum += std::acos(std::min(1.0f, std::max(-1.0f, dot))) * 180.0 / 3.14159265358979;
+              ++angle_count;
+            }
+          }
+        }
+        // 양자화 한 단계의 절반 (float는 float 오차)
+        float tolerance = 1e-4f * diagonal;
+        if (format == VAT_PACKED)
+          for (int c = 0; c < 3; ++c)
+            tolerance = std::max(tolerance, (vat.bounds_max[c] - vat.bounds_min[c]) / 65535.0f);
+        const bool same = frame_error <= tolerance;
+        ok = ok && same;
+
+        std::printf("%-28s %6.1f %-7s %7d %9zu %10.2f %10.2f %10.1f %12.4f %12.2f%s\n", name.c_str(), vat.fps,
+          format == VAT_PACKED ? "packed" : "float", vat.frames, vat.num_vertices, vat.bytes() / 1048576.0,
+          vat.bytes() / 1048576.0 / std::max(clip.end - clip.start, 1e-3f), bake_ms, 100.0f * max_error / diagonal,
+          angle_count ? angle_sum / angle_count : 0.0, same ? "" : "  FAIL: baked frames differ from skinning");
+      }
+    }
+  }
+  std::printf("\n");
+  return ok;
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<std::string> models;
+  unsigned int max_threads = ThreadPool::default_thread_count();
+  size_t synthetic_mb = 0;
+  bool base64 = false;
+  bool draco = false;
+  bool quantize = false;
+  bool compress = false;
+  bool ktx2 = false;
+  bool mips = false;
+  bool stream = false;
+  bool animation = false;
+  bool skinning = false;
+  bool morph = false;
+  bool vat = false;
+  bool cache_snapshot = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "-j" && i + 1 < argc)
+      max_threads = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+    else if (arg == "--synthetic" && i + 1 < argc)
+      synthetic_mb = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    else if (arg == "--base64")
+      base64 = true;
+    else if (arg == "--draco")
+      draco = true;
+    else if (arg == "--quantize")
+      quantize = true;
+    else if (arg == "--compress")
+      compress = true;
+    else if (arg == "--ktx2")
+      ktx2 = true;
+    else if (arg == "--mips")
+      mips = true;
+    else if (arg == "--stream")
+      stream = true;
+    else if (arg == "--animation")
+      animation = true;
+    else if (arg == "--skinning")
+      skinning = true;
+    else if (arg == "--morph")
+      morph = true;
+    else if (arg == "--vat")
+      vat = true;
+    else if (arg == "--cache-snapshot")
+      cache_snapshot = true;
+    else
+      models.push_back(arg);
+  }
+  if (models.empty())
+    models.assign(default_models, default_models + sizeof(default_models) / sizeof(default_models[0]));
+
+  std::vector<std::string> json_files;
+  for (const std::string& name : models)
+    json_files.push_back("test_models/" + name);
+
+  const std::string synthetic_file = "bench_synthetic.gltf";
+  if (synthetic_mb > 0)
+  {
+    if (write_synthetic_gltf(synthetic_file, synthetic_mb))
+      json_files.push_back(synthetic_file);
+    else
+      std::printf("failed to write %s\n", synthetic_file.c_str());
+  }
+
+  const bool base64_ok = !base64 || bench_base64();
+  if (draco)
+    bench_draco(max_threads);
+  if (quantize)
+    bench_quantize(models);
+  if (compress)
+    bench_compress(models, max_threads);
+  if (ktx2)
+    bench_ktx2(models, max_threads);
+  if (mips)
+    bench_mips(models, max_threads);
+  const bool stream_ok = !stream || bench_stream();
+  const bool animation_ok = !animation || bench_animation(models, max_threads);
+  const bool skinning_ok = !skinning || (bench_skinning(models) && bench_skinning_instances(models, max_threads));
+  const bool morph_ok = !morph || bench_morph();
+  const bool vat_ok = !vat || bench_vat(models, max_threads);
+  const bool cache_ok = !cache_snapshot || bench_cache_snapshot(models, max_threads);
+
+  bench_json_parse(json_files);
+  if (synthetic_mb > 0)
+    std::remove(synthetic_file.c_str());
+
+  bench_image_decode(models, max_threads);
+  bench_scene_cache(models, max_threads);
+
+  return (base64_ok && stream_ok && animation_ok && skinning_ok && morph_ok && vat_ok && cache_ok) ? 0 : 1;
+}
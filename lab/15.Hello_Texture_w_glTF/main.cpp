@@ -10,15 +10,37 @@
 #include <fstream>
 #include <cassert>
 #include <chrono>
-
-#define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "../glTF/tiny_gltf.h"
 #define BUFFER_OFFSET(i) ((char*)0 + (i))
 
 #include "../common/transform.hpp"
+#include "ThreadPool.h"
+#include "ImageDecoder.h"
+#include "AsyncLoader.h"
+#include "MeshQuantizer.h"
+#include "ResourceCache.h"
+#include "TextureCompressor.h"
+#include "KtxTexture.h"
+#include "TextureArray.h"
+#include "MipGenerator.h"
+#include "TexturePacker.h"
+#include "TextureStreamer.h"
+#include "StagingRing.h"
+#include "ShaderCache.h"
+#include "Animation.h"
+#include "Skinning.h"
+#include "Morph.h"
+#include "VertexAnimation.h"
 
 namespace kmuvcl {
   namespace math {
@@ -80,37 +102,19 @@ void init_state();
 ////////////////////////////////////////////////////////////////////////////////
 /// 쉐이더 관련 변수 및 함수
 ////////////////////////////////////////////////////////////////////////////////
-GLuint  program;          // 쉐이더 프로그램 객체의 레퍼런스 값
-GLint   loc_a_position;
-GLint   loc_a_normal;
-GLint   loc_a_texcoord;
-GLint   loc_a_color;
-
-GLint   loc_u_PVM;
-GLint   loc_u_M;
-
-GLint   loc_u_view_position_wc;
-GLint   loc_u_light_position_wc;
-
-GLint   loc_u_light_ambient;
-GLint   loc_u_light_diffuse;
-GLint   loc_u_light_specular;
 
-GLint   loc_u_material_ambient;
-GLint   loc_u_material_specular;
-GLint   loc_u_material_shininess;
-
-GLint   loc_u_diffuse_texture;
-GLint   loc_u_color;
-
-//shader_flag 0은 color, 1은 texture 정보가 있으면 true이다. 거기에 따라서 shader구성이 변한다.
-bool shader_flag[10]={false,};
+// 쉐이더 소스는 primitive가 쓰는 기능의 bitmask(ShaderFeature)에 따라 아래 조각을 이어서 만든다. (init_code)
 
 std::string vertex_init="#version 120// GLSL 1.20\nuniform mat4 u_PVM;\nattribute vec3 a_position;\nuniform mat4 u_M;\nattribute vec2 a_texcoord;\nvarying vec3 v_normal_wc;\nvarying vec3 v_position_wc;\n";
 std::string yes_normal_VI="attribute vec3 a_normal;\n";
-std::string vertex_code="void main(){\n\tgl_Position=u_PVM*vec4(a_position,1.0f);\n\tv_position_wc = (u_M * vec4(a_position, 1)).xyz;\n";
+std::string vertex_code="void main(){\n";
+std::string position_VC="\tgl_Position=u_PVM*vec4(a_position,1.0f);\n\tv_position_wc = (u_M * vec4(a_position, 1)).xyz;\n";
 std::string no_normal_VC="\tv_normal_wc=normalize((u_M * vec4(1.0f,1.0f,1.0f,0.0f)).xyz);\n";
 std::string yes_normal_VC="\tv_normal_wc=normalize((u_M * vec4(a_normal, 0)).xyz);\n";
+// 양자화된 position은 메시마다의 u_dequant로 되돌리고, octahedral 인코딩된 normal은 vec3로 디코딩한다.
+std::string quantized_VI="uniform mat4 u_dequant;\nuniform bool u_normal_oct;\nvec3 oct_decode(vec2 e)\n{\n\tvec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n\tif (n.z < 0.0)\n\t\tn.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);\n\treturn normalize(n);\n}\n";
+std::string quantized_position_VC="\tvec4 position = u_dequant * vec4(a_position, 1.0);\n\tgl_Position=u_PVM*position;\n\tv_position_wc = (u_M * position).xyz;\n";
+std::string quantized_normal_VC="\tvec3 normal = u_normal_oct ? oct_decode(a_normal.xy) : a_normal;\n\tv_normal_wc=normalize((u_M * vec4(normal, 0)).xyz);\n";
 
 std::string frag_init="#version 120// GLSL 1.20\nvarying vec3 v_normal_wc;\nvarying vec3 v_position_wc;\nuniform vec4 u_material_ambient;\nuniform vec4 u_material_specular;\nuniform float u_material_shininess;\nuniform vec3 u_view_position_wc;\nuniform vec3 u_light_position_wc;\nuniform vec4 u_light_ambient;\nuniform vec4 u_light_diffuse;\nuniform vec4 u_light_specular;\n";
 std::string no_texture_FFI="\tvec4 material_diffuse = u_diffuse_texture;\n";
@@ -129,15 +133,46 @@ std::string color_FC = "\ttmp_color += vec4(v_color,1.0f);\n";
 std::string texture_VI = "varying vec2 v_texcoord;\n";
 std::string texture_VC = "\tv_texcoord = a_texcoord;\n";
 
+// skinning: JOINTS_0/WEIGHTS_0으로 joint 행렬 4개를 섞는다. 행렬은 uniform block에서, SHADER_SKIN_BUFFER면 텍스처 buffer에서 읽는다.
+std::string skin_VI="attribute vec4 a_joints;\nattribute vec4 a_weights;\n";
+std::string skin_block_extension="#extension GL_ARB_uniform_buffer_object : enable\n";
+std::string skin_block_VI="layout(std140) uniform JointPalette\n{\n\tmat4 u_joints[MAX_PALETTE_JOINTS];\n};\nmat4 joint_matrix(float j)\n{\n\treturn u_joints[int(j)];\n}\n";
+std::string skin_buffer_extension="#extension GL_EXT_gpu_shader4 : enable\n";
+std::string skin_buffer_VI="uniform samplerBuffer u_joint_texture;\nmat4 joint_matrix(float j)\n{\n\tint i = int(j) * 4;\n\treturn mat4(texelFetchBuffer(u_joint_texture, i), texelFetchBuffer(u_joint_texture, i + 1), texelFetchBuffer(u_joint_texture, i + 2), texelFetchBuffer(u_joint_texture, i + 3));\n}\n";
+std::string skin_VC="\tmat4 skin = a_weights.x * joint_matrix(a_joints.x) + a_weights.y * joint_matrix(a_joints.y) + a_weights.z * joint_matrix(a_joints.z) + a_weights.w * joint_matrix(a_joints.w);\n";
+std::string skin_position_VC="\tvec4 position = skin * vec4(a_position, 1.0);\n\tgl_Position=u_PVM*position;\n\tv_position_wc = (u_M * position).xyz;\n";
+std::string skin_quantized_position_VC="\tvec4 position = skin * (u_dequant * vec4(a_position, 1.0));\n\tgl_Position=u_PVM*position;\n\tv_position_wc = (u_M * position).xyz;\n";
+std::string skin_normal_VC="\tv_normal_wc=normalize((u_M * (skin * vec4(a_normal, 0))).xyz);\n";
+std::string skin_quantized_normal_VC="\tvec3 normal = u_normal_oct ? oct_decode(a_normal.xy) : a_normal;\n\tv_normal_wc=normalize((u_M * (skin * vec4(normal, 0))).xyz);\n";
+// morph target: 정점마다 (첫 항목, 항목 수)를 읽고 그 정점의 0이 아닌 delta만 weight를 곱해 더한다. (build_morph_texels)
+// 이 조각 뒤의 코드는 a_position, a_normal 대신 morph_position, morph_normal을 읽는다.
+std::string morph_extension="#extension GL_EXT_gpu_shader4 : enable\n";
+std::string morph_VI="uniform samplerBuffer u_morph_texture;\nuniform float u_morph_weights[MAX_MORPH_WEIGHTS];\nuniform bool u_morph_normals;\n";
+std::string morph_position_VC="\tvec3 morph_position = a_position;\n";
+std::string morph_normal_VC="\tvec3 morph_normal = a_normal;\n";
+std::string morph_loop_VC="\tvec4 morph_header = texelFetchBuffer(u_morph_texture, gl_VertexID);\n\tint morph_stride = u_morph_normals ? 2 : 1;\n\tfor (int k = 0; k < int(morph_header.y); ++k)\n\t{\n\t\tint texel = int(morph_header.x) + k * morph_stride;\n\t\tvec4 delta = texelFetchBuffer(u_morph_texture, texel);\n\t\tfloat weight = u_morph_weights[int(delta.w)];\n\t\tmorph_position += weight * delta.xyz;\n";
+std::string morph_loop_normal_VC="\t\tif (u_morph_normals)\n\t\t\tmorph_normal += weight * texelFetchBuffer(u_morph_texture, texel + 1).xyz;\n";
+// vertex animation texture: 이웃한 두 frame의 position, normal을 읽어 보간하고 instance 위치로 옮긴다. (u_vat_time과 a_instance.w는 frame 단위)
+// 이 조각 뒤의 코드는 a_position, a_normal 대신 vat_position, vat_normal을 읽는다.
+std::string vat_VI="uniform samplerBuffer u_vat_texture;\nuniform int u_vat_first;\nuniform int u_vat_vertices;\nuniform float u_vat_frames;\nuniform float u_vat_time;\nuniform bool u_vat_packed;\nuniform vec3 u_vat_min;\nuniform vec3 u_vat_extent;\nattribute vec4 a_instance;\nvoid vat_read(float frame, out vec3 position, out vec3 normal)\n{\n\tint vertex = int(frame) * u_vat_vertices + u_vat_first + gl_VertexID;\n\tif (u_vat_packed)\n\t{\n\t\tvec4 texel = texelFetchBuffer(u_vat_texture, vertex);\n\t\tposition = u_vat_min + texel.xyz * u_vat_extent;\n\t\tfloat octa = floor(texel.w * 65535.0 + 0.5);\n\t\tvec2 e = vec2(floor(octa / 256.0), mod(octa, 256.0)) / 255.0 * 2.0 - 1.0;\n\t\tnormal = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n\t\tif (normal.z < 0.0)\n\t\t\tnormal.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);\n\t}\n\telse\n\t{\n\t\tposition = texelFetchBuffer(u_vat_texture, vertex * 2).xyz;\n\t\tnormal = texelFetchBuffer(u_vat_texture, vertex * 2 + 1).xyz;\n\t}\n}\n";
+std::string vat_VC="\tfloat vat_frame = mod(u_vat_time + a_instance.w, u_vat_frames);\n\tfloat vat_next = (floor(vat_frame) + 1.0 < u_vat_frames) ? floor(vat_frame) + 1.0 : 0.0;\n\tvec3 vat_p0, vat_n0, vat_p1, vat_n1;\n\tvat_read(vat_frame, vat_p0, vat_n0);\n\tvat_read(vat_next, vat_p1, vat_n1);\n\tvec3 vat_position = mix(vat_p0, vat_p1, fract(vat_frame)) + a_instance.xyz;\n\tvec3 vat_normal = mix(vat_n0, vat_n1, fract(vat_frame));\n";
+
+// 텍스처 배열: layer 번호로 읽고, 아틀라스에 든 텍스처는 uv를 아틀라스 안으로 옮긴다. (wrap은 fract로)
+std::string texture_array_extension="#extension GL_EXT_texture_array : enable\n";
+std::string array_texture_FI="uniform sampler2DArray u_diffuse_texture;\nuniform float u_layer;\nuniform vec4 u_uv_transform;\nuniform float u_atlas;\nvarying vec2 v_texcoord;\n";
+std::string array_texture_FFI="\tvec2 uv = mix(v_texcoord, u_uv_transform.xy + fract(v_texcoord) * u_uv_transform.zw, u_atlas);\n\tvec4 material_diffuse = texture2DArray(u_diffuse_texture, vec3(uv, u_layer));\n";
+
 std::string factor_FI = "uniform vec4 u_color;\n";
 std::string factor_FC = "\ttmp_color += u_color;\n";
 std::string texcrood_factor_FC = "\ttmp_color += vec4(tmp_color[0]*u_color[0],tmp_color[1]*u_color[1],tmp_color[2]*u_color[2],tmp_color[3]*u_color[3]);\n";
 
 
-void init_shader_code(const std::string& code, const std::string& filename);
-void init_code();
-GLuint create_shader_from_file(const std::string& filename, GLuint shader_type);
-void init_shader_program();
+void init_code(unsigned features, std::string* vertex_shader_code, std::string* fragment_shader_code);
+
+// 기능 bitmask마다 프로그램 하나를 컴파일해 두고 모든 모델이 같이 쓴다.
+// 링크한 프로그램의 binary는 shader_cache/에 저장해 두고 다음 실행에서 읽는다. (--no-shader-cache: 항상 컴파일)
+ShaderCache shader_cache(init_code);
+bool use_shader_binaries = true;
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -148,9 +183,10 @@ kmuvcl::math::mat4x4f   mat_PVM;
 
 float   g_angle = 0.0;
 bool    g_is_animation = false;
+int     g_animation_clip = 0;     // 모델마다 재생하는 glTF animation clip (-1이면 node 변환 그대로, N 키로 바꿈)
 std::chrono::time_point<std::chrono::system_clock> prev, curr;
 
-void set_transform();
+void set_transform(const tinygltf::Model& model);   // model의 카메라를 쓴다.
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -162,15 +198,255 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 ////////////////////////////////////////////////////////////////////////////////
 /// 렌더링 관련 변수 및 함수
 ////////////////////////////////////////////////////////////////////////////////
-tinygltf::Model model;
+ThreadPool loader_pool;         // 이미지 디코딩 등 로딩 작업용 스레드 풀
+
+// 내용이 같은 buffer/texture는 여러 모델이 같은 GL 객체를 쓴다.
+ResourceCache resource_cache;
+
+bool use_sax_parser = false;      // --sax: JSON을 DOM 없이 스트리밍으로 파싱
+bool quantize_vertices = false;   // --quantize: 로딩 후 정점 attribute를 양자화
+
+// --compress[=bc|bc7|etc2]: 텍스처를 블록 압축 형식으로 인코딩해서 올림 (결과는 texture_cache/에 저장)
+TextureCompression texture_compression = TEXTURE_COMPRESSION_NONE;
+
+// --texture-array: 텍스처를 크기/형식별 GL_TEXTURE_2D_ARRAY와 아틀라스로 묶어 올림 (TextureArray.h)
+bool use_texture_arrays = false;
+GLuint placeholder_texture_array = 0;     // 배열이 준비되기 전에 쓰는 흰색 1x1
+GLuint bound_texture_array = 0;           // 0번 unit에 bind된 배열 (같으면 다시 bind하지 않음)
+
+// GL 3.3 / ARB_sampler_objects가 있으면 필터와 wrap을 텍스처가 아니라 sampler 객체에 두고 draw할 때 bind한다.
+// (이미지가 같으면 sampler가 달라도 텍스처 하나를 같이 씀) 없으면 예전처럼 텍스처 파라미터를 쓴다.
+bool use_sampler_objects = false;
+GLuint bound_sampler = 0;                 // 0번 unit에 bind된 sampler 객체
+
+// --mip-filter=box|kaiser: mip chain을 glGenerateMipmap 대신 로더의 worker에서 sRGB를 고려해 만들어 올림 (MipGenerator.h)
+MipFilter mip_filter = MIP_FILTER_NONE;
+bool mip_benchmark = false;       // --mip-bench: 텍스처가 준비되면 glGenerateMipmap과 CPU 필터의 시간/PSNR 비교
+
+// --pack-textures: material이 읽는 채널만 남긴 R8/RG8 텍스처로 올리고 occlusion은 metallicRoughness의 R에 합침 (TexturePacker.h)
+bool pack_textures = false;
+
+// --texture-budget=MB: 텍스처를 mip tail만 올린 채로 시작하고, 그릴 때 화면에 필요한 level을 budget 안에서 올림 (TextureStreamer.h)
+bool stream_textures = false;
+TextureStreamer texture_streamer;
 
-GLuint position_buffer;
-GLuint color_buffer;
-GLuint normal_buffer;
-GLuint texcoord_buffer;
-GLuint index_buffer;
+// --texture-budget으로 관리하는 GL 텍스처 하나의 level 데이터 (RAM에 두고 필요할 때 다시 올린다)
+struct StreamedTexture
+{
+  bool compressed = false;
+  GLenum internal_format = GL_RGBA8;    // 압축이면 compressed_gl_format()
+  std::vector<MipLevel> levels;         // 압축 텍스처도 width, height, data만 쓴다.
+};
+std::unordered_map<GLuint, StreamedTexture> streamed_textures;
+std::vector<TextureStreamChange> texture_stream_changes;
+
+// --staging[=MB]: 디코딩된 텍스처와 정점 데이터를 worker가 persistent-mapped 링에 복사하고,
+// 렌더링 스레드는 링에서 GPU로 복사하는 명령만 냄 (StagingRing.h, 기본 64 MB)
+size_t staging_ring_bytes = 0;
+StagingRing staging_ring;
+std::unordered_set<GLuint> staging_buffers;   // 아직 복사 명령을 내지 않은 buffer (이것을 쓰는 모델은 그리지 않음)
+
+typedef std::pair<const unsigned char*, size_t> StagingSource;
+
+// 링에 쓰는 중이거나 복사 명령을 기다리는 업로드 하나 (텍스처 이미지 또는 buffer)
+struct StagedUpload
+{
+  size_t offset = 0;                            // 링 안의 위치
+  size_t size = 0;
+  std::shared_ptr<std::atomic<bool>> written;   // worker가 다 쓰면 true
+  int image_index = -1;                         // 텍스처 이미지 (-1이면 buffer)
+  GLuint buffer = 0;                            // glCopyBufferSubData로 채울 buffer
+};
+
+// GL extension으로 확인한 GPU의 압축 형식 (texture_codec_bit()의 bitmask, KHR_texture_basisu의 KTX2용)
+unsigned gpu_texture_codecs = 0;
+
+// 텍스처 통계: RGBA8로 올렸을 때와 실제로 올린 크기, 인코딩 속도
+struct TextureStats
+{
+  size_t rgba_bytes = 0;
+  size_t gpu_bytes = 0;
+  size_t encoded = 0;
+  size_t encoded_pixels = 0;
+  double encode_ms = 0.0;
+  size_t cache_hits = 0;
+  size_t ktx2 = 0;
+  size_t mip_chains = 0;        // worker 스레드에서 만든 mip chain (압축한 것 포함)
+  double mip_ms = 0.0;          // worker 스레드들이 mip chain을 만드는 데 쓴 시간
+  size_t packed = 0;            // --pack-textures로 줄인 이미지
+  size_t merged = 0;            // 그중 occlusion을 합친 것
+} texture_stats;
+
+// --texture-array에서 텍스처 하나가 들어 있는 곳
+struct TextureSlot
+{
+  GLuint array = 0;
+  float  layer = 0.0f;
+  float  uv_transform[4] = { 0.0f, 0.0f, 1.0f, 1.0f };   // 아틀라스: offset.xy, scale.zw
+  float  atlas = 0.0f;                                    // 1이면 uv를 아틀라스 안으로 옮긴다.
+};
+
+// primitive 하나를 그리는 쉐이더 variant
+struct PrimitiveShader
+{
+  unsigned features = 0;
+  const ShaderProgram* shader = nullptr;        // shader_cache의 프로그램 (컴파일이 끝나기 전에는 program이 0)
+  const ShaderProgram* fallback = nullptr;      // 그동안 그리는 프로그램 (features & fallback_shader_features)
+};
+
+// fallback variant에 남기는 기능: 정점을 읽는 방법과 material 색만 (모델마다 몇 개 되지 않아 바로 컴파일해 둔다)
+const unsigned fallback_shader_features = SHADER_QUANTIZED | SHADER_NORMAL | SHADER_FACTOR | SHADER_SKIN | SHADER_SKIN_BUFFER |
+  SHADER_MORPH | SHADER_VAT;
+
+// skinning: joint 행렬을 uniform block(GL 3.1 / ARB_uniform_buffer_object)으로 올린다.
+// joint가 MAX_PALETTE_JOINTS보다 많은 skin이 있거나 --skin-buffer면 텍스처 buffer(ARB_texture_buffer_object)로 올린다.
+bool has_palette_blocks = false;
+bool has_palette_textures = false;
+bool use_palette_textures = false;    // --skin-buffer
+bool skin_check = false;              // --skin-check: 첫 skinned primitive를 transform feedback으로 받아 CPU 기준 구현과 비교
+
+// --cpu-skinning: 쉐이더 대신 CPU(AVX2/SSE, 스레드)에서 skinning해서 primitive별 buffer에 쓰고 그것을 그린다.
+// skinning하면서 구한 AABB로 화면 밖의 primitive는 그리지 않는다.
+bool cpu_skinning = false;
+std::unique_ptr<ThreadPool> skinning_pool;
+
+// --cpu-skinning 통계 (B)
+struct
+{
+  size_t updates = 0;           // skin_primitives_on_cpu() 호출
+  size_t vertices = 0;
+  double ms = 0.0;
+  size_t drawn = 0;             // 그린 skinned primitive
+  size_t culled = 0;            // AABB가 화면 밖이라 뺀 것
+} skinning_stats;
+
+// --cpu-skinning: skinned primitive 하나 (palette별로 따로 둔다)
+struct SkinnedPrimitive
+{
+  int palette = -1;
+  SkinnedVertices vertices;                     // 원래 정점 (read_skinned_vertices)
+  GLuint buffer = 0;                            // position, normal (SKINNED_VERTEX_FLOATS)
+  SkinBounds bounds;                            // 마지막으로 skinning한 position의 AABB (mesh 좌표)
+  int morph = -1;                               // morph_primitives 인덱스: skinning 전에 CPU에서 섞는다.
+};
+
+// morph target: primitive마다 0이 아닌 delta만 풀어 두고 텍스처 buffer(ARB_texture_buffer_object + EXT_gpu_shader4)로 올려
+// 쉐이더에서 weight로 섞는다. 텍스처 buffer가 없거나, target이 MAX_MORPH_WEIGHTS보다 많거나, --cpu-morph면
+// CPU에서 weight가 0이 아닌 target만 더해 primitive별 buffer에 쓴다. (--quantize와는 같이 쓰지 않는다)
+bool cpu_morph = false;                         // --cpu-morph
+
+struct MorphPrimitive
+{
+  MorphTargets targets;
+  bool has_normals = false;                     // NORMAL delta도 섞음 (primitive에 NORMAL이 있을 때만)
+  GLuint texture = 0;                           // GPU: GL_TEXTURE_BUFFER 텍스처 (build_morph_texels)
+  GLuint texture_buffer = 0;
+  std::vector<float> base_positions;            // CPU: 원래 position, normal (vertex * 3)
+  std::vector<float> base_normals;
+  std::vector<float> positions;                 // CPU: 섞은 결과
+  std::vector<float> normals;
+  GLuint buffer = 0;                            // CPU: positions 뒤에 normals (has_normals일 때)
+  std::vector<float> applied_weights;           // CPU: buffer에 들어 있는 결과의 weight
+};
+
+// --crowd=N: skinned 모델의 clip 0을 vertex animation texture(VAT, 텍스처 buffer)로 구워 두고 instance N개를 instanced draw로 그린다.
+// instance마다 격자 위의 위치와 재생 시각이 다르며, primitive마다 draw 한 번으로 모든 instance를 그린다. (skinning은 하지 않음)
+// ARB_draw_instanced, ARB_instanced_arrays와 텍스처 buffer가 있어야 한다.
+size_t crowd_instances = 0;
+float vat_fps = 30.0f;                  // --vat-fps=F: 굽는 간격. 높을수록 빠른 동작의 보간 오차가 줄고 VRAM이 는다.
+bool vat_float = false;                 // --vat-float: 16비트로 줄이지 않고 float로 굽기 (VRAM 4배)
+bool has_instancing = false;
+float crowd_seconds = 0.0f;             // crowd의 재생 시각
+
+// --crowd 통계 (B)
+struct
+{
+  size_t frames = 0;
+  double seconds = 0.0;
+  size_t draws = 0;             // instanced draw 수
+} crowd_stats;
+
+// 씬에 올라간 glTF 파일 하나. 모델마다 자기 transform, GL 객체 목록, 쉐이더를 가진다.
+struct SceneModel
+{
+  std::string filename;
+  kmuvcl::math::mat4f transform;                // 씬에서의 위치
+
+  tinygltf::Model model;
+  std::unique_ptr<AsyncLoader> loader;          // 로딩이 시작되기 전에는 nullptr (model보다 먼저 소멸해야 함)
+  bool is_ready = false;                        // geometry를 GPU에 올림 (그릴 수 있음)
+  bool is_textures_ready = false;
+  bool is_unloading = false;                    // 씬에서 뺌. 로더가 끝나면 지운다.
+  std::chrono::time_point<std::chrono::system_clock> start;   // add_scene_model 시각
+
+  unsigned shader_features = 0;                 // primitive들이 쓰는 기능을 모두 합친 것 (ShaderFeature)
+  std::vector<std::vector<PrimitiveShader>> primitive_shaders;  // mesh, primitive 인덱스별 쉐이더 variant
+
+  std::vector<AnimationClip> animation_clips;   // model.animations를 SoA key 배열로 푼 것
+  int animation_clip = -1;                      // 재생 중인 clip (-1이면 node의 TRS를 그대로 씀)
+  AnimationInstance animation;                  // 재생 시각, channel별 cursor, node TRS
+
+  NodeHierarchy node_hierarchy;                 // skin: 부모가 앞에 오는 node 순서
+  std::vector<float> world_matrices;            // skin: node별 씬 root 기준 변환
+  std::vector<SkinPalette> skin_palettes;       // skin을 쓰는 mesh node별 joint 행렬
+  std::vector<GLuint> palette_buffers;          // skin_palettes별 uniform block (SHADER_SKIN_BUFFER면 텍스처 buffer의 내용)
+  std::vector<GLuint> palette_textures;         // SHADER_SKIN_BUFFER: skin_palettes별 GL_TEXTURE_BUFFER 텍스처
+  std::vector<int> node_palettes;               // node별 skin_palettes 인덱스 (-1이면 skin 없음)
+  bool is_pose_changed = true;                  // joint 행렬을 다시 계산해서 올려야 함
+  bool is_skin_checked = false;                 // --skin-check
+
+  std::vector<SkinnedPrimitive> skinned_primitives;       // --cpu-skinning
+  std::vector<std::vector<int>> palette_primitives;       // palette, primitive별 skinned_primitives 인덱스 (-1이면 없음)
+  int drawing_palette = -1;                               // draw_node가 그리는 node의 palette
+
+  std::vector<MorphPrimitive> morph_primitives;           // targets가 있는 primitive
+  std::vector<std::vector<int>> mesh_morphs;              // mesh, primitive별 morph_primitives 인덱스 (-1이면 없음)
+  const float* drawing_weights = nullptr;                 // draw_node가 그리는 node의 morph weight
+  size_t num_drawing_weights = 0;
+
+  VertexAnimation vat;                                    // --crowd
+  GLuint vat_texture = 0;                                 // GL_TEXTURE_BUFFER 텍스처와 그 내용
+  GLuint vat_buffer = 0;
+  GLuint instance_buffer = 0;                             // instance마다 (위치 xyz, 재생 시각 offset(frame))
+  std::vector<std::vector<int>> vat_first;                // palette, primitive별 VAT의 첫 정점 (-1이면 없음)
+  std::thread vat_thread;                                 // --crowd: vat를 굽는 스레드 (frame들은 loader_pool에서 skinning)
+  std::atomic<bool> is_vat_baked{ false };                // vat_thread가 끝남 (아래 결과가 유효)
+  bool is_vat_baking = false;                             // 구워서 올릴 때까지 그리지 않음 (update_scene이 finish_crowd 호출)
+  bool is_vat_ok = false;                                 // vat_thread의 결과
+  std::string vat_err;
+  double vat_bake_ms = 0.0;
+
+  std::vector<GLuint> buffer_objects;           // bufferView 인덱스별 VBO/IBO
+  std::vector<GLuint> texture_objects;          // texture 인덱스별 텍스처 객체
+  std::vector<uint64_t> texture_image_hashes;   // texture 인덱스별 이미지 내용 해시
+  std::vector<bool> texture_owned;              // 이 모델이 내용을 올려야 하는 텍스처 (캐시에 새로 만든 것)
+  std::vector<int> texture_sources;             // texture 인덱스별로 쓰는 이미지 (KHR_texture_basisu 포함, 없으면 -1)
+  std::vector<GLuint> sampler_objects;          // texture 인덱스별 GL sampler 객체 (use_sampler_objects)
+  std::vector<GLuint> texture_arrays;           // --texture-array: 이 모델의 텍스처 배열
+  std::vector<TextureSlot> texture_slots;       // --texture-array: texture 인덱스별 배열과 layer
+  std::vector<MeshDequantization> mesh_dequant; // mesh 인덱스별 position dequantization
+  std::vector<std::vector<PrimitiveExtent>> primitive_extents;  // --texture-budget: mesh, primitive 인덱스별 크기와 UV 밀도
+  std::deque<StagedUpload> staged_uploads;      // --staging: 링에 올린 순서대로 복사 명령을 낸다.
+  std::deque<int> waiting_images;               // --staging: 디코딩은 끝났지만 링에 자리가 없어 기다리는 이미지
+  bool is_geometry_staging = false;             // --staging: buffer가 다 채워질 때까지 그리지 않음
+
+  size_t texture_rgba_bytes = 0;                // 이 모델이 올린 텍스처를 모두 RGBA8로 올렸을 때의 크기
+  size_t texture_gpu_bytes = 0;                 // 실제로 올린 크기
+
+  ~SceneModel()
+  {
+    if (vat_thread.joinable())
+      vat_thread.join();
+  }
+};
+
+std::vector<std::unique_ptr<SceneModel>> scene_models;
 
-GLuint diffuse_texid;
+// 동시에 파싱하는 파일 수. 나머지는 앞의 것이 끝날 때까지 기다린다.
+size_t max_parallel_loads = ThreadPool::default_thread_count();
+
+// 프레임마다 GPU로 올릴 텍스처 데이터의 양 (이 양을 넘기면 다음 프레임으로 미룸)
+size_t texture_upload_budget = 8 * 1024 * 1024;
 
 kmuvcl::math::vec3f view_position_wc;
 
@@ -188,13 +464,70 @@ float               material_shininess = 1.0f;
 
 kmuvcl::math::vec4f color_tmp;
 
-bool load_model(tinygltf::Model &model, const std::string filename);
-void init_buffer_objects();     // VBO init 함수: GPU의 VBO를 초기화하는 함수.
-void init_texture_objects();
-
+void init_buffer_object(SceneModel& sm, int bufferView_index);
+void init_buffer_objects(SceneModel& sm);     // VBO init 함수: GPU의 VBO를 초기화하는 함수.
+void init_texture_objects(SceneModel& sm, std::vector<bool>* needed_images);  // 이미지가 준비되기 전까지 쓸 1x1 placeholder 텍스처 생성
+void upload_texture_image(SceneModel& sm, int image_index, uint64_t image_hash, const StagedUpload* staged = nullptr);
+size_t upload_decoded_textures(SceneModel& sm, size_t budget);
+void init_texture_arrays(SceneModel& sm);     // --texture-array: 디코딩이 끝난 이미지로 배열/아틀라스를 만든다.
+
+void release_gl_objects(SceneModel& sm);      // 이 모델이 쓰던 buffer/texture/program을 놓는다.
+
+GLenum compressed_gl_format(TextureCodec codec);
+GLenum texture_internal_format(int component, int bits);
+int texture_pixel_bytes(int component, int bits);
+void set_texture_swizzle(GLenum target, TextureSwizzle swizzle);
+void count_texture_bytes(SceneModel& sm, size_t rgba_bytes, size_t gpu_bytes);
+bool is_texture_compression_supported(TextureCompression mode);
+unsigned supported_texture_codecs();
+int texture_image_source(const tinygltf::Model& model, const tinygltf::Texture& texture);
+const tinygltf::Sampler& texture_sampler(const tinygltf::Model& model, const tinygltf::Texture& texture);
+void count_compressed_texture(const CompressedTexture& texture);
+void print_texture_stats();
+void benchmark_mipmaps(const SceneModel& sm);  // --mip-bench
+
+// --texture-budget
+void measure_primitives(SceneModel& sm);
+void start_streamed_texture(GLuint texture, StreamedTexture& streamed);   // tail만 올리고 texture_streamer에 등록
+void upload_texture_levels(const StreamedTexture& streamed, int first, int last);
+void request_texture_level(const SceneModel& sm, const PrimitiveExtent& extent, int texture_index,
+  const kmuvcl::math::mat4f& mat_model);
+void update_texture_streaming(size_t upload_budget);   // 이번 프레임의 요청으로 level을 올리고 내린다.
+void print_streaming_stats();
+
+// --staging
+bool stage_upload(const std::vector<StagingSource>& sources, StagedUpload* upload);   // 링에 자리를 잡고 worker에 복사를 맡긴다.
+void texture_staging_sources(const SceneModel& sm, int image_index, std::vector<StagingSource>* sources);
+size_t issue_staged_uploads(SceneModel& sm, size_t budget);
+
+// 씬 관리: 로딩/언로딩은 update_scene()이 매 프레임 조금씩 진행한다. (렌더링 루프를 멈추지 않음)
+SceneModel* add_scene_model(const std::string& filename, const kmuvcl::math::mat4f& transform);
+void remove_scene_model(SceneModel* sm);
+void init_scene_model(SceneModel& sm);        // 파싱이 끝난 모델의 GL 객체와 쉐이더를 만든다.
+unsigned primitive_shader_features(const SceneModel& sm, const tinygltf::Primitive& primitive);
+void init_primitive_shaders(SceneModel& sm);  // primitive마다 쉐이더 variant를 고른다. (처음 쓰는 variant는 컴파일)
+void print_shader_stats();
+void update_scene(size_t texture_budget);
+
+void update_animations(float seconds);        // 재생 중인 clip을 seconds만큼 진행해 node TRS를 샘플링한다.
+void init_skin_palettes(SceneModel& sm);      // skin을 쓰는 node마다 joint palette와 그것을 올릴 GL 객체를 만든다.
+void update_skin_palettes();                  // pose가 바뀐 모델의 joint 행렬을 계산해서 올린다.
+void bind_skin_palette(const SceneModel& sm, int palette);
+void check_gpu_skinning(const SceneModel& sm);  // --skin-check
+void init_cpu_skinning(SceneModel& sm);       // --cpu-skinning
+void skin_primitives_on_cpu(SceneModel& sm);
+void print_skinning_stats();                  // --cpu-skinning (B)
+bool is_box_visible(const kmuvcl::math::mat4f& mat_PVM, const SkinBounds& bounds);
+void init_morph_targets(SceneModel& sm);       // targets가 있는 primitive마다 delta를 풀어 텍스처 buffer(또는 CPU 경로)를 만든다.
+MorphPrimitive* find_morph(SceneModel& sm, size_t mesh, size_t primitive);
+void update_cpu_morph(MorphPrimitive& mp, const float* weights, size_t num_weights);
+void init_crowd(SceneModel& sm);              // --crowd: clip 0을 VAT로 굽기 시작한다.
+void finish_crowd(SceneModel& sm);            // --crowd: 다 구운 VAT와 instance 배치를 올린다.
+bool has_baked_primitive(const SceneModel& sm, size_t mesh, size_t primitive);
+void print_crowd_stats();                     // --crowd (B)
 void draw_scene();
-void draw_node(const tinygltf::Node& node, kmuvcl::math::mat4f mat_view);
-void draw_mesh(const tinygltf::Mesh& mesh, const kmuvcl::math::mat4f& mat_model);
+void draw_node(SceneModel& sm, const tinygltf::Node& node, kmuvcl::math::mat4f mat_view);
+void draw_mesh(SceneModel& sm, const tinygltf::Mesh& mesh, const kmuvcl::math::mat4f& mat_model);
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -208,214 +541,257 @@ float c_translate_x=0, c_translate_y=0, c_translate_z=0;
 void init_state()
 {
   glEnable(GL_DEPTH_TEST);
+  // 1/2/3채널 이미지는 행 길이가 4의 배수가 아닐 수 있다.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
   
   prev = curr = std::chrono::system_clock::now();
 }
 
-void init_code(){
-	vertex_init += shader_flag[0] ? color_VI : "";
-	vertex_init += shader_flag[1] ? texture_VI : "";
-	vertex_init += shader_flag[3] ? yes_normal_VI : "";
+// 디코딩된 이미지마다 glGenerateMipmap(렌더링 스레드, glFinish까지)과 CPU 필터(한 스레드)의 시간을 재고,
+// 각 level을 선형 공간 면적 평균(reference_mip_level)과 비교한 PSNR을 낸다. (4x4보다 작은 level은 빼고 평균)
+void benchmark_mipmaps(const SceneModel& sm)
+{
+  static const MipFilter filters[] = { MIP_FILTER_BOX, MIP_FILTER_KAISER };
+  const tinygltf::Model& model = sm.model;
+  const std::vector<bool> srgb = srgb_images(model);
+
+  std::printf("[mip bench] %s, CPU %s\n", glGetString(GL_RENDERER), mip_generator_impl_name());
+  std::printf("%-6s %-11s %-5s %10s %10s %10s %9s %9s %9s\n", "image", "size", "sRGB",
+    "gl(ms)", "box(ms)", "kaiser(ms)", "gl(dB)", "box(dB)", "kaiser(dB)");
+
+  double total_ms[3] = { 0.0, 0.0, 0.0 };
+  std::vector<uint64_t> seen;
+  std::vector<unsigned char> rgba;
+  for (size_t j = 0; j < model.images.size(); ++j)
+  {
+    const tinygltf::Image& image = model.images[j];
+    const uint64_t hash = sm.loader->image_hash(int(j));
+    if (image.as_is || std::find(seen.begin(), seen.end(), hash) != seen.end() || !convert_to_rgba8(image, &rgba))
+      continue;
+    seen.push_back(hash);
+
+    // GL: level 0만 올리고 glGenerateMipmap이 끝날 때까지 잰 뒤 level들을 읽어 온다.
+    std::vector<MipLevel> chains[3];
+    double ms[3];
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &rgba[0]);
+    glFinish();
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glFinish();
+    ms[0] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    for (int w = image.width, h = image.height, level = 0; ; ++level)
+    {
+      chains[0].push_back(MipLevel());
+      MipLevel& l = chains[0].back();
+      l.width = w;
+      l.height = h;
+      l.data.resize(size_t(w) * h * 4);
+      glPixelStorei(GL_PACK_ALIGNMENT, 1);
+      glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, &l.data[0]);
+      if (w == 1 && h == 1)
+        break;
+      w = std::max(1, w / 2);
+      h = std::max(1, h / 2);
+    }
+    glDeleteTextures(1, &texture);
+
+    for (int f = 0; f < 2; ++f)
+    {
+      begin = std::chrono::steady_clock::now();
+      generate_mip_chain(&rgba[0], image.width, image.height, filters[f], srgb[j], &chains[f + 1]);
+      ms[f + 1] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    double psnr[3] = { 0.0, 0.0, 0.0 };
+    int levels = 0;
+    MipLevel reference;
+    for (size_t level = 1; level < chains[0].size(); ++level)
+    {
+      if (chains[0][level].width < 4 || chains[0][level].height < 4)
+        break;
+      reference_mip_level(&rgba[0], image.width, image.height, int(level), srgb[j], &reference);
+      for (int c = 0; c < 3; ++c)
+        psnr[c] += mip_level_psnr(chains[c][level], reference);
+      ++levels;
+    }
+
+    char size[32];
+    std::snprintf(size, sizeof(size), "%dx%d", image.width, image.height);
+    std::printf("%-6zu %-11s %-5s %10.2f %10.2f %10.2f", j, size, srgb[j] ? "yes" : "no", ms[0], ms[1], ms[2]);
+    for (int c = 0; c < 3; ++c)
+    {
+      if (levels > 0)
+        std::printf(" %9.2f", psnr[c] / levels);
+      else
+        std::printf(" %9s", "-");
+    }
+    std::printf("\n");
+    for (int c = 0; c < 3; ++c)
+      total_ms[c] += ms[c];
+  }
+  std::printf("%-6s %-11s %-5s %10.2f %10.2f %10.2f\n", "total", "", "", total_ms[0], total_ms[1], total_ms[2]);
+}
+
+void init_code(unsigned features, std::string* vertex_shader_code, std::string* fragment_shader_code){
+	std::string vertex_init = ::vertex_init, vertex_code = ::vertex_code;
+	std::string frag_init = ::frag_init, frag_code = ::frag_code;
+
+	vertex_init += (features & SHADER_COLOR) ? color_VI : "";
+	vertex_init += (features & SHADER_TEXTURE) ? texture_VI : "";
+	vertex_init += (features & SHADER_NORMAL) ? yes_normal_VI : "";
+	vertex_init += (features & SHADER_QUANTIZED) ? quantized_VI : "";
+	if(features & SHADER_SKIN)
+	{
+		std::string palette_VI = skin_buffer_VI;
+		if(!(features & SHADER_SKIN_BUFFER))
+		{
+			palette_VI = skin_block_VI;
+			palette_VI.replace(palette_VI.find("MAX_PALETTE_JOINTS"), 18, std::to_string(MAX_PALETTE_JOINTS));
+		}
+		vertex_init.insert(vertex_init.find('\n') + 1, (features & SHADER_SKIN_BUFFER) ? skin_buffer_extension : skin_block_extension);
+		vertex_init += skin_VI + palette_VI;
+	}
+	if(features & SHADER_MORPH)
+	{
+		std::string weights_VI = morph_VI;
+		weights_VI.replace(weights_VI.find("MAX_MORPH_WEIGHTS"), 17, std::to_string(MAX_MORPH_WEIGHTS));
+		if(vertex_init.find(morph_extension) == std::string::npos)
+			vertex_init.insert(vertex_init.find('\n') + 1, morph_extension);
+		vertex_init += weights_VI;
+	}
+	if(features & SHADER_VAT)
+	{
+		if(vertex_init.find(morph_extension) == std::string::npos)
+			vertex_init.insert(vertex_init.find('\n') + 1, morph_extension);
+		vertex_init += vat_VI;
+	}
 	
-	vertex_code += shader_flag[3] ? yes_normal_VC : no_normal_VC;
-	vertex_code += shader_flag[1] ? texture_VC : "";
-	vertex_code += shader_flag[0] ? color_VC : "";
+	if(features & SHADER_SKIN)
+		vertex_code += skin_VC + ((features & SHADER_QUANTIZED) ? skin_quantized_position_VC : skin_position_VC);
+	else
+		vertex_code += (features & SHADER_QUANTIZED) ? quantized_position_VC : position_VC;
+	if((features & SHADER_NORMAL) && (features & SHADER_SKIN))
+		vertex_code += (features & SHADER_QUANTIZED) ? skin_quantized_normal_VC : skin_normal_VC;
+	else if(features & SHADER_NORMAL)
+		vertex_code += (features & SHADER_QUANTIZED) ? quantized_normal_VC : yes_normal_VC;
+	else
+		vertex_code += no_normal_VC;
+	vertex_code += (features & SHADER_TEXTURE) ? texture_VC : "";
+	vertex_code += (features & SHADER_COLOR) ? color_VC : "";
+	if(features & SHADER_MORPH)
+	{
+		for(size_t at = vertex_code.find("a_position"); at != std::string::npos; at = vertex_code.find("a_position", at))
+			vertex_code.replace(at, 10, "morph_position");
+		for(size_t at = vertex_code.find("a_normal"); at != std::string::npos; at = vertex_code.find("a_normal", at))
+			vertex_code.replace(at, 8, "morph_normal");
+		std::string morph_code = morph_position_VC + ((features & SHADER_NORMAL) ? morph_normal_VC : "") + morph_loop_VC;
+		morph_code += ((features & SHADER_NORMAL) ? morph_loop_normal_VC : "") + std::string("\t}\n");
+		vertex_code.insert(vertex_code.find('\n') + 1, morph_code);
+	}
+	if(features & SHADER_VAT)
+	{
+		for(size_t at = vertex_code.find("a_position"); at != std::string::npos; at = vertex_code.find("a_position", at))
+			vertex_code.replace(at, 10, "vat_position");
+		for(size_t at = vertex_code.find("a_normal"); at != std::string::npos; at = vertex_code.find("a_normal", at))
+			vertex_code.replace(at, 8, "vat_normal");
+		vertex_code.insert(vertex_code.find('\n') + 1, vat_VC);
+	}
 	
-	frag_init += shader_flag[1] ? yes_texture_FI : no_texture_FI;
-	frag_init += shader_flag[0] ? color_FI : "";
-	frag_init += shader_flag[2] ? factor_FI : "";
+	if(features & SHADER_TEXTURE_ARRAY)
+		frag_init.insert(frag_init.find('\n') + 1, texture_array_extension);
+	frag_init += (features & SHADER_TEXTURE) ? ((features & SHADER_TEXTURE_ARRAY) ? array_texture_FI : yes_texture_FI) : no_texture_FI;
+	frag_init += (features & SHADER_COLOR) ? color_FI : "";
+	frag_init += (features & SHADER_FACTOR) ? factor_FI : "";
 	frag_init += frag_init_first;
-	frag_init += shader_flag[1] ? yes_texture_FFI : no_texture_FFI;
+	frag_init += (features & SHADER_TEXTURE) ? ((features & SHADER_TEXTURE_ARRAY) ? array_texture_FFI : yes_texture_FFI) : no_texture_FFI;
 	frag_init += frag_init_last;
 	
-	if(!shader_flag[0] && !shader_flag[1] && !shader_flag[2])
+	if(!(features & SHADER_COLOR) && !(features & SHADER_TEXTURE) && !(features & SHADER_FACTOR))
 		frag_code += no_color_FC;
-	if(shader_flag[0])
+	if(features & SHADER_COLOR)
 		frag_code += color_FC;
-	if(shader_flag[1] && shader_flag[2])
+	if((features & SHADER_TEXTURE) && (features & SHADER_FACTOR))
 		frag_code += texcrood_factor_FC;
-	else if(shader_flag[2])
+	else if(features & SHADER_FACTOR)
 		frag_code += factor_FC;
 	frag_code += "\tgl_FragColor = tmp_color;\n";
   vertex_code+="}";
   frag_code+="}";
-}
-
-void init_shader_code(const std::string& code, const std::string& filename){
-  std::ofstream out(filename);
-  if (out.is_open()) {
-    out << code;
-  } else {
-    out << "파일을 찾을 수 없습니다!" << std::endl;
-  }
-}
-
-// GLSL 파일을 읽어서 컴파일한 후 쉐이더 객체를 생성하는 함수
-GLuint create_shader_from_file(const std::string& filename, GLuint shader_type)
-{
-  GLuint shader = 0;
-
-  shader = glCreateShader(shader_type);
-
-  std::ifstream shader_file(filename.c_str());
-  std::string shader_string;
-
-  shader_string.assign(
-    (std::istreambuf_iterator<char>(shader_file)),
-    std::istreambuf_iterator<char>());
-
-  // Get rid of BOM in the head of shader_string
-  // Because, some GLSL compiler (e.g., Mesa Shader compiler) cannot handle UTF-8 with BOM
-  if (shader_string.compare(0, 3, "\xEF\xBB\xBF") == 0)  // Is the file marked as UTF-8?
-  {
-    std::cout << "Shader code (" << filename << ") is written in UTF-8 with BOM" << std::endl;
-    std::cout << "  When we pass the shader code to GLSL compiler, we temporarily get rid of BOM" << std::endl;
-    shader_string.erase(0, 3);                  // Now get rid of the BOM.
-  }
-
-  const GLchar* shader_src = shader_string.c_str();
-  glShaderSource(shader, 1, (const GLchar * *)& shader_src, NULL);
-  glCompileShader(shader);
-
-  GLint is_compiled;
-  glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compiled);
-  if (is_compiled != GL_TRUE)
-  {
-    std::cout << "Shader COMPILE error: " << std::endl;
-
-    GLint buf_len;
-    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &buf_len);
-
-    std::string log_string(1 + buf_len, '\0');
-    glGetShaderInfoLog(shader, buf_len, 0, (GLchar *)log_string.c_str());
-
-    std::cout << "error_log: " << log_string << std::endl;
-
-    glDeleteShader(shader);
-    shader = 0;
-  }
 
-  return shader;
+  *vertex_shader_code = vertex_init + vertex_code;
+  *fragment_shader_code = frag_init + frag_code;
 }
 
-// vertex shader와 fragment shader를 링크시켜 program을 생성하는 함수
-void init_shader_program()
+// 여러 primitive가 같은 bufferView를 공유하므로 bufferView마다 한 번만 만든다.
+void init_buffer_object(SceneModel& sm, int bufferView_index)
 {
-  GLuint vertex_shader
-    = create_shader_from_file("./shader/vertex.glsl", GL_VERTEX_SHADER);
-
-  std::cout << "vertex_shader id: " << vertex_shader << std::endl;
-  assert(vertex_shader != 0);
-
-  GLuint fragment_shader
-    = create_shader_from_file("./shader/fragment.glsl", GL_FRAGMENT_SHADER);
-
-  std::cout << "fragment_shader id: " << fragment_shader << std::endl;
-  assert(fragment_shader != 0);
-
-  program = glCreateProgram();
-  glAttachShader(program, vertex_shader);
-  glAttachShader(program, fragment_shader);
-  glLinkProgram(program);
-
-  GLint is_linked;
-  glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
-  if (is_linked != GL_TRUE)
-  {
-    std::cout << "Shader LINK error: " << std::endl;
-
-    GLint buf_len;
-    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &buf_len);
-
-    std::string log_string(1 + buf_len, '\0');
-    glGetProgramInfoLog(program, buf_len, 0, (GLchar *)log_string.c_str());
-
-    std::cout << "error_log: " << log_string << std::endl;
-
-    glDeleteProgram(program);
-    program = 0;
-  }
-
-  std::cout << "program id: " << program << std::endl;
-  assert(program != 0);
-
-  loc_u_PVM = glGetUniformLocation(program, "u_PVM");
-  loc_u_M = glGetUniformLocation(program, "u_M");
-  loc_a_position = glGetAttribLocation(program, "a_position");
-
-  loc_u_view_position_wc = glGetUniformLocation(program, "u_view_position_wc");
-  loc_u_light_position_wc = glGetUniformLocation(program, "u_light_position_wc");
-  loc_u_light_ambient = glGetUniformLocation(program, "u_light_ambient");
-  loc_u_light_diffuse = glGetUniformLocation(program, "u_light_diffuse");
-  loc_u_light_specular = glGetUniformLocation(program, "u_light_specular");
-  loc_u_material_ambient = glGetUniformLocation(program, "u_material_ambient");
-  loc_u_material_specular = glGetUniformLocation(program, "u_material_specular");
-  loc_u_material_shininess = glGetUniformLocation(program, "u_material_shininess");
-  loc_u_diffuse_texture = glGetUniformLocation(program, "u_diffuse_texture");
-  
-  if(shader_flag[0])
-    loc_a_color = glGetAttribLocation(program, "a_color");
-  if(shader_flag[1])
-  	loc_a_texcoord = glGetAttribLocation(program, "a_texcoord");
-  if(shader_flag[2])
-    loc_u_color = glGetUniformLocation(program, "u_color");
-  if(shader_flag[3])
-	  loc_a_normal = glGetAttribLocation(program, "a_normal");
-  	
-}
+  if (sm.buffer_objects[bufferView_index] != 0)
+    return;
 
-bool load_model(tinygltf::Model &model, const std::string filename)
-{
-  tinygltf::TinyGLTF loader;
-  std::string err;
-  std::string warn;
+  const tinygltf::BufferView& bufferView = sm.model.bufferViews[bufferView_index];
+  const tinygltf::Buffer& buffer = sm.model.buffers[bufferView.buffer];
 
-  bool res = loader.LoadASCIIFromFile(&model, &err, &warn, filename);
-  if (!warn.empty())
+  const unsigned char* data = &buffer.data.at(0) + bufferView.byteOffset;
+  if (!staging_ring.enabled())
   {
-    std::cout << "WARNING: " << warn << std::endl;
+    sm.buffer_objects[bufferView_index] = resource_cache.acquire_buffer(bufferView.target, data, bufferView.byteLength);
+    return;
   }
 
-  if (!err.empty())
-  {
-    std::cout << "ERROR: " << err << std::endl;
-  }
+  // --staging: 새로 만든 buffer는 자리만 잡고, worker가 링에 쓴 것을 나중에 복사해 채운다. (링에 자리가 없으면 바로 올림)
+  bool created;
+  const GLuint object = resource_cache.acquire_buffer(bufferView.target, data, bufferView.byteLength, &created);
+  sm.buffer_objects[bufferView_index] = object;
+  if (!created)
+    return;
 
-  if (!res)
+  StagedUpload upload;
+  upload.buffer = object;
+  if (stage_upload(std::vector<StagingSource>(1, StagingSource(data, bufferView.byteLength)), &upload))
   {
-    std::cout << "Failed to load glTF: " << filename << std::endl;
+    sm.staged_uploads.push_back(upload);
+    staging_buffers.insert(object);
   }
   else
   {
-    std::cout << "Loaded glTF: " << filename << std::endl;
+    glBindBuffer(bufferView.target, object);
+    glBufferSubData(bufferView.target, 0, bufferView.byteLength, data);
   }
-
-  std::cout << std::endl;
-
-  return res;
 }
 
-void init_buffer_objects()
+void init_buffer_objects(SceneModel& sm)
 {
-  const std::vector<tinygltf::Mesh>& meshes = model.meshes;
+  tinygltf::Model& model = sm.model;
   const std::vector<tinygltf::Material>& materials = model.materials;
   const std::vector<tinygltf::Accessor>& accessors = model.accessors;
   const std::vector<tinygltf::BufferView>& bufferViews = model.bufferViews;
-  const std::vector<tinygltf::Buffer>& buffers = model.buffers;
 
-  for (const tinygltf::Mesh& mesh : meshes)
+  sm.buffer_objects.assign(bufferViews.size(), 0);
+
+  for (tinygltf::Mesh& mesh : model.meshes)
   {
-    for (const tinygltf::Primitive& primitive : mesh.primitives)
+    for (tinygltf::Primitive& primitive : mesh.primitives)
     {
+      // glTF(KHR_mesh_quantization 포함)에서 허용하지 않는 형식의 attribute는 빼고 그린다.
+      for (std::map<std::string, int>::iterator it = primitive.attributes.begin(); it != primitive.attributes.end(); )
+      {
+        if (is_valid_attribute_format(it->first, accessors[it->second]))
+        {
+          ++it;
+          continue;
+        }
+        std::cout << "WARNING: unsupported " << it->first << " format in mesh " << mesh.name << std::endl;
+        it = primitive.attributes.erase(it);
+      }
+
       if(primitive.indices!=-1)
       {
         const tinygltf::Accessor& accessor = accessors[primitive.indices];
-        const tinygltf::BufferView& bufferView = bufferViews[accessor.bufferView];
-        const tinygltf::Buffer& buffer = buffers[bufferView.buffer];
-        glGenBuffers(1, &index_buffer);
-        glBindBuffer(bufferView.target, index_buffer);
-        glBufferData(bufferView.target, bufferView.byteLength,
-          &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
+        init_buffer_object(sm, accessor.bufferView);
       }
       if (primitive.material > -1)
       {
@@ -424,7 +800,7 @@ void init_buffer_objects()
         {
           if(parameter.first.compare("baseColorFactor")==0)
           {
-            shader_flag[2]=true;
+            sm.shader_features |= SHADER_FACTOR;
           }
         }
       }
@@ -432,391 +808,2376 @@ void init_buffer_objects()
       for (const auto& attrib : primitive.attributes)
       {
         const tinygltf::Accessor& accessor = accessors[attrib.second];
-        const tinygltf::BufferView& bufferView = bufferViews[accessor.bufferView];
-        const tinygltf::Buffer& buffer = buffers[bufferView.buffer];
 
         if (attrib.first.compare("POSITION") == 0)
         {
-          glGenBuffers(1, &position_buffer);
-          glBindBuffer(bufferView.target, position_buffer);
-          glBufferData(bufferView.target, bufferView.byteLength,
-            &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
+          init_buffer_object(sm, accessor.bufferView);
         }
         else if (attrib.first.compare("NORMAL") == 0)
         {
-        	shader_flag[3]=true;
-          glGenBuffers(1, &normal_buffer);
-          glBindBuffer(bufferView.target, normal_buffer);
-          glBufferData(bufferView.target, bufferView.byteLength,
-            &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
+        	sm.shader_features |= SHADER_NORMAL;
+          init_buffer_object(sm, accessor.bufferView);
         }
         else if (attrib.first.compare("TEXCOORD_0") == 0)
         {
-          shader_flag[1]=true;
-          glGenBuffers(1, &texcoord_buffer);
-          glBindBuffer(bufferView.target, texcoord_buffer);
-          glBufferData(bufferView.target, bufferView.byteLength,
-            &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
+          sm.shader_features |= SHADER_TEXTURE;
+          init_buffer_object(sm, accessor.bufferView);
         }
         else if (attrib.first.compare("COLOR_0") == 0)
         {
-          shader_flag[0]=true;
-          glGenBuffers(1, &color_buffer);
-          glBindBuffer(bufferView.target, color_buffer);
-          glBufferData(bufferView.target, bufferView.byteLength,
-            &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
+          sm.shader_features |= SHADER_COLOR;
+          init_buffer_object(sm, accessor.bufferView);
+        }
+        // skin의 joint 행렬은 init_skin_palettes()가 만든다.
+        else if (attrib.first.compare("JOINTS_0") == 0 || attrib.first.compare("WEIGHTS_0") == 0)
+        {
+          init_buffer_object(sm, accessor.bufferView);
         }
       }
     }
   }
 }
 
-void init_texture_objects()
+void init_texture_objects(SceneModel& sm, std::vector<bool>* needed_images)
 {
+  const tinygltf::Model& model = sm.model;
   const std::vector<tinygltf::Texture>& textures = model.textures;
-  const std::vector<tinygltf::Image>& images = model.images;
-  const std::vector<tinygltf::Sampler>& samplers = model.samplers;
 
-  for (const tinygltf::Texture& texture : textures)
-  {
-    glGenTextures(1, &diffuse_texid);
-    glBindTexture(GL_TEXTURE_2D, diffuse_texid);
+  // 이미지 디코딩이 끝날 때까지는 흰색 1x1 텍스처로 그린다.
+  const GLubyte placeholder[4] = { 255, 255, 255, 255 };
 
-    const tinygltf::Image& image = images[texture.source];
-    const tinygltf::Sampler& sampler = samplers[texture.sampler];
+  sm.texture_objects.assign(textures.size(), 0);
+  sm.texture_image_hashes.assign(textures.size(), 0);
+  sm.texture_owned.assign(textures.size(), false);
+  sm.texture_sources.assign(textures.size(), -1);
+  sm.sampler_objects.assign(textures.size(), 0);
+  needed_images->assign(model.images.size(), false);
 
-    GLenum format = GL_RGBA;
-    if (image.component == 1) {
-      format = GL_RED;
-    }
-    else if (image.component == 2) {
-      format = GL_RG;
-    }
-    else if (image.component == 3) {
-      format = GL_RGB;
+  if (sm.shader_features & SHADER_TEXTURE_ARRAY)
+  {
+    if (placeholder_texture_array == 0)
+    {
+      glGenTextures(1, &placeholder_texture_array);
+      glBindTexture(GL_TEXTURE_2D_ARRAY, placeholder_texture_array);
+      glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, 1, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      bound_texture_array = 0;
     }
+    TextureSlot slot;
+    slot.array = placeholder_texture_array;
+    sm.texture_slots.assign(textures.size(), slot);
+  }
 
-    GLenum type = GL_UNSIGNED_BYTE;
-    if (image.bits == 16) {
-      type = GL_UNSIGNED_SHORT;
+  for (size_t i = 0; i < textures.size(); ++i)
+  {
+    const tinygltf::Texture& texture = textures[i];
+
+    // 이미지가 없는 텍스처는 placeholder로 남는다. (다른 이미지에 합친 occlusion은 그 이미지를 쓴다)
+    const int source = sm.loader->packed_image_source(texture_image_source(model, texture));
+    sm.texture_sources[i] = source;
+    sm.texture_image_hashes[i] = (source >= 0) ? sm.loader->image_hash(source) : 0;
+
+    const tinygltf::Sampler& sampler = texture_sampler(model, texture);
+    if (use_sampler_objects)
+      sm.sampler_objects[i] = resource_cache.acquire_sampler(sampler);
+
+    // 텍스처 배열은 이미지가 모두 디코딩된 뒤에 init_texture_arrays()가 한꺼번에 만든다.
+    if (sm.shader_features & SHADER_TEXTURE_ARRAY)
+    {
+      if (source >= 0)
+        (*needed_images)[source] = true;
+      continue;
     }
 
+    // 같은 이미지 (sampler 객체가 없으면 + 같은 sampler 상태)의 텍스처가 이미 있으면 공유하고, 그 이미지는 디코딩하지 않는다.
+    bool created;
+    sm.texture_objects[i] = resource_cache.acquire_texture(use_sampler_objects ? sm.texture_image_hashes[i] :
+      ResourceCache::texture_key(sm.texture_image_hashes[i], sampler), &created);
+    if (!created || source < 0)
+      continue;
+    sm.texture_owned[i] = true;
+    (*needed_images)[source] = true;
+
+    glBindTexture(GL_TEXTURE_2D, sm.texture_objects[i]);
+
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-      image.width, image.height, 0, format, type, &image.image[0]);
+      1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
-    //glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    //glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrapS);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrapT);
+    if (!use_sampler_objects)
+    {
+      glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
+      glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+      //glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      //glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrapS);
+      glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrapT);
+    }
 
     glGenerateMipmap(GL_TEXTURE_2D);
   }
 }
 
-void set_transform()
+// 압축 텍스처를 어디서 얻었는지 통계에 넣는다.
+void count_compressed_texture(const CompressedTexture& texture)
 {
-  mat_view.set_to_identity();
-  //mat_proj.set_to_identity();
+  if (texture.from_ktx2)
+  {
+    ++texture_stats.ktx2;
+  }
+  else if (texture.from_cache)
+  {
+    ++texture_stats.cache_hits;
+  }
+  else
+  {
+    ++texture_stats.encoded;
+    texture_stats.encoded_pixels += size_t(texture.levels[0].width) * texture.levels[0].height;
+    texture_stats.encode_ms += texture.encode_ms;
+  }
+}
 
-  float fovy = 70.0f;
-  float aspectRatio = 1.0f;
-  float znear = 0.01f;
-  float zfar = 100.0f;
-  bool proj_flag = false;
-  bool view_flag = false;
+// 디코딩이 끝난 이미지를 그 이미지(와 내용이 같은 이미지)를 쓰는 모든 텍스처 객체에 올린다.
+void upload_texture_image(SceneModel& sm, int image_index, uint64_t image_hash, const StagedUpload* staged)
+{
+  const tinygltf::Model& model = sm.model;
+  const std::vector<tinygltf::Texture>& textures = model.textures;
+  const tinygltf::Image& image = model.images[image_index];
+  const CompressedTexture* compressed = sm.loader->compressed_image(image_index);
+  const std::vector<MipLevel>* mips = sm.loader->mip_chain(image_index);
+  const TextureSwizzle swizzle = sm.loader->texture_swizzle(image_index);
 
-  const std::vector<tinygltf::Node>& nodes = model.nodes;
-  const std::vector<tinygltf::Camera>& cameras = model.cameras;
-  if(cameras.size()>camera_index){
-    const tinygltf::Camera& camera = cameras[camera_index];
-    if (camera.type.compare("perspective") == 0)
-    {
-      proj_flag = true;
-      fovy = kmuvcl::math::rad2deg(camera.perspective.yfov);
-      aspectRatio = camera.perspective.aspectRatio;
-      znear = camera.perspective.znear;
-      zfar = camera.perspective.zfar;
+  // --pack-textures: 읽는 채널만 남긴 이미지 (mip chain도 이것으로 만든 것)
+  const tinygltf::Image* packed = sm.loader->packed_image(image_index);
+  const tinygltf::Image& pixels = packed ? *packed : image;
 
-      /*std::cout << "(camera.mode() == Camera::kPerspective)" << std::endl;
-      std::cout << "(fovy, aspect, n, f): " << fovy << ", " << aspectRatio << ", " << znear << ", " << zfar << std::endl;*/
-      mat_proj = kmuvcl::math::perspective(fovy, aspectRatio, znear, zfar);
-    }
-    else if(camera.type.compare("orthographic") == 0)
+  // 압축 캐시에서 읽은 이미지는 디코딩하지 않았으므로 픽셀이 없다.
+  if (!compressed && (pixels.image.empty() || pixels.width < 1 || pixels.height < 1))
+    return;
+
+  // --staging: level 데이터는 링(GL_PIXEL_UNPACK_BUFFER)에 texture_staging_sources()의 순서로 이어져 있으므로
+  // 포인터 대신 링 안의 위치를 넘긴다.
+  if (staged)
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging_ring.buffer());
+
+  for (size_t i = 0; i < textures.size(); ++i)
+  {
+    if (sm.texture_image_hashes[i] != image_hash || !sm.texture_owned[i])
+      continue;
+    sm.texture_owned[i] = false;
+
+    size_t staged_offset = staged ? staged->offset : 0;
+    auto source = [&](const std::vector<unsigned char>& data) -> const void* {
+      if (!staged)
+        return &data[0];
+      const void* offset = BUFFER_OFFSET(staged_offset);
+      staged_offset += data.size();
+      return offset;
+    };
+
+    glBindTexture(GL_TEXTURE_2D, sm.texture_objects[i]);
+    set_texture_swizzle(GL_TEXTURE_2D, swizzle);
+
+    if (compressed)
     {
-      proj_flag = true;
-      float xmag = camera.orthographic.xmag;
-      float ymag = camera.orthographic.ymag;
-      float znear = camera.orthographic.znear;
-      float zfar = camera.orthographic.zfar;
+      // 미리 만들어 둔 mip chain을 그대로 올린다.
+      const std::vector<CompressedLevel>& levels = compressed->levels;
+      if (stream_textures)
+      {
+        StreamedTexture streamed;
+        streamed.compressed = true;
+        streamed.internal_format = compressed_gl_format(compressed->codec);
+        for (const CompressedLevel& l : levels)
+        {
+          const MipLevel level = { l.width, l.height, l.data };
+          streamed.levels.push_back(level);
+        }
+        start_streamed_texture(sm.texture_objects[i], streamed);
+      }
+      else
+      {
+        for (size_t level = 0; level < levels.size(); ++level)
+        {
+          glCompressedTexImage2D(GL_TEXTURE_2D, GLint(level), compressed_gl_format(compressed->codec),
+            levels[level].width, levels[level].height, 0, GLsizei(levels[level].data.size()), source(levels[level].data));
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(levels.size()) - 1);
+      }
 
-      /*std::cout << "(camera.mode() == Camera::kOrtho)" << std::endl;
-      std::cout << "(xmag, ymag, n, f): " << xmag << ", " << ymag << ", " << znear << ", " << zfar << std::endl;*/
-      mat_proj = kmuvcl::math::ortho(-xmag, xmag, -ymag, ymag, znear, zfar);
+      count_texture_bytes(sm, uncompressed_texture_bytes(levels[0].width, levels[0].height), compressed->size());
+      count_compressed_texture(*compressed);
+      continue;
     }
 
-    for (const tinygltf::Node& node : nodes)
+    if (mips)
     {
-      if (node.camera == camera_index)
+      // worker 스레드에서 만든 RGBA8 mip chain을 그대로 올린다. (줄인 이미지면 남긴 채널만 저장됨)
+      const GLenum internal_format = texture_internal_format(pixels.component, 8);
+      if (stream_textures)
       {
-        mat_view.set_to_identity();
-        
-        if (node.scale.size() == 3) {
-          view_flag = true;
-          mat_view = mat_view*kmuvcl::math::scale<float>(
-                1.0f / node.scale[0], 1.0f / node.scale[1], 1.0f / node.scale[2]);
+        StreamedTexture streamed;
+        streamed.internal_format = internal_format;
+        streamed.levels = *mips;
+        start_streamed_texture(sm.texture_objects[i], streamed);
+      }
+      else
+      {
+        for (size_t level = 0; level < mips->size(); ++level)
+        {
+          const MipLevel& l = (*mips)[level];
+          glTexImage2D(GL_TEXTURE_2D, GLint(level), internal_format, l.width, l.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, source(l.data));
         }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(mips->size()) - 1);
+      }
 
-        if (node.rotation.size() == 4) {
-          view_flag = true;
-          mat_view = mat_view*kmuvcl::math::quat2mat(
-                node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3]).transpose();
-        }
+      count_texture_bytes(sm, mip_chain_bytes(*mips),
+        uncompressed_texture_bytes(pixels.width, pixels.height, texture_pixel_bytes(pixels.component, 8)));
+      continue;
+    }
 
-        if (node.translation.size() == 3) {
-          view_flag = true;
-          mat_view = mat_view*kmuvcl::math::translate<float>(
-                -node.translation[0]-c_translate_x, -node.translation[1]-c_translate_y, -node.translation[2]-c_translate_z);
-        }      
-      }
+    GLenum format = GL_RGBA;
+    if (pixels.component == 1) {
+      format = GL_RED;
+    }
+    else if (pixels.component == 2) {
+      format = GL_RG;
+    }
+    else if (pixels.component == 3) {
+      format = GL_RGB;
+    }
+
+    GLenum type = GL_UNSIGNED_BYTE;
+    if (pixels.bits == 16) {
+      type = GL_UNSIGNED_SHORT;
     }
+
+    // 내부 형식은 이미지의 채널 수와 bit 수를 따른다. (16 bit 이미지를 8 bit로 줄이지 않음)
+    glTexImage2D(GL_TEXTURE_2D, 0, texture_internal_format(pixels.component, pixels.bits),
+      pixels.width, pixels.height, 0, format, type, source(pixels.image));
+
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    count_texture_bytes(sm, uncompressed_texture_bytes(pixels.width, pixels.height),
+      uncompressed_texture_bytes(pixels.width, pixels.height, texture_pixel_bytes(pixels.component, pixels.bits)));
   }
-  if(!proj_flag) mat_proj = kmuvcl::math::perspective(fovy, aspectRatio, znear, zfar);
-  if(!view_flag) mat_view = kmuvcl::math::translate(-c_translate_x, -c_translate_y, -c_translate_z-2.0f);
-}
 
+  if (staged)
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
 
-void draw_node(const tinygltf::Node& node, kmuvcl::math::mat4f mat_model)
+// 디코딩된 이미지를 budget 바이트만큼 GPU로 올리고, 올린 바이트 수를 반환한다.
+// 한 프레임에 너무 많이 올려 렌더링이 끊기지 않도록 나머지는 다음 프레임으로 미룬다.
+size_t upload_decoded_textures(SceneModel& sm, size_t budget)
 {
-  const std::vector<tinygltf::Node>& nodes = model.nodes;
-  const std::vector<tinygltf::Mesh>& meshes = model.meshes;
+  AsyncLoader& loader = *sm.loader;
+  size_t uploaded = 0;
+  int image_index;
 
-  if (node.scale.size() == 3) {
-    mat_model = mat_model * kmuvcl::math::scale<float>(
-      node.scale[0], node.scale[1], node.scale[2]);
+  // --staging: 링에 다 쓴 것의 복사 명령을 내고, 디코딩이 끝난 이미지는 worker가 링에 쓰게 한다.
+  // (--texture-budget은 level을 RAM에서 따로 올리므로 텍스처는 바로 올림)
+  if (staging_ring.enabled())
+  {
+    uploaded = issue_staged_uploads(sm, budget);
+    std::vector<StagingSource> sources;
+    while (!stream_textures)
+    {
+      if (!sm.waiting_images.empty())
+        image_index = sm.waiting_images.front();
+      else if (loader.pop_decoded_image(&image_index))
+        sm.waiting_images.push_back(image_index);
+      else
+        break;
+
+      texture_staging_sources(sm, image_index, &sources);
+      size_t size = 0;
+      for (const StagingSource& s : sources)
+        size += s.second;
+
+      StagedUpload upload;
+      upload.image_index = image_index;
+      if (!sources.empty() && size <= staging_ring.capacity())
+      {
+        if (!stage_upload(sources, &upload))
+          break;      // 앞의 복사가 끝나서 자리가 나면 다음 프레임에
+        sm.staged_uploads.push_back(upload);
+      }
+      else
+      {
+        // 올릴 텍스처가 없거나 링보다 큰 이미지
+        upload_texture_image(sm, image_index, loader.image_hash(image_index));
+        uploaded += size;
+      }
+      sm.waiting_images.pop_front();
+    }
+    if (!stream_textures)
+      return uploaded;
   }
 
-  if (node.rotation.size() == 4) {
-    mat_model = mat_model * kmuvcl::math::quat2mat(
-      node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3]);
-  }
+  while (uploaded < budget && loader.pop_decoded_image(&image_index))
+  {
+    upload_texture_image(sm, image_index, loader.image_hash(image_index));
+    const CompressedTexture* compressed = loader.compressed_image(image_index);
+    const std::vector<MipLevel>* mips = loader.mip_chain(image_index);
+    const tinygltf::Image* packed = loader.packed_image(image_index);
+    if (compressed)
+      uploaded += compressed->size();
+    else if (mips)
+      uploaded += mip_chain_bytes(*mips);
+    else if (packed)
+      uploaded += packed->image.size();
+    else
+      uploaded += sm.model.images[image_index].image.size();
 
-  if (node.translation.size() == 3) {
-    mat_model = mat_model * kmuvcl::math::translate<float>(
-      node.translation[0], node.translation[1], node.translation[2]);
+    // --texture-budget: level 데이터는 streamed_textures로 복사해 두었다.
+    if (stream_textures)
+      loader.release_levels(image_index);
   }
 
-  if (node.matrix.size() == 16)
+  return uploaded;
+}
+
+// 이미지와 sampler가 같은 텍스처는 한 layer를 같이 쓴다. (sampler 객체를 쓰면 이미지만 같으면 됨)
+// 올리는 것은 한 프레임에 한꺼번에 한다.
+void init_texture_arrays(SceneModel& sm)
+{
+  const tinygltf::Model& model = sm.model;
+  const std::vector<tinygltf::Texture>& textures = model.textures;
+  const AsyncLoader& loader = *sm.loader;
+
+  // 내용이 같은 이미지는 하나만 디코딩되어 있으므로 해시로 찾는다.
+  std::map<uint64_t, int> decoded_images;
+  for (size_t j = 0; j < model.images.size(); ++j)
   {
-    kmuvcl::math::mat4f mat_node;
-    mat_node(0, 0) = node.matrix[0];
-    mat_node(0, 1) = node.matrix[1];
-    mat_node(0, 2) = node.matrix[2];
-    mat_node(0, 3) = node.matrix[3];
+    const tinygltf::Image& image = model.images[j];
+    if (loader.compressed_image(int(j)) || (!image.as_is && !image.image.empty()))
+      decoded_images.insert(std::make_pair(loader.image_hash(int(j)), int(j)));
+  }
+
+  std::vector<TextureArrayInput> inputs;
+  std::vector<int> input_images;
+  std::vector<tinygltf::Sampler> input_samplers;
+  std::vector<int> texture_inputs(textures.size(), -1);
+  std::map<uint64_t, int> input_of_key;
+  for (size_t i = 0; i < textures.size(); ++i)
+  {
+    std::map<uint64_t, int>::const_iterator image = decoded_images.find(sm.texture_image_hashes[i]);
+    if (sm.texture_sources[i] < 0 || image == decoded_images.end())
+      continue;
+
+    const tinygltf::Texture& texture = textures[i];
+    const tinygltf::Sampler& sampler = texture_sampler(model, texture);
+    const uint64_t key = use_sampler_objects ? sm.texture_image_hashes[i] :
+      ResourceCache::texture_key(sm.texture_image_hashes[i], sampler);
+    std::map<uint64_t, int>::const_iterator found = input_of_key.find(key);
+    if (found != input_of_key.end())
+    {
+      texture_inputs[i] = found->second;
+      continue;
+    }
+
+    const CompressedTexture* compressed = loader.compressed_image(image->second);
+    const tinygltf::Image& pixels = model.images[image->second];
+    tinygltf::Sampler filter = sampler;
+    filter.wrapS = filter.wrapT = TINYGLTF_TEXTURE_WRAP_REPEAT;
+
+    TextureArrayInput input;
+    input.width = compressed ? compressed->levels[0].width : pixels.width;
+    input.height = compressed ? compressed->levels[0].height : pixels.height;
+    input.codec = compressed ? compressed->codec : TEXTURE_CODEC_NONE;
+    input.levels = compressed ? int(compressed->levels.size()) : 0;
+    // sampler 객체를 쓰면 배열에는 sampler 상태가 없으므로 크기와 형식만으로 묶는다.
+    input.sampler_key = use_sampler_objects ? 0 : ResourceCache::sampler_key(sampler);
+    input.filter_key = use_sampler_objects ? 0 : ResourceCache::sampler_key(filter);
+    input.can_atlas = !compressed && sampler.wrapS != TINYGLTF_TEXTURE_WRAP_MIRRORED_REPEAT &&
+      sampler.wrapT != TINYGLTF_TEXTURE_WRAP_MIRRORED_REPEAT;
+
+    texture_inputs[i] = input_of_key[key] = int(inputs.size());
+    inputs.push_back(input);
+    input_images.push_back(image->second);
+    input_samplers.push_back(sampler);
+  }
+
+  GLint max_layers = 256, max_size = 2048;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+  TextureArrayPlan plan;
+  plan_texture_arrays(inputs, max_layers, std::min<GLint>(max_size, 2048), &plan);
+
+  sm.texture_arrays.assign(plan.arrays.size(), 0);
+  if (!plan.arrays.empty())
+    glGenTextures(GLsizei(plan.arrays.size()), &sm.texture_arrays[0]);
+
+  std::vector<unsigned char> rgba, atlas;
+  size_t atlas_entries = 0, layers = 0;
+  for (size_t a = 0; a < plan.arrays.size(); ++a)
+  {
+    const TextureArrayDesc& desc = plan.arrays[a];
+    const tinygltf::Sampler& sampler = input_samplers[desc.first_input];
+    std::vector<size_t> members;
+    for (size_t k = 0; k < inputs.size(); ++k)
+    {
+      if (plan.placements[k].array == int(a))
+        members.push_back(k);
+    }
+    layers += desc.layers;
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, sm.texture_arrays[a]);
+
+    if (desc.codec != TEXTURE_CODEC_NONE)
+    {
+      // 압축된 mip chain은 level마다 배열을 잡고 layer별로 채운다.
+      const GLenum format = compressed_gl_format(desc.codec);
+      for (int level = 0; level < desc.levels; ++level)
+      {
+        const CompressedLevel& first = loader.compressed_image(input_images[members[0]])->levels[level];
+        glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, first.width, first.height, desc.layers, 0,
+          GLsizei(first.data.size() * desc.layers), nullptr);
+        for (size_t k : members)
+        {
+          const CompressedLevel& l = loader.compressed_image(input_images[k])->levels[level];
+          glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, plan.placements[k].layer,
+            l.width, l.height, 1, format, GLsizei(l.data.size()), &l.data[0]);
+        }
+      }
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, desc.levels - 1);
+      for (size_t k : members)
+      {
+        count_texture_bytes(sm, 0, loader.compressed_image(input_images[k])->size());
+        count_compressed_texture(*loader.compressed_image(input_images[k]));
+      }
+    }
+    else
+    {
+      glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, desc.width, desc.height, desc.layers, 0,
+        GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+      if (desc.atlas)
+      {
+        // 아틀라스는 layer마다 CPU에서 합쳐서 올린다.
+        for (int layer = 0; layer < desc.layers; ++layer)
+        {
+          atlas.assign(size_t(desc.width) * desc.height * 4, 0);
+          for (size_t k : members)
+          {
+            const TexturePlacement& p = plan.placements[k];
+            if (p.layer == layer && convert_to_rgba8(model.images[input_images[k]], &rgba))
+              blit_to_atlas(&rgba[0], inputs[k].width, inputs[k].height, p.x, p.y, &atlas[0], desc.width);
+          }
+          glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, desc.width, desc.height, 1,
+            GL_RGBA, GL_UNSIGNED_BYTE, &atlas[0]);
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, TEXTURE_ATLAS_MAX_LEVEL);
+        atlas_entries += members.size();
+      }
+      else if (std::all_of(members.begin(), members.end(), [&](size_t k) { return loader.mip_chain(input_images[k]); }))
+      {
+        // CPU에서 만든 mip chain은 level마다 배열을 잡고 layer별로 채운다. (크기가 같으므로 level 수도 같다)
+        const std::vector<MipLevel>& first = *loader.mip_chain(input_images[members[0]]);
+        for (size_t level = 1; level < first.size(); ++level)
+        {
+          glTexImage3D(GL_TEXTURE_2D_ARRAY, GLint(level), GL_RGBA8, first[level].width, first[level].height, desc.layers, 0,
+            GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        for (size_t k : members)
+        {
+          const std::vector<MipLevel>& mips = *loader.mip_chain(input_images[k]);
+          for (size_t level = 0; level < mips.size(); ++level)
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, GLint(level), 0, 0, plan.placements[k].layer,
+              mips[level].width, mips[level].height, 1, GL_RGBA, GL_UNSIGNED_BYTE, &mips[level].data[0]);
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, GLint(first.size()) - 1);
+      }
+      else
+      {
+        for (size_t k : members)
+        {
+          if (convert_to_rgba8(model.images[input_images[k]], &rgba))
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, plan.placements[k].layer, desc.width, desc.height, 1,
+              GL_RGBA, GL_UNSIGNED_BYTE, &rgba[0]);
+        }
+      }
+      // 아틀라스는 gutter가 TEXTURE_ATLAS_MAX_LEVEL까지만 맞으므로 합친 layer에서 GL이 만든다.
+      if (desc.atlas || !loader.mip_chain(input_images[members[0]]))
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+      count_texture_bytes(sm, 0, uncompressed_texture_bytes(desc.width, desc.height) * desc.layers);
+    }
+
+    // 아틀라스의 wrap은 쉐이더가 한다.
+    if (!use_sampler_objects)
+    {
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, desc.atlas ? GL_CLAMP_TO_EDGE : sampler.wrapS);
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, desc.atlas ? GL_CLAMP_TO_EDGE : sampler.wrapT);
+    }
+  }
+  bound_texture_array = 0;
+
+  for (const TextureArrayInput& input : inputs)
+    count_texture_bytes(sm, uncompressed_texture_bytes(input.width, input.height), 0);
+
+  for (size_t i = 0; i < textures.size(); ++i)
+  {
+    if (texture_inputs[i] < 0)
+      continue;
+    const TexturePlacement& p = plan.placements[texture_inputs[i]];
+    TextureSlot& slot = sm.texture_slots[i];
+    slot.array = sm.texture_arrays[p.array];
+    slot.layer = float(p.layer);
+    std::copy(p.uv_transform, p.uv_transform + 4, slot.uv_transform);
+    slot.atlas = plan.arrays[p.array].atlas ? 1.0f : 0.0f;
+
+    // 아틀라스의 wrap은 쉐이더가 하므로 sampler는 필터만 같고 가장자리에서 멈추는 것으로 바꾼다.
+    if (use_sampler_objects && plan.arrays[p.array].atlas)
+    {
+      tinygltf::Sampler clamp = texture_sampler(model, textures[i]);
+      clamp.wrapS = clamp.wrapT = GL_CLAMP_TO_EDGE;
+      resource_cache.release_sampler(sm.sampler_objects[i]);
+      sm.sampler_objects[i] = resource_cache.acquire_sampler(clamp);
+    }
+  }
+
+  std::cout << "texture arrays: " << inputs.size() << " textures -> " << plan.arrays.size() << " arrays ("
+    << layers << " layers, " << atlas_entries << " in atlases)" << std::endl;
+}
+
+void release_gl_objects(SceneModel& sm)
+{
+  for (GLuint buffer : sm.buffer_objects)
+  {
+    if (buffer != 0)
+      resource_cache.release_buffer(buffer);
+  }
+  for (GLuint texture : sm.texture_objects)
+  {
+    if (resource_cache.release_texture(texture))
+    {
+      texture_streamer.remove_texture(texture);
+      streamed_textures.erase(texture);
+    }
+  }
+  for (GLuint sampler : sm.sampler_objects)
+  {
+    if (sampler != 0)
+      resource_cache.release_sampler(sampler);
+  }
+  bound_sampler = 0;
+
+  if (!sm.texture_arrays.empty())
+    glDeleteTextures(GLsizei(sm.texture_arrays.size()), &sm.texture_arrays[0]);
+  bound_texture_array = 0;
+
+  sm.buffer_objects.clear();
+  sm.texture_objects.clear();
+  sm.sampler_objects.clear();
+  sm.texture_arrays.clear();
+
+  if (!sm.palette_buffers.empty())
+    glDeleteBuffers(GLsizei(sm.palette_buffers.size()), &sm.palette_buffers[0]);
+  if (!sm.palette_textures.empty())
+    glDeleteTextures(GLsizei(sm.palette_textures.size()), &sm.palette_textures[0]);
+  sm.palette_buffers.clear();
+  sm.palette_textures.clear();
+
+  for (const SkinnedPrimitive& sp : sm.skinned_primitives)
+    glDeleteBuffers(1, &sp.buffer);
+  sm.skinned_primitives.clear();
+  for (const MorphPrimitive& mp : sm.morph_primitives)
+  {
+    glDeleteTextures(1, &mp.texture);
+    glDeleteBuffers(1, &mp.texture_buffer);
+    glDeleteBuffers(1, &mp.buffer);
+  }
+  sm.morph_primitives.clear();
+  sm.mesh_morphs.clear();
+  glDeleteTextures(1, &sm.vat_texture);
+  glDeleteBuffers(1, &sm.vat_buffer);
+  glDeleteBuffers(1, &sm.instance_buffer);
+  sm.vat_texture = sm.vat_buffer = sm.instance_buffer = 0;
+  sm.vat_first.clear();
+  sm.primitive_shaders.clear();
+}
+
+GLenum compressed_gl_format(TextureCodec codec)
+{
+  switch (codec)
+  {
+  case TEXTURE_CODEC_BC1:       return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  case TEXTURE_CODEC_BC3:       return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  case TEXTURE_CODEC_BC4:       return GL_COMPRESSED_RED_RGTC1;
+  case TEXTURE_CODEC_BC5:       return GL_COMPRESSED_RG_RGTC2;
+  case TEXTURE_CODEC_BC7:       return GL_COMPRESSED_RGBA_BPTC_UNORM;
+  case TEXTURE_CODEC_ETC2_RGB:  return GL_COMPRESSED_RGB8_ETC2;
+  case TEXTURE_CODEC_ETC2_RGBA: return GL_COMPRESSED_RGBA8_ETC2_EAC;
+  case TEXTURE_CODEC_EAC_R11:   return GL_COMPRESSED_R11_EAC;
+  case TEXTURE_CODEC_EAC_RG11:  return GL_COMPRESSED_RG11_EAC;
+  default:                      return GL_RGBA;
+  }
+}
+
+// 디코딩된 이미지의 채널 수와 bit 수에 맞는 비압축 내부 형식
+GLenum texture_internal_format(int component, int bits)
+{
+  static const GLenum formats8[4] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+  static const GLenum formats16[4] = { GL_R16, GL_RG16, GL_RGB16, GL_RGBA16 };
+  const int n = std::min(std::max(component, 1), 4) - 1;
+  return (bits == 16) ? formats16[n] : formats8[n];
+}
+
+// 그 형식의 픽셀당 바이트 수 (RGB는 드라이버가 보통 4채널로 채우므로 RGBA와 같게 센다)
+int texture_pixel_bytes(int component, int bits)
+{
+  static const int bytes[4] = { 1, 2, 4, 4 };
+  return bytes[std::min(std::max(component, 1), 4) - 1] * ((bits == 16) ? 2 : 1);
+}
+
+// --pack-textures로 줄인 텍스처를 원래 이미지처럼 읽게 한다. (TexturePacker.h)
+void set_texture_swizzle(GLenum target, TextureSwizzle swizzle)
+{
+  static const GLint gray[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+  static const GLint roughness_metallic[4] = { GL_ZERO, GL_RED, GL_GREEN, GL_ONE };
+  if (swizzle == TEXTURE_SWIZZLE_GRAY)
+    glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, gray);
+  else if (swizzle == TEXTURE_SWIZZLE_ROUGHNESS_METALLIC)
+    glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, roughness_metallic);
+}
+
+// 전체 통계와 모델별 VRAM에 더한다. (rgba_bytes는 RGBA8로 올렸을 때의 크기)
+void count_texture_bytes(SceneModel& sm, size_t rgba_bytes, size_t gpu_bytes)
+{
+  texture_stats.rgba_bytes += rgba_bytes;
+  texture_stats.gpu_bytes += gpu_bytes;
+  sm.texture_rgba_bytes += rgba_bytes;
+  sm.texture_gpu_bytes += gpu_bytes;
+}
+
+bool is_texture_compression_supported(TextureCompression mode)
+{
+  switch (mode)
+  {
+  case TEXTURE_COMPRESSION_BC:    return GLEW_EXT_texture_compression_s3tc && GLEW_ARB_texture_compression_rgtc;
+  case TEXTURE_COMPRESSION_BC7:   return GLEW_ARB_texture_compression_bptc && GLEW_ARB_texture_compression_rgtc;
+  case TEXTURE_COMPRESSION_ETC2:  return GLEW_ARB_ES3_compatibility;
+  default:                        return true;
+  }
+}
+
+unsigned supported_texture_codecs()
+{
+  unsigned codecs = 0;
+  if (GLEW_EXT_texture_compression_s3tc)
+    codecs |= texture_codec_bit(TEXTURE_CODEC_BC1) | texture_codec_bit(TEXTURE_CODEC_BC3);
+  if (GLEW_ARB_texture_compression_rgtc)
+    codecs |= texture_codec_bit(TEXTURE_CODEC_BC4) | texture_codec_bit(TEXTURE_CODEC_BC5);
+  if (GLEW_ARB_texture_compression_bptc)
+    codecs |= texture_codec_bit(TEXTURE_CODEC_BC7);
+  if (GLEW_ARB_ES3_compatibility)
+    codecs |= texture_codec_bit(TEXTURE_CODEC_ETC2_RGB) | texture_codec_bit(TEXTURE_CODEC_ETC2_RGBA) |
+      texture_codec_bit(TEXTURE_CODEC_EAC_R11) | texture_codec_bit(TEXTURE_CODEC_EAC_RG11);
+  return codecs;
+}
+
+// texture의 sampler. 지정하지 않았으면 glTF 기본값 (REPEAT, 필터는 구현이 정하므로 LINEAR_MIPMAP_LINEAR/LINEAR)
+const tinygltf::Sampler& texture_sampler(const tinygltf::Model& model, const tinygltf::Texture& texture)
+{
+  static const tinygltf::Sampler default_sampler;
+  return (size_t(texture.sampler) < model.samplers.size()) ? model.samplers[texture.sampler] : default_sampler;
+}
+
+// KHR_texture_basisu의 KTX2 이미지를 이 빌드와 GPU로 올릴 수 있으면 그것을, 아니면 기본 source를 쓴다.
+// 쓸 이미지가 없으면 -1
+int texture_image_source(const tinygltf::Model& model, const tinygltf::Texture& texture)
+{
+  const int source = (size_t(texture.source) < model.images.size()) ? texture.source : -1;
+  const int basisu = basisu_texture_source(texture);
+  if (basisu < 0 || size_t(basisu) >= model.images.size())
+    return source;
+
+  // scene cache에서 읽은 이미지는 이미 풀려 있을 수 있다.
+  const tinygltf::Image& image = model.images[basisu];
+  std::string reason;
+  if (!image.as_is || can_load_ktx2(image.image, gpu_texture_codecs, &reason))
+    return basisu;
+
+  std::cout << "WARNING: cannot use KTX2 image " << basisu << " (" << reason << ")";
+  if (source >= 0)
+    std::cout << ", using image " << source << " instead";
+  std::cout << std::endl;
+  return source;
+}
+
+void print_texture_stats()
+{
+  const TextureStats& st = texture_stats;
+  std::printf("texture VRAM: %.2f MB -> %.2f MB (saved %.2f MB)", st.rgba_bytes / 1048576.0,
+    st.gpu_bytes / 1048576.0, (double(st.rgba_bytes) - double(st.gpu_bytes)) / 1048576.0);
+  if (texture_compression != TEXTURE_COMPRESSION_NONE)
+  {
+    std::printf(", %s: encoded %zu", texture_compression_name(texture_compression), st.encoded);
+    if (st.encode_ms > 0.0)
+      std::printf(" (%.1f Mpixel/s per thread)", st.encoded_pixels / (st.encode_ms * 1000.0));
+    std::printf(", cache hits %zu", st.cache_hits);
+  }
+  if (st.ktx2 > 0)
+    std::printf(", KTX2 %zu", st.ktx2);
+  if (mip_filter != MIP_FILTER_NONE)
+    std::printf(", %s mips %zu (%.1f ms on workers)", mip_filter_name(mip_filter), st.mip_chains, st.mip_ms);
+  if (pack_textures)
+    std::printf(", packed %zu (%zu with occlusion)", st.packed, st.merged);
+  std::printf("\n");
+  if (staging_ring.enabled())
+  {
+    std::printf("staging: %zu uploads (%.2f MB) through a %.1f MB ring, peak %.2f MB, ring full %zu times\n",
+      staging_ring.allocations(), staging_ring.staged_bytes() / 1048576.0, staging_ring.capacity() / 1048576.0,
+      staging_ring.peak_bytes() / 1048576.0, staging_ring.full_count());
+  }
+  if (stream_textures)
+    print_streaming_stats();
+}
+
+// --texture-budget: primitive마다 bounding sphere와 UV 밀도를 재 둔다. (쉐이더는 TEXCOORD_0만 읽는다)
+// 잴 수 없는 primitive는 uv_density가 0이라 항상 level 0을 요청한다.
+void measure_primitives(SceneModel& sm)
+{
+  const tinygltf::Model& model = sm.model;
+  sm.primitive_extents.resize(model.meshes.size());
+  for (size_t m = 0; m < model.meshes.size(); ++m)
+  {
+    const std::vector<tinygltf::Primitive>& primitives = model.meshes[m].primitives;
+    sm.primitive_extents[m].assign(primitives.size(), PrimitiveExtent());
+    for (size_t p = 0; p < primitives.size(); ++p)
+    {
+      if (!measure_primitive(model, primitives[p], 0, &sm.primitive_extents[m][p]))
+        sm.primitive_extents[m][p] = PrimitiveExtent();
+    }
+  }
+}
+
+// level 데이터를 streamed_textures로 옮기고 mip tail만 올린다. (GL_TEXTURE_2D에 bind된 텍스처)
+void start_streamed_texture(GLuint texture, StreamedTexture& streamed)
+{
+  std::vector<size_t> level_bytes;
+  for (const MipLevel& l : streamed.levels)
+    level_bytes.push_back(l.data.size());
+  const int tail = texture_streamer.add_texture(texture, streamed.levels[0].width, streamed.levels[0].height,
+    level_bytes);
+
+  StreamedTexture& s = streamed_textures[texture];
+  s = std::move(streamed);
+  upload_texture_levels(s, tail, int(s.levels.size()));
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, tail);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(s.levels.size()) - 1);
+}
+
+// level first ~ last - 1을 올린다. (GL_TEXTURE_2D에 bind된 텍스처)
+void upload_texture_levels(const StreamedTexture& streamed, int first, int last)
+{
+  for (int level = first; level < last; ++level)
+  {
+    const MipLevel& l = streamed.levels[level];
+    if (streamed.compressed)
+      glCompressedTexImage2D(GL_TEXTURE_2D, level, streamed.internal_format, l.width, l.height, 0,
+        GLsizei(l.data.size()), &l.data[0]);
+    else
+      glTexImage2D(GL_TEXTURE_2D, level, streamed.internal_format, l.width, l.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+        &l.data[0]);
+  }
+}
+
+// primitive를 그릴 때 텍스처에 필요한 mip level을 texture_streamer에 알린다.
+// 화면에서의 크기는 bounding sphere의 가장 가까운 깊이와 UV 밀도로 추정한다.
+void request_texture_level(const SceneModel& sm, const PrimitiveExtent& extent, int texture_index,
+  const kmuvcl::math::mat4f& mat_model)
+{
+  const GLuint texture = sm.texture_objects[texture_index];
+  std::unordered_map<GLuint, StreamedTexture>::const_iterator it = streamed_textures.find(texture);
+  if (it == streamed_textures.end())
+    return;
+  const MipLevel& top = it->second.levels[0];
+
+  const kmuvcl::math::mat4f mat_MV = mat_view * kmuvcl::math::translate<float>(m_translate_x, m_translate_y, m_translate_z) *
+    mat_model;
+  float scale = 0.0f;     // 가장 많이 늘어나는 축
+  for (int c = 0; c < 3; ++c)
+    scale = std::max(scale, std::sqrt(mat_MV(0, c) * mat_MV(0, c) + mat_MV(1, c) * mat_MV(1, c) + mat_MV(2, c) * mat_MV(2, c)));
+  if (!(scale > 0.0f))
+    return;
+  const kmuvcl::math::vec4f center = mat_MV * kmuvcl::math::vec4f(extent.center[0], extent.center[1], extent.center[2], 1.0f);
+
+  // 직교 투영이면 거리와 상관없다.
+  const bool is_ortho = mat_proj(3, 3) == 1.0f;
+  const float distance = is_ortho ? 1.0f : -center[2] - extent.radius * scale;
+
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  const float pixels_per_unit = mat_proj(1, 1) * viewport[3] * 0.5f;
+  const float texels_per_unit = extent.uv_density / scale * std::max(top.width, top.height);
+  texture_streamer.request(texture, texture_mip_demand(texels_per_unit, distance, pixels_per_unit));
+}
+
+// 프레임을 그린 뒤에 호출한다. 올릴 level은 RAM의 데이터로 올리고, 놓을 level은 0x0으로 다시 지정해
+// 드라이버가 메모리를 돌려받게 한다. (base level 밖의 level은 텍스처 완전성에 들어가지 않으므로 형식은 상관없음)
+void update_texture_streaming(size_t upload_budget)
+{
+  texture_streamer.update(upload_budget, &texture_stream_changes);
+  for (const TextureStreamChange& change : texture_stream_changes)
+  {
+    const StreamedTexture& streamed = streamed_textures[change.id];
+    glBindTexture(GL_TEXTURE_2D, change.id);
+    if (change.new_level < change.old_level)
+      upload_texture_levels(streamed, change.new_level, change.old_level);
+    for (int level = change.old_level; level < change.new_level; ++level)
+      glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, change.new_level);
+  }
+}
+
+void print_streaming_stats()
+{
+  const TextureStreamerStats& st = texture_streamer.stats();
+  std::printf("texture streaming: resident %.2f / %.2f MB (tails %.2f MB, all levels %.2f MB), "
+    "%zu/%zu drawn textures at wanted level, %zu textures, loaded %zu levels (%.2f MB), evicted %zu levels (%.2f MB)\n",
+    st.resident_bytes / 1048576.0, st.budget / 1048576.0, st.tail_bytes / 1048576.0, st.full_bytes / 1048576.0,
+    st.satisfied, st.requested, st.textures, st.loads, st.loaded_bytes / 1048576.0, st.evictions,
+    st.evicted_bytes / 1048576.0);
+}
+
+// 링에 size만큼 자리를 잡고, sources를 이어서 그 자리에 쓰는 작업을 worker에 넣는다. 자리가 없으면 false
+// sources가 가리키는 데이터는 upload->written이 true가 될 때까지 살아 있어야 한다.
+bool stage_upload(const std::vector<StagingSource>& sources, StagedUpload* upload)
+{
+  size_t size = 0;
+  for (const StagingSource& s : sources)
+    size += s.second;
+  if (!staging_ring.allocate(size, &upload->offset))
+    return false;
+
+  upload->size = size;
+  upload->written = std::make_shared<std::atomic<bool>>(false);
+
+  unsigned char* dst = staging_ring.data(upload->offset);
+  std::shared_ptr<std::atomic<bool>> written = upload->written;
+  loader_pool.enqueue([sources, dst, written]() {
+    unsigned char* p = dst;
+    for (const StagingSource& s : sources)
+    {
+      if (s.second > 0)
+        std::memcpy(p, s.first, s.second);
+      p += s.second;
+    }
+    written->store(true, std::memory_order_release);
+  });
+  return true;
+}
+
+// upload_texture_image()가 읽는 순서대로 이미지의 level 데이터. 이 모델이 올릴 텍스처가 없으면 비운다.
+void texture_staging_sources(const SceneModel& sm, int image_index, std::vector<StagingSource>* sources)
+{
+  sources->clear();
+  const uint64_t hash = sm.loader->image_hash(image_index);
+  bool owned = false;
+  for (size_t i = 0; i < sm.texture_owned.size(); ++i)
+    owned = owned || (sm.texture_owned[i] && sm.texture_image_hashes[i] == hash);
+  if (!owned)
+    return;
+
+  const CompressedTexture* compressed = sm.loader->compressed_image(image_index);
+  const std::vector<MipLevel>* mips = sm.loader->mip_chain(image_index);
+  const tinygltf::Image* packed = sm.loader->packed_image(image_index);
+  const tinygltf::Image& pixels = packed ? *packed : sm.model.images[image_index];
+  if (compressed)
+  {
+    for (const CompressedLevel& l : compressed->levels)
+      sources->push_back(StagingSource(l.data.data(), l.data.size()));
+  }
+  else if (mips)
+  {
+    for (const MipLevel& l : *mips)
+      sources->push_back(StagingSource(l.data.data(), l.data.size()));
+  }
+  else if (!pixels.image.empty() && pixels.width > 0 && pixels.height > 0)
+  {
+    sources->push_back(StagingSource(pixels.image.data(), pixels.image.size()));
+  }
+}
+
+// worker가 다 쓴 업로드부터 순서대로 링에서 GPU로 복사하는 명령을 낸다. budget 바이트를 넘으면 다음 프레임에
+// 명령을 낸 바이트 수를 반환한다.
+size_t issue_staged_uploads(SceneModel& sm, size_t budget)
+{
+  size_t issued = 0;
+  while (issued < budget && !sm.staged_uploads.empty())
+  {
+    const StagedUpload& upload = sm.staged_uploads.front();
+    if (!upload.written->load(std::memory_order_acquire))
+      break;
+
+    if (upload.image_index >= 0)
+    {
+      upload_texture_image(sm, upload.image_index, sm.loader->image_hash(upload.image_index), &upload);
+    }
+    else
+    {
+      glBindBuffer(GL_COPY_READ_BUFFER, staging_ring.buffer());
+      glBindBuffer(GL_COPY_WRITE_BUFFER, upload.buffer);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, upload.offset, 0, upload.size);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+      glBindBuffer(GL_COPY_READ_BUFFER, 0);
+      staging_buffers.erase(upload.buffer);
+    }
+    staging_ring.submit(upload.offset);
+    issued += upload.size;
+    sm.staged_uploads.pop_front();
+  }
+  return issued;
+}
+
+void set_transform(const tinygltf::Model& model)
+{
+  mat_view.set_to_identity();
+  //mat_proj.set_to_identity();
+
+  float fovy = 70.0f;
+  float aspectRatio = 1.0f;
+  float znear = 0.01f;
+  float zfar = 100.0f;
+  bool proj_flag = false;
+  bool view_flag = false;
+
+  const std::vector<tinygltf::Node>& nodes = model.nodes;
+  const std::vector<tinygltf::Camera>& cameras = model.cameras;
+  if(cameras.size()>camera_index){
+    const tinygltf::Camera& camera = cameras[camera_index];
+    if (camera.type.compare("perspective") == 0)
+    {
+      proj_flag = true;
+      fovy = kmuvcl::math::rad2deg(camera.perspective.yfov);
+      aspectRatio = camera.perspective.aspectRatio;
+      znear = camera.perspective.znear;
+      zfar = camera.perspective.zfar;
+
+      /*std::cout << "(camera.mode() == Camera::kPerspective)" << std::endl;
+      std::cout << "(fovy, aspect, n, f): " << fovy << ", " << aspectRatio << ", " << znear << ", " << zfar << std::endl;*/
+      mat_proj = kmuvcl::math::perspective(fovy, aspectRatio, znear, zfar);
+    }
+    else if(camera.type.compare("orthographic") == 0)
+    {
+      proj_flag = true;
+      float xmag = camera.orthographic.xmag;
+      float ymag = camera.orthographic.ymag;
+      float znear = camera.orthographic.znear;
+      float zfar = camera.orthographic.zfar;
+
+      /*std::cout << "(camera.mode() == Camera::kOrtho)" << std::endl;
+      std::cout << "(xmag, ymag, n, f): " << xmag << ", " << ymag << ", " << znear << ", " << zfar << std::endl;*/
+      mat_proj = kmuvcl::math::ortho(-xmag, xmag, -ymag, ymag, znear, zfar);
+    }
+
+    for (const tinygltf::Node& node : nodes)
+    {
+      if (node.camera == camera_index)
+      {
+        mat_view.set_to_identity();
+        
+        if (node.scale.size() == 3) {
+          view_flag = true;
+          mat_view = mat_view*kmuvcl::math::scale<float>(
+                1.0f / node.scale[0], 1.0f / node.scale[1], 1.0f / node.scale[2]);
+        }
+
+        if (node.rotation.size() == 4) {
+          view_flag = true;
+          mat_view = mat_view*kmuvcl::math::quat2mat(
+                node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3]).transpose();
+        }
+
+        if (node.translation.size() == 3) {
+          view_flag = true;
+          mat_view = mat_view*kmuvcl::math::translate<float>(
+                -node.translation[0]-c_translate_x, -node.translation[1]-c_translate_y, -node.translation[2]-c_translate_z);
+        }      
+      }
+    }
+  }
+  if(!proj_flag) mat_proj = kmuvcl::math::perspective(fovy, aspectRatio, znear, zfar);
+  if(!view_flag) mat_view = kmuvcl::math::translate(-c_translate_x, -c_translate_y, -c_translate_z-2.0f);
+}
+
+
+void draw_node(SceneModel& sm, const tinygltf::Node& node, kmuvcl::math::mat4f mat_model)
+{
+  const tinygltf::Model& model = sm.model;
+  const std::vector<tinygltf::Node>& nodes = model.nodes;
+  const std::vector<tinygltf::Mesh>& meshes = model.meshes;
+  const size_t node_index = &node - &nodes[0];
+
+  // glTF의 node 변환은 T * R * S 순서로 곱한다. animation을 재생 중이면 pose의 TRS를 쓴다.
+  if (sm.animation_clip >= 0 && !sm.animation.pose.is_matrix[node_index])
+  {
+    const AnimationPose& pose = sm.animation.pose;
+    const float* t = &pose.translations[node_index * 3];
+    const float* r = &pose.rotations[node_index * 4];
+    const float* s = &pose.scales[node_index * 3];
+    mat_model = mat_model * kmuvcl::math::translate<float>(t[0], t[1], t[2]) *
+      kmuvcl::math::quat2mat(r[0], r[1], r[2], r[3]) * kmuvcl::math::scale<float>(s[0], s[1], s[2]);
+  }
+  else
+  {
+    if (node.translation.size() == 3) {
+      mat_model = mat_model * kmuvcl::math::translate<float>(
+        node.translation[0], node.translation[1], node.translation[2]);
+    }
+
+    if (node.rotation.size() == 4) {
+      mat_model = mat_model * kmuvcl::math::quat2mat(
+        node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3]);
+    }
+
+    if (node.scale.size() == 3) {
+      mat_model = mat_model * kmuvcl::math::scale<float>(
+        node.scale[0], node.scale[1], node.scale[2]);
+    }
+  }
+
+  if (node.matrix.size() == 16)
+  {
+    kmuvcl::math::mat4f mat_node;
+    mat_node(0, 0) = node.matrix[0];
+    mat_node(0, 1) = node.matrix[1];
+    mat_node(0, 2) = node.matrix[2];
+    mat_node(0, 3) = node.matrix[3];
 
     mat_node(1, 0) = node.matrix[4];
     mat_node(1, 1) = node.matrix[5];
     mat_node(1, 2) = node.matrix[6];
     mat_node(1, 3) = node.matrix[7];
 
-    mat_node(2, 0) = node.matrix[8];
-    mat_node(2, 1) = node.matrix[9];
-    mat_node(2, 2) = node.matrix[10];
-    mat_node(2, 3) = node.matrix[11];
+    mat_node(2, 0) = node.matrix[8];
+    mat_node(2, 1) = node.matrix[9];
+    mat_node(2, 2) = node.matrix[10];
+    mat_node(2, 3) = node.matrix[11];
+
+    mat_node(3, 0) = node.matrix[12];
+    mat_node(3, 1) = node.matrix[13];
+    mat_node(3, 2) = node.matrix[14];
+    mat_node(3, 3) = node.matrix[15];
+
+    mat_model = mat_model * mat_node;
+  }
+
+  if (node.mesh > -1)
+  {
+    sm.drawing_palette = sm.node_palettes.empty() ? -1 : sm.node_palettes[node_index];
+    if (sm.drawing_palette >= 0 && !sm.palette_buffers.empty())
+      bind_skin_palette(sm, sm.drawing_palette);
+    // morph weight는 pose에 있다. (animation이 없으면 node나 mesh의 기본값)
+    const AnimationPose& pose = sm.animation.pose;
+    const bool has_weights = !sm.morph_primitives.empty() && node_index < pose.weight_counts.size();
+    sm.num_drawing_weights = has_weights ? size_t(pose.weight_counts[node_index]) : 0;
+    sm.drawing_weights = (sm.num_drawing_weights > 0) ? &pose.weights[pose.weight_offsets[node_index]] : nullptr;
+    draw_mesh(sm, meshes[node.mesh], mat_model);
+    sm.drawing_palette = -1;
+  }
+
+  for (size_t i = 0; i < node.children.size(); ++i)
+  {
+    draw_node(sm, nodes[node.children[i]], mat_model);
+  }
+}
+
+void draw_mesh(SceneModel& sm, const tinygltf::Mesh& mesh, const kmuvcl::math::mat4f& mat_model)
+{
+  const tinygltf::Model& model = sm.model;
+  const std::vector<PrimitiveShader>& primitive_shaders = sm.primitive_shaders[&mesh - &model.meshes[0]];
+  const std::vector<tinygltf::Material>& materials = model.materials;
+  const std::vector<tinygltf::Texture>& textures = model.textures;
+  const std::vector<tinygltf::Accessor>& accessors = model.accessors;
+  const std::vector<tinygltf::BufferView>& bufferViews = model.bufferViews;
+  const std::vector<tinygltf::Buffer>& buffers = model.buffers;
+
+  mat_PVM = mat_proj * mat_view* kmuvcl::math::translate<float>(m_translate_x, m_translate_y, m_translate_z) * mat_model;
+
+  view_position_wc[0] = mat_view(0, 3);
+  view_position_wc[1] = mat_view(1, 3);
+  view_position_wc[2] = mat_view(2, 3);
+
+  kmuvcl::math::mat4f mat_dequant;
+  if (sm.shader_features & SHADER_QUANTIZED)
+  {
+    const MeshDequantization& dq = sm.mesh_dequant[&mesh - &model.meshes[0]];
+    mat_dequant = kmuvcl::math::translate<float>(dq.offset[0], dq.offset[1], dq.offset[2]) *
+      kmuvcl::math::scale<float>(dq.scale[0], dq.scale[1], dq.scale[2]);
+  }
+
+  const ShaderProgram* bound_shader = nullptr;
+  for (const tinygltf::Primitive& primitive : mesh.primitives)
+  {
+    // 컴파일이 끝나기 전(또는 실패했으면)에는 fallback으로 그린다.
+    const PrimitiveShader& ps = primitive_shaders[&primitive - &mesh.primitives[0]];
+    const bool is_compiled = ps.shader->program != 0;
+    const unsigned features = is_compiled ? ps.features : (ps.features & fallback_shader_features);
+    const ShaderProgram& shader = is_compiled ? *ps.shader : *ps.fallback;
+    if (shader.program == 0)
+      continue;
+
+    // --cpu-skinning: position과 normal은 skinning한 buffer에서 읽는다.
+    const SkinnedPrimitive* skinned = nullptr;
+    if (sm.drawing_palette >= 0 && !sm.skinned_primitives.empty())
+    {
+      const int index = sm.palette_primitives[sm.drawing_palette][&primitive - &mesh.primitives[0]];
+      skinned = (index >= 0) ? &sm.skinned_primitives[index] : nullptr;
+    }
+    if (skinned && !is_box_visible(mat_PVM, skinned->bounds))
+    {
+      ++skinning_stats.culled;
+      continue;
+    }
+    skinning_stats.drawn += skinned ? 1 : 0;
+
+    // --crowd: VAT로 구운 primitive는 position, normal을 VAT에서 읽고 instance 수만큼 그린다.
+    const bool vat = (features & SHADER_VAT) != 0;
+    int vat_first = -1;
+    if (vat && sm.drawing_palette >= 0 && size_t(sm.drawing_palette) < sm.vat_first.size() &&
+      !sm.vat_first[sm.drawing_palette].empty())
+      vat_first = sm.vat_first[sm.drawing_palette][&primitive - &mesh.primitives[0]];
+    if (vat && vat_first < 0)
+      continue;
+
+    // morph target: SHADER_MORPH면 쉐이더가 섞고, 아니면 CPU에서 섞은 buffer에서 position과 normal을 읽는다.
+    MorphPrimitive* morph = find_morph(sm, &mesh - &model.meshes[0], &primitive - &mesh.primitives[0]);
+    const MorphPrimitive* morphed = nullptr;
+    if (morph && morph->buffer != 0 && !skinned)
+    {
+      update_cpu_morph(*morph, sm.drawing_weights, sm.num_drawing_weights);
+      morphed = morph;
+    }
+
+    // primitive마다 variant가 다를 수 있다. 프로그램이 바뀔 때만 bind하고 공통 uniform을 넣는다.
+    if (&shader != bound_shader)
+    {
+      bound_shader = &shader;
+      glUseProgram(shader.program);
+      glUniformMatrix4fv(shader.loc_u_PVM, 1, GL_FALSE, mat_PVM);
+      glUniformMatrix4fv(shader.loc_u_M, 1, GL_FALSE, mat_model);
+
+      glUniform3fv(shader.loc_u_view_position_wc, 1, view_position_wc);
+      glUniform3fv(shader.loc_u_light_position_wc, 1, light_position_wc);
+
+      glUniform4fv(shader.loc_u_light_ambient, 1, light_ambient);
+      glUniform4fv(shader.loc_u_light_diffuse, 1, light_diffuse);
+      glUniform4fv(shader.loc_u_light_specular, 1, light_specular);
+
+      glUniform4fv(shader.loc_u_material_ambient, 1, material_ambient);
+      glUniform4fv(shader.loc_u_material_specular, 1, material_specular);
+      glUniform1f(shader.loc_u_material_shininess, material_shininess);
+      if(!(features & SHADER_TEXTURE))
+        glUniform4fv(shader.loc_u_diffuse_texture, 1, diffuse_texture);
+      if(features & SHADER_QUANTIZED)
+        glUniformMatrix4fv(shader.loc_u_dequant, 1, GL_FALSE, mat_dequant);
+      if(features & SHADER_SKIN_BUFFER)
+        glUniform1i(shader.loc_u_joint_texture, 1);
+      if(features & SHADER_MORPH)
+        glUniform1i(shader.loc_u_morph_texture, 2);
+      if(features & SHADER_VAT)
+      {
+        const VertexAnimation& va = sm.vat;
+        const float extent[3] = { va.bounds_max[0] - va.bounds_min[0], va.bounds_max[1] - va.bounds_min[1],
+          va.bounds_max[2] - va.bounds_min[2] };
+        glUniform1i(shader.loc_u_vat_texture, 3);
+        glUniform1i(shader.loc_u_vat_vertices, GLint(va.num_vertices));
+        glUniform1f(shader.loc_u_vat_frames, float(va.frames));
+        glUniform1f(shader.loc_u_vat_time, std::fmod(crowd_seconds * va.fps, float(va.frames)));
+        glUniform1i(shader.loc_u_vat_packed, va.format == VAT_PACKED);
+        glUniform3fv(shader.loc_u_vat_min, 1, va.bounds_min);
+        glUniform3fv(shader.loc_u_vat_extent, 1, extent);
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_BUFFER, sm.vat_texture);
+        glActiveTexture(GL_TEXTURE0);
+      }
+    }
+    if (vat)
+      glUniform1i(shader.loc_u_vat_first, vat_first);
+
+    if (morph && (features & SHADER_MORPH))
+    {
+      float weights[MAX_MORPH_WEIGHTS] = {};
+      std::copy(sm.drawing_weights, sm.drawing_weights + std::min<size_t>(sm.num_drawing_weights, MAX_MORPH_WEIGHTS),
+        weights);
+      glActiveTexture(GL_TEXTURE2);
+      glBindTexture(GL_TEXTURE_BUFFER, morph->texture);
+      glActiveTexture(GL_TEXTURE0);
+      glUniform1fv(shader.loc_u_morph_weights, MAX_MORPH_WEIGHTS, weights);
+      glUniform1i(shader.loc_u_morph_normals, morph->has_normals);
+    }
+
+    if (primitive.material > -1)
+    {
+      const tinygltf::Material& material = materials[primitive.material];
+      for (const std::pair<std::string, tinygltf::Parameter> parameter : material.values)
+      {
+        if (parameter.first.compare("baseColorTexture") == 0)
+        {
+          if (parameter.second.TextureIndex() > -1 && (features & SHADER_TEXTURE_ARRAY))
+          {
+            // 배열이 바뀔 때만 bind하고, 텍스처는 layer와 uv 변환으로 고른다.
+            const TextureSlot& slot = sm.texture_slots[parameter.second.TextureIndex()];
+            if (slot.array != bound_texture_array)
+            {
+              glActiveTexture(GL_TEXTURE0);
+              glBindTexture(GL_TEXTURE_2D_ARRAY, slot.array);
+              bound_texture_array = slot.array;
+            }
+            glUniform1i(shader.loc_u_diffuse_texture, 0);
+            glUniform1f(shader.loc_u_layer, slot.layer);
+            glUniform4fv(shader.loc_u_uv_transform, 1, slot.uv_transform);
+            glUniform1f(shader.loc_u_atlas, slot.atlas);
+          }
+          else if (parameter.second.TextureIndex() > -1 && (features & SHADER_TEXTURE))
+          {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, sm.texture_objects[parameter.second.TextureIndex()]);
+
+            glUniform1i(shader.loc_u_diffuse_texture, 0);
+
+            if (stream_textures)
+            {
+              const PrimitiveExtent& extent =
+                sm.primitive_extents[&mesh - &model.meshes[0]][&primitive - &mesh.primitives[0]];
+              request_texture_level(sm, extent, parameter.second.TextureIndex(), mat_model);
+            }
+          }
+
+          // 필터와 wrap은 sampler 객체에 있다. (바뀔 때만 bind)
+          const int texture_index = parameter.second.TextureIndex();
+          if (texture_index > -1 && use_sampler_objects && sm.sampler_objects[texture_index] != bound_sampler)
+          {
+            glBindSampler(0, sm.sampler_objects[texture_index]);
+            bound_sampler = sm.sampler_objects[texture_index];
+          }
+        }
+		    if (parameter.first.compare("baseColorFactor") == 0)
+        {
+          color_tmp[0] = parameter.second.number_array[0];
+          color_tmp[1] = parameter.second.number_array[1];
+          color_tmp[2] = parameter.second.number_array[2];
+          color_tmp[3] = parameter.second.number_array[3];
+          glUniform4fv(shader.loc_u_color, 1, color_tmp);
+        }
+      }
+    }
+    int count=-1;
+
+    for (const std::pair<std::string, int>& attrib : primitive.attributes)
+    {
+      const int accessor_index = attrib.second;
+      const tinygltf::Accessor& accessor = accessors[accessor_index];
+
+      int bufferView_index = accessor.bufferView;
+      const tinygltf::BufferView& bufferView = bufferViews[bufferView_index];
+      const tinygltf::Buffer& buffer = buffers[bufferView.buffer];
+      const int byteStride = accessor.ByteStride(bufferView);
+      count = accessor.count;
+      if (vat && (attrib.first.compare("POSITION") == 0 || attrib.first.compare("NORMAL") == 0))
+        continue;
+
+      if (attrib.first.compare("POSITION") == 0 && skinned)
+      {
+        glBindBuffer(GL_ARRAY_BUFFER, skinned->buffer);
+        glEnableVertexAttribArray(shader.loc_a_position);
+        glVertexAttribPointer(shader.loc_a_position, 3, GL_FLOAT, GL_FALSE,
+          SKINNED_VERTEX_FLOATS * sizeof(float), BUFFER_OFFSET(0));
+      }
+      else if (attrib.first.compare("NORMAL") == 0 && skinned)
+      {
+        glBindBuffer(GL_ARRAY_BUFFER, skinned->buffer);
+        glEnableVertexAttribArray(shader.loc_a_normal);
+        glVertexAttribPointer(shader.loc_a_normal, 3, GL_FLOAT, GL_FALSE,
+          SKINNED_VERTEX_FLOATS * sizeof(float), BUFFER_OFFSET(3 * sizeof(float)));
+      }
+      else if (attrib.first.compare("POSITION") == 0 && morphed)
+      {
+        glBindBuffer(GL_ARRAY_BUFFER, morphed->buffer);
+        glEnableVertexAttribArray(shader.loc_a_position);
+        glVertexAttribPointer(shader.loc_a_position, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+      }
+      else if (attrib.first.compare("NORMAL") == 0 && morphed && morphed->has_normals)
+      {
+        glBindBuffer(GL_ARRAY_BUFFER, morphed->buffer);
+        glEnableVertexAttribArray(shader.loc_a_normal);
+        glVertexAttribPointer(shader.loc_a_normal, 3, GL_FLOAT, GL_FALSE, 0,
+          BUFFER_OFFSET(morphed->positions.size() * sizeof(float)));
+      }
+      else if (attrib.first.compare("POSITION") == 0)
+      {
+        glBindBuffer(bufferView.target, sm.buffer_objects[bufferView_index]);
+        glEnableVertexAttribArray(shader.loc_a_position);
+        glVertexAttribPointer(shader.loc_a_position,
+          accessor.type, accessor.componentType,
+          accessor.normalized ? GL_TRUE : GL_FALSE, byteStride,
+          BUFFER_OFFSET(accessor.byteOffset));
+      }
+      else if (attrib.first.compare("NORMAL") == 0)
+      {
+        glBindBuffer(bufferView.target, sm.buffer_objects[bufferView_index]);
+        glEnableVertexAttribArray(shader.loc_a_normal);
+        glVertexAttribPointer(shader.loc_a_normal,
+          accessor.type, accessor.componentType,
+          accessor.normalized ? GL_TRUE : GL_FALSE, byteStride,
+          BUFFER_OFFSET(accessor.byteOffset));
+        if(features & SHADER_QUANTIZED)
+          glUniform1i(shader.loc_u_normal_oct, accessor.type == TINYGLTF_TYPE_VEC2);
+      }
+      else if (attrib.first.compare("TEXCOORD_0") == 0 && (features & SHADER_TEXTURE))
+      {
+        glBindBuffer(bufferView.target, sm.buffer_objects[bufferView_index]);
+        glEnableVertexAttribArray(shader.loc_a_texcoord);
+        glVertexAttribPointer(shader.loc_a_texcoord,
+          accessor.type, accessor.componentType,
+          accessor.normalized ? GL_TRUE : GL_FALSE, byteStride,
+          BUFFER_OFFSET(accessor.byteOffset));
+      }
+      else if (attrib.first.compare("COLOR_0") == 0 && (features & SHADER_COLOR))
+      {
+        glBindBuffer(bufferView.target, sm.buffer_objects[bufferView_index]);
+        glEnableVertexAttribArray(shader.loc_a_color);
+        glVertexAttribPointer(shader.loc_a_color,
+          accessor.type, accessor.componentType,
+          accessor.normalized ? GL_TRUE : GL_FALSE, byteStride,
+          BUFFER_OFFSET(accessor.byteOffset));
+      }
+      // joint 인덱스는 정규화하지 않은 정수를 float로 받는다.
+      else if (attrib.first.compare("JOINTS_0") == 0 && (features & SHADER_SKIN))
+      {
+        glBindBuffer(bufferView.target, sm.buffer_objects[bufferView_index]);
+        glEnableVertexAttribArray(shader.loc_a_joints);
+        glVertexAttribPointer(shader.loc_a_joints,
+          accessor.type, accessor.componentType,
+          GL_FALSE, byteStride,
+          BUFFER_OFFSET(accessor.byteOffset));
+      }
+      else if (attrib.first.compare("WEIGHTS_0") == 0 && (features & SHADER_SKIN))
+      {
+        glBindBuffer(bufferView.target, sm.buffer_objects[bufferView_index]);
+        glEnableVertexAttribArray(shader.loc_a_weights);
+        glVertexAttribPointer(shader.loc_a_weights,
+          accessor.type, accessor.componentType,
+          accessor.normalized ? GL_TRUE : GL_FALSE, byteStride,
+          BUFFER_OFFSET(accessor.byteOffset));
+      }
+    }
+    if (vat)
+    {
+      glBindBuffer(GL_ARRAY_BUFFER, sm.instance_buffer);
+      glEnableVertexAttribArray(shader.loc_a_instance);
+      glVertexAttribPointer(shader.loc_a_instance, 4, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+      glVertexAttribDivisor(shader.loc_a_instance, 1);
+      ++crowd_stats.draws;
+    }
+    const GLsizei instances = vat ? GLsizei(crowd_instances) : 1;
+    if(primitive.indices!=-1)
+    {
+      const tinygltf::Accessor& index_accessor = accessors[primitive.indices];
+
+      int bufferView_index = index_accessor.bufferView;
+      const tinygltf::BufferView& bufferView = bufferViews[bufferView_index];
+      const tinygltf::Buffer& buffer = buffers[bufferView.buffer];
+
+      glBindBuffer(bufferView.target, sm.buffer_objects[bufferView_index]);
+
+      if (vat)
+        glDrawElementsInstanced(primitive.mode, index_accessor.count, index_accessor.componentType,
+          BUFFER_OFFSET(index_accessor.byteOffset), instances);
+      else
+        glDrawElements(primitive.mode,
+          index_accessor.count,
+          index_accessor.componentType,
+          BUFFER_OFFSET(index_accessor.byteOffset));    
+    }
+    else if (vat)
+    {
+      glDrawArraysInstanced(primitive.mode, 0, count, instances);
+    }
+    else
+    {
+      glDrawArrays(primitive.mode, 0, count);
+    }
+    // 정점 attribute 배열 비활성화 (VAT는 position, normal attribute를 쓰지 않는다)
+    if (vat)
+    {
+      glVertexAttribDivisor(shader.loc_a_instance, 0);
+      glDisableVertexAttribArray(shader.loc_a_instance);
+    }
+    else
+      glDisableVertexAttribArray(shader.loc_a_position);
+    if(features & SHADER_COLOR)
+      glDisableVertexAttribArray(shader.loc_a_color);
+    if(features & SHADER_TEXTURE)
+      glDisableVertexAttribArray(shader.loc_a_texcoord);
+    if((features & SHADER_NORMAL) && !vat)
+      glDisableVertexAttribArray(shader.loc_a_normal);
+    if(features & SHADER_SKIN)
+    {
+      glDisableVertexAttribArray(shader.loc_a_joints);
+      glDisableVertexAttribArray(shader.loc_a_weights);
+    }
+  }
+  glUseProgram(0);
+}
+
+void draw_scene()
+{
+  kmuvcl::math::mat4f mat_model;
+  mat_model.set_to_identity();
+  
+  // set object transformation
+  curr = std::chrono::system_clock::now();
+  std::chrono::duration<float> elaped_seconds = (curr - prev);
+  prev = curr;
+
+  if (g_is_animation)
+  {
+    g_angle += 30.0f * elaped_seconds.count();
+    if (g_angle > 25200.0f)
+    {
+      g_angle = 0.0f;
+    }
+  }
+  update_animations(elaped_seconds.count());
+  update_skin_palettes();
+  if (crowd_instances > 0)
+  {
+    crowd_seconds += elaped_seconds.count();
+    crowd_stats.seconds += elaped_seconds.count();
+    ++crowd_stats.frames;
+  }
+  
+  mat_model = kmuvcl::math::rotate(g_angle*0.7f, 0.0f, 0.0f, 1.0f);
+  mat_model = kmuvcl::math::rotate(g_angle*1.0f, 0.0f, 1.0f, 0.0f)*mat_model;
+  mat_model = kmuvcl::math::rotate(g_angle*0.5f, 1.0f, 0.0f, 0.0f)*mat_model;
+  mat_model = kmuvcl::math::translate(0.0f, 0.0f, -4.0f)*mat_model;
+
+  for (const std::unique_ptr<SceneModel>& sm : scene_models)
+  {
+    if (!sm->is_ready || sm->is_unloading || sm->is_geometry_staging || sm->is_vat_baking)
+      continue;
+
+    const std::vector<tinygltf::Node>& nodes = sm->model.nodes;
+    for (const tinygltf::Scene& scene : sm->model.scenes)
+    {
+      for (size_t i = 0; i < scene.nodes.size(); ++i)
+      {
+        const tinygltf::Node& node = nodes[scene.nodes[i]];
+        draw_node(*sm, node, mat_model * sm->transform);
+      }
+    }
+  }
+
+}
+
+void update_animations(float seconds)
+{
+  for (const std::unique_ptr<SceneModel>& sm : scene_models)
+  {
+    if (!sm->is_ready || sm->is_unloading || sm->animation_clips.empty())
+      continue;
+
+    AnimationInstance& animation = sm->animation;
+    const int clip_index = (size_t(g_animation_clip) < sm->animation_clips.size()) ? g_animation_clip : -1;
+    if (clip_index != sm->animation_clip)
+    {
+      // clip을 바꾸면 처음부터 (채널이 없는 node는 glTF의 값으로 돌려 놓는다)
+      sm->animation_clip = clip_index;
+      init_animation_pose(sm->model, &animation.pose);
+      animation.cursors.clear();
+      sm->is_pose_changed = true;
+      if (clip_index < 0)
+        continue;
+      animation.time = sm->animation_clips[clip_index].start;
+    }
+    else if (clip_index < 0)
+      continue;
+    else
+      animation.time = wrap_animation_time(sm->animation_clips[clip_index], animation.time + seconds);
+
+    sample_animation(sm->animation_clips[clip_index], animation.time, &animation.cursors, &animation.pose);
+    sm->is_pose_changed = true;
+  }
+}
+
+void init_skin_palettes(SceneModel& sm)
+{
+  if (sm.model.skins.empty())
+    return;
+  if (cpu_skinning)
+  {
+    init_cpu_skinning(sm);
+    return;
+  }
+  if (!has_palette_blocks && !has_palette_textures)
+  {
+    std::cout << "WARNING: skinning is not supported by this GL driver, drawing the bind pose" << std::endl;
+    return;
+  }
+
+  std::string err;
+  if (!build_skin_palettes(sm.model, &sm.skin_palettes, &err))
+    std::cout << "skin: " << err << std::endl;
+  bool textures = use_palette_textures || !has_palette_blocks;
+  for (const SkinPalette& palette : sm.skin_palettes)
+    textures = textures || palette.joints.size() > size_t(MAX_PALETTE_JOINTS);
+  if (textures && !has_palette_textures)
+  {
+    std::cout << "WARNING: skins with more than " << MAX_PALETTE_JOINTS
+      << " joints need texture buffers, drawing the bind pose" << std::endl;
+    sm.skin_palettes.clear();
+  }
+  if (sm.skin_palettes.empty())
+    return;
+
+  build_node_hierarchy(sm.model, &sm.node_hierarchy);
+  init_animation_pose(sm.model, &sm.animation.pose);
+  sm.shader_features |= SHADER_SKIN | (textures ? SHADER_SKIN_BUFFER : 0);
+  sm.node_palettes.assign(sm.model.nodes.size(), -1);
+
+  // uniform block은 쉐이더에 선언한 크기만큼 잡는다. 텍스처 buffer는 joint 수만큼
+  const GLenum target = textures ? GL_TEXTURE_BUFFER : GL_UNIFORM_BUFFER;
+  sm.palette_buffers.resize(sm.skin_palettes.size());
+  glGenBuffers(GLsizei(sm.palette_buffers.size()), &sm.palette_buffers[0]);
+  if (textures)
+  {
+    sm.palette_textures.resize(sm.skin_palettes.size());
+    glGenTextures(GLsizei(sm.palette_textures.size()), &sm.palette_textures[0]);
+  }
+  size_t joints = 0;
+  for (size_t i = 0; i < sm.skin_palettes.size(); ++i)
+  {
+    const SkinPalette& palette = sm.skin_palettes[i];
+    const size_t count = textures ? palette.joints.size() : size_t(MAX_PALETTE_JOINTS);
+    sm.node_palettes[palette.node] = int(i);
+    glBindBuffer(target, sm.palette_buffers[i]);
+    glBufferData(target, count * 16 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    if (textures)
+    {
+      glBindTexture(GL_TEXTURE_BUFFER, sm.palette_textures[i]);
+      glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, sm.palette_buffers[i]);
+    }
+    joints += palette.joints.size();
+  }
+  glBindBuffer(target, 0);
+  if (textures)
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+  sm.is_pose_changed = true;
+
+  std::cout << "skins: " << sm.skin_palettes.size() << " palettes, " << joints << " joints ("
+    << (textures ? "texture buffer" : "uniform block") << ", " << skinning_impl_name() << ")" << std::endl;
+}
+
+void update_skin_palettes()
+{
+  for (const std::unique_ptr<SceneModel>& sm : scene_models)
+  {
+    if (!sm->is_ready || sm->is_unloading || sm->skin_palettes.empty() || !sm->is_pose_changed)
+      continue;
+
+    compute_world_matrices(sm->model, sm->node_hierarchy, sm->animation.pose, &sm->world_matrices);
+    for (SkinPalette& palette : sm->skin_palettes)
+      compute_joint_matrices(sm->world_matrices, &palette);
+    sm->is_pose_changed = false;
+    if (!sm->skinned_primitives.empty())
+    {
+      skin_primitives_on_cpu(*sm);
+      continue;
+    }
+
+    const GLenum target = (sm->shader_features & SHADER_SKIN_BUFFER) ? GL_TEXTURE_BUFFER : GL_UNIFORM_BUFFER;
+    for (size_t i = 0; i < sm->skin_palettes.size(); ++i)
+    {
+      const SkinPalette& palette = sm->skin_palettes[i];
+      glBindBuffer(target, sm->palette_buffers[i]);
+      glBufferSubData(target, 0, palette.matrices.size() * sizeof(float), &palette.matrices[0]);
+    }
+    glBindBuffer(target, 0);
+
+    if (skin_check && !sm->is_skin_checked)
+    {
+      check_gpu_skinning(*sm);
+      sm->is_skin_checked = true;
+    }
+  }
+}
+
+// --cpu-skinning: skin을 쓰는 node의 primitive마다 원래 정점을 읽어 두고 skinning 결과를 담을 buffer를 만든다.
+// (쉐이더는 skin이 없는 variant를 쓰고 position, normal만 이 buffer에서 읽는다)
+void init_cpu_skinning(SceneModel& sm)
+{
+  if (quantize_vertices || !(GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range))
+  {
+    std::cout << "WARNING: --cpu-skinning needs float positions and glMapBufferRange, drawing the bind pose" << std::endl;
+    return;
+  }
+
+  const tinygltf::Model& model = sm.model;
+  std::string err;
+  if (!build_skin_palettes(model, &sm.skin_palettes, &err))
+    std::cout << "skin: " << err << std::endl;
+  build_node_hierarchy(model, &sm.node_hierarchy);
+  init_animation_pose(model, &sm.animation.pose);
+  sm.node_palettes.assign(model.nodes.size(), -1);
+  sm.palette_primitives.resize(sm.skin_palettes.size());
+
+  size_t vertices = 0;
+  for (size_t i = 0; i < sm.skin_palettes.size(); ++i)
+  {
+    const SkinPalette& palette = sm.skin_palettes[i];
+    const tinygltf::Mesh& mesh = model.meshes[model.nodes[palette.node].mesh];
+    sm.node_palettes[palette.node] = int(i);
+    sm.palette_primitives[i].assign(mesh.primitives.size(), -1);
+    for (size_t j = 0; j < mesh.primitives.size(); ++j)
+    {
+      SkinnedPrimitive sp;
+      sp.palette = int(i);
+      if (!read_skinned_vertices(model, mesh.primitives[j], &sp.vertices) || sp.vertices.size() == 0)
+        continue;
+      const MorphPrimitive* morph = find_morph(sm, model.nodes[palette.node].mesh, j);
+      if (morph && morph->base_positions.size() == sp.vertices.positions.size())
+        sp.morph = int(morph - &sm.morph_primitives[0]);
+      glGenBuffers(1, &sp.buffer);
+      glBindBuffer(GL_ARRAY_BUFFER, sp.buffer);
+      glBufferData(GL_ARRAY_BUFFER, sp.vertices.size() * SKINNED_VERTEX_FLOATS * sizeof(float), nullptr, GL_STREAM_DRAW);
+      sm.palette_primitives[i][j] = int(sm.skinned_primitives.size());
+      vertices += sp.vertices.size();
+      sm.skinned_primitives.push_back(std::move(sp));
+    }
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  if (!skinning_pool)
+    skinning_pool.reset(new ThreadPool());
+  sm.is_pose_changed = true;
+
+  std::cout << "skins: " << sm.skin_palettes.size() << " palettes, " << sm.skinned_primitives.size()
+    << " primitives, " << vertices << " vertices (CPU " << skinning_impl_name() << ", "
+    << skinning_pool->size() << " threads)" << std::endl;
+}
+
+// 모든 skinned primitive의 buffer를 매핑해 두고 worker들이 정점 묶음씩 바로 쓴다.
+void skin_primitives_on_cpu(SceneModel& sm)
+{
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  std::vector<SkinJob> jobs;
+  std::vector<SkinnedPrimitive*> mapped;
+  const AnimationPose& pose = sm.animation.pose;
+  for (SkinnedPrimitive& sp : sm.skinned_primitives)
+  {
+    const SkinPalette& palette = sm.skin_palettes[sp.palette];
+    if (sp.morph >= 0)
+    {
+      // 섞은 정점을 skinning한다. (weight는 mesh node의 것)
+      const MorphPrimitive& mp = sm.morph_primitives[sp.morph];
+      const float* weights = pose.weights.data() + pose.weight_offsets[palette.node];
+      const size_t num_weights = pose.weight_counts[palette.node];
+      apply_morph_targets(&mp.base_positions[0], sp.vertices.size(), mp.targets.positions, weights, num_weights,
+        &sp.vertices.positions[0]);
+      if (mp.has_normals && mp.base_normals.size() == sp.vertices.normals.size())
+        apply_morph_targets(&mp.base_normals[0], sp.vertices.size(), mp.targets.normals, weights, num_weights,
+          &sp.vertices.normals[0]);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, sp.buffer);
+    void* out = glMapBufferRange(GL_ARRAY_BUFFER, 0, sp.vertices.size() * SKINNED_VERTEX_FLOATS * sizeof(float),
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!out)
+      continue;
+    SkinJob job;
+    job.vertices = &sp.vertices;
+    job.joint_matrices = &palette.matrices[0];
+    job.num_joints = palette.joints.size();
+    job.out = static_cast<float*>(out);
+    jobs.push_back(job);
+    mapped.push_back(&sp);
+  }
+
+  skin_vertices_jobs(jobs, *skinning_pool);
+
+  for (size_t i = 0; i < mapped.size(); ++i)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, mapped[i]->buffer);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    mapped[i]->bounds = jobs[i].bounds;
+    skinning_stats.vertices += mapped[i]->vertices.size();
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  skinning_stats.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+  ++skinning_stats.updates;
+}
+
+void print_skinning_stats()
+{
+  const double updates = double(std::max<size_t>(skinning_stats.updates, 1));
+  std::printf("cpu skinning (%s, %u threads): %zu updates, %.3f ms and %.0f vertices per update (%.1f Mvert/s), "
+    "drawn %zu / culled %zu primitives\n", skinning_impl_name(), skinning_pool ? skinning_pool->size() : 0u,
+    skinning_stats.updates, skinning_stats.ms / updates, skinning_stats.vertices / updates,
+    skinning_stats.vertices / std::max(skinning_stats.ms * 1000.0, 1e-9), skinning_stats.drawn, skinning_stats.culled);
+}
+
+// targets가 있는 primitive마다 0이 아닌 delta만 스트림으로 풀고, GPU면 정점별 표를 텍스처 buffer로 올린다.
+// CPU 경로는 원래 position, normal을 읽어 두고 섞은 결과를 담을 buffer를 만든다. (--cpu-skinning이 skinning하는 primitive는
+// skinning 입력에 바로 섞으므로 buffer가 없다)
+void init_morph_targets(SceneModel& sm)
+{
+  const tinygltf::Model& model = sm.model;
+  bool has_targets = false;
+  for (const tinygltf::Mesh& mesh : model.meshes)
+    for (const tinygltf::Primitive& primitive : mesh.primitives)
+      has_targets = has_targets || !primitive.targets.empty();
+  if (!has_targets)
+    return;
+  if (quantize_vertices)
+  {
+    std::cout << "WARNING: morph targets are not supported with --quantize, drawing the base mesh" << std::endl;
+    return;
+  }
+
+  GLint max_texels = 0;
+  if (has_palette_textures)
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+  if (sm.animation.pose.weight_counts.size() != model.nodes.size())
+    init_animation_pose(model, &sm.animation.pose);
+
+  std::string err;
+  std::vector<float> texels;
+  size_t gpu = 0, cpu = 0, deltas = 0, texture_bytes = 0;
+  sm.mesh_morphs.resize(model.meshes.size());
+  for (size_t i = 0; i < model.meshes.size(); ++i)
+  {
+    const std::vector<tinygltf::Primitive>& primitives = model.meshes[i].primitives;
+    sm.mesh_morphs[i].assign(primitives.size(), -1);
+    for (size_t j = 0; j < primitives.size(); ++j)
+    {
+      const tinygltf::Primitive& primitive = primitives[j];
+      MorphPrimitive mp;
+      if (!build_morph_targets(model, primitive, &mp.targets, &err))
+        continue;
+      std::map<std::string, int>::const_iterator normal = primitive.attributes.find("NORMAL");
+      mp.has_normals = normal != primitive.attributes.end() && !mp.targets.normals.empty();
+
+      const bool cpu_skinned = cpu_skinning && !model.skins.empty() && primitive.attributes.count("JOINTS_0") > 0;
+      bool on_gpu = has_palette_textures && !cpu_morph && !cpu_skinned &&
+        mp.targets.positions.size() <= size_t(MAX_MORPH_WEIGHTS);
+      if (on_gpu)
+      {
+        build_morph_texels(mp.targets, mp.has_normals, &texels);
+        on_gpu = texels.size() / 4 <= size_t(max_texels);
+      }
+      if (on_gpu)
+      {
+        glGenBuffers(1, &mp.texture_buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, mp.texture_buffer);
+        glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(float), &texels[0], GL_STATIC_DRAW);
+        glGenTextures(1, &mp.texture);
+        glBindTexture(GL_TEXTURE_BUFFER, mp.texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, mp.texture_buffer);
+        texture_bytes += texels.size() * sizeof(float);
+        ++gpu;
+      }
+      else
+      {
+        const tinygltf::Accessor& position = model.accessors[primitive.attributes.find("POSITION")->second];
+        if (!read_accessor_floats(model, position, &mp.base_positions) ||
+          (mp.has_normals && !read_accessor_floats(model, model.accessors[normal->second], &mp.base_normals)))
+        {
+          err += "cannot read the base mesh of morph targets\n";
+          continue;
+        }
+        if (!cpu_skinned)
+        {
+          mp.positions.resize(mp.base_positions.size());
+          mp.normals.resize(mp.base_normals.size());
+          glGenBuffers(1, &mp.buffer);
+          glBindBuffer(GL_ARRAY_BUFFER, mp.buffer);
+          glBufferData(GL_ARRAY_BUFFER, (mp.positions.size() + mp.normals.size()) * sizeof(float), nullptr,
+            GL_STREAM_DRAW);
+        }
+        ++cpu;
+      }
+      deltas += mp.targets.num_deltas();
+      sm.mesh_morphs[i][j] = int(sm.morph_primitives.size());
+      sm.morph_primitives.push_back(std::move(mp));
+    }
+  }
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  if (!err.empty())
+    std::cout << "morph: " << err << std::endl;
+  std::cout << "morph targets: " << gpu + cpu << " primitives (" << gpu << " texture buffer, " << cpu << " CPU "
+    << morph_impl_name() << "), " << deltas << " non-zero deltas, " << texture_bytes << " texture bytes" << std::endl;
+}
 
-    mat_node(3, 0) = node.matrix[12];
-    mat_node(3, 1) = node.matrix[13];
-    mat_node(3, 2) = node.matrix[14];
-    mat_node(3, 3) = node.matrix[15];
+MorphPrimitive* find_morph(SceneModel& sm, size_t mesh, size_t primitive)
+{
+  if (sm.mesh_morphs.empty() || sm.mesh_morphs[mesh][primitive] < 0)
+    return nullptr;
+  return &sm.morph_primitives[sm.mesh_morphs[mesh][primitive]];
+}
 
-    mat_model = mat_model * mat_node;
-  }
+// CPU morph: weight가 바뀌었을 때만 다시 섞어서 올린다.
+void update_cpu_morph(MorphPrimitive& mp, const float* weights, size_t num_weights)
+{
+  std::vector<float> current(mp.targets.positions.size(), 0.0f);
+  std::copy(weights, weights + std::min(num_weights, current.size()), current.begin());
+  if (current == mp.applied_weights)
+    return;
+
+  const size_t num_vertices = mp.targets.num_vertices;
+  apply_morph_targets(&mp.base_positions[0], num_vertices, mp.targets.positions, &current[0], current.size(),
+    &mp.positions[0]);
+  if (mp.has_normals)
+    apply_morph_targets(&mp.base_normals[0], num_vertices, mp.targets.normals, &current[0], current.size(),
+      &mp.normals[0]);
+
+  glBindBuffer(GL_ARRAY_BUFFER, mp.buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, mp.positions.size() * sizeof(float), &mp.positions[0]);
+  if (mp.has_normals)
+    glBufferSubData(GL_ARRAY_BUFFER, mp.positions.size() * sizeof(float), mp.normals.size() * sizeof(float),
+      &mp.normals[0]);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  mp.applied_weights.swap(current);
+}
 
-  if (node.mesh > -1)
+// clip 0을 VAT로 굽기 시작한다. 렌더링 스레드를 막지 않도록 vat_thread에서 굽고 (frame들은 loader_pool의 worker들이
+// 나눠 skinning), 끝나면 update_scene이 finish_crowd()로 올린다. 구울 수 없으면 (--crowd 없이처럼) 모델 하나를
+// GPU skinning으로 그린다.
+void init_crowd(SceneModel& sm)
+{
+  // 굽는 쪽(read_skinned_vertices)은 float position과 vec3 normal을 읽는다. (--quantize는 양자화 전 정점이 없음)
+  if (quantize_vertices)
   {
-    draw_mesh(meshes[node.mesh], mat_model);
+    std::cout << "WARNING: --crowd needs float positions, drawing one GPU-skinned model" << std::endl;
+    init_skin_palettes(sm);
+    return;
   }
-
-  for (size_t i = 0; i < node.children.size(); ++i)
+  if (!has_instancing || !has_palette_textures || sm.animation_clips.empty())
   {
-    draw_node(nodes[node.children[i]], mat_model);
+    std::cout << "WARNING: --crowd needs an animation clip, instanced arrays and texture buffers" << std::endl;
+    init_skin_palettes(sm);
+    return;
   }
+
+  // 굽는 동안 렌더링 스레드는 model을 고치지 않고 vat를 읽지 않는다. (그리지 않음)
+  // loader_pool의 작업 안에서는 parallel_for를 부를 수 없으므로 파싱 스레드처럼 따로 스레드를 둔다.
+  SceneModel* target = &sm;
+  const VatFormat format = vat_float ? VAT_FLOAT : VAT_PACKED;
+  sm.is_vat_baking = true;
+  sm.vat_thread = std::thread([target, format] {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    target->is_vat_ok = bake_vertex_animation(target->model, target->animation_clips[0], vat_fps, format, loader_pool,
+      &target->vat, &target->vat_err);
+    target->vat_bake_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    target->is_vat_baked = true;
+  });
 }
 
-void draw_mesh(const tinygltf::Mesh& mesh, const kmuvcl::math::mat4f& mat_model)
+// vat_thread가 끝나면 update_scene에서 호출한다. VAT를 텍스처 buffer에 올리고, instance를 VAT의 bounds 간격으로
+// 격자에 놓는다. 구운 것이 없거나 너무 크면 모델 하나를 GPU skinning으로 그린다.
+void finish_crowd(SceneModel& sm)
 {
-  const std::vector<tinygltf::Material>& materials = model.materials;
-  const std::vector<tinygltf::Texture>& textures = model.textures;
-  const std::vector<tinygltf::Accessor>& accessors = model.accessors;
-  const std::vector<tinygltf::BufferView>& bufferViews = model.bufferViews;
-  const std::vector<tinygltf::Buffer>& buffers = model.buffers;
+  sm.vat_thread.join();
+  sm.is_vat_baking = false;
+  if (!sm.vat_err.empty())
+    std::cout << "skin: " << sm.vat_err << std::endl;
+  GLint max_texels = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+  if (!sm.is_vat_ok || sm.vat.num_texels() > size_t(max_texels))
+  {
+    std::cout << "WARNING: cannot bake a vertex animation texture (" << sm.vat.num_texels() << " texels, max "
+      << max_texels << "), try a lower --vat-fps" << std::endl;
+    sm.vat = VertexAnimation();
+    init_skin_palettes(sm);
+    return;
+  }
 
-  glUseProgram(program);
-  mat_PVM = mat_proj * mat_view* kmuvcl::math::translate<float>(m_translate_x, m_translate_y, m_translate_z) * mat_model;
-  glUniformMatrix4fv(loc_u_PVM, 1, GL_FALSE, mat_PVM);
-  glUniformMatrix4fv(loc_u_M, 1, GL_FALSE, mat_model);
+  glGenBuffers(1, &sm.vat_buffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, sm.vat_buffer);
+  if (sm.vat.format == VAT_FLOAT)
+    glBufferData(GL_TEXTURE_BUFFER, sm.vat.bytes(), &sm.vat.texels_float[0], GL_STATIC_DRAW);
+  else
+    glBufferData(GL_TEXTURE_BUFFER, sm.vat.bytes(), &sm.vat.texels_packed[0], GL_STATIC_DRAW);
+  glGenTextures(1, &sm.vat_texture);
+  glBindTexture(GL_TEXTURE_BUFFER, sm.vat_texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, sm.vat.format == VAT_FLOAT ? GL_RGBA32F : GL_RGBA16, sm.vat_buffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  // 그리는 데는 frames, fps, bounds, num_vertices, primitives만 쓰므로 올린 텍셀은 놓는다.
+  std::vector<float>().swap(sm.vat.texels_float);
+  std::vector<uint16_t>().swap(sm.vat.texels_packed);
+
+  // draw_node가 palette로 primitive의 첫 정점을 찾는다.
+  sm.node_palettes.assign(sm.model.nodes.size(), -1);
+  for (const VatPrimitive& vp : sm.vat.primitives)
+  {
+    if (sm.vat_first.size() <= size_t(vp.palette))
+      sm.vat_first.resize(vp.palette + 1);
+    std::vector<int>& first = sm.vat_first[vp.palette];
+    if (first.empty())
+      first.assign(sm.model.meshes[sm.model.nodes[vp.node].mesh].primitives.size(), -1);
+    first[vp.primitive] = int(vp.first_vertex);
+    sm.node_palettes[vp.node] = vp.palette;
+  }
 
-  view_position_wc[0] = mat_view(0, 3);
-  view_position_wc[1] = mat_view(1, 3);
-  view_position_wc[2] = mat_view(2, 3);
-  glUniform3fv(loc_u_view_position_wc, 1, view_position_wc);
-  glUniform3fv(loc_u_light_position_wc, 1, light_position_wc);
+  // mesh 좌표의 x, z 격자에 가운데를 맞춰 놓고, 재생 시각은 황금비로 흩는다.
+  const float spacing = 1.25f * std::max(sm.vat.bounds_max[0] - sm.vat.bounds_min[0],
+    sm.vat.bounds_max[2] - sm.vat.bounds_min[2]);
+  const size_t side = size_t(std::ceil(std::sqrt(double(crowd_instances))));
+  const size_t rows = (crowd_instances + side - 1) / side;
+  std::vector<float> instances(crowd_instances * 4, 0.0f);
+  for (size_t i = 0; i < crowd_instances; ++i)
+  {
+    instances[i * 4] = (float(i % side) - 0.5f * float(side - 1)) * spacing;
+    instances[i * 4 + 2] = (float(i / side) - 0.5f * float(rows - 1)) * spacing;
+    instances[i * 4 + 3] = std::fmod(float(i) * 0.618034f, 1.0f) * float(sm.vat.frames);
+  }
+  glGenBuffers(1, &sm.instance_buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, sm.instance_buffer);
+  glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(float), &instances[0], GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  std::printf("crowd: %zu instances, %zu vertices each, VAT %d frames at %.1f fps (%s) %.2f MB, baked in %.1f ms\n",
+    crowd_instances, sm.vat.num_vertices, sm.vat.frames, sm.vat.fps, sm.vat.format == VAT_FLOAT ? "float" : "packed",
+    sm.vat.bytes() / 1048576.0, sm.vat_bake_ms);
+}
 
-  glUniform4fv(loc_u_light_ambient, 1, light_ambient);
-  glUniform4fv(loc_u_light_diffuse, 1, light_diffuse);
-  glUniform4fv(loc_u_light_specular, 1, light_specular);
-  
-  glUniform4fv(loc_u_material_ambient, 1, material_ambient);
-  glUniform4fv(loc_u_material_specular, 1, material_specular);
-  glUniform1f(loc_u_material_shininess, material_shininess);
-  if(!shader_flag[1])
-    glUniform4fv(loc_u_diffuse_texture, 1, diffuse_texture);
+bool has_baked_primitive(const SceneModel& sm, size_t mesh, size_t primitive)
+{
+  for (const VatPrimitive& vp : sm.vat.primitives)
+  {
+    if (size_t(sm.model.nodes[vp.node].mesh) == mesh && size_t(vp.primitive) == primitive)
+      return true;
+  }
+  return false;
+}
 
+// VAT의 크기와 프레임 시간을 같이 보여 준다. (--vat-fps, --vat-float로 바꿔 가며 비교)
+void print_crowd_stats()
+{
+  size_t bytes = 0;
+  for (const std::unique_ptr<SceneModel>& sm : scene_models)
+    bytes += sm->is_vat_baking ? 0 : sm->vat.bytes();
+  const double frames = double(std::max<size_t>(crowd_stats.frames, 1));
+  std::printf("crowd: %zu instances in %.0f draws per frame, VAT %.2f MB, %.2f ms/frame (%.1f fps)\n",
+    crowd_instances, crowd_stats.draws / frames, bytes / 1048576.0, crowd_stats.seconds * 1000.0 / frames,
+    crowd_stats.seconds > 0.0 ? frames / crowd_stats.seconds : 0.0);
+}
 
-  for (const tinygltf::Primitive& primitive : mesh.primitives)
+// AABB의 꼭짓점 8개가 모두 clip 공간의 한 평면 밖에 있으면 보이지 않는다.
+bool is_box_visible(const kmuvcl::math::mat4f& mat_PVM, const SkinBounds& bounds)
+{
+  if (bounds.min[0] > bounds.max[0])
+    return false;
+  int outside[6] = { 0, 0, 0, 0, 0, 0 };
+  for (int corner = 0; corner < 8; ++corner)
   {
-    if (primitive.material > -1)
+    const float p[3] = {
+      (corner & 1) ? bounds.max[0] : bounds.min[0],
+      (corner & 2) ? bounds.max[1] : bounds.min[1],
+      (corner & 4) ? bounds.max[2] : bounds.min[2] };
+    float clip[4];
+    for (int r = 0; r < 4; ++r)
+      clip[r] = mat_PVM(r, 0) * p[0] + mat_PVM(r, 1) * p[1] + mat_PVM(r, 2) * p[2] + mat_PVM(r, 3);
+    for (int axis = 0; axis < 3; ++axis)
     {
-      const tinygltf::Material& material = materials[primitive.material];
-      for (const std::pair<std::string, tinygltf::Parameter> parameter : material.values)
-      {
-        if (parameter.first.compare("baseColorTexture") == 0)
-        {
-          if (parameter.second.TextureIndex() > -1)
-          {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, diffuse_texid);
-
-            glUniform1i(loc_u_diffuse_texture, 0);
-          }
-        }
-		    if (parameter.first.compare("baseColorFactor") == 0)
-        {
-          color_tmp[0] = parameter.second.number_array[0];
-          color_tmp[1] = parameter.second.number_array[1];
-          color_tmp[2] = parameter.second.number_array[2];
-          color_tmp[3] = parameter.second.number_array[3];
-          glUniform4fv(loc_u_color, 1, color_tmp);
-        }
-      }
+      outside[axis * 2] += clip[axis] < -clip[3];
+      outside[axis * 2 + 1] += clip[axis] > clip[3];
     }
-    int count=-1;
+  }
+  for (int plane = 0; plane < 6; ++plane)
+  {
+    if (outside[plane] == 8)
+      return false;
+  }
+  return true;
+}
 
-    for (const std::pair<std::string, int>& attrib : primitive.attributes)
-    {
-      const int accessor_index = attrib.second;
-      const tinygltf::Accessor& accessor = accessors[accessor_index];
+// uniform block은 binding point에, 텍스처 buffer는 1번 unit에 bind한다. (0번은 baseColor 텍스처)
+void bind_skin_palette(const SceneModel& sm, int palette)
+{
+  if (sm.shader_features & SHADER_SKIN_BUFFER)
+  {
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, sm.palette_textures[palette]);
+    glActiveTexture(GL_TEXTURE0);
+  }
+  else
+    glBindBufferBase(GL_UNIFORM_BUFFER, JOINT_PALETTE_BINDING, sm.palette_buffers[palette]);
+}
 
-      int bufferView_index = accessor.bufferView;
-      const tinygltf::BufferView& bufferView = bufferViews[bufferView_index];
-      const tinygltf::Buffer& buffer = buffers[bufferView.buffer];
-      const int byteStride = accessor.ByteStride(bufferView);
-      count = accessor.count;
+// 첫 skinned primitive를 그리는 것과 같은 쉐이더 소스로 transform feedback에 받아 skin_vertices_reference()와 비교한다.
+// (u_M을 단위 행렬로 두므로 v_position_wc, v_normal_wc가 mesh 좌표의 skinning 결과)
+void check_gpu_skinning(const SceneModel& sm)
+{
+  if (quantize_vertices || !GLEW_VERSION_3_0)
+  {
+    std::cout << "skin check: skipped (needs GL 3.0 transform feedback and float positions)" << std::endl;
+    return;
+  }
 
-      if (attrib.first.compare("POSITION") == 0)
-      {
-        glBindBuffer(bufferView.target, position_buffer);
-        glEnableVertexAttribArray(loc_a_position);
-        glVertexAttribPointer(loc_a_position,
-          accessor.type, accessor.componentType,
-          accessor.normalized ? GL_TRUE : GL_FALSE, byteStride,
-          BUFFER_OFFSET(accessor.byteOffset));
-      }
-      else if (attrib.first.compare("NORMAL") == 0)
+  const tinygltf::Model& model = sm.model;
+  for (const SkinPalette& palette : sm.skin_palettes)
+  {
+    const int mesh_index = model.nodes[palette.node].mesh;
+    const std::vector<PrimitiveShader>& shaders = sm.primitive_shaders[mesh_index];
+    for (size_t j = 0; j < shaders.size(); ++j)
+    {
+      const tinygltf::Primitive& primitive = model.meshes[mesh_index].primitives[j];
+      SkinnedVertices vertices;
+      if (!(shaders[j].features & SHADER_SKIN) || !read_skinned_vertices(model, primitive, &vertices))
+        continue;
+      std::vector<float> cpu_positions, cpu_normals;
+      skin_vertices_reference(vertices, &palette.matrices[0], palette.joints.size(), &cpu_positions, &cpu_normals);
+
+      std::string codes[2];
+      init_code(shaders[j].features, &codes[0], &codes[1]);
+      const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+      GLuint program = glCreateProgram();
+      GLuint stages[2];
+      for (int s = 0; s < 2; ++s)
       {
-        glBindBuffer(bufferView.target, normal_buffer);
-        glEnableVertexAttribArray(loc_a_normal);
-        glVertexAttribPointer(loc_a_normal,
-          accessor.type, accessor.componentType,
-          accessor.normalized ? GL_TRUE : GL_FALSE, byteStride,
-          BUFFER_OFFSET(accessor.byteOffset));
+        const char* source = codes[s].c_str();
+        stages[s] = glCreateShader(types[s]);
+        glShaderSource(stages[s], 1, &source, nullptr);
+        glCompileShader(stages[s]);
+        glAttachShader(program, stages[s]);
       }
-      else if (attrib.first.compare("TEXCOORD_0") == 0)
+      const char* varyings[2] = { "v_position_wc", "v_normal_wc" };
+      glTransformFeedbackVaryings(program, 2, varyings, GL_INTERLEAVED_ATTRIBS);
+      glLinkProgram(program);
+      GLint linked = GL_FALSE;
+      glGetProgramiv(program, GL_LINK_STATUS, &linked);
+
+      const size_t count = vertices.size();
+      std::vector<float> gpu(count * 6, 0.0f);
+      if (linked == GL_TRUE)
       {
-        glBindBuffer(bufferView.target, texcoord_buffer);
-        glEnableVertexAttribArray(loc_a_texcoord);
-        glVertexAttribPointer(loc_a_texcoord,
-          accessor.type, accessor.componentType,
-          accessor.normalized ? GL_TRUE : GL_FALSE, byteStride,
-          BUFFER_OFFSET(accessor.byteOffset));
+        kmuvcl::math::mat4f identity;
+        identity.set_to_identity();
+        glUseProgram(program);
+        glUniformMatrix4fv(glGetUniformLocation(program, "u_M"), 1, GL_FALSE, identity);
+        glUniformMatrix4fv(glGetUniformLocation(program, "u_PVM"), 1, GL_FALSE, identity);
+        glUniform1i(glGetUniformLocation(program, "u_joint_texture"), 1);
+        const GLuint block = glGetUniformBlockIndex(program, "JointPalette");
+        if (block != GL_INVALID_INDEX)
+          glUniformBlockBinding(program, block, JOINT_PALETTE_BINDING);
+        bind_skin_palette(sm, int(&palette - &sm.skin_palettes[0]));
+
+        // 그릴 때와 같은 buffer에서 읽는다. (JOINTS_0만 정규화하지 않음)
+        static const char* names[4][2] = { { "POSITION", "a_position" }, { "NORMAL", "a_normal" },
+          { "JOINTS_0", "a_joints" }, { "WEIGHTS_0", "a_weights" } };
+        std::vector<GLint> enabled;
+        for (int a = 0; a < 4; ++a)
+        {
+          std::map<std::string, int>::const_iterator it = primitive.attributes.find(names[a][0]);
+          const GLint location = glGetAttribLocation(program, names[a][1]);
+          if (it == primitive.attributes.end() || location < 0)
+            continue;
+          const tinygltf::Accessor& accessor = model.accessors[it->second];
+          const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+          glBindBuffer(GL_ARRAY_BUFFER, sm.buffer_objects[accessor.bufferView]);
+          glEnableVertexAttribArray(location);
+          glVertexAttribPointer(location, accessor.type, accessor.componentType,
+            (accessor.normalized && a != 2) ? GL_TRUE : GL_FALSE, accessor.ByteStride(view),
+            BUFFER_OFFSET(accessor.byteOffset));
+          enabled.push_back(location);
+        }
+
+        GLuint feedback;
+        glGenBuffers(1, &feedback);
+        glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, feedback);
+        glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, gpu.size() * sizeof(float), nullptr, GL_STATIC_READ);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedback);
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, GLsizei(count));
+        glEndTransformFeedback();
+        glDisable(GL_RASTERIZER_DISCARD);
+        glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, gpu.size() * sizeof(float), &gpu[0]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glDeleteBuffers(1, &feedback);
+
+        for (GLint location : enabled)
+          glDisableVertexAttribArray(location);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glUseProgram(0);
       }
-      else if (attrib.first.compare("COLOR_0") == 0)
+      for (int s = 0; s < 2; ++s)
+        glDeleteShader(stages[s]);
+      glDeleteProgram(program);
+
+      float position_error = 0.0f, normal_error = 0.0f;
+      for (size_t v = 0; v < count; ++v)
       {
-        glBindBuffer(bufferView.target, color_buffer);
-        glEnableVertexAttribArray(loc_a_color);
-        glVertexAttribPointer(loc_a_color,
-          accessor.type, accessor.componentType,
-          accessor.normalized ? GL_TRUE : GL_FALSE, 0,
-          BUFFER_OFFSET(accessor.byteOffset));
+        for (int c = 0; c < 3; ++c)
+        {
+          position_error = std::max(position_error, std::fabs(gpu[v * 6 + c] - cpu_positions[v * 3 + c]));
+          if (!cpu_normals.empty())
+            normal_error = std::max(normal_error, std::fabs(gpu[v * 6 + 3 + c] - cpu_normals[v * 3 + c]));
+        }
       }
+      std::printf("skin check: mesh %d primitive %zu, %zu vertices, %zu joints: %s, max error position %g, normal %g\n",
+        mesh_index, j, count, palette.joints.size(), linked == GL_TRUE ? "GPU vs CPU" : "link failed", position_error,
+        normal_error);
+      return;
     }
-    if(primitive.indices!=-1)
-    {
-      const tinygltf::Accessor& index_accessor = accessors[primitive.indices];
+  }
+}
 
-      int bufferView_index = index_accessor.bufferView;
-      const tinygltf::BufferView& bufferView = bufferViews[bufferView_index];
-      const tinygltf::Buffer& buffer = buffers[bufferView.buffer];
+SceneModel* add_scene_model(const std::string& filename, const kmuvcl::math::mat4f& transform)
+{
+  std::unique_ptr<SceneModel> sm(new SceneModel);
+  sm->filename = filename;
+  sm->transform = transform;
+  sm->start = std::chrono::system_clock::now();
 
-      glBindBuffer(bufferView.target, index_buffer);
+  scene_models.push_back(std::move(sm));
+  return scene_models.back().get();
+}
 
-      glDrawElements(primitive.mode,
-        index_accessor.count,
-        index_accessor.componentType,
-        BUFFER_OFFSET(index_accessor.byteOffset));    
-    }
-    else
+// 바로 지우지 않는다. 디코딩 작업이 남아 있으면 update_scene()이 끝날 때까지 기다렸다가 지운다.
+void remove_scene_model(SceneModel* sm)
+{
+  sm->is_unloading = true;
+}
+
+void init_scene_model(SceneModel& sm)
+{
+  // 양자화하기 전에 잰다. (메시 좌표 그대로)
+  if (stream_textures)
+    measure_primitives(sm);
+  if (quantize_vertices)
+  {
+    size_t before = vertex_attribute_bytes(sm.model);
+    quantize_meshes(sm.model, &sm.mesh_dequant);
+    sm.shader_features |= SHADER_QUANTIZED;
+    std::cout << "vertex attributes: " << before << " -> " << vertex_attribute_bytes(sm.model) << " bytes" << std::endl;
+  }
+  if (!sm.model.animations.empty())
+  {
+    std::string err;
+    if (!build_animation_clips(sm.model, &sm.animation_clips, &err))
+      std::cout << "animation: " << err << std::endl;
+    size_t channels = 0, keys = 0;
+    for (const AnimationClip& clip : sm.animation_clips)
     {
-      glDrawArrays(primitive.mode, 0, count);
+      channels += clip.channels.size();
+      keys += clip.num_keys();
     }
-    // 정점 attribute 배열 비활성화
-    glDisableVertexAttribArray(loc_a_position);
-    if(shader_flag[0])
-      glDisableVertexAttribArray(loc_a_color);
-    if(shader_flag[1])
-      glDisableVertexAttribArray(loc_a_texcoord);
-    if(shader_flag[3])
-      glDisableVertexAttribArray(loc_a_normal);
+    std::cout << "animations: " << sm.animation_clips.size() << " clips, " << channels << " channels, " << keys
+      << " keys" << std::endl;
   }
-  glUseProgram(0);
+  // GPU의 VBO를 초기화하는 함수 호출
+  std::vector<bool> needed_images;
+  init_buffer_objects(sm);
+  if (use_texture_arrays && (sm.shader_features & SHADER_TEXTURE))
+    sm.shader_features |= SHADER_TEXTURE_ARRAY;
+  init_texture_objects(sm, &needed_images);
+  sm.loader->start_decoding(needed_images);
+  std::cout << "shared: " << resource_cache.buffer_hits() << " buffers (" << resource_cache.buffer_bytes_saved()
+    << " bytes), " << resource_cache.texture_hits() << " textures, " << resource_cache.num_samplers() << " sampler objects"
+    << std::endl;
+
+  init_morph_targets(sm);
+  if (crowd_instances > 0 && !sm.model.skins.empty())
+    init_crowd(sm);
+  else
+    init_skin_palettes(sm);
+  // --crowd: VAT를 읽는 primitive는 다 구워야 알 수 있으므로 쉐이더는 finish_crowd() 뒤에 정한다.
+  if (!sm.is_vat_baking)
+    init_primitive_shaders(sm);
+  sm.is_ready = true;
+
+  // --staging: 다른 모델이 링에 올린 buffer를 같이 쓸 수도 있다.
+  sm.is_geometry_staging = std::any_of(sm.buffer_objects.begin(), sm.buffer_objects.end(),
+    [](GLuint buffer) { return staging_buffers.count(buffer) > 0; });
+  if (sm.is_geometry_staging)
+    return;
+
+  std::chrono::duration<float, std::milli> elapsed = std::chrono::system_clock::now() - sm.start;
+  std::cout << "geometry ready: " << sm.filename << " " << elapsed.count() << " ms" << std::endl;
 }
 
-void draw_scene()
+// draw_mesh()가 이 primitive를 그릴 때 읽는 attribute와 material 값
+unsigned primitive_shader_features(const SceneModel& sm, const tinygltf::Primitive& primitive)
 {
-  const std::vector<tinygltf::Node>& nodes = model.nodes;
-
-  kmuvcl::math::mat4f mat_model;
-  mat_model.set_to_identity();
-  
-  // set object transformation
-  curr = std::chrono::system_clock::now();
-  std::chrono::duration<float> elaped_seconds = (curr - prev);
-  prev = curr;
+  unsigned features = sm.shader_features & SHADER_QUANTIZED;
+  bool has_texcoord = false, has_joints = false, has_weights = false;
+  for (const std::pair<const std::string, int>& attrib : primitive.attributes)
+  {
+    if (attrib.first.compare("NORMAL") == 0)
+      features |= SHADER_NORMAL;
+    else if (attrib.first.compare("COLOR_0") == 0)
+      features |= SHADER_COLOR;
+    else if (attrib.first.compare("TEXCOORD_0") == 0)
+      has_texcoord = true;
+    else if (attrib.first.compare("JOINTS_0") == 0)
+      has_joints = true;
+    else if (attrib.first.compare("WEIGHTS_0") == 0)
+      has_weights = true;
+  }
+  // skin을 쓰는 모델이면 (init_skin_palettes) joint 행렬을 읽는 방법도 모델을 따른다.
+  if (has_joints && has_weights)
+    features |= sm.shader_features & (SHADER_SKIN | SHADER_SKIN_BUFFER);
 
-  if (g_is_animation)
+  if (primitive.material > -1)
   {
-    g_angle += 30.0f * elaped_seconds.count();
-    if (g_angle > 25200.0f)
+    const tinygltf::Material& material = sm.model.materials[primitive.material];
+    for (const std::pair<const std::string, tinygltf::Parameter>& parameter : material.values)
     {
-      g_angle = 0.0f;
+      if (parameter.first.compare("baseColorTexture") == 0 && parameter.second.TextureIndex() > -1 && has_texcoord)
+        features |= SHADER_TEXTURE | (sm.shader_features & SHADER_TEXTURE_ARRAY);
+      else if (parameter.first.compare("baseColorFactor") == 0)
+        features |= SHADER_FACTOR;
     }
   }
-  
-  mat_model = kmuvcl::math::rotate(g_angle*0.7f, 0.0f, 0.0f, 1.0f);
-  mat_model = kmuvcl::math::rotate(g_angle*1.0f, 0.0f, 1.0f, 0.0f)*mat_model;
-  mat_model = kmuvcl::math::rotate(g_angle*0.5f, 1.0f, 0.0f, 0.0f)*mat_model;
-  mat_model = kmuvcl::math::translate(0.0f, 0.0f, -4.0f)*mat_model;
+  return features;
+}
+
+void init_primitive_shaders(SceneModel& sm)
+{
+  std::vector<unsigned> used;
 
-  for (const tinygltf::Scene& scene : model.scenes)
+  sm.primitive_shaders.resize(sm.model.meshes.size());
+  for (size_t i = 0; i < sm.model.meshes.size(); ++i)
   {
-    for (size_t i = 0; i < scene.nodes.size(); ++i)
+    const std::vector<tinygltf::Primitive>& primitives = sm.model.meshes[i].primitives;
+    sm.primitive_shaders[i].resize(primitives.size());
+    for (size_t j = 0; j < primitives.size(); ++j)
     {
-      const tinygltf::Node& node = nodes[scene.nodes[i]];
-      draw_node(node, mat_model);
+      PrimitiveShader& ps = sm.primitive_shaders[i][j];
+      ps.features = primitive_shader_features(sm, primitives[j]);
+      const MorphPrimitive* morph = find_morph(sm, i, j);
+      if (morph && morph->texture != 0)
+        ps.features |= SHADER_MORPH;
+      // --crowd: 구운 primitive는 VAT만 읽는다. (양자화, skin, morph는 구운 결과에 이미 들어 있거나 쓰지 않음)
+      if (sm.vat_texture != 0 && has_baked_primitive(sm, i, j))
+        ps.features = (ps.features & ~(SHADER_QUANTIZED | SHADER_SKIN | SHADER_SKIN_BUFFER | SHADER_MORPH)) | SHADER_VAT;
+      ps.shader = &shader_cache.acquire(ps.features);
+      ps.fallback = &shader_cache.acquire_now(ps.features & fallback_shader_features);
+      if (std::find(used.begin(), used.end(), ps.features) == used.end())
+        used.push_back(ps.features);
     }
   }
 
+  std::printf("shader variants: %zu used, %zu in cache, %zu compiling\n", used.size(), shader_cache.num_programs(),
+    shader_cache.pending());
+  if (shader_cache.pending() == 0)
+    print_shader_stats();
+}
+
+// 처음 실행(컴파일)과 다음 실행(binary 캐시)의 쉐이더 준비 시간을 비교할 수 있게 누적해서 보여 준다.
+void print_shader_stats()
+{
+  std::printf("shader startup: compiled %zu programs, %.1f ms on the render thread%s", shader_cache.compiled(),
+    shader_cache.compile_ms(), shader_cache.parallel_compile() ? " (parallel compile)" : "");
+  if (shader_cache.binary_cache_enabled())
+  {
+    std::printf(", loaded %zu from binaries in %.1f ms", shader_cache.binary_loads(), shader_cache.binary_ms());
+    if (shader_cache.binary_rejects() > 0)
+      std::printf(" (%zu rejected by the driver, recompiled)", shader_cache.binary_rejects());
+  }
+  std::printf("\n");
+}
+
+// 매 프레임 렌더링 전에 호출한다. 오래 걸리는 일(파싱, 디코딩)은 로더의 스레드에서 하고
+// 여기서는 끝난 결과를 GPU로 옮기기만 하므로 로딩/언로딩 중에도 렌더링 루프가 멈추지 않는다.
+void update_scene(size_t texture_budget)
+{
+  // 파싱 중인 파일이 max_parallel_loads보다 적으면 대기 중인 파일의 로딩을 시작한다.
+  size_t parsing = 0;
+  for (const std::unique_ptr<SceneModel>& sm : scene_models)
+  {
+    if (sm->loader && !sm->is_ready && !sm->loader->failed())
+      ++parsing;
+  }
+  for (const std::unique_ptr<SceneModel>& sm : scene_models)
+  {
+    if (parsing >= max_parallel_loads)
+      break;
+    if (sm->loader || sm->is_unloading)
+      continue;
+
+    sm->loader.reset(new AsyncLoader(loader_pool));
+    sm->loader->use_sax_parser(use_sax_parser);
+    sm->loader->set_texture_compression(texture_compression);
+    sm->loader->set_mip_filter(mip_filter);
+    sm->loader->set_texture_packing(pack_textures);
+    sm->loader->set_supported_codecs(gpu_texture_codecs);
+    sm->loader->start(sm->filename);
+    ++parsing;
+  }
+
+  for (size_t i = 0; i < scene_models.size(); )
+  {
+    SceneModel& sm = *scene_models[i];
+
+    // 언로드: 로더의 작업이 모두 끝난 뒤에 GL 객체를 놓고 지운다. (작업이 model을 참조하므로)
+    // 이 모델이 만든 텍스처는 다른 모델도 쓸 수 있으므로 디코딩된 이미지는 끝까지 올린다.
+    if (sm.is_unloading || (sm.loader && sm.loader->failed()))
+    {
+      if (!sm.loader || (sm.loader->idle() && (!sm.is_ready || sm.loader->finished()) &&
+        sm.staged_uploads.empty() && sm.waiting_images.empty() && (!sm.is_vat_baking || sm.is_vat_baked)))
+      {
+        release_gl_objects(sm);
+        std::cout << (sm.is_unloading ? "unloaded: " : "removed: ") << sm.filename << std::endl;
+        scene_models.erase(scene_models.begin() + i);
+        continue;
+      }
+      if (sm.is_ready)
+        texture_budget -= std::min(texture_budget, upload_decoded_textures(sm, texture_budget));
+      ++i;
+      continue;
+    }
+
+    // 파싱이 끝나면 geometry부터 올려서 바로 그린다. (텍스처는 placeholder)
+    if (sm.loader && sm.loader->poll_model(sm.model))
+      init_scene_model(sm);
+
+    // --crowd: 다 구운 VAT를 올리고 나서 쉐이더를 정하고 그리기 시작한다.
+    if (sm.is_vat_baking && sm.is_vat_baked)
+    {
+      finish_crowd(sm);
+      init_primitive_shaders(sm);
+    }
+
+    // 텍스처 업로드 budget은 모든 모델이 나눠 쓴다.
+    if (sm.is_ready && !sm.is_textures_ready)
+    {
+      texture_budget -= std::min(texture_budget, upload_decoded_textures(sm, texture_budget));
+      if (sm.is_geometry_staging && std::none_of(sm.buffer_objects.begin(), sm.buffer_objects.end(),
+        [](GLuint buffer) { return staging_buffers.count(buffer) > 0; }))
+      {
+        sm.is_geometry_staging = false;
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::system_clock::now() - sm.start;
+        std::cout << "geometry ready: " << sm.filename << " " << elapsed.count() << " ms" << std::endl;
+      }
+      if (sm.loader->finished() && sm.staged_uploads.empty() && sm.waiting_images.empty())
+      {
+        if (sm.shader_features & SHADER_TEXTURE_ARRAY)
+          init_texture_arrays(sm);
+        sm.is_textures_ready = true;
+        texture_stats.mip_chains += sm.loader->mip_chain_count();
+        texture_stats.mip_ms += sm.loader->mip_ms();
+        texture_stats.packed += sm.loader->packed_image_count();
+        texture_stats.merged += sm.loader->merged_image_count();
+
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::system_clock::now() - sm.start;
+        std::cout << "textures ready: " << sm.filename << " " << elapsed.count() << " ms" << std::endl;
+        std::printf("  texture VRAM: %.2f MB (%.2f MB as RGBA8)\n", sm.texture_gpu_bytes / 1048576.0,
+          sm.texture_rgba_bytes / 1048576.0);
+        print_texture_stats();
+        if (mip_benchmark)
+          benchmark_mipmaps(sm);
+      }
+    }
+    ++i;
+  }
 }
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
@@ -908,11 +3269,50 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     g_is_animation = !g_is_animation;
     std::cout << (g_is_animation ? "animation" : "no animation") << std::endl;
   }
+
+  // N: 다음 animation clip (마지막 clip 다음은 정지)
+  if (key == GLFW_KEY_N && action == GLFW_PRESS)
+  {
+    size_t num_clips = 0;
+    for (const std::unique_ptr<SceneModel>& sm : scene_models)
+      num_clips = std::max(num_clips, sm->animation_clips.size());
+    g_animation_clip = (g_animation_clip + 1 < int(num_clips)) ? g_animation_clip + 1 : -1;
+    std::cout << "animation clip: " << g_animation_clip << std::endl;
+  }
+
+  // B: --texture-budget의 상주 통계
+  if (key == GLFW_KEY_B && action == GLFW_PRESS && stream_textures)
+    print_streaming_stats();
+  if (key == GLFW_KEY_B && action == GLFW_PRESS && cpu_skinning)
+    print_skinning_stats();
+  if (key == GLFW_KEY_B && action == GLFW_PRESS && crowd_instances > 0)
+    print_crowd_stats();
+
+  // Z: 첫 모델을 하나 더 올림 (GPU 리소스는 공유), X: 마지막에 올린 모델을 내림
+  if (key == GLFW_KEY_Z && action == GLFW_PRESS && !scene_models.empty())
+  {
+    size_t n = scene_models.size();
+    add_scene_model(scene_models[0]->filename,
+      kmuvcl::math::translate<float>(1.5f * n, 0.0f, 0.0f) * scene_models[0]->transform);
+    std::cout << "loading: " << scene_models[0]->filename << std::endl;
+  }
+  if (key == GLFW_KEY_X && action == GLFW_PRESS)
+  {
+    for (size_t i = scene_models.size(); i > 0; --i)
+    {
+      if (!scene_models[i - 1]->is_unloading)
+      {
+        remove_scene_model(scene_models[i - 1].get());
+        break;
+      }
+    }
+  }
 }
 
 int main(int argc, char * argv[])
 {
   GLFWwindow* window;
+  std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
 
   // Initialize GLFW library
   if (!glfwInit())
@@ -935,37 +3335,219 @@ int main(int argc, char * argv[])
 
   // Print out the OpenGL version supported by the graphics card in my PC
   std::cout << glGetString(GL_VERSION) << std::endl;
+
+  use_sampler_objects = GLEW_VERSION_3_3 || GLEW_ARB_sampler_objects;
+  has_palette_blocks = GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object;
+  has_palette_textures = (GLEW_VERSION_3_1 || GLEW_ARB_texture_buffer_object) && GLEW_EXT_gpu_shader4;
+  has_instancing = GLEW_VERSION_3_3 || (GLEW_ARB_draw_instanced && GLEW_ARB_instanced_arrays);
+  if (!use_sampler_objects)
+    std::cout << "WARNING: sampler objects are not supported, using texture parameters" << std::endl;
+
   init_state();
   if(argc<2) std::printf("./실행파일_이름 gltf파일_이름(./test_models 제외)");
-  std::string tmp = argv[1];
-  tmp = "test_models/" + tmp;
-  load_model(model, tmp);
 
-  // GPU의 VBO를 초기화하는 함수 호출
-  init_buffer_objects();
-  init_texture_objects();
-  init_code();
-  init_shader_code(vertex_init+vertex_code, "./shader/vertex.glsl");
-  init_shader_code(frag_init+frag_code, "./shader/fragment.glsl");
-  init_shader_program();
+  // ./final_lab Sponza.gltf --sax : JSON을 DOM 없이 스트리밍으로 파싱
+  // ./final_lab Sponza.gltf --quantize : 정점 attribute를 16-bit로 양자화해서 GPU에 올림
+  // ./final_lab Sponza.gltf --texture-array : 텍스처를 텍스처 배열과 아틀라스로 묶어서 올림
+  // ./final_lab Sponza.gltf --compress : 텍스처를 BC1/3/4/5로 압축해서 올림 (--compress=bc7, --compress=etc2)
+  // ./final_lab Sponza.gltf --mip-filter=kaiser : mip chain을 CPU에서 sRGB를 고려해 만듦 (box, kaiser)
+  // ./final_lab Sponza.gltf --pack-textures : material이 읽는 채널만 남기고 occlusion을 metallicRoughness에 합쳐서 올림
+  // ./final_lab Sponza.gltf --mip-bench : glGenerateMipmap과 CPU mip 생성의 시간, 품질(PSNR) 비교
+  // ./final_lab Sponza.gltf --texture-budget=64 : 텍스처 VRAM을 64 MB 안에서 화면에 필요한 mip level만 올림 (B: 통계)
+  // ./final_lab Sponza.gltf --no-shader-cache : 쉐이더 binary 캐시(shader_cache/)를 쓰지 않고 매번 컴파일
+  // ./final_lab Sponza.gltf --staging=32 : 텍스처와 정점 데이터를 worker가 32 MB persistent-mapped 링에 쓰고 GPU 복사로 올림
+  // ./final_lab BrainStem.gltf --skin-buffer : joint 행렬을 uniform block 대신 텍스처 buffer로 올림
+  // ./final_lab BrainStem.gltf --skin-check : GPU skinning 결과를 transform feedback으로 받아 CPU 기준 구현과 비교
+  // ./final_lab BrainStem.gltf --cpu-skinning : CPU(AVX2, 여러 스레드)에서 skinning해서 매핑한 buffer에 쓰고, AABB로 culling
+  // ./final_lab AnimatedMorphCube.gltf --cpu-morph : morph target을 쉐이더 대신 CPU(SSE)에서 섞음
+  // ./final_lab BrainStem.gltf --crowd=400 : clip을 vertex animation texture로 구워 instance 400개를 instanced draw로 그림 (B: 통계)
+  // ./final_lab BrainStem.gltf --crowd=400 --vat-fps=60 --vat-float : 굽는 간격(기본 30)과 형식 (VRAM과 보간 오차)
+  //     VRAM = 정점 수 * fps * clip 길이(초) * 8바이트 (--vat-float는 32바이트)
+  //     BrainStem(34159 정점, 35초) packed: 15 fps 137 MB/오차 3.6%, 30 fps 273 MB/1.25%, 60 fps 545 MB/0.74%
+  //     (오차는 frame 사이 position의 최대 오차를 bounds 대각선에 대한 비율로, bench_loader --vat)
+  //     10 fps 이하는 빠른 동작에서 10% 넘게 어긋나고, --vat-float는 오차를 거의 줄이지 못하면서 VRAM만 4배가 된다.
+  // ./final_lab Duck/glTF/Duck.gltf Box/glTF/Box.gltf : 여러 파일을 x축으로 나란히 올림
+  std::vector<std::string> filenames;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "--sax")
+      use_sax_parser = true;
+    else if (arg == "--quantize")
+      quantize_vertices = true;
+    else if (arg == "--texture-array")
+      use_texture_arrays = true;
+    else if (arg == "--compress")
+      texture_compression = TEXTURE_COMPRESSION_BC;
+    else if (arg.compare(0, 11, "--compress=") == 0)
+    {
+      if (!parse_texture_compression(arg.substr(11), &texture_compression))
+        std::cout << "unknown texture compression: " << arg.substr(11) << std::endl;
+    }
+    else if (arg.compare(0, 13, "--mip-filter=") == 0)
+    {
+      if (!parse_mip_filter(arg.substr(13), &mip_filter))
+        std::cout << "unknown mip filter: " << arg.substr(13) << std::endl;
+    }
+    else if (arg == "--mip-bench")
+      mip_benchmark = true;
+    else if (arg == "--pack-textures")
+      pack_textures = true;
+    else if (arg.compare(0, 17, "--texture-budget=") == 0)
+    {
+      const double mb = std::atof(arg.c_str() + 17);
+      if (mb > 0.0)
+      {
+        stream_textures = true;
+        texture_streamer.set_budget(size_t(mb * 1048576.0));
+      }
+      else
+      {
+        std::cout << "invalid texture budget: " << arg.substr(17) << std::endl;
+      }
+    }
+    else if (arg == "--no-shader-cache")
+      use_shader_binaries = false;
+    else if (arg == "--staging")
+      staging_ring_bytes = 64 * 1048576;
+    else if (arg == "--skin-buffer")
+      use_palette_textures = true;
+    else if (arg == "--skin-check")
+      skin_check = true;
+    else if (arg == "--cpu-skinning")
+      cpu_skinning = true;
+    else if (arg == "--cpu-morph")
+      cpu_morph = true;
+    else if (arg == "--vat-float")
+      vat_float = true;
+    else if (arg.compare(0, 8, "--crowd=") == 0)
+      crowd_instances = size_t(std::max(0, std::atoi(arg.c_str() + 8)));
+    else if (arg.compare(0, 10, "--vat-fps=") == 0)
+    {
+      const double fps = std::atof(arg.c_str() + 10);
+      if (fps > 0.0)
+        vat_fps = float(fps);
+      else
+        std::cout << "invalid VAT frame rate: " << arg.substr(10) << std::endl;
+    }
+    else if (arg.compare(0, 10, "--staging=") == 0)
+    {
+      const double mb = std::atof(arg.c_str() + 10);
+      if (mb > 0.0)
+        staging_ring_bytes = size_t(mb * 1048576.0);
+      else
+        std::cout << "invalid staging ring size: " << arg.substr(10) << std::endl;
+    }
+    else
+      filenames.push_back("test_models/" + arg);
+  }
+  gpu_texture_codecs = supported_texture_codecs();
+  if (use_texture_arrays && !GLEW_EXT_texture_array && !GLEW_VERSION_3_0)
+  {
+    std::cout << "WARNING: texture arrays are not supported by this GL driver" << std::endl;
+    use_texture_arrays = false;
+  }
+  if (!is_texture_compression_supported(texture_compression))
+  {
+    std::cout << "WARNING: " << texture_compression_name(texture_compression)
+      << " textures are not supported by this GL driver, uploading uncompressed" << std::endl;
+    texture_compression = TEXTURE_COMPRESSION_NONE;
+  }
+  // 배열은 layer마다 swizzle을 다르게 걸 수 없으므로 RGBA8 그대로 올린다.
+  if (pack_textures && use_texture_arrays)
+  {
+    std::cout << "WARNING: --pack-textures is ignored with --texture-array" << std::endl;
+    pack_textures = false;
+  }
+  if (pack_textures && !GLEW_VERSION_3_3 && !GLEW_ARB_texture_swizzle)
+  {
+    std::cout << "WARNING: texture swizzle is not supported by this GL driver, uploading RGBA" << std::endl;
+    pack_textures = false;
+  }
+  // 배열의 layer는 따로 올리고 내릴 수 없다.
+  if (stream_textures && use_texture_arrays)
+  {
+    std::cout << "WARNING: --texture-budget is ignored with --texture-array" << std::endl;
+    stream_textures = false;
+  }
+  // level을 따로 올리려면 RAM에 mip chain이 있어야 한다. (압축하면 압축 결과의 level을 쓴다)
+  if (stream_textures && mip_filter == MIP_FILTER_NONE && texture_compression == TEXTURE_COMPRESSION_NONE)
+  {
+    std::cout << "--texture-budget: generating box mip chains on the loader workers" << std::endl;
+    mip_filter = MIP_FILTER_BOX;
+  }
+  shader_cache.enable_parallel_compile();
+  if (use_shader_binaries && !shader_cache.enable_binary_cache("shader_cache"))
+    std::cout << "WARNING: program binaries are not supported by this GL driver, compiling shaders every run" << std::endl;
+  if (staging_ring_bytes > 0 && !staging_ring.init(staging_ring_bytes))
+    std::cout << "WARNING: persistent mapped buffers are not supported by this GL driver, uploading directly" << std::endl;
+  if (staging_ring.enabled() && stream_textures)
+    std::cout << "--staging: textures are streamed with --texture-budget, staging vertex buffers only" << std::endl;
+
+  // 파싱, buffer 읽기, 이미지 디코딩은 백그라운드에서 하고 렌더링 루프는 바로 시작한다.
+  for (size_t i = 0; i < filenames.size(); ++i)
+  {
+    add_scene_model(filenames[i], kmuvcl::math::translate<float>(1.5f * i, 0.0f, 0.0f));
+  }
+
+  bool is_first_frame = true;
+
   glfwSetKeyCallback(window, key_callback);
-  std::cout<<position_buffer<<std::endl;
   // Loop until the user closes the window
   while (!glfwWindowShouldClose(window))
   {
+    update_scene(texture_upload_budget);
+    // 컴파일이 끝난 쉐이더 variant는 이번 프레임부터 fallback 대신 쓴다.
+    if (shader_cache.update() > 0 && shader_cache.pending() == 0)
+      print_shader_stats();
+
     glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    set_transform();
-    draw_scene();
+    // 카메라는 처음으로 준비된 모델의 것을 쓴다.
+    for (const std::unique_ptr<SceneModel>& sm : scene_models)
+    {
+      if (sm->is_ready && !sm->is_unloading)
+      {
+        set_transform(sm->model);
+        draw_scene();
+        break;
+      }
+    }
+    // 이번 프레임에 그린 텍스처의 요청으로 mip level을 올리고 내린다.
+    if (stream_textures)
+      update_texture_streaming(texture_upload_budget);
+    // 이번 프레임에 낸 링의 복사 명령에 fence를 건다.
+    staging_ring.end_frame();
 
     // Swap front and back buffers
     glfwSwapBuffers(window);
 
+    if (is_first_frame)
+    {
+      is_first_frame = false;
+
+      std::chrono::duration<float, std::milli> elapsed = std::chrono::system_clock::now() - start;
+      std::cout << "first frame: " << elapsed.count() << " ms" << std::endl;
+    }
+
     // Poll for and process events
     glfwPollEvents();
   }
 
+  if (stream_textures)
+    print_streaming_stats();
+
+  // 로더의 작업과 링에 쓰는 작업이 남아 있으면 끝날 때까지 기다린 뒤 GL 객체를 놓는다.
+  loader_pool.wait();
+  for (std::unique_ptr<SceneModel>& sm : scene_models)
+  {
+    sm->loader.reset();
+    release_gl_objects(*sm);
+  }
+  scene_models.clear();
+  shader_cache.release();
+  staging_ring.release();
   glfwTerminate();
 
   return 0;
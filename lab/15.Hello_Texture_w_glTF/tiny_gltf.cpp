@@ -0,0 +1,11 @@
+// tinygltf / stb_image 구현부.
+// 여러 소스 파일이 tiny_gltf.h를 include하므로 구현은 이 파일 한 곳에서만 만든다.
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+// data URI의 base64는 SIMD 디코더(Base64.h)로 푼다.
+#include "Base64.h"
+#define TINYGLTF_BASE64_DECODE(in, len, out) decode_base64(in, len, out)
+
+#include "../glTF/tiny_gltf.h"
@@ -2111,75 +2111,89 @@ bool IsDataURI(const std::string &in) {
   return false;
 }
 
-bool DecodeDataURI(std::vector<unsigned char> *out, std::string &mime_type,
-                   const std::string &in, size_t reqBytes, bool checkSize) {
-  std::string header = "data:application/octet-stream;base64,";
-  std::string data;
-  if (in.find(header) == 0) {
-    data = base64_decode(in.substr(header.size()));  // cut mime string.
-  }
-
-  if (data.empty()) {
-    header = "data:image/jpeg;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "image/jpeg";
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
-    }
-  }
-
-  if (data.empty()) {
-    header = "data:image/png;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "image/png";
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
-    }
+// Decodes `len` base64 characters at `in` directly into `out` and returns the
+// number of bytes written. Decoding stops at the first '=' or non-base64
+// character, like base64_decode(). `out` must hold at least len / 4 * 3 + 3
+// bytes.
+//
+// Define TINYGLTF_BASE64_DECODE(in, len, out) before including this file to
+// provide a faster (e.g. SIMD) decoder with the same contract.
+#ifndef TINYGLTF_BASE64_DECODE
+struct Base64DecodeTable {
+  signed char value[256];
+
+  Base64DecodeTable() {
+    for (int i = 0; i < 256; i++) value[i] = -1;
+    for (int i = 0; i < 64; i++)
+      value[static_cast<unsigned char>(base64_chars[size_t(i)])] =
+          static_cast<signed char>(i);
   }
+};
 
-  if (data.empty()) {
-    header = "data:image/bmp;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "image/bmp";
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
-    }
-  }
+static size_t Base64DecodeTo(const char *in, size_t len, unsigned char *out) {
+  static const Base64DecodeTable table;
+
+  unsigned char *dst = out;
+  unsigned int v = 0;
+  int n = 0;
+  for (size_t i = 0; i < len; i++) {
+    int c = table.value[static_cast<unsigned char>(in[i])];
+    if (c < 0) break;
+    v = (v << 6) | static_cast<unsigned int>(c);
+    if (++n == 4) {
+      *dst++ = static_cast<unsigned char>(v >> 16);
+      *dst++ = static_cast<unsigned char>(v >> 8);
+      *dst++ = static_cast<unsigned char>(v);
+      v = 0;
+      n = 0;
+    }
+  }
+  if (n >= 2) {
+    v <<= 6 * (4 - n);
+    *dst++ = static_cast<unsigned char>(v >> 16);
+    if (n == 3) *dst++ = static_cast<unsigned char>(v >> 8);
+  }
+  return size_t(dst - out);
+}
+#define TINYGLTF_BASE64_DECODE(in, len, out) Base64DecodeTo(in, len, out)
+#endif
 
-  if (data.empty()) {
-    header = "data:image/gif;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "image/gif";
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
-    }
-  }
+bool DecodeDataURI(std::vector<unsigned char> *out, std::string &mime_type,
+                   const std::string &in, size_t reqBytes, bool checkSize) {
+  // {header, mime type}. An empty mime type leaves `mime_type` unchanged.
+  static const char *const kHeaders[][2] = {
+      {"data:application/octet-stream;base64,", ""},
+      {"data:image/jpeg;base64,", "image/jpeg"},
+      {"data:image/png;base64,", "image/png"},
+      {"data:image/bmp;base64,", "image/bmp"},
+      {"data:image/gif;base64,", "image/gif"},
+      {"data:text/plain;base64,", "text/plain"},
+      {"data:application/gltf-buffer;base64,", ""},
+  };
 
-  if (data.empty()) {
-    header = "data:text/plain;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "text/plain";
-      data = base64_decode(in.substr(header.size()));
-    }
-  }
+  for (size_t h = 0; h < sizeof(kHeaders) / sizeof(kHeaders[0]); h++) {
+    const size_t header_len = strlen(kHeaders[h][0]);
+    if (in.compare(0, header_len, kHeaders[h][0]) != 0) continue;
 
-  if (data.empty()) {
-    header = "data:application/gltf-buffer;base64,";
-    if (in.find(header) == 0) {
-      data = base64_decode(in.substr(header.size()));
-    }
-  }
+    // Decode straight into the output storage (no substr/std::string copies).
+    // It is swapped into `out` only on success.
+    const size_t len = in.size() - header_len;
+    std::vector<unsigned char> data(len / 4 * 3 + 3);
+    const size_t size =
+        TINYGLTF_BASE64_DECODE(in.data() + header_len, len, data.data());
+    if (size == 0) continue;
 
-  if (data.empty()) {
-    return false;
-  }
+    if (kHeaders[h][1][0] != '\0') mime_type = kHeaders[h][1];
 
-  if (checkSize) {
-    if (data.size() != reqBytes) {
+    if (checkSize && size != reqBytes) {
       return false;
     }
-    out->resize(reqBytes);
-  } else {
-    out->resize(data.size());
+    data.resize(size);
+    out->swap(data);
+    return true;
   }
-  std::copy(data.begin(), data.end(), out->begin());
-  return true;
+
+  return false;
 }
 
 static bool ParseJsonAsValue(Value *ret, const json &o) {
@@ -4035,7 +4049,12 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
         }
 
         auto bufferView = model->accessors[primitive.indices].bufferView;
-        if (bufferView < 0 || size_t(bufferView) >= model->bufferViews.size()) {
+        if (bufferView < 0) {
+          // bufferView can be omitted when the data comes from an extension
+          // such as KHR_draco_mesh_compression.
+          continue;
+        }
+        if (size_t(bufferView) >= model->bufferViews.size()) {
           if (err) {
             (*err) += "accessor[" + std::to_string(primitive.indices) +
                       "] invalid bufferView";